@@ -0,0 +1,250 @@
+#pragma once
+#include "MatlabAPI_base.h"
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+#include <initializer_list>
+
+namespace MatlabAPI
+{
+	/**
+	 * @brief Element types that MatlabArray::view<T>() gives access to
+	 */
+	enum class ArrayElementType
+	{
+		Double,
+		Single,
+		Int8,
+		Uint8,
+		Int16,
+		Uint16,
+		Int32,
+		Uint32,
+		Int64,
+		Uint64,
+		Logical
+	};
+
+	template<typename T>
+	struct ArrayElementTypeOf;
+	template<> struct ArrayElementTypeOf<double>   { static constexpr ArrayElementType value = ArrayElementType::Double; };
+	template<> struct ArrayElementTypeOf<float>    { static constexpr ArrayElementType value = ArrayElementType::Single; };
+	template<> struct ArrayElementTypeOf<int8_t>   { static constexpr ArrayElementType value = ArrayElementType::Int8; };
+	template<> struct ArrayElementTypeOf<uint8_t>  { static constexpr ArrayElementType value = ArrayElementType::Uint8; };
+	template<> struct ArrayElementTypeOf<int16_t>  { static constexpr ArrayElementType value = ArrayElementType::Int16; };
+	template<> struct ArrayElementTypeOf<uint16_t> { static constexpr ArrayElementType value = ArrayElementType::Uint16; };
+	template<> struct ArrayElementTypeOf<int32_t>  { static constexpr ArrayElementType value = ArrayElementType::Int32; };
+	template<> struct ArrayElementTypeOf<uint32_t> { static constexpr ArrayElementType value = ArrayElementType::Uint32; };
+	template<> struct ArrayElementTypeOf<int64_t>  { static constexpr ArrayElementType value = ArrayElementType::Int64; };
+	template<> struct ArrayElementTypeOf<uint64_t> { static constexpr ArrayElementType value = ArrayElementType::Uint64; };
+	template<> struct ArrayElementTypeOf<bool>     { static constexpr ArrayElementType value = ArrayElementType::Logical; };
+
+	/**
+	 * @brief Non-owning N-d view over column-major array data.
+	 *
+	 * Element (i0, i1, ..., in) is at data()[i0 * stride0 + i1 * stride1 + ...]. A view
+	 * returned by MatlabArray::view<T>() is contiguous (stride0 = 1, stride1 = rows, ...);
+	 * row(), col(), slice() and transposed() return strided views onto the same memory.
+	 * at() checks the bounds, operator() and operator[] do not.
+	 *
+	 * T is const for read-only views. A view does not keep the data alive, it is valid as long
+	 * as the array it was taken from is neither destroyed nor resized.
+	 */
+	template<typename T>
+	class ArrayView
+	{
+	public:
+		using value_type = typename std::remove_const<T>::type;
+
+		ArrayView() = default;
+
+		/**
+		 * @brief Contiguous column-major view
+		 */
+		ArrayView(T* data, const std::vector<size_t>& dimensions)
+			: m_data(data)
+			, m_dimensions(dimensions)
+			, m_strides(dimensions.size())
+		{
+			size_t stride = 1;
+			for (size_t i = 0; i < m_dimensions.size(); ++i)
+			{
+				m_strides[i] = stride;
+				stride *= m_dimensions[i];
+			}
+			m_size = m_dimensions.empty() ? 0 : stride;
+			m_contiguous = true;
+		}
+		ArrayView(T* data, const std::vector<size_t>& dimensions, const std::vector<size_t>& strides)
+			: m_data(data)
+			, m_dimensions(dimensions)
+			, m_strides(strides)
+		{
+			if (m_strides.size() != m_dimensions.size())
+				throw std::invalid_argument("ArrayView: " + std::to_string(m_dimensions.size()) + " dimensions but "
+											+ std::to_string(m_strides.size()) + " strides");
+			m_size = m_dimensions.empty() ? 0 : 1;
+			size_t expected = 1;
+			m_contiguous = true;
+			for (size_t i = 0; i < m_dimensions.size(); ++i)
+			{
+				m_size *= m_dimensions[i];
+				m_contiguous &= m_dimensions[i] == 1 || m_strides[i] == expected;
+				expected *= m_dimensions[i];
+			}
+		}
+
+		// Mutable views convert to read-only views
+		template<typename U, typename = typename std::enable_if<std::is_same<const U, T>::value && !std::is_same<U, T>::value>::type>
+		ArrayView(const ArrayView<U>& other)
+			: ArrayView(other.data(), other.getDimensions(), other.getStrides())
+		{}
+
+		T* data() const { return m_data; }
+		size_t size() const { return m_size; }
+		bool empty() const { return m_size == 0; }
+
+		/**
+		 * @brief true if the elements are stored without gaps in column-major order
+		 */
+		bool isContiguous() const { return m_contiguous; }
+
+		size_t getNumberOfDimensions() const { return m_dimensions.size(); }
+		const std::vector<size_t>& getDimensions() const { return m_dimensions; }
+		const std::vector<size_t>& getStrides() const { return m_strides; }
+
+		/**
+		 * @brief Extent of dimension d, 1 for trailing dimensions as in MATLAB
+		 */
+		size_t getDimension(size_t d) const { return d < m_dimensions.size() ? m_dimensions[d] : 1; }
+		size_t getRows() const { return m_dimensions.empty() ? 0 : m_dimensions[0]; }
+
+		/**
+		 * @brief Product of all dimensions beyond the first
+		 */
+		size_t getCols() const
+		{
+			if (m_dimensions.size() < 2)
+				return m_dimensions.empty() ? 0 : 1;
+			size_t cols = 1;
+			for (size_t i = 1; i < m_dimensions.size(); ++i)
+				cols *= m_dimensions[i];
+			return cols;
+		}
+
+		/**
+		 * @brief Element at a linear column-major index, as A(index + 1) in MATLAB
+		 */
+		T& operator[](size_t index) const
+		{
+			if (m_contiguous)
+				return m_data[index];
+			size_t offset = 0;
+			for (size_t i = 0; i < m_dimensions.size(); ++i)
+			{
+				offset += (index % m_dimensions[i]) * m_strides[i];
+				index /= m_dimensions[i];
+			}
+			return m_data[offset];
+		}
+		T& operator()(size_t row, size_t col) const
+		{
+			return m_data[row * m_strides[0] + col * (m_strides.size() > 1 ? m_strides[1] : 0)];
+		}
+
+		/**
+		 * @brief Bounds checked access with one index per dimension, trailing indices may be omitted
+		 */
+		template<typename... Indices>
+		T& at(Indices... indices) const
+		{
+			return m_data[getOffset({ static_cast<size_t>(indices)... })];
+		}
+
+		/**
+		 * @brief Row r, strided by the number of rows (slice along the first dimension)
+		 */
+		ArrayView row(size_t r) const { return slice(0, r); }
+
+		/**
+		 * @brief Column c (slice along the second dimension)
+		 */
+		ArrayView col(size_t c) const { return slice(1, c); }
+
+		/**
+		 * @brief View with dimension d fixed to index, the dimension is kept with extent 1
+		 */
+		ArrayView slice(size_t d, size_t index) const
+		{
+			if (d >= m_dimensions.size())
+				throw std::out_of_range("ArrayView: dimension " + std::to_string(d) + " of a " + std::to_string(m_dimensions.size()) + "-d view");
+			checkIndex(d, index);
+			std::vector<size_t> dimensions = m_dimensions;
+			std::vector<size_t> strides = m_strides;
+			dimensions[d] = 1;
+			return ArrayView(m_data + index * m_strides[d], dimensions, strides);
+		}
+
+		/**
+		 * @brief Matrix transpose without copying, the view must have two dimensions
+		 */
+		ArrayView transposed() const
+		{
+			if (m_dimensions.size() != 2)
+				throw std::invalid_argument("ArrayView: transposed() needs a 2-d view, not " + std::to_string(m_dimensions.size()) + "-d");
+			return ArrayView(m_data, { m_dimensions[1], m_dimensions[0] }, { m_strides[1], m_strides[0] });
+		}
+
+		/**
+		 * @brief Copies the elements in column-major order
+		 */
+		std::vector<value_type> toVector() const
+		{
+			if (m_contiguous)
+				return std::vector<value_type>(m_data, m_data + m_size);
+			std::vector<value_type> values;
+			values.reserve(m_size);
+			for (size_t i = 0; i < m_size; ++i)
+				values.push_back((*this)[i]);
+			return values;
+		}
+
+	private:
+		size_t getOffset(std::initializer_list<size_t> indices) const
+		{
+			if (indices.size() > m_dimensions.size())
+			{
+				// Extra indices beyond the last dimension must be 0, as in MATLAB
+				size_t d = 0;
+				for (size_t index : indices)
+					if (d++ >= m_dimensions.size() && index != 0)
+						throw std::out_of_range("ArrayView: index " + std::to_string(index) + " exceeds dimension " + std::to_string(d - 1));
+			}
+			size_t offset = 0;
+			size_t d = 0;
+			for (size_t index : indices)
+			{
+				if (d >= m_dimensions.size())
+					break;
+				checkIndex(d, index);
+				offset += index * m_strides[d];
+				++d;
+			}
+			return offset;
+		}
+		void checkIndex(size_t d, size_t index) const
+		{
+			if (m_dimensions.empty() || index >= getDimension(d))
+				throw std::out_of_range("ArrayView: index " + std::to_string(index) + " out of range for dimension " + std::to_string(d)
+										+ " of size " + std::to_string(getDimension(d)));
+		}
+
+		T* m_data = nullptr;
+		std::vector<size_t> m_dimensions;
+		std::vector<size_t> m_strides;
+		size_t m_size = 0;
+		bool m_contiguous = true;
+	};
+}
@@ -0,0 +1,153 @@
+#pragma once
+#include "MatlabAPI_base.h"
+#include "math/Matrix.h"
+#include <string>
+#include <vector>
+#include <functional>
+#include <type_traits>
+#include <cstring>
+#include <cstdint>
+
+namespace MatlabAPI
+{
+	/**
+	 * @brief Transfers large numeric arrays through a memory-mapped file instead of the engine connection.
+	 *
+	 * The data is written into a mapped file and MATLAB reads it with memmapfile, only the
+	 * file path and the dimensions travel through the engine. On Linux the file is placed in
+	 * /dev/shm, so it lives in shared memory and never touches the disk.
+	 * This pays off for arrays of several megabytes, small arrays are faster with MatlabEngine::addVariable().
+	 * Variables transferred this way are not registered in the variable map of the engine.
+	 *
+	 * Example:
+	 * @code
+	 * BulkTransfer::Region region = BulkTransfer::allocate<double>("log", samples, channels);
+	 * readLog(region.data<double>()); // fill the mapped memory directly, column-major
+	 * region.commit();
+	 * @endcode
+	 */
+	class MATLAB_API BulkTransfer
+	{
+		struct Mapping;
+	public:
+		enum class Layout
+		{
+			ColumnMajor, // MATLAB order
+			RowMajor     // C order, transposed by MATLAB after the transfer
+		};
+
+		/**
+		 * @brief Writable mapped memory for one variable.
+		 *        The caller fills data() and commit() creates the MATLAB variable from it,
+		 *        so the only copy of the data is made by MATLAB itself.
+		 */
+		class MATLAB_API Region
+		{
+			friend class BulkTransfer;
+		public:
+			Region(Region&& other) noexcept;
+			Region& operator=(Region&& other) noexcept;
+			Region(const Region&) = delete;
+			Region& operator=(const Region&) = delete;
+
+			/**
+			 * @brief Discards the region if it was not committed
+			 */
+			~Region();
+
+			bool isValid() const { return m_data != nullptr || (m_mapping && m_rows * m_cols == 0); }
+			void* data() { return m_data; }
+			template<typename T>
+			T* data() { return static_cast<T*>(m_data); }
+
+			size_t getRows() const { return m_rows; }
+			size_t getCols() const { return m_cols; }
+			size_t getSizeInBytes() const { return m_rows * m_cols * m_elementSize; }
+
+			/**
+			 * @brief Creates the MATLAB variable from the content of the region and releases the region
+			 * @return true on success
+			 */
+			bool commit();
+
+		private:
+			Region() = default;
+			void release();
+
+			std::string m_name;
+			const char* m_className = nullptr;
+			size_t m_elementSize = 0;
+			size_t m_rows = 0;
+			size_t m_cols = 0;
+			Layout m_layout = Layout::ColumnMajor;
+			Mapping* m_mapping = nullptr;
+			void* m_data = nullptr;
+		};
+
+		/**
+		 * @brief Creates a mapped region for a rows x cols variable of type T
+		 * @return invalid region on error
+		 */
+		template<typename T>
+		static Region allocate(const std::string& name, size_t rows, size_t cols, Layout layout = Layout::ColumnMajor)
+		{
+			return allocate(name, className<T>(), sizeof(T), rows, cols, layout);
+		}
+
+		/**
+		 * @brief Copies data into a mapped region and creates the MATLAB variable name from it
+		 */
+		template<typename T>
+		static bool send(const std::string& name, const T* data, size_t rows, size_t cols, Layout layout = Layout::ColumnMajor)
+		{
+			Region region = allocate<T>(name, rows, cols, layout);
+			if (!region.isValid())
+				return false;
+			if (region.getSizeInBytes() > 0)
+				std::memcpy(region.data(), data, region.getSizeInBytes());
+			return region.commit();
+		}
+		static bool send(const std::string& name, const Matrix& matrix)
+		{
+			return send(name, matrix.data(), matrix.getRows(), matrix.getCols(), Layout::RowMajor);
+		}
+
+		/**
+		 * @brief Reads a 2-D numeric variable through a mapped file.
+		 *        MATLAB converts the values to T.
+		 * @param data receives the values in column-major order
+		 * @return false if the variable does not exist or is not a numeric matrix
+		 */
+		template<typename T>
+		static bool receive(const std::string& name, std::vector<T>& data, size_t& rows, size_t& cols)
+		{
+			return receive(name, className<T>(), sizeof(T), false, [&](size_t r, size_t c) -> void* {
+				rows = r;
+				cols = c;
+				data.resize(r * c);
+				return data.data();
+				});
+		}
+		static Matrix receiveMatrix(const std::string& name);
+
+	private:
+		template<typename T>
+		static const char* className()
+		{
+			static_assert(std::is_arithmetic<T>::value && !std::is_same<T, bool>::value, "BulkTransfer supports numeric types only");
+			static_assert(sizeof(T) <= 8, "MATLAB has no numeric type wider than 64 bit");
+			if constexpr (std::is_floating_point<T>::value)
+				return sizeof(T) == 4 ? "single" : "double";
+			else if constexpr (std::is_signed<T>::value)
+				return sizeof(T) == 1 ? "int8" : sizeof(T) == 2 ? "int16" : sizeof(T) == 4 ? "int32" : "int64";
+			else
+				return sizeof(T) == 1 ? "uint8" : sizeof(T) == 2 ? "uint16" : sizeof(T) == 4 ? "uint32" : "uint64";
+		}
+
+		static Region allocate(const std::string& name, const char* className, size_t elementSize, size_t rows, size_t cols, Layout layout);
+
+		// allocator receives the dimensions and returns the destination buffer, or nullptr to abort
+		static bool receive(const std::string& name, const char* className, size_t elementSize, bool transpose,
+			const std::function<void* (size_t rows, size_t cols)>& allocator);
+	};
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include "MatlabAPI_base.h"
+#include "MatlabArray.h"
+#include "MatlabEngine.h"
+#include "math/Matrix.h"
+#include <string>
+#include <functional>
+#include <cstddef>
+
+namespace MatlabAPI
+{
+	/**
+	 * @brief Transfers large arrays through the engine in blocks of rows, so that the memory needed
+	 *        besides the data itself does not grow with the size of the array.
+	 *
+	 * send() preallocates the variable in the engine with the first block and writes the others
+	 * into it with indexed assignments (MatlabEngine::setVariableSlice()), receive() reads the
+	 * variable block by block. A block holds about chunkSize bytes, at least one row.
+	 * Two blocks are in flight on the engine thread while the next one is produced or the previous
+	 * one is consumed, so local processing overlaps with the transfers and the extra memory is
+	 * about three blocks. Sending a Matrix this way needs no column-major copy of the whole matrix.
+	 * Variables transferred this way are not registered in the variable map of the engine.
+	 *
+	 * Example, streaming a file into MATLAB with 3 x 16 MB of buffers:
+	 * @code
+	 * ChunkedTransfer::send("data", rows, channels, sizeof(int16_t), [&](size_t first, size_t count) {
+	 *     ArrayBuffer<int16_t> buffer = MatlabArray::createBuffer<int16_t>(count * channels);
+	 *     readColumnMajor(file, first, count, buffer.data());
+	 *     return MatlabArray("data", std::move(buffer), { count, channels });
+	 * });
+	 * @endcode
+	 */
+	class MATLAB_API ChunkedTransfer
+	{
+	public:
+		static constexpr size_t defaultChunkSize = 16 * 1024 * 1024; // bytes per block
+
+		/**
+		 * @brief Returns rows [first, first + count) as a count x cols array, all blocks must have the same class.
+		 *        Called with count 0 for an array without rows.
+		 */
+		using RowProducer = std::function<MatlabArray(size_t first, size_t count)>;
+
+		/**
+		 * @brief Receives rows [first, first + rows.getM()) in ascending order, returns false to stop the transfer
+		 */
+		using RowConsumer = std::function<bool(size_t first, const MatlabArray& rows)>;
+
+		/**
+		 * @brief Creates the rows x cols variable name from the blocks returned by produce
+		 * @param elementSize bytes per element, sizes the blocks
+		 * @return false if a block is invalid or a transfer failed, the variable is incomplete then
+		 */
+		static bool send(const std::string& name, size_t rows, size_t cols, size_t elementSize, const RowProducer& produce,
+			size_t chunkSize = defaultChunkSize);
+		static bool send(const std::string& name, const Matrix& matrix, size_t chunkSize = defaultChunkSize);
+
+		/**
+		 * @brief Reads a numeric or logical variable block by block, dimensions beyond the second are folded into the columns
+		 * @return false if the variable does not exist, a transfer failed or consume returned false
+		 */
+		static bool receive(const std::string& name, const RowConsumer& consume, size_t chunkSize = defaultChunkSize);
+
+		/**
+		 * @return the variable converted to double, an empty matrix on error
+		 */
+		static Matrix receiveMatrix(const std::string& name, size_t chunkSize = defaultChunkSize);
+
+		/**
+		 * @brief Rows per block for rows of rowBytes bytes, at least 1
+		 */
+		static size_t getRowsPerChunk(size_t rowBytes, size_t chunkSize);
+
+	private:
+		static bool receive(const MatlabEngine::RemoteVariable& variable, const RowConsumer& consume, size_t chunkSize);
+	};
+}
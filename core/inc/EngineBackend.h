@@ -0,0 +1,180 @@
+#pragma once
+#include "MatlabAPI_base.h"
+#include "MatlabArray.h"
+#include <vector>
+#include <string>
+#include <memory>
+#include <functional>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace MatlabAPI
+{
+	/**
+	 * @brief Connection to something that executes MATLAB commands.
+	 *
+	 * MatlabEngine and EnginePool talk to MATLAB only through this interface.
+	 * createNative() returns the backend for the compiled-in engine API (C or C++),
+	 * InProcessBackend is a stand-in without MATLAB for tests and benchmarks.
+	 *
+	 * The public functions count every call as one round trip and measure the time
+	 * spent in the backend, the implementations are provided by the protected do... functions.
+	 * A backend is used by one thread at a time, only cancel() and the statistics may be
+	 * called from other threads.
+	 */
+	class MATLAB_API EngineBackend
+	{
+	public:
+		struct Statistics
+		{
+			size_t roundTrips = 0; // sum of all calls below
+			size_t evals = 0;
+			size_t fevals = 0;
+			size_t puts = 0;
+			size_t gets = 0;
+			size_t errors = 0;
+			std::chrono::nanoseconds busyTime{ 0 }; // time spent inside the backend
+		};
+
+		/**
+		 * @brief Metadata of a workspace variable as reported by whos
+		 */
+		struct VariableInfo
+		{
+			std::string className;           // MATLAB class, "double", "cell", ...
+			std::vector<size_t> dimensions;
+			bool complex = false;
+			bool sparse = false;
+			size_t bytes = 0;                // memory used by MATLAB
+
+			size_t getRows() const { return dimensions.empty() ? 0 : dimensions[0]; }
+			size_t getCols() const;          // product of all dimensions beyond the first
+			size_t getNumberOfElements() const;
+		};
+
+		/**
+		 * @brief Part of a variable written by setVariableSlice()
+		 */
+		enum class Slice
+		{
+			Rows,     // name(first+1:first+m, :) = values, values has the columns of name
+			Columns,  // name(:, first+1:first+n) = values, values has the rows of name
+			Elements  // name(first+1:first+numel(values)) = values, a contiguous range in column-major order
+		};
+
+		EngineBackend();
+		virtual ~EngineBackend();
+
+		EngineBackend(const EngineBackend&) = delete;
+		EngineBackend& operator=(const EngineBackend&) = delete;
+
+		/**
+		 * @brief Starts or connects to MATLAB using the compiled-in engine API
+		 * @param startcmd name of a shared session to connect to, empty to start a new MATLAB process
+		 * @param singleUse start a MATLAB process that is not shared with other engines
+		 *        (only relevant for the C engine API on Windows)
+		 * @return nullptr if MATLAB could not be started
+		 */
+		static std::unique_ptr<EngineBackend> createNative(const std::u16string& startcmd, bool singleUse = false);
+
+		virtual std::string getName() const = 0;
+
+		/**
+		 * @brief true for backends that talk to a real MATLAB process
+		 */
+		virtual bool isNative() const { return false; }
+
+		/**
+		 * @return 0 on success, -1 on error
+		 */
+		int eval(const std::string& command);
+
+		/**
+		 * @return the return values, empty on error
+		 */
+		std::vector<MatlabArray> feval(const std::string& function, size_t nargout, const std::vector<MatlabArray>& args);
+		bool setVariable(const std::string& name, const MatlabArray& value);
+
+		/**
+		 * @return the value named name, an invalid array on error
+		 */
+		MatlabArray getVariable(const std::string& name);
+		MatlabArray getProperty(const MatlabArray& object, const std::string& property);
+
+		/**
+		 * @brief Queries class, size and memory of a variable without transferring its data
+		 * @return false if the variable does not exist
+		 */
+		bool getVariableInfo(const std::string& name, VariableInfo& info);
+
+		/**
+		 * @brief Reads rows [first, first + count) of a numeric or logical variable, only these rows are transferred.
+		 *        Dimensions beyond the second are folded into the columns, as name(first+1:first+count, :) in MATLAB.
+		 * @return a count x columns array, an invalid array on error
+		 */
+		MatlabArray getVariableRows(const std::string& name, size_t first, size_t count);
+
+		/**
+		 * @brief Writes values into a part of the existing variable name with one indexed assignment,
+		 *        only values is transferred. As in MATLAB the variable grows with zeros if the slice
+		 *        reaches beyond its end. Dimensions beyond the second are folded into the columns.
+		 * @return false if the variable does not exist or the sizes do not fit
+		 */
+		bool setVariableSlice(const std::string& name, Slice slice, size_t first, const MatlabArray& values);
+
+		/**
+		 * @brief Sets the number of rows of a numeric or logical variable, as name(rows, :) = 0 or
+		 *        name(rows+1:end, :) = [] in MATLAB. New rows are zero, the columns are kept.
+		 */
+		bool resizeVariableRows(const std::string& name, size_t rows);
+
+		/**
+		 * @brief Number of operations started so far, operation ids count from 1
+		 */
+		uint64_t getOperationCount() const { return m_operationCount; }
+
+		/**
+		 * @brief listener gets called with the id of every operation when it starts, on the thread that
+		 *        starts it and before the operation runs. Binds cancel() to the operation a caller is
+		 *        about to start. nullptr removes the listener.
+		 */
+		void setOperationListener(std::function<void(uint64_t operation)> listener) { m_operationListener = std::move(listener); }
+
+		/**
+		 * @brief Interrupts the operation with the given id if it is still running.
+		 *        Can be called from any thread.
+		 * @return true if the operation was interrupted
+		 */
+		bool cancel(uint64_t operation);
+
+		Statistics getStatistics() const;
+		void resetStatistics();
+
+	protected:
+		virtual int doEval(const std::string& command) = 0;
+		virtual std::vector<MatlabArray> doFeval(const std::string& function, size_t nargout, const std::vector<MatlabArray>& args) = 0;
+		virtual bool doSetVariable(const std::string& name, const MatlabArray& value) = 0;
+		virtual MatlabArray doGetVariable(const std::string& name) = 0;
+		virtual MatlabArray doGetProperty(const MatlabArray& object, const std::string& property);
+		// The default implementations evaluate whos and indexing expressions with a temporary variable,
+		// they only accept plain variable names
+		virtual bool doGetVariableInfo(const std::string& name, VariableInfo& info);
+		virtual MatlabArray doGetVariableRows(const std::string& name, size_t first, size_t count);
+		virtual bool doSetVariableSlice(const std::string& name, Slice slice, size_t first, const MatlabArray& values);
+		virtual bool doResizeVariableRows(const std::string& name, size_t rows);
+		virtual bool doCancel() { return false; }
+
+	private:
+		class Operation;
+
+		std::atomic<uint64_t> m_operationCount{ 0 };
+		std::mutex m_operationMutex;
+		uint64_t m_runningOperation = 0;
+		std::function<void(uint64_t)> m_operationListener;
+
+		mutable std::mutex m_statisticsMutex;
+		Statistics m_statistics;
+	};
+}
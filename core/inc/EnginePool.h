@@ -0,0 +1,178 @@
+#pragma once
+#include "MatlabAPI_base.h"
+#include "MatlabArray.h"
+#include "EngineBackend.h"
+#include "math/Matrix.h"
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <atomic>
+#include <stdexcept>
+#include <type_traits>
+
+namespace MatlabAPI
+{
+	/**
+	 * @brief Pool of independent MATLAB sessions that execute jobs in parallel.
+	 *
+	 * Each session runs in its own MATLAB process (or backend) and is driven by its own worker thread.
+	 * Jobs are queued and picked up by the next idle session. After each job the workspace
+	 * of the session is cleared, so every job starts with an empty, isolated workspace.
+	 * The pool is independent of the MatlabEngine singleton.
+	 */
+	class MATLAB_API EnginePool
+	{
+	public:
+		/**
+		 * @brief Handle to one MATLAB session, passed to the jobs.
+		 *        Only valid during the execution of the job.
+		 */
+		class MATLAB_API Session
+		{
+			friend class EnginePool;
+		public:
+			size_t getIndex() const { return m_index; }
+
+			/**
+			 * @brief Evaluates a command in the workspace of this session
+			 * @return 0 on success, -1 on error
+			 */
+			int eval(const std::string& command);
+
+			bool setVariable(const std::string& name, const MatlabArray& value);
+			bool setVariable(const std::string& name, const Matrix& value);
+			MatlabArray getVariable(const std::string& name);
+			Matrix getMatrix(const std::string& name);
+
+			/**
+			 * @brief Removes all variables from the workspace of this session
+			 */
+			void clearWorkspace();
+
+			EngineBackend& getBackend() { return *m_backend; }
+
+		private:
+			Session(size_t index);
+			~Session();
+
+			bool open(std::unique_ptr<EngineBackend> backend);
+			void close();
+			bool isOpen() const;
+
+			size_t m_index;
+			std::unique_ptr<EngineBackend> m_backend;
+		};
+
+		/**
+		 * @brief Creates the backend of the session with the given index, nullptr on error.
+		 *        Called by the worker thread of the session.
+		 */
+		typedef std::function<std::unique_ptr<EngineBackend>(size_t index)> BackendFactory;
+
+		/**
+		 * @brief Starts sessionCount new MATLAB sessions in parallel
+		 * @param sessionCount number of MATLAB sessions
+		 */
+		explicit EnginePool(size_t sessionCount);
+
+		/**
+		 * @brief Connects to already running shared MATLAB sessions (see matlab.engine.shareEngine)
+		 * @param sessionNames one session is created for each name
+		 */
+		explicit EnginePool(const std::vector<std::u16string>& sessionNames);
+
+		/**
+		 * @brief Creates sessionCount sessions with backends from createBackend,
+		 *        for example InProcessBackends for tests
+		 */
+		EnginePool(size_t sessionCount, BackendFactory createBackend);
+		~EnginePool();
+
+		EnginePool(const EnginePool&) = delete;
+		EnginePool& operator=(const EnginePool&) = delete;
+
+		/**
+		 * @brief Queues a job which gets executed by the next idle session
+		 * @param job callable with the signature R(Session&)
+		 * @return future which receives the return value or the exception thrown by the job.
+		 *         Receives a std::runtime_error if the job is dropped without running,
+		 *         because no session could be started or the pool is destroyed.
+		 */
+		template<typename Func>
+		auto submit(Func&& job) -> std::future<decltype(job(std::declval<Session&>()))>
+		{
+			typedef decltype(job(std::declval<Session&>())) R;
+			auto task = std::make_shared<typename std::decay<Func>::type>(std::forward<Func>(job));
+			auto promise = std::make_shared<std::promise<R>>();
+			std::future<R> future = promise->get_future();
+			Job queued;
+			queued.run = [task, promise](Session& session) {
+				try {
+					if constexpr (std::is_void<R>::value)
+					{
+						(*task)(session);
+						promise->set_value();
+					}
+					else
+						promise->set_value((*task)(session));
+				}
+				catch (...) {
+					promise->set_exception(std::current_exception());
+				}
+			};
+			queued.fail = [promise](const std::string& reason) {
+				promise->set_exception(std::make_exception_ptr(std::runtime_error(reason)));
+			};
+			enqueue(std::move(queued));
+			return future;
+		}
+
+		/**
+		 * @brief Blocks until all queued jobs are finished
+		 */
+		void waitForAll();
+
+		/**
+		 * @brief Blocks until all sessions have finished starting
+		 * @return number of sessions that could be started
+		 */
+		size_t waitForStartup();
+
+		size_t getSessionCount() const { return m_sessions.size(); }
+		size_t getIdleSessionCount() const { return m_idleCount.load(); }
+		size_t getQueuedJobCount() const;
+
+	private:
+		struct Job
+		{
+			std::function<void(Session&)> run;
+			std::function<void(const std::string&)> fail; // completes the future of a job that never runs
+		};
+
+		void start(size_t sessionCount);
+		void enqueue(Job&& job);
+		void workerLoop(Session* session);
+		static void failJobs(std::deque<Job>& jobs, const std::string& reason);
+
+		BackendFactory m_createBackend;
+
+		std::vector<Session*> m_sessions;
+		std::vector<std::thread> m_workers;
+
+		mutable std::mutex m_mutex;
+		std::condition_variable m_jobAvailable;
+		std::condition_variable m_stateChanged;
+		std::deque<Job> m_jobs;
+		size_t m_runningJobs = 0;
+		size_t m_startedSessions = 0;
+		size_t m_pendingStartups = 0;
+		std::atomic<size_t> m_idleCount;
+		bool m_stop = false;
+	};
+}
@@ -0,0 +1,136 @@
+#pragma once
+#include "MatlabAPI_base.h"
+#include <array>
+#include <map>
+#include <string>
+#include <chrono>
+#include <cstdint>
+
+namespace MatlabAPI
+{
+	/**
+	 * @brief Call counts, latency histograms and transferred bytes of the MATLAB engine calls.
+	 *
+	 * MatlabEngine records every eval, feval, addVariable, getVariable, removeVariable,
+	 * sendVariableToEngine and updateVariableFromEngine call, per operation and per variable.
+	 * The latency is the time spent on the engine thread, without the time a call waited in the queue.
+	 * Transfers that were skipped by the variable cache count as calls without bytes.
+	 * In profiling builds every recorded call is also an easy_profiler block.
+	 *
+	 * Recording is thread-safe and enabled by default.
+	 */
+	class MATLAB_API EngineTelemetry
+	{
+	public:
+		enum class Operation
+		{
+			Eval,
+			Feval,
+			AddVariable,
+			GetVariable,
+			RemoveVariable,
+			SendVariable,
+			UpdateVariable,
+			QueryVariable,
+			SetVariableSlice,
+			ResizeVariable,
+
+			count
+		};
+		static constexpr size_t operationCount = static_cast<size_t>(Operation::count);
+
+		/**
+		 * @brief Variables with more distinct names are recorded under this name
+		 */
+		static constexpr size_t maxTrackedVariables = 1024;
+		static constexpr const char* otherVariables = "<other>";
+
+		static const char* getOperationName(Operation operation);
+
+		/**
+		 * @brief Histogram with power of two buckets: bucket 0 counts calls below 2 us,
+		 *        bucket i calls in [2^i, 2^(i+1)) us, the last bucket everything above.
+		 */
+		struct MATLAB_API LatencyHistogram
+		{
+			static constexpr size_t bucketCount = 32;
+			std::array<uint64_t, bucketCount> buckets{};
+
+			void add(std::chrono::nanoseconds latency);
+			void add(const LatencyHistogram& other);
+			uint64_t getCount() const;
+
+			/**
+			 * @brief Upper bound of the bucket that contains the given percentile
+			 * @param percent 0 to 100
+			 */
+			std::chrono::microseconds getPercentile(double percent) const;
+			static std::chrono::microseconds getBucketUpperBound(size_t bucket);
+		};
+
+		struct MATLAB_API Counters
+		{
+			uint64_t calls = 0;
+			uint64_t errors = 0;
+			uint64_t bytesToEngine = 0;
+			uint64_t bytesFromEngine = 0;
+			std::chrono::nanoseconds totalTime{ 0 };
+			std::chrono::nanoseconds maxTime{ 0 };
+			LatencyHistogram latency;
+
+			void add(const Counters& other);
+		};
+
+		typedef std::array<Counters, operationCount> OperationCounters;
+
+		struct MATLAB_API Snapshot
+		{
+			OperationCounters operations;                   // indexed by Operation
+			std::map<std::string, OperationCounters> variables; // calls without a variable (eval, feval) are not listed
+			std::chrono::nanoseconds duration{ 0 };         // time since the last reset
+
+			const Counters& get(Operation operation) const { return operations[static_cast<size_t>(operation)]; }
+			Counters getTotal() const;
+
+			/**
+			 * @brief Serializes the snapshot, times are in microseconds
+			 */
+			std::string toJson() const;
+		};
+
+		/**
+		 * @brief Records one call from construction to destruction
+		 */
+		class MATLAB_API Scope
+		{
+		public:
+			Scope(Operation operation, const std::string& variable = "");
+			~Scope();
+
+			Scope(const Scope&) = delete;
+			Scope& operator=(const Scope&) = delete;
+
+			void addBytesToEngine(uint64_t bytes) { m_bytesToEngine += bytes; }
+			void addBytesFromEngine(uint64_t bytes) { m_bytesFromEngine += bytes; }
+			void setFailed(bool failed = true) { m_failed = failed; }
+
+		private:
+			Operation m_operation;
+			std::string m_variable;
+			bool m_active;
+			bool m_failed = false;
+			uint64_t m_bytesToEngine = 0;
+			uint64_t m_bytesFromEngine = 0;
+			std::chrono::steady_clock::time_point m_start;
+		};
+
+		static void setEnabled(bool enable);
+		static bool isEnabled();
+
+		static void record(Operation operation, const std::string& variable, std::chrono::nanoseconds latency,
+						   uint64_t bytesToEngine, uint64_t bytesFromEngine, bool failed);
+
+		static Snapshot getSnapshot();
+		static void reset();
+	};
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include "EngineBackend.h"
+#include "math/Matrix.h"
+#include <unordered_map>
+
+namespace MatlabAPI
+{
+	/**
+	 * @brief Deterministic stand-in for MATLAB that runs inside the calling process.
+	 *
+	 * Stores variables in a map and understands a small subset of MATLAB, so the wrapper
+	 * can be tested and benchmarked without a MATLAB installation:
+	 *  - statements separated by newlines, ';' or ','
+	 *  - clear / clearvars, optionally with names or prefix* patterns
+	 *  - assignments from numbers, [1 2; 3 4] matrix literals, 'strings', variables and
+	 *    their transposes, and from scalar arithmetic (x * 2, 1 - x)
+	 *  - function calls with one or more return values: [A, B, C, D] = ssdata(sys)
+	 *  - the functions ss, tf, c2d ('zoh' and 'tustin'), ssdata, zeros, eye
+	 *  - metadata and row ranges of numeric and logical variables (getVariableInfo(), getVariableRows())
+	 *  - slices and row counts of numeric and logical variables (setVariableSlice(), resizeVariableRows()),
+	 *    the values must have the class of the variable
+	 *
+	 * ss and tf objects are stored as cell arrays. c2d and ssdata are computed natively,
+	 * transfer functions are realized in controllable canonical form, so the matrices of
+	 * a converted transfer function may differ from MATLAB by a state transformation.
+	 * Every call waits for the configured latency to model the IPC round trip of a real engine.
+	 */
+	class MATLAB_API InProcessBackend : public EngineBackend
+	{
+	public:
+		InProcessBackend();
+		~InProcessBackend();
+
+		std::string getName() const override { return "InProcess"; }
+
+		/**
+		 * @brief Artificial latency added to every call
+		 */
+		void setLatency(std::chrono::microseconds latency) { m_latency = latency.count(); }
+		std::chrono::microseconds getLatency() const { return std::chrono::microseconds(m_latency.load()); }
+
+		bool hasVariable(const std::string& name) const;
+		std::vector<std::string> getVariableNames() const;
+
+	protected:
+		int doEval(const std::string& command) override;
+		std::vector<MatlabArray> doFeval(const std::string& function, size_t nargout, const std::vector<MatlabArray>& args) override;
+		bool doSetVariable(const std::string& name, const MatlabArray& value) override;
+		MatlabArray doGetVariable(const std::string& name) override;
+		bool doGetVariableInfo(const std::string& name, VariableInfo& info) override;
+		MatlabArray doGetVariableRows(const std::string& name, size_t first, size_t count) override;
+		bool doSetVariableSlice(const std::string& name, Slice slice, size_t first, const MatlabArray& values) override;
+		bool doResizeVariableRows(const std::string& name, size_t rows) override;
+
+	private:
+		void simulateLatency() const;
+
+		// Throw std::runtime_error with a MATLAB like message on error
+		void executeStatement(const std::string& statement);
+		MatlabArray evaluateExpression(const std::string& expression);
+		MatlabArray evaluateOperand(const std::string& operand);
+		std::vector<MatlabArray> callFunction(const std::string& function, size_t nargout, const std::vector<MatlabArray>& args);
+		void clear(const std::vector<std::string>& patterns);
+
+		std::unordered_map<std::string, MatlabArray> m_variables;
+		std::atomic<long long> m_latency{ 0 }; // microseconds
+	};
+}
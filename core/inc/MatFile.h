@@ -0,0 +1,312 @@
+#pragma once
+#include "MatlabAPI_base.h"
+#include "MatlabArray.h"
+#include "math/Matrix.h"
+#include <string>
+#include <vector>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <cstdint>
+
+namespace MatlabAPI
+{
+	/**
+	 * @brief Element data types and array classes of the MAT-file v5 format
+	 */
+	struct MATLAB_API MatFileFormat
+	{
+		enum DataType : uint32_t
+		{
+			miINT8 = 1,
+			miUINT8 = 2,
+			miINT16 = 3,
+			miUINT16 = 4,
+			miINT32 = 5,
+			miUINT32 = 6,
+			miSINGLE = 7,
+			miDOUBLE = 9,
+			miINT64 = 12,
+			miUINT64 = 13,
+			miMATRIX = 14,
+			miCOMPRESSED = 15,
+			miUTF8 = 16,
+			miUTF16 = 17,
+			miUTF32 = 18
+		};
+		enum ArrayClass : uint8_t
+		{
+			mxCELL = 1,
+			mxSTRUCT = 2,
+			mxOBJECT = 3,
+			mxCHAR = 4,
+			mxSPARSE = 5,
+			mxDOUBLE = 6,
+			mxSINGLE = 7,
+			mxINT8 = 8,
+			mxUINT8 = 9,
+			mxINT16 = 10,
+			mxUINT16 = 11,
+			mxINT32 = 12,
+			mxUINT32 = 13,
+			mxINT64 = 14,
+			mxUINT64 = 15
+		};
+
+		static const char* getClassName(ArrayClass arrayClass);
+
+		template<typename T>
+		static constexpr ArrayClass classOf()
+		{
+			static_assert(std::is_arithmetic<T>::value && !std::is_same<T, bool>::value, "MAT-files store numeric types only");
+			static_assert(sizeof(T) <= 8, "MATLAB has no numeric type wider than 64 bit");
+			if constexpr (std::is_floating_point<T>::value)
+				return sizeof(T) == 4 ? mxSINGLE : mxDOUBLE;
+			else if constexpr (std::is_signed<T>::value)
+				return sizeof(T) == 1 ? mxINT8 : sizeof(T) == 2 ? mxINT16 : sizeof(T) == 4 ? mxINT32 : mxINT64;
+			else
+				return sizeof(T) == 1 ? mxUINT8 : sizeof(T) == 2 ? mxUINT16 : sizeof(T) == 4 ? mxUINT32 : mxUINT64;
+		}
+		template<typename T>
+		static constexpr DataType dataTypeOf()
+		{
+			switch (classOf<T>())
+			{
+			case mxSINGLE: return miSINGLE;
+			case mxINT8:   return miINT8;
+			case mxUINT8:  return miUINT8;
+			case mxINT16:  return miINT16;
+			case mxUINT16: return miUINT16;
+			case mxINT32:  return miINT32;
+			case mxUINT32: return miUINT32;
+			case mxINT64:  return miINT64;
+			case mxUINT64: return miUINT64;
+			default:       return miDOUBLE;
+			}
+		}
+
+		/**
+		 * @brief true if zlib compression is compiled in
+		 */
+		static bool isCompressionAvailable();
+	};
+
+	/**
+	 * @brief Writes MAT-file v5 files (the format of save -v7) without MATLAB.
+	 *
+	 * Variables are written one after the other. Large matrices can be streamed row block
+	 * by row block with beginRows() / appendRows() / endRows(); the blocks are buffered in
+	 * a temporary file next to the output, so the memory use does not depend on the number of rows.
+	 * With Compression::Zlib every variable is stored as a compressed element, if zlib is available.
+	 *
+	 * Example:
+	 * @code
+	 * MatFileWriter file("log.mat", MatFileWriter::Compression::Zlib);
+	 * file.write("Ts", Matrix({ { 0.001 } }));
+	 * file.beginRows("trajectory", 6);
+	 * while (simulate(state))
+	 *     file.appendRows(state.data(), 1);
+	 * file.endRows();
+	 * file.close();
+	 * @endcode
+	 */
+	class MATLAB_API MatFileWriter
+	{
+	public:
+		enum class Compression
+		{
+			None,
+			Zlib
+		};
+
+		/**
+		 * @brief Creates the file and writes the header, check isOpen()
+		 */
+		explicit MatFileWriter(const std::string& path, Compression compression = Compression::None);
+
+		/**
+		 * @brief Finishes a pending row stream and closes the file
+		 */
+		~MatFileWriter();
+
+		MatFileWriter(const MatFileWriter&) = delete;
+		MatFileWriter& operator=(const MatFileWriter&) = delete;
+
+		bool isOpen() const { return m_file.is_open(); }
+		const std::string& getPath() const { return m_path; }
+		Compression getCompression() const { return m_compression; }
+
+		/**
+		 * @brief Writes a numeric matrix given in column-major order
+		 */
+		template<typename T>
+		bool write(const std::string& name, const T* data, size_t rows, size_t cols)
+		{
+			return writeNumeric(name, MatFileFormat::classOf<T>(), MatFileFormat::dataTypeOf<T>(), sizeof(T), data, nullptr, rows, cols);
+		}
+
+		/**
+		 * @brief Writes a complex double matrix, real and imaginary parts in column-major order
+		 */
+		bool writeComplex(const std::string& name, const double* real, const double* imag, size_t rows, size_t cols)
+		{
+			return writeNumeric(name, MatFileFormat::mxDOUBLE, MatFileFormat::miDOUBLE, sizeof(double), real, imag, rows, cols);
+		}
+
+		bool write(const std::string& name, const Matrix& matrix);
+		bool write(const std::string& name, const std::string& text);
+		bool write(const std::string& name, const std::vector<bool>& values);
+
+		/**
+		 * @brief Writes an array under its own name.
+		 *        Supported are double, char and logical arrays and cell arrays of those.
+		 */
+		bool write(const MatlabArray& array);
+
+		/**
+		 * @brief Starts streaming a double matrix with cols columns and a growing number of rows.
+		 *        No other variable can be written until endRows() is called.
+		 */
+		bool beginRows(const std::string& name, size_t cols);
+
+		/**
+		 * @brief Appends rows x cols values given in row-major (C) order
+		 */
+		bool appendRows(const double* data, size_t rows);
+		bool appendRows(const Matrix& block);
+
+		/**
+		 * @brief Writes the streamed matrix to the file
+		 */
+		bool endRows();
+		bool isStreamingRows() const { return m_rowStream != nullptr; }
+
+		/**
+		 * @brief Finishes a pending row stream and closes the file
+		 * @return false if any write failed
+		 */
+		bool close();
+
+	private:
+		struct RowStream;
+
+		bool writeNumeric(const std::string& name, MatFileFormat::ArrayClass arrayClass, MatFileFormat::DataType type,
+			size_t elementSize, const void* real, const void* imag, size_t rows, size_t cols);
+
+		// Writes a complete top-level miMATRIX element, compressed if enabled
+		bool writeElement(const std::string& name, const std::string& element);
+		bool checkWritable();
+
+		std::string m_path;
+		Compression m_compression;
+		std::fstream m_file;
+		std::unique_ptr<RowStream> m_rowStream;
+		bool m_failed = false;
+	};
+
+	/**
+	 * @brief Reads MAT-file v5 files without MATLAB.
+	 *
+	 * The file is memory-mapped. Opening it only lists the variables; compressed variables
+	 * are decompressed when they are read. Uncompressed real numeric variables that are stored
+	 * in their own class can be accessed in place with map(), without copying.
+	 */
+	class MATLAB_API MatFileReader
+	{
+		struct Mapping;
+	public:
+		struct Variable
+		{
+			std::string name;
+			MatFileFormat::ArrayClass arrayClass = MatFileFormat::mxDOUBLE;
+			std::vector<size_t> dimensions;
+			bool complex = false;
+			bool logical = false;
+			bool compressed = false;
+
+			size_t getRows() const { return dimensions.size() > 0 ? dimensions[0] : 0; }
+			size_t getCols() const;
+			size_t getNumberOfElements() const;
+			const char* getClassName() const { return MatFileFormat::getClassName(arrayClass); }
+		};
+
+		/**
+		 * @brief Maps the file and lists its variables, check isOpen()
+		 */
+		explicit MatFileReader(const std::string& path);
+		~MatFileReader();
+
+		MatFileReader(const MatFileReader&) = delete;
+		MatFileReader& operator=(const MatFileReader&) = delete;
+
+		bool isOpen() const { return m_mapping != nullptr; }
+		const std::string& getPath() const { return m_path; }
+		const std::vector<Variable>& getVariables() const { return m_variables; }
+
+		/**
+		 * @return nullptr if there is no variable with this name
+		 */
+		const Variable* find(const std::string& name) const;
+
+		/**
+		 * @brief Reads a real numeric or logical variable, converted to T, in column-major order.
+		 *        Dimensions beyond the second are folded into cols.
+		 * @return false if the variable does not exist or is not numeric
+		 */
+		template<typename T>
+		bool read(const std::string& name, std::vector<T>& data, size_t& rows, size_t& cols) const
+		{
+			return readNumeric(name, MatFileFormat::classOf<T>(), sizeof(T), rows, cols, [&data](size_t count) -> void* {
+				data.resize(count);
+				return data.data();
+				});
+		}
+
+		/**
+		 * @return empty matrix if the variable does not exist or is not numeric
+		 */
+		Matrix readMatrix(const std::string& name) const;
+
+		/**
+		 * @return empty string if the variable does not exist or is not a char array
+		 */
+		std::string readString(const std::string& name) const;
+
+		/**
+		 * @brief Reads double, char and logical arrays and cell arrays of those.
+		 *        Other numeric classes are converted to double.
+		 * @return invalid array if the variable does not exist or is not supported
+		 */
+		MatlabArray read(const std::string& name) const;
+
+		/**
+		 * @brief Pointer to the data of the variable inside the mapped file, valid while the reader exists
+		 * @return nullptr if the variable is compressed, complex or not stored as T
+		 */
+		template<typename T>
+		const T* map(const std::string& name, size_t& rows, size_t& cols) const
+		{
+			return static_cast<const T*>(mapNumeric(name, MatFileFormat::classOf<T>(), MatFileFormat::dataTypeOf<T>(), rows, cols));
+		}
+
+	private:
+		struct Entry
+		{
+			size_t offset = 0; // of the element data, behind the tag
+			size_t size = 0;
+		};
+
+		bool parse();
+		// Element data of the variable, decompressed into buffer if needed
+		const uint8_t* getElement(size_t index, size_t& size, std::vector<uint8_t>& buffer) const;
+		bool readNumeric(const std::string& name, MatFileFormat::ArrayClass targetClass, size_t elementSize, size_t& rows, size_t& cols,
+			const std::function<void* (size_t count)>& allocate) const;
+		const void* mapNumeric(const std::string& name, MatFileFormat::ArrayClass arrayClass, MatFileFormat::DataType type, size_t& rows, size_t& cols) const;
+
+		std::string m_path;
+		Mapping* m_mapping = nullptr;
+		std::vector<Variable> m_variables;
+		std::vector<Entry> m_entries;
+	};
+}
@@ -15,11 +15,25 @@
 /// USER_SECTION_START 2
 #include "MatlabEngine.h"
 #include "MatlabArray.h"
+#include "ArrayView.h"
+#include "MatlabFuture.h"
+#include "EngineBackend.h"
+#include "EngineTelemetry.h"
+#include "Utf.h"
+#include "NumericConversion.h"
+#include "InProcessBackend.h"
+#include "EnginePool.h"
+#include "BulkTransfer.h"
+#include "ChunkedTransfer.h"
+#include "StructSchema.h"
+#include "MatFile.h"
 
 #include "math/Matrix.h"
 #include "math/StateSpaceModel.h"
 #include "math/TransferFunction.h"
 #include "math/MIMOSystem.h"
+#include "math/CoefficientArena.h"
+#include "math/LinearAlgebra.h"
 
 
 #include "ui/MatlabEmbeddedPlotWidget.h"
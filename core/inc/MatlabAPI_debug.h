@@ -233,4 +233,18 @@ namespace MatlabAPI
 
 /// USER_SECTION_START 3
 
+// ---------------------------------------------------------------------------
+// "Engine" profiling section, the calls into MATLAB recorded by EngineTelemetry.
+// ---------------------------------------------------------------------------
+#define MATLAB_API_ENGINE_PROFILING_COLORBASE Orange
+#define MATLAB_API_ENGINE_PROFILING_BLOCK_C(text, color) MATLAB_API_PROFILING_BLOCK_C(text, color)
+#define MATLAB_API_ENGINE_PROFILING_NONSCOPED_BLOCK_C(text, color) MATLAB_API_PROFILING_NONSCOPED_BLOCK_C(text, color)
+#define MATLAB_API_ENGINE_PROFILING_END_BLOCK MATLAB_API_PROFILING_END_BLOCK;
+#define MATLAB_API_ENGINE_PROFILING_FUNCTION_C(color) MATLAB_API_PROFILING_FUNCTION_C(color)
+#define MATLAB_API_ENGINE_PROFILING_BLOCK(text, colorStage) MATLAB_API_PROFILING_BLOCK(text, CONCAT_SYMBOLS(MATLAB_API_ENGINE_PROFILING_COLORBASE, colorStage))
+#define MATLAB_API_ENGINE_PROFILING_NONSCOPED_BLOCK(text, colorStage) MATLAB_API_PROFILING_NONSCOPED_BLOCK(text, CONCAT_SYMBOLS(MATLAB_API_ENGINE_PROFILING_COLORBASE, colorStage))
+#define MATLAB_API_ENGINE_PROFILING_FUNCTION(colorStage) MATLAB_API_PROFILING_FUNCTION(CONCAT_SYMBOLS(MATLAB_API_ENGINE_PROFILING_COLORBASE, colorStage))
+#define MATLAB_API_ENGINE_PROFILING_VALUE(name, value) MATLAB_API_PROFILING_VALUE(name, value)
+#define MATLAB_API_ENGINE_PROFILING_TEXT(name, value) MATLAB_API_PROFILING_TEXT(name, value)
+
 /// USER_SECTION_END
\ No newline at end of file
@@ -1,7 +1,11 @@
 #pragma once
 #include "MatlabAPI_base.h"
+#include "ArrayView.h"
 #include <vector>
 #include <string>
+#include <cstdint>
+#include <utility>
+#include <atomic>
 
 #ifdef MATLAB_API_USE_CPP_API
 namespace matlab {
@@ -18,9 +22,68 @@ typedef struct mxArray_tag mxArray;
 namespace MatlabAPI
 {
     class MATLAB_API MatlabEngine;
+    class MATLAB_API MatlabArray;
+
+    /**
+     * @brief Element memory allocated the way the MATLAB API expects it, created with MatlabArray::createBuffer<T>().
+     *        Fill it and pass it to the MatlabArray constructor, which adopts the memory without copying.
+     */
+    template<typename T>
+    class ArrayBuffer
+    {
+        friend class MatlabArray;
+    public:
+        ArrayBuffer() = default;
+        ArrayBuffer(ArrayBuffer&& other) noexcept
+            : m_handle(other.m_handle)
+            , m_data(other.m_data)
+            , m_size(other.m_size)
+        {
+            other.m_handle = nullptr;
+            other.m_data = nullptr;
+            other.m_size = 0;
+        }
+        ArrayBuffer& operator=(ArrayBuffer&& other) noexcept
+        {
+            if (this != &other)
+            {
+                reset();
+                std::swap(m_handle, other.m_handle);
+                std::swap(m_data, other.m_data);
+                std::swap(m_size, other.m_size);
+            }
+            return *this;
+        }
+        ArrayBuffer(const ArrayBuffer&) = delete;
+        ArrayBuffer& operator=(const ArrayBuffer&) = delete;
+        ~ArrayBuffer() { reset(); }
+
+        T* data() const { return m_data; }
+        size_t size() const { return m_size; }
+        T* begin() const { return m_data; }
+        T* end() const { return m_data + m_size; }
+        T& operator[](size_t index) const { return m_data[index]; }
+        explicit operator bool() const { return m_handle != nullptr; }
+
+    private:
+        ArrayBuffer(void* handle, T* data, size_t size)
+            : m_handle(handle)
+            , m_data(data)
+            , m_size(size)
+        {}
+        void reset();
+
+        void* m_handle = nullptr; // owns the memory until a MatlabArray adopts it
+        T* m_data = nullptr;
+        size_t m_size = 0;
+    };
 
     /**
      * @brief C++ wrapper for MATLAB mxArray with RAII and modern C++ features
+     *
+     * Copies share the underlying array through a reference count, copying a MatlabArray or passing it
+     * by value is O(1). The data is duplicated by the first mutation of a shared copy (setCell(), setField(),
+     * the mutable view(), getData(), release()), so copies behave like independent values.
      */
     class MATLAB_API MatlabArray 
     {
@@ -58,6 +121,20 @@ namespace MatlabAPI
         MatlabArray(const std::string& name, size_t rows, size_t cols, const std::vector<double>& data);
         
 
+        /**
+         * @brief Adopts the memory of buffer without copying, the elements are in column-major order
+         * @throws std::invalid_argument if the dimensions don't match the buffer size
+         */
+        template<typename T>
+        MatlabArray(const std::string& name, ArrayBuffer<T>&& buffer, const std::vector<size_t>& dimensions)
+            : MatlabArray(name)
+        {
+            ArrayBuffer<T> adopted(std::move(buffer));
+            void* handle = adopted.m_handle;
+            adopted.m_handle = nullptr; // owned by adoptBuffer() from here on, also if it throws
+            adoptBuffer(ArrayElementTypeOf<T>::value, handle, adopted.m_size, dimensions);
+        }
+
         /**
          * @brief Create string array
          */
@@ -93,6 +170,30 @@ namespace MatlabAPI
 
         static MatlabArray createCell(const std::string& name, size_t rows, size_t cols);
 
+        /**
+         * @brief rows x cols struct array with the given fields, all field values are []
+         */
+        static MatlabArray createStruct(const std::string& name, size_t rows, size_t cols, const std::vector<std::string>& fieldNames);
+
+        /**
+         * @brief Uninitialized memory for count elements, to be filled and adopted by a MatlabArray.
+         *        T is a real numeric type or bool.
+         *
+         * Example:
+         * @code
+         * ArrayBuffer<double> buffer = MatlabArray::createBuffer<double>(rows * cols);
+         * fill(buffer.data());
+         * MatlabEngine::addVariable(new MatlabArray("x", std::move(buffer), { rows, cols }));
+         * @endcode
+         */
+        template<typename T>
+        static ArrayBuffer<T> createBuffer(size_t count)
+        {
+            void* data = nullptr;
+            void* handle = allocateBuffer(ArrayElementTypeOf<T>::value, count, data);
+            return ArrayBuffer<T>(handle, static_cast<T*>(data), count);
+        }
+
         // ===== Access to underlying mxArray =====
 #ifdef MATLAB_API_USE_CPP_API
 		matlab::data::Array* get() const { return array_; }
@@ -148,11 +249,67 @@ namespace MatlabAPI
 
         // ===== Data Access =====
 
+        /**
+         * @brief Zero-copy view of the elements, for all real numeric classes and logical (bool).
+         *        The mutable view() first unshares data that is shared with copies of this array.
+         *        The view is invalidated when the array is destroyed, overwritten or updated from the engine.
+         * @throws std::runtime_error if the array is not of type T or is complex or sparse
+         */
+        template<typename T>
+        ArrayView<T> view()
+        {
+            detach();
+            return ArrayView<T>(static_cast<T*>(getViewData(ArrayElementTypeOf<T>::value, true)), getDimensions());
+        }
+        template<typename T>
+        ArrayView<const T> view() const
+        {
+            return ArrayView<const T>(static_cast<const T*>(getViewData(ArrayElementTypeOf<T>::value, false)), getDimensions());
+        }
+        template<typename T>
+        ArrayView<const T> cview() const { return view<T>(); }
+
+        /**
+         * @brief Copy of the elements in column-major order, T must match the class of the array
+         * @throws std::runtime_error if the array is not of type T
+         */
         template<typename T>
-		std::vector<T> getRowData(size_t row) const;
+        std::vector<T> getVector() const { return view<T>().toVector(); }
+
+        /**
+         * @brief Converts the elements of any real numeric or logical array into target (getNumberOfElements() values),
+         *        target[i] = element[i] * scale + offset, vectorized (see NumericConversion)
+         * @throws std::runtime_error if the array is not real numeric or logical
+         */
+        void copyAsDouble(double* target, double scale = 1.0, double offset = 0.0) const;
 
+        /**
+         * @brief Copies a single array or converts a double array into target (getNumberOfElements() values)
+         * @throws std::runtime_error if the array is neither single nor double
+         */
+        void copyAsSingle(float* target) const;
+
+        /**
+         * @brief Copy of one row of a matrix
+         * @throws std::out_of_range if row >= getM()
+         */
+        template<typename T>
+		std::vector<T> getRowData(size_t row) const { return view<T>().row(row).toVector(); }
+
+        /**
+         * @brief Copy of one column of a matrix
+         * @throws std::out_of_range if col >= getN()
+         */
 		template<typename T>
-		std::vector<T> getColData(size_t col) const;
+		std::vector<T> getColData(size_t col) const { return view<T>().col(col).toVector(); }
+
+        /**
+         * @brief Copy of rows [first, first + count) with all columns, dimensions beyond the second are folded into the columns.
+         *        For all real numeric classes and logical.
+         * @throws std::out_of_range if the rows exceed getM()
+         * @throws std::runtime_error for other classes
+         */
+        MatlabArray getRowRange(size_t first, size_t count) const;
 
 #ifdef MATLAB_API_USE_CPP_API
         //template<typename T>
@@ -183,7 +340,11 @@ namespace MatlabAPI
         void* getDataRaw();
         void* getDataRawC() const;
 
-        double* getPr() const;
+        /**
+         * @brief Real part of a double array. The non-const overload first unshares data that is shared with copies.
+         */
+        double* getPr();
+        const double* getPr() const;
 #endif
 
         // ===== Convenience Methods for Common Types =====
@@ -213,8 +374,18 @@ namespace MatlabAPI
          */
         std::vector<std::vector<double>> getDoubleMatrix() const;
 
+        /**
+         * @brief Get matrix data as one contiguous row-major buffer, element (r, c) is at r * getN() + c.
+         *        Uses a cache-blocked transpose, prefer this over getDoubleMatrix() for large arrays.
+         */
+        std::vector<double> getDoubleMatrixRowMajor() const;
+
         // ===== Cell Array Access =====
 
+        /**
+         * @brief With the C API cells and fields are returned without a copy, the first mutation
+         *        of the returned array copies it (as for shared copies), so writes never reach this array.
+         */
         MatlabArray getCell(size_t index) const;
 
         void setCell(size_t index, const MatlabArray& value);
@@ -223,15 +394,39 @@ namespace MatlabAPI
 
         std::vector<std::string> getFieldNames() const;
 
-#ifdef MATLAB_API_USE_CPP_API
-        //MatlabArray getField(const std::string& fieldname, size_t index = 0) const;
-        //
-        //void setField(const std::string& fieldname, const MatlabArray& value, size_t index = 0);
-#else
+        size_t getNumberOfFields() const;
+
+        /**
+         * @throws std::runtime_error if the array is not a struct or has no field fieldname
+         * @throws std::out_of_range if index >= getNumberOfElements()
+         */
         MatlabArray getField(const std::string& fieldname, size_t index = 0) const;
-        
+
         void setField(const std::string& fieldname, const MatlabArray& value, size_t index = 0);
-#endif
+
+        /**
+         * @brief All field values of element index by position, in the order of getFieldNames()
+         */
+        std::vector<MatlabArray> getFields(size_t index = 0) const;
+
+        /**
+         * @brief As getFields(index), fieldNames is the result of getFieldNames() and is resolved once
+         *        by the caller for all elements of a struct array
+         * @throws std::invalid_argument if the number of names differs from getNumberOfFields()
+         */
+        std::vector<MatlabArray> getFields(size_t index, const std::vector<std::string>& fieldNames) const;
+
+        /**
+         * @brief Sets all fields of element index, values are in the order of getFieldNames()
+         * @throws std::invalid_argument if the number of values differs from getNumberOfFields()
+         */
+        void setFields(size_t index, const std::vector<MatlabArray>& values);
+
+        /**
+         * @brief As setFields(index, values), fieldNames is the result of getFieldNames()
+         * @throws std::invalid_argument if the number of values or names differs from getNumberOfFields()
+         */
+        void setFields(size_t index, const std::vector<MatlabArray>& values, const std::vector<std::string>& fieldNames);
 
         // ===== Utility Methods =====
 
@@ -241,13 +436,38 @@ namespace MatlabAPI
         void print(std::ostream& os = std::cout) const;
 
         /**
-         * @brief Clone the array
+         * @brief Clone the array, the data is shared until either array is modified
          */
         MatlabArray clone() const;
 
+        /**
+         * @brief true if the data is shared with copies of this array
+         */
+        bool isShared() const;
+
+		/**
+		 * @brief Computes a hash over the class, the dimensions and the content of the array (64 bit words, each mixed with the splitmix64 finalizer).
+		 *        Cell and struct arrays are hashed recursively.
+		 * @return false if the array is empty or contains elements that cannot be hashed (objects, sparse arrays, ...)
+		 */
+		bool computeContentHash(uint64_t& hash) const;
+
+		/**
+		 * @brief Size of the element data in bytes, cell and struct arrays are summed up recursively.
+		 *        Objects, sparse arrays and strings count as 0.
+		 */
+		size_t getSizeInBytes() const;
+
 		bool updateFromEngine();
 		bool updateToEngine();
 
+		/**
+		 * @brief Sends only rows [first, first + count) to the engine variable with one indexed assignment,
+		 *        for example after samples were appended. The engine variable grows if the rows lie beyond its end.
+		 *        Like updateToEngine() it needs an array registered with MatlabEngine::addVariable().
+		 */
+		bool updateRowsToEngine(size_t first, size_t count);
+
         // ===== Operators =====
 
         explicit operator bool() const { return array_ != nullptr; }
@@ -264,15 +484,55 @@ namespace MatlabAPI
 #endif
 
         private:
+            template<typename T>
+            friend class ArrayBuffer;
+
+            // Element data for view(), type checked
+            void* getViewData(ArrayElementType type, bool writable) const;
+
+            // Memory of ArrayBuffer: handle owns data until adoptBuffer() or freeBuffer() is called
+            static void* allocateBuffer(ArrayElementType type, size_t count, void*& data);
+            static void freeBuffer(ArrayElementType type, void* handle);
+            void adoptBuffer(ArrayElementType type, void* handle, size_t count, const std::vector<size_t>& dimensions);
+
+            // Copy-on-write: share() makes this array refer to the data of other,
+            // detach() gives this array its own copy if the data is shared
+            void share(const MatlabArray& other);
+            void detach();
 #ifdef MATLAB_API_USE_CPP_API
-			matlab::data::Array* array_;
+            void attach(matlab::data::Array arr);
+            void dropReference();
 #else
-            mxArray* array_;
-            bool owns_memory_;
+            void attach(mxArray* arr, bool take_ownership);
+            void dropReference(bool destroy = true);
+            // Cell or field of another array without a copy, see getCell()
+            static MatlabArray borrow(const std::string& name, mxArray* child);
+#endif
+
+#ifdef MATLAB_API_USE_CPP_API
+			matlab::data::Array* array_ = nullptr;
+#else
+            mxArray* array_ = nullptr;
+#endif
+            // Number of MatlabArrays sharing array_, nullptr if array_ is not owned
+            std::atomic<size_t>* m_references = nullptr;
+#ifndef MATLAB_API_USE_CPP_API
+            // array_ is a cell or field of another array, detach() copies it before a mutation
+            bool m_borrowed = false;
 #endif
             
 			std::string m_name;
 
 			MatlabEngine* m_owner = nullptr;
     };
+
+    template<typename T>
+    void ArrayBuffer<T>::reset()
+    {
+        if (m_handle)
+            MatlabArray::freeBuffer(ArrayElementTypeOf<T>::value, m_handle);
+        m_handle = nullptr;
+        m_data = nullptr;
+        m_size = 0;
+    }
 }
\ No newline at end of file
@@ -1,71 +1,675 @@
 #pragma once
 #include "MatlabAPI_base.h"
 #include "MatlabArray.h"
+#include "MatlabFuture.h"
+#include "EngineBackend.h"
+#include "EngineTelemetry.h"
 #include "math/Matrix.h"
 #include <unordered_map>
-
-#ifdef MATLAB_API_USE_CPP_API
-namespace matlab {
-	namespace engine
-	{
-		class MATLABEngine;
-	}
-}
-#else
-struct engine; // Forward declaration of mxArray
-typedef struct engine Engine;
-#endif
+#include <functional>
+#include <future>
+#include <atomic>
+#include <cstdint>
 
 namespace MatlabAPI
 {
+	/**
+	 * @brief Singleton access to the MATLAB engine.
+	 *
+	 * The engine is owned by a dedicated engine thread. All public functions are thread-safe:
+	 * calls from other threads are queued and executed by the engine thread in the order
+	 * they arrive. The synchronous functions block until their request is executed,
+	 * the asynchronous ones return a future immediately.
+	 * Calls made on the engine thread itself (for example from a continuation) run inline.
+	 *
+	 * MATLAB is accessed through an EngineBackend. instantiate() uses the native engine API,
+	 * instantiate(std::unique_ptr<EngineBackend>) accepts any backend, for example an InProcessBackend.
+	 */
 	class MATLAB_API MatlabEngine
 	{
 		friend class MatlabArray;
-#ifdef MATLAB_API_USE_CPP_API
-		MatlabEngine(const std::u16string& startcmd);
-#else
-		MatlabEngine(const char* startcmd);
-#endif
+		MatlabEngine(std::shared_ptr<EngineBackend> backend);
 		~MatlabEngine();
 	public:
 		static bool instantiate();
-#ifdef MATLAB_API_USE_CPP_API
-		static bool instantiate(const std::u16string& startcmd, int retryCount = 10);
-#else
 		static bool instantiate(const std::u16string& startcmd, int retryCount = 10);
+#ifndef MATLAB_API_USE_CPP_API
 		static bool instantiate(const char* startcmd, int retryCount = 10);
 #endif
+
+		/**
+		 * @brief Instantiates the engine with the given backend instead of the native engine API.
+		 *        Like instantiate(startcmd) it returns true if the engine is already instantiated,
+		 *        backend is not used in that case.
+		 * @return false if backend is nullptr or the engine could not be started
+		 */
+		static bool instantiate(std::unique_ptr<EngineBackend> backend);
+
+		/**
+		 * @brief Starts the engine on the engine thread and returns immediately.
+		 *
+		 * Failed attempts are retried with exponential backoff (0.5 s, 1 s, 2 s, ... up to 8 s).
+		 * Calls made while the engine is starting are queued and executed once it is ready,
+		 * or fail as if the engine was not instantiated if the start fails.
+		 * Calling it again while the engine is starting returns the same future.
+		 * Cancelling the future stops further retries.
+		 *
+		 * Example, to show the main window without waiting for MATLAB:
+		 * @code
+		 * MatlabEngine::instantiateAsync().then([](bool started) {
+		 *     QMetaObject::invokeMethod(qApp, [started]() { onMatlabReady(started); });
+		 * });
+		 * @endcode
+		 * @return future which receives true once the engine is ready, false if all attempts failed
+		 */
+		static MatlabFuture<bool> instantiateAsync(const std::u16string& startcmd = u"", int retryCount = 10);
+		static MatlabFuture<bool> instantiateAsync(std::unique_ptr<EngineBackend> backend);
+
+		/**
+		 * @brief Starts the engine with a backend created by createBackend on the engine thread.
+		 *        A nullptr or an exception counts as a failed attempt.
+		 */
+		static MatlabFuture<bool> instantiateAsync(std::function<std::unique_ptr<EngineBackend>()> createBackend, int retryCount);
 		static bool terminate();
 		static bool isInstantiated();
 
+		/**
+		 * @brief true while instantiateAsync() is starting the engine
+		 */
+		static bool isStarting();
+
+		/**
+		 * @brief true if the engine is instantiated or starting, calls are accepted in both cases
+		 */
+		static bool isAvailable() { return isInstantiated() || isStarting(); }
+
 		static MatlabEngine* getInstance();
-		
+
+		/**
+		 * @brief Backend used by the engine, nullptr if not instantiated.
+		 *        Apart from getStatistics() and cancel() it may only be used on the engine thread.
+		 */
+		static EngineBackend* getBackend();
+
+		/**
+		 * @brief Records puts, evals and gets and executes them with a constant number of engine round trips.
+		 *
+		 * flush() sends all put values packed into one cell array, runs all operations
+		 * as one combined script and reads all results back in one packed transfer.
+		 * The operations are executed in the order they were recorded. A failing operation
+		 * does not stop the following ones, its error message is available through getError().
+		 * Variables created by put are not registered in the variable map of the engine.
+		 *
+		 * Example:
+		 * @code
+		 * MatlabEngine::Batch batch;
+		 * batch.put(MatlabArray("x", x));
+		 * size_t evalOp = batch.eval("y = cumsum(x);");
+		 * size_t getOp = batch.get("y");
+		 * batch.flush();
+		 * if (batch.succeeded(getOp))
+		 *     std::vector<double> y = batch.getResult(getOp).getDoubleVector();
+		 * @endcode
+		 */
+		class MATLAB_API Batch
+		{
+		public:
+			enum class OperationType
+			{
+				Put,
+				Eval,
+				Get
+			};
+
+			Batch();
+			~Batch();
+
+			/**
+			 * @brief Records a put of value under the name of value
+			 * @return index of the operation
+			 */
+			size_t put(const MatlabArray& value);
+			size_t put(const std::string& name, const Matrix& value);
+
+			/**
+			 * @brief Records the evaluation of command.
+			 *        Commands that clear the whole workspace also clear the internal batch variables.
+			 * @return index of the operation
+			 */
+			size_t eval(const std::string& command);
+
+			/**
+			 * @brief Records a read of the variable name
+			 * @return index of the operation, use getResult() to access the value after the flush
+			 */
+			size_t get(const std::string& name);
+
+			/**
+			 * @brief Executes all operations recorded since the last flush
+			 * @return true if all operations succeeded
+			 */
+			bool flush();
+
+			/**
+			 * @brief Removes all operations and results
+			 */
+			void clear();
+
+			size_t getOperationCount() const { return m_operations.size(); }
+			size_t getPendingOperationCount() const { return m_operations.size() - m_firstPending; }
+			OperationType getOperationType(size_t operation) const;
+
+			bool succeeded(size_t operation) const;
+			const std::string& getError(size_t operation) const;
+
+			/**
+			 * @brief Value read by a get operation
+			 * @throws std::out_of_range if the operation does not exist
+			 * @throws std::invalid_argument if the operation is not a get operation
+			 */
+			const MatlabArray& getResult(size_t operation) const;
+
+		private:
+			struct Operation
+			{
+				OperationType type;
+				std::string text; // command or variable name
+				size_t slot = 0;  // index into m_inputs or m_results
+				bool executed = false;
+				bool success = false;
+				std::string error;
+			};
+
+			const Operation& getOperation(size_t operation) const;
+			std::string buildScript(size_t firstInput, size_t firstResult) const;
+			void failPending(const std::string& error);
+
+			std::vector<Operation> m_operations;
+			std::vector<MatlabArray> m_inputs;
+			std::vector<MatlabArray> m_results;
+			size_t m_firstPending = 0;
+		};
+
+		/**
+		 * @brief Command template that is compiled once and executed with changing parameter values.
+		 *
+		 * Parameters are written as $name in the template. Their values are transferred as typed
+		 * workspace variables, so they are neither formatted into the command nor rounded.
+		 * Only values that changed since the last execution get transferred again, a bound value
+		 * with the same class, dimensions and content as the transferred one is not sent.
+		 * With a native backend the template is compiled into a generated MATLAB script, which
+		 * MATLAB parses once and runs in the base workspace; other backends evaluate the rewritten command.
+		 * Copies share the same compiled command. A handle may be used by one thread at a time.
+		 *
+		 * Example:
+		 * @code
+		 * MatlabEngine::PreparedCommand discretize = MatlabEngine::prepare("sysd = c2d(sys, $dt, $method);");
+		 * for (double dt : sampleTimes)
+		 *     discretize.execute(dt, "zoh");  // positional, in order of first appearance
+		 * discretize.bind("dt", 0.01).execute();
+		 * @endcode
+		 */
+		class MATLAB_API PreparedCommand
+		{
+			friend class MatlabEngine;
+		public:
+			PreparedCommand();
+			~PreparedCommand();
+
+			bool isValid() const { return m_state != nullptr; }
+
+			/**
+			 * @brief true if the template was compiled into a script on the engine side
+			 */
+			bool isCompiled() const;
+			const std::string& getCommand() const;
+
+			/**
+			 * @brief Parameter names without $, in order of their first appearance
+			 */
+			const std::vector<std::string>& getParameterNames() const;
+
+			/**
+			 * @throws std::invalid_argument if the template has no parameter with this name
+			 */
+			PreparedCommand& bind(const std::string& parameter, const MatlabArray& value);
+			PreparedCommand& bind(const std::string& parameter, const Matrix& value) { return bind(parameter, toArgument(value)); }
+			PreparedCommand& bind(const std::string& parameter, double value) { return bind(parameter, toArgument(value)); }
+			PreparedCommand& bind(const std::string& parameter, const std::string& value) { return bind(parameter, toArgument(value)); }
+			PreparedCommand& bind(const std::string& parameter, const char* value) { return bind(parameter, toArgument(value)); }
+
+			/**
+			 * @brief Executes the command with the currently bound values
+			 * @return 0 on success, -1 on error or if a parameter is not bound
+			 */
+			int execute();
+
+			/**
+			 * @brief Binds values to the parameters in order of their first appearance and executes the command
+			 * @throws std::invalid_argument if the number of values does not match the number of parameters
+			 */
+			int execute(const std::vector<MatlabArray>& values);
+			template<typename... Args>
+			int execute(const Args&... args)
+			{
+				return execute(std::vector<MatlabArray>{ toArgument(args)... });
+			}
+
+		private:
+			struct State;
+			PreparedCommand(std::shared_ptr<State> state);
+
+			std::shared_ptr<State> m_state;
+		};
+
+		/**
+		 * @brief Compiles a command template with $name parameters, see PreparedCommand
+		 * @return invalid handle if the engine is not instantiated
+		 */
+		static PreparedCommand prepare(const std::string& command);
+
+		/**
+		 * @brief Owns temporary workspace variables and clears them when it goes out of scope.
+		 *
+		 * getName() returns names that are unique across all scopes and callers.
+		 * Those names, and every variable passed to addVariable() on the thread of the
+		 * innermost scope, are tracked. The destructor clears all of them with one clear command
+		 * and removes their MatlabArrays from the variable map; pointers to them become invalid.
+		 * The destructor does not wait for the engine. Scopes nest and must be destroyed
+		 * in reverse order of creation on the thread that created them.
+		 *
+		 * Example:
+		 * @code
+		 * {
+		 *     MatlabEngine::WorkspaceScope scope;
+		 *     std::string sys = scope.getName("sys");
+		 *     MatlabEngine::addVariable(A.toMatlabArray(scope.getName("A")));
+		 *     MatlabEngine::eval((sys + " = ss(" + scope.getName("A") + ", 1, 1, 0);").c_str());
+		 * } // sys and A are cleared
+		 * @endcode
+		 */
+		class MATLAB_API WorkspaceScope
+		{
+		public:
+			WorkspaceScope();
+			~WorkspaceScope();
+
+			WorkspaceScope(const WorkspaceScope&) = delete;
+			WorkspaceScope& operator=(const WorkspaceScope&) = delete;
+
+			/**
+			 * @brief Unique variable name derived from hint, the same hint returns the same name
+			 */
+			std::string getName(const std::string& hint);
+
+			/**
+			 * @brief Clears the variable name at the end of the scope
+			 */
+			void track(const std::string& name);
+			const std::vector<std::string>& getVariableNames() const { return m_names; }
+
+			/**
+			 * @brief Clears the tracked variables now and waits for the engine, the scope stays usable
+			 * @return false if the clear command failed
+			 */
+			bool clear();
+
+			/**
+			 * @brief Innermost scope of the calling thread, nullptr if there is none
+			 */
+			static WorkspaceScope* getCurrent();
+
+		private:
+			std::string m_prefix;
+			std::vector<std::string> m_names;
+			WorkspaceScope* m_parent;
+		};
+
+
+		/**
+		 * @brief Lazy handle to a workspace variable: metadata is queried without transferring the data.
+		 *
+		 * getRemoteVariable() queries class, size and memory with one whos call. The data is
+		 * transferred on the first call of getData() and cached in the handle; getRowRange()
+		 * transfers only the requested rows. The handle is a snapshot of the time of the query,
+		 * isCurrent() tells if an eval, feval or put may have changed the workspace since then,
+		 * refresh() queries the metadata again and drops the cached data.
+		 * Remote variables are not registered in the variable map of the engine.
+		 *
+		 * Example, reading the last 100 samples of a long log:
+		 * @code
+		 * MatlabEngine::RemoteVariable log = MatlabEngine::getRemoteVariable("log");
+		 * if (log.isValid() && log.getClassName() == "double" && log.getRows() >= 100)
+		 *     MatlabArray tail = log.getRowRange(log.getRows() - 100, 100);
+		 * @endcode
+		 */
+		class MATLAB_API RemoteVariable
+		{
+			friend class MatlabEngine;
+		public:
+			RemoteVariable();
+
+			/**
+			 * @brief true if the variable existed when the metadata was queried
+			 */
+			bool isValid() const { return m_valid; }
+			bool isCurrent() const;
+			const std::string& getName() const { return m_name; }
+
+			const EngineBackend::VariableInfo& getInfo() const { return m_info; }
+			const std::string& getClassName() const { return m_info.className; }
+			const std::vector<size_t>& getDimensions() const { return m_info.dimensions; }
+			size_t getRows() const { return m_info.getRows(); }
+			size_t getCols() const { return m_info.getCols(); }
+			size_t getNumberOfElements() const { return m_info.getNumberOfElements(); }
+			size_t getSizeInBytes() const { return m_info.bytes; }
+			bool isComplex() const { return m_info.complex; }
+			bool isSparse() const { return m_info.sparse; }
+
+			/**
+			 * @brief true if getData() has transferred the data
+			 */
+			bool isFetched() const { return m_data.isValid(); }
+
+			/**
+			 * @brief The whole array, transferred on the first call
+			 * @return invalid array if the handle is invalid or the transfer failed
+			 */
+			const MatlabArray& getData();
+
+			/**
+			 * @brief Rows [first, first + count) with all columns (dimensions beyond the second are folded into the columns).
+			 *        Only these rows are transferred, or they are copied from the cached data if getData() was called.
+			 *        Supports numeric and logical variables.
+			 * @return a count x getCols() array, an invalid array if the range exceeds getRows() or on error
+			 */
+			MatlabArray getRowRange(size_t first, size_t count) const;
+
+			/**
+			 * @brief Queries the metadata again and drops the cached data
+			 * @return false if the variable does not exist anymore
+			 */
+			bool refresh();
+
+		private:
+			RemoteVariable(const std::string& name);
+
+			std::string m_name;
+			EngineBackend::VariableInfo m_info;
+			bool m_valid = false;
+			uint64_t m_epoch = 0; // workspace epoch of the query
+			MatlabArray m_data;
+		};
+
+		/**
+		 * @brief Lazy handle to the variable name, see RemoteVariable.
+		 *        Only the metadata is transferred.
+		 * @return invalid handle if the variable does not exist or the engine is not instantiated
+		 */
+		static RemoteVariable getRemoteVariable(const std::string& name);
+
+		/**
+		 * @brief Writes values into a slice of the existing workspace variable name, see EngineBackend::Slice.
+		 *        Only values is transferred and assigned with one indexed assignment.
+		 * @return false if the variable does not exist, the sizes do not fit or the engine is not instantiated
+		 */
+		static bool setVariableSlice(const std::string& name, EngineBackend::Slice slice, size_t first, const MatlabArray& values);
+
+		/**
+		 * @brief Puts values under its name and grows the variable to rows rows, the new rows are zero.
+		 *        Preallocates a variable that is filled by setVariableSlice() afterwards.
+		 */
+		static bool preallocateVariable(const MatlabArray& values, size_t rows);
+
+		/**
+		 * @brief Workspace variable that grows by appended rows, for logs and other streamed data.
+		 *
+		 * Each append() transfers only the new rows and writes them with one indexed assignment.
+		 * The variable is preallocated in the engine and its capacity doubles whenever it is full,
+		 * so MATLAB copies every row O(1) times on average. Until trim() the variable has
+		 * getCapacity() rows in MATLAB, the rows beyond getRows() are zero.
+		 * The first append() creates (or replaces) the variable, later appends must have the same
+		 * number of columns. The destructor trims the variable without waiting for the engine.
+		 *
+		 * Example:
+		 * @code
+		 * MatlabEngine::GrowingVariable log("log");
+		 * while (acquiring)
+		 *     log.append(MatlabArray("samples", readSamples(), { 1000, 4 }));
+		 * log.trim();
+		 * MatlabEngine::eval("plot(log)");
+		 * @endcode
+		 */
+		class MATLAB_API GrowingVariable
+		{
+		public:
+			/**
+			 * @param initialCapacity rows allocated by the first append()
+			 */
+			explicit GrowingVariable(const std::string& name, size_t initialCapacity = 1024);
+			~GrowingVariable();
+
+			GrowingVariable(const GrowingVariable&) = delete;
+			GrowingVariable& operator=(const GrowingVariable&) = delete;
+
+			/**
+			 * @brief Appends the rows of a numeric or logical array
+			 * @return false if the columns do not match or the transfer failed, the variable is unchanged then
+			 */
+			bool append(const MatlabArray& rows);
+
+			/**
+			 * @brief Shrinks the variable in the engine to getRows() rows and waits for the engine
+			 */
+			bool trim();
+
+			const std::string& getName() const { return m_name; }
+			size_t getRows() const { return m_rows; }
+			size_t getCols() const { return m_cols; }
+
+			/**
+			 * @brief Rows allocated in the engine, 0 before the first append()
+			 */
+			size_t getCapacity() const { return m_capacity; }
+
+		private:
+			std::string m_name;
+			size_t m_initialCapacity;
+			size_t m_rows = 0;
+			size_t m_cols = 0;
+			size_t m_capacity = 0;
+		};
+
 
 		static int eval(const char* command);
 
+		/**
+		 * @brief Calls a MATLAB function with typed arguments.
+		 *        Arguments and return values are transferred directly: no command string
+		 *        gets parsed and the base workspace is not touched.
+		 * @param function name of the MATLAB function
+		 * @param nargout number of requested return values
+		 * @param args input arguments
+		 * @return the return values, empty on error
+		 */
+		static std::vector<MatlabArray> feval(const std::string& function, size_t nargout, const std::vector<MatlabArray>& args);
+
+		/**
+		 * @brief Calls a MATLAB function with MatlabArray, Matrix, scalar and string arguments
+		 * 
+		 * Example:
+		 * @code
+		 * std::vector<MatlabArray> sysd = MatlabEngine::feval("c2d", 1, sys, 0.001, "zoh");
+		 * @endcode
+		 */
+		template<typename... Args>
+		static std::vector<MatlabArray> feval(const std::string& function, size_t nargout, const Args&... args)
+		{
+			return feval(function, nargout, std::vector<MatlabArray>{ toArgument(args)... });
+		}
+
 		static bool addVariable(MatlabArray* var);
 		static bool removeVariable(const std::string& name);
-		static MatlabArray* getVariable(const std::string& name);
+		/**
+		 * @brief Copy of a variable, the variable is added to the map if it is not in there yet.
+		 *        The copy shares the data with the map entry and is not changed by later transfers,
+		 *        removeVariable() or other threads.
+		 * @return an invalid array if the variable does not exist
+		 */
+		static MatlabArray getVariable(const std::string& name);
 		static Matrix getMatrix(const std::string& name);
 		static std::vector<std::string> listVariables();
-#ifdef MATLAB_API_USE_CPP_API
+
+		// ===== Variable cache =====
+		// Every variable in the map remembers a content hash and the workspace epoch of its last transfer.
+		// Each eval/feval starts a new epoch, because it may have changed any variable in the workspace.
+		// Transfers of variables whose content is unchanged within the same epoch are skipped.
+
+		struct CacheStatistics
+		{
+			size_t hits = 0;   // transfers that were skipped
+			size_t misses = 0; // transfers that were executed
+		};
+		static CacheStatistics getCacheStatistics();
+		static void resetCacheStatistics();
+
+		/**
+		 * @brief Forces the next transfer of every variable, for example after the workspace
+		 *        was modified outside of this class
+		 */
+		static void invalidateVariableCache();
+		static uint64_t getWorkspaceEpoch();
+
+		/**
+		 * @brief Version of a variable in the map, incremented each time its content changes
+		 * @return 0 if the variable is not in the map
+		 */
+		static uint64_t getVariableVersion(const std::string& name);
+
 		static MatlabArray getProperty(MatlabArray* array, const std::u16string& property);
-#endif
+
+		// ===== Asynchronous API =====
+		// The calls return immediately, the result gets delivered through the returned future.
+		// Requests are executed by MATLAB in the order they are issued.
+		// Continuations run on the engine thread, not on the calling thread.
+		// They must not block on another future of the engine, see MatlabFuture.
+
+		/**
+		 * @brief Asynchronous version of eval
+		 * @return future which receives 0 on success, -1 on error
+		 */
+		static MatlabFuture<int> evalAsync(const std::string& command);
+
+		/**
+		 * @brief Calls a MATLAB function asynchronously
+		 * @param function name of the MATLAB function
+		 * @param nargout number of requested return values
+		 * @param args input arguments
+		 * @return future which receives the return values, empty on error
+		 */
+		static MatlabFuture<std::vector<MatlabArray>> fevalAsync(const std::string& function, size_t nargout, const std::vector<MatlabArray>& args);
+
+		/**
+		 * @brief Reads a variable from the MATLAB workspace asynchronously.
+		 *        The returned array is a detached copy, it is not registered in the variable map.
+		 * @return future which receives the array, an invalid array on error
+		 */
+		static MatlabFuture<MatlabArray> getVariableAsync(const std::string& name);
+
+		/**
+		 * @brief Writes var into the MATLAB workspace asynchronously, using the name of var
+		 * @return future which receives true on success
+		 */
+		static MatlabFuture<bool> setVariableAsync(const MatlabArray& var);
+
+		/**
+		 * @brief Asynchronous version of setVariableSlice
+		 * @return future which receives true on success
+		 */
+		static MatlabFuture<bool> setVariableSliceAsync(const std::string& name, EngineBackend::Slice slice, size_t first, const MatlabArray& values);
+
+		/**
+		 * @brief Reads rows [first, first + count) of a numeric or logical variable asynchronously,
+		 *        see EngineBackend::getVariableRows()
+		 * @return future which receives a count x columns array, an invalid array on error
+		 */
+		static MatlabFuture<MatlabArray> getVariableRowsAsync(const std::string& name, size_t first, size_t count);
 
 
 	private:
-#ifdef MATLAB_API_USE_CPP_API
-		static const std::unique_ptr<matlab::engine::MATLABEngine> &getEngine();
-#else
-		static Engine* getEngine();
-#endif
+		// Creates the backend on the engine thread, retries retryCount times
+		static bool start(const std::function<std::shared_ptr<EngineBackend>()>& createBackend, int retryCount);
+		static MatlabFuture<bool> startAsync(const std::function<std::shared_ptr<EngineBackend>()>& createBackend, int retryCount);
+		// Creates the instance, must be called on the engine thread
+		static bool createInstance(const std::function<std::shared_ptr<EngineBackend>()>& createBackend);
+		// Delay before the next attempt after attempt failed (1 based)
+		static std::chrono::milliseconds getRetryDelay(int attempt);
+
+		struct CachedVariable
+		{
+			MatlabArray* array = nullptr;
+			uint64_t contentHash = 0;
+			bool hashValid = false;
+			uint64_t version = 0;
+			uint64_t epoch = 0;  // workspace epoch of the last transfer
+			bool synced = false; // the engine held the same content after the last transfer
+		};
 
 		static bool updateVariableFromEngine(MatlabArray* var);
 		static bool sendVariableToEngine(MatlabArray* var);
+		static bool sendRowsToEngine(MatlabArray* var, size_t first, size_t count);
+
+		static CachedVariable* findCachedVariable(MatlabArray* var);
+		bool isInSync(const CachedVariable& entry, uint64_t& hash, bool& hashable) const;
+		bool pushVariable(CachedVariable& entry, EngineTelemetry::Scope& telemetry);
+		bool pullVariable(CachedVariable& entry, EngineTelemetry::Scope& telemetry);
+
+		// Transfers that bypass the variable map
+		static bool sendToEngine(const MatlabArray& var);
+		static MatlabArray receiveFromEngine(const std::string& name);
+		// Called from any thread, recorded in the telemetry
+		static bool queryVariable(const std::string& name, EngineBackend::VariableInfo& info);
+		static MatlabArray receiveVariable(const std::string& name);
+		static MatlabArray receiveRows(const std::string& name, size_t first, size_t count);
+		static bool resizeVariable(const std::string& name, size_t rows, bool wait);
+		static int evalScript(const std::string& script);
+		// Clears a variable without waiting for the engine
+		static void discardVariable(const std::string& name);
+		// Clears the variables with one command and removes them from the variable map
+		static bool removeVariables(const std::vector<std::string>& names, bool wait);
 
 		static void err_matlabNotStarted();
 
+		static const MatlabArray& toArgument(const MatlabArray& value) { return value; }
+		static MatlabArray toArgument(const Matrix& value);
+		static MatlabArray toArgument(double value) { return MatlabArray("arg", value); }
+		static MatlabArray toArgument(const std::string& value) { return MatlabArray("arg", value); }
+		static MatlabArray toArgument(const char* value) { return MatlabArray("arg", std::string(value)); }
+
+		// ===== Engine thread =====
+		static bool isEngineThread();
+		// Appends a job to the queue of the engine thread, starts the thread if needed
+		static void postJob(std::function<void()>&& job);
+		// Executes the queued jobs and stops the engine thread
+		static void stopEngineThread();
+		// Lets the engine thread exit once the queue is empty, can be called on the engine thread
+		static void finishEngineThread();
+
+		// Executes func on the engine thread and waits for its result
+		template<typename Func>
+		static auto invoke(Func&& func) -> decltype(func())
+		{
+			if (isEngineThread())
+				return func();
+			std::packaged_task<decltype(func())()> task(std::forward<Func>(func));
+			auto result = task.get_future();
+			postJob([&task]() { task(); });
+			return result.get();
+		}
+
 	
-		std::unordered_map<std::string, MatlabArray*> m_variables; // map of variable name to MatlabArray
+		std::unordered_map<std::string, CachedVariable> m_variables; // map of variable name to MatlabArray
+		std::atomic<uint64_t> m_workspaceEpoch{ 1 };
+		CacheStatistics m_cacheStatistics;
 	};
 }
\ No newline at end of file
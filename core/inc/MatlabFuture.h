@@ -0,0 +1,322 @@
+#pragma once
+#include "MatlabAPI_base.h"
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <vector>
+#include <chrono>
+#include <exception>
+#include <future>
+#include <stdexcept>
+#include <optional>
+#include <type_traits>
+
+namespace MatlabAPI
+{
+	template<typename T>
+	class MatlabFuture;
+
+	template<typename T>
+	class MatlabPromise;
+
+	namespace Internal
+	{
+		template<typename T>
+		struct FutureState
+		{
+			typedef typename std::conditional<std::is_void<T>::value, bool, T>::type Stored;
+
+			std::mutex mutex;
+			std::condition_variable readyCondition;
+			bool ready = false;
+			bool cancelled = false;
+			std::optional<Stored> value;
+			std::exception_ptr exception;
+			std::vector<std::function<void()>> continuations;
+			std::function<bool()> canceller;
+
+			// Returns false if the state was already completed
+			template<typename Setter>
+			bool complete(Setter&& setter)
+			{
+				std::vector<std::function<void()>> pending;
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					if (ready)
+						return false;
+					setter();
+					ready = true;
+					pending.swap(continuations);
+					canceller = nullptr;
+				}
+				readyCondition.notify_all();
+				for (auto& continuation : pending)
+					continuation();
+				return true;
+			}
+		};
+
+		// Shared by all copies of a MatlabPromise, the last copy that goes away
+		// breaks a state that never received a result, so waiting futures don't hang
+		template<typename T>
+		struct PromiseOwner
+		{
+			std::shared_ptr<FutureState<T>> state;
+
+			explicit PromiseOwner(const std::shared_ptr<FutureState<T>>& state)
+				: state(state)
+			{}
+			~PromiseOwner()
+			{
+				state->complete([this]() { state->exception = std::make_exception_ptr(std::future_error(std::future_errc::broken_promise)); });
+			}
+		};
+
+		template<typename T, typename Func>
+		auto invokeContinuation(Func& func, FutureState<T>& state)
+		{
+			if constexpr (std::is_void<T>::value)
+				return func();
+			else
+				return func(*state.value);
+		}
+	}
+
+	/**
+	 * @brief Result of an asynchronous MATLAB operation.
+	 *
+	 * Copies refer to the same result, get() can be called multiple times.
+	 * Continuations registered with then() are executed on the thread that completes
+	 * the operation, for MatlabEngine futures the engine thread itself, or immediately on
+	 * the calling thread if the result is already available. GUI code has to post back to its
+	 * own thread (for example using QMetaObject::invokeMethod) before touching widgets.
+	 *
+	 * A continuation must not wait for another MatlabEngine future (get(), wait()): that
+	 * operation is queued behind the running continuation and never completes. Chain it with
+	 * then() instead, or call the synchronous MatlabEngine functions, which run inline on the engine thread.
+	 */
+	template<typename T>
+	class MatlabFuture
+	{
+		friend class MatlabPromise<T>;
+		template<typename> friend class MatlabFuture;
+	public:
+		MatlabFuture() = default;
+
+		/**
+		 * @brief Creates a future that already holds a value
+		 */
+		template<typename U = T, typename = typename std::enable_if<!std::is_void<U>::value>::type>
+		static MatlabFuture makeReady(U value)
+		{
+			MatlabPromise<T> promise;
+			promise.setValue(std::move(value));
+			return promise.getFuture();
+		}
+
+		bool isValid() const { return m_state != nullptr; }
+		bool isReady() const
+		{
+			if (!m_state)
+				return false;
+			std::lock_guard<std::mutex> lock(m_state->mutex);
+			return m_state->ready;
+		}
+		bool isCancelled() const
+		{
+			if (!m_state)
+				return false;
+			std::lock_guard<std::mutex> lock(m_state->mutex);
+			return m_state->cancelled;
+		}
+
+		void wait() const
+		{
+			checkValid();
+			std::unique_lock<std::mutex> lock(m_state->mutex);
+			m_state->readyCondition.wait(lock, [this]() { return m_state->ready; });
+		}
+
+		/**
+		 * @return true if the result is available
+		 */
+		template<typename Rep, typename Period>
+		bool waitFor(const std::chrono::duration<Rep, Period>& timeout) const
+		{
+			checkValid();
+			std::unique_lock<std::mutex> lock(m_state->mutex);
+			return m_state->readyCondition.wait_for(lock, timeout, [this]() { return m_state->ready; });
+		}
+
+		/**
+		 * @brief Blocks until the result is available
+		 * @throws std::runtime_error if the operation was cancelled,
+		 *         std::future_error (broken_promise) if the promise was dropped without a result,
+		 *         rethrows the exception of a failed operation or continuation
+		 */
+		T get() const
+		{
+			wait();
+			if (m_state->exception)
+				std::rethrow_exception(m_state->exception);
+			if constexpr (!std::is_void<T>::value)
+				return *m_state->value;
+		}
+
+		/**
+		 * @brief Tries to cancel the operation.
+		 *        An operation that already runs in MATLAB gets interrupted if possible.
+		 * @return true if the future is now cancelled, false if the result was already available
+		 */
+		bool cancel()
+		{
+			if (!m_state)
+				return false;
+			std::function<bool()> canceller;
+			{
+				std::lock_guard<std::mutex> lock(m_state->mutex);
+				if (m_state->ready)
+					return false;
+				canceller = m_state->canceller;
+			}
+			if (canceller)
+				canceller();
+			m_state->complete([this]() {
+				m_state->cancelled = true;
+				m_state->exception = std::make_exception_ptr(std::runtime_error("MATLAB operation was cancelled"));
+				});
+			// The canceller may already have completed this future through a cancelled predecessor
+			return isCancelled();
+		}
+
+		/**
+		 * @brief Registers a continuation which receives the result of this future.
+		 *        If this future fails or gets cancelled, the continuation is skipped and
+		 *        the returned future receives the same exception.
+		 *        Cancelling the returned future also cancels this future.
+		 * @param func callable with the signature R(T), or R() for MatlabFuture<void>
+		 * @return future which receives the return value of the continuation
+		 */
+		template<typename Func>
+		auto then(Func&& func) -> MatlabFuture<decltype(Internal::invokeContinuation<T>(func, std::declval<Internal::FutureState<T>&>()))>
+		{
+			typedef decltype(Internal::invokeContinuation<T>(func, std::declval<Internal::FutureState<T>&>())) R;
+			checkValid();
+			MatlabPromise<R> next;
+			// The continuation is stored in the state it reads, a shared pointer would keep a state alive
+			// that never completes. It only runs from complete() or below, while the state is still referenced.
+			// The promise is owned by the continuation, dropping it without running breaks the returned future.
+			Internal::FutureState<T>* state = m_state.get();
+			std::function<void()> continuation = [state, promise = next, func = std::forward<Func>(func)]() mutable {
+				if (state->exception)
+				{
+					std::shared_ptr<Internal::FutureState<R>> nextState = promise.m_state;
+					nextState->complete([&]() {
+						nextState->cancelled = state->cancelled;
+						nextState->exception = state->exception;
+						});
+					return;
+				}
+				try {
+					if constexpr (std::is_void<R>::value)
+					{
+						Internal::invokeContinuation<T>(func, *state);
+						promise.setValue();
+					}
+					else
+						promise.setValue(Internal::invokeContinuation<T>(func, *state));
+				}
+				catch (...) {
+					promise.setException(std::current_exception());
+				}
+				};
+
+			std::weak_ptr<Internal::FutureState<T>> weakState = m_state;
+			next.setCanceller([weakState]() {
+				MatlabFuture<T> upstream;
+				upstream.m_state = weakState.lock();
+				return upstream.cancel();
+				});
+
+			bool runNow = false;
+			{
+				std::lock_guard<std::mutex> lock(m_state->mutex);
+				if (m_state->ready)
+					runNow = true;
+				else
+					m_state->continuations.push_back(continuation);
+			}
+			if (runNow)
+				continuation();
+			return next.getFuture();
+		}
+
+	private:
+		explicit MatlabFuture(const std::shared_ptr<Internal::FutureState<T>>& state)
+			: m_state(state)
+		{}
+
+		void checkValid() const
+		{
+			if (!m_state)
+				throw std::logic_error("MatlabFuture has no shared state");
+		}
+
+		std::shared_ptr<Internal::FutureState<T>> m_state;
+	};
+
+	/**
+	 * @brief Producer side of a MatlabFuture.
+	 *        Only the first call to setValue() or setException() has an effect,
+	 *        a cancelled future ignores the late result. Copies share the result, if the
+	 *        last copy is destroyed without a result the future fails with broken_promise.
+	 */
+	template<typename T>
+	class MatlabPromise
+	{
+		template<typename> friend class MatlabFuture;
+	public:
+		MatlabPromise()
+			: m_state(std::make_shared<Internal::FutureState<T>>())
+			, m_owner(std::make_shared<Internal::PromiseOwner<T>>(m_state))
+		{}
+
+		MatlabFuture<T> getFuture() const { return MatlabFuture<T>(m_state); }
+
+		template<typename U = T, typename = typename std::enable_if<!std::is_void<U>::value>::type>
+		bool setValue(U value)
+		{
+			return m_state->complete([&]() { m_state->value.emplace(std::move(value)); });
+		}
+		template<typename U = T, typename = typename std::enable_if<std::is_void<U>::value>::type>
+		bool setValue()
+		{
+			return m_state->complete([&]() { m_state->value.emplace(true); });
+		}
+		bool setException(std::exception_ptr exception)
+		{
+			return m_state->complete([&]() { m_state->exception = exception; });
+		}
+
+		/**
+		 * @brief Sets the function that gets called by MatlabFuture::cancel() to abort the running operation
+		 */
+		void setCanceller(std::function<bool()> canceller)
+		{
+			std::lock_guard<std::mutex> lock(m_state->mutex);
+			if (!m_state->ready)
+				m_state->canceller = std::move(canceller);
+		}
+
+		bool isCancelled() const
+		{
+			std::lock_guard<std::mutex> lock(m_state->mutex);
+			return m_state->cancelled;
+		}
+
+	private:
+		std::shared_ptr<Internal::FutureState<T>> m_state;
+		std::shared_ptr<Internal::PromiseOwner<T>> m_owner;
+	};
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include "MatlabAPI_base.h"
+#include <cstdint>
+#include <cstddef>
+
+namespace MatlabAPI
+{
+	/**
+	 * @brief Bulk conversion between the numeric element types of MATLAB arrays.
+	 *
+	 * Every function converts count elements from source into the caller provided target,
+	 * target[i] = source[i] * scale + offset. 8, 16 bit, 32 bit integers and single are converted
+	 * 4 (SSE2) or 8 (AVX2) elements at a time, 64 bit integers by a scalar loop.
+	 * Conversions to float round to nearest like a static_cast.
+	 */
+	class MATLAB_API NumericConversion
+	{
+	public:
+		static void toDouble(const double* source, size_t count, double* target, double scale = 1.0, double offset = 0.0);
+		static void toDouble(const float* source, size_t count, double* target, double scale = 1.0, double offset = 0.0);
+		static void toDouble(const int8_t* source, size_t count, double* target, double scale = 1.0, double offset = 0.0);
+		static void toDouble(const uint8_t* source, size_t count, double* target, double scale = 1.0, double offset = 0.0);
+		static void toDouble(const int16_t* source, size_t count, double* target, double scale = 1.0, double offset = 0.0);
+		static void toDouble(const uint16_t* source, size_t count, double* target, double scale = 1.0, double offset = 0.0);
+		static void toDouble(const int32_t* source, size_t count, double* target, double scale = 1.0, double offset = 0.0);
+		static void toDouble(const uint32_t* source, size_t count, double* target, double scale = 1.0, double offset = 0.0);
+		static void toDouble(const int64_t* source, size_t count, double* target, double scale = 1.0, double offset = 0.0);
+		static void toDouble(const uint64_t* source, size_t count, double* target, double scale = 1.0, double offset = 0.0);
+		static void toDouble(const bool* source, size_t count, double* target, double scale = 1.0, double offset = 0.0);
+
+		static void toSingle(const double* source, size_t count, float* target);
+	};
+}
@@ -0,0 +1,424 @@
+#pragma once
+#include "MatlabAPI_base.h"
+#include "MatlabArray.h"
+#include "math/Matrix.h"
+#include <string>
+#include <vector>
+#include <tuple>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+namespace MatlabAPI
+{
+	/**
+	 * @brief Field list of a C++ aggregate that is marshalled to a MATLAB struct by StructMarshaller.
+	 *        Specialized with MATLAB_API_STRUCT_SCHEMA(), fields is a tuple of StructField.
+	 */
+	template<typename T>
+	struct StructSchema;
+
+	template<typename T, typename = void>
+	struct HasStructSchema : std::false_type {};
+	template<typename T>
+	struct HasStructSchema<T, std::void_t<decltype(StructSchema<T>::fields)>> : std::true_type {};
+
+	/**
+	 * @brief MATLAB field name and member of one schema field
+	 */
+	template<typename Class, typename Member>
+	struct StructField
+	{
+		const char* name;
+		Member Class::* member;
+	};
+
+	template<typename Class, typename Member>
+	constexpr StructField<Class, Member> makeStructField(const char* name, Member Class::* member)
+	{
+		return { name, member };
+	}
+
+	/**
+	 * @brief Converts a field value to and from a MatlabArray, specialized for:
+	 *        arithmetic types and bool (1 x 1), std::string (char), std::vector of arithmetic types,
+	 *        bool and std::string (N x 1, strings as cell), Matrix, MatlabArray,
+	 *        types with a StructSchema (struct) and std::vector of them (1 x N struct array)
+	 * fromArray() throws std::runtime_error if the array can't be converted.
+	 */
+	template<typename T, typename = void>
+	struct StructFieldValue;
+
+	/**
+	 * @brief Marshals C++ aggregates with a StructSchema to and from MATLAB structs and struct arrays.
+	 *
+	 * The field names are collected from the schema once per type, a struct array is created
+	 * with all fields at once and each element is filled with MatlabArray::setFields().
+	 * Reading resolves the position of each schema field in the array once per call and then
+	 * reads each element with MatlabArray::getFields(), fields that are not in the schema are ignored.
+	 *
+	 * Example:
+	 * @code
+	 * struct Sample { double time; std::vector<double> values; std::string unit; };
+	 * MATLAB_API_STRUCT_SCHEMA(Sample, MATLAB_API_FIELD(time), MATLAB_API_FIELD(values), MATLAB_API_FIELD_AS(unit, "Unit"));
+	 *
+	 * MatlabArray array = StructMarshaller::toStructArray("samples", samples);       // 1 x N struct
+	 * std::vector<Sample> back = StructMarshaller::fromStructArray<Sample>(array);
+	 * @endcode
+	 */
+	class StructMarshaller
+	{
+	public:
+		/**
+		 * @brief 1 x 1 struct
+		 */
+		template<typename T>
+		static MatlabArray toStruct(const std::string& name, const T& value);
+
+		/**
+		 * @brief 1 x N struct array
+		 */
+		template<typename T>
+		static MatlabArray toStructArray(const std::string& name, const std::vector<T>& values);
+
+		/**
+		 * @throws std::runtime_error if the array is not a struct, lacks a schema field or a field can't be converted
+		 * @throws std::out_of_range if index >= array.getNumberOfElements()
+		 */
+		template<typename T>
+		static T fromStruct(const MatlabArray& array, size_t index = 0);
+		template<typename T>
+		static void fromStruct(const MatlabArray& array, T& value, size_t index = 0);
+
+		/**
+		 * @brief All elements of a struct array in column-major order
+		 */
+		template<typename T>
+		static std::vector<T> fromStructArray(const MatlabArray& array);
+
+		/**
+		 * @brief MATLAB field names of the schema of T, in schema order
+		 */
+		template<typename T>
+		static const std::vector<std::string>& getFieldNames();
+
+	private:
+		template<typename T>
+		static std::vector<MatlabArray> toFields(const T& value);
+
+		// Position of each schema field in arrayFields, the field names of array
+		template<typename T>
+		static std::vector<size_t> getFieldIndices(const MatlabArray& array, const std::vector<std::string>& arrayFields);
+
+		template<typename T>
+		static void fromFields(const std::vector<MatlabArray>& fields, const std::vector<size_t>& indices, T& value);
+	};
+
+	namespace Internal
+	{
+		template<size_t Size, bool Signed>
+		struct IntegerOfSize;
+		template<> struct IntegerOfSize<1, true>  { typedef int8_t type; };
+		template<> struct IntegerOfSize<1, false> { typedef uint8_t type; };
+		template<> struct IntegerOfSize<2, true>  { typedef int16_t type; };
+		template<> struct IntegerOfSize<2, false> { typedef uint16_t type; };
+		template<> struct IntegerOfSize<4, true>  { typedef int32_t type; };
+		template<> struct IntegerOfSize<4, false> { typedef uint32_t type; };
+		template<> struct IntegerOfSize<8, true>  { typedef int64_t type; };
+		template<> struct IntegerOfSize<8, false> { typedef uint64_t type; };
+
+		// MATLAB element type of an arithmetic field, e.g. long -> int32 or int64 depending on the platform
+		template<typename T>
+		using StructElementType = typename std::conditional<std::is_floating_point<T>::value,
+			typename std::conditional<sizeof(T) == sizeof(float), float, double>::type,
+			typename IntegerOfSize<sizeof(T), std::is_signed<T>::value>::type>::type;
+
+		template<typename E>
+		bool hasElementType(const MatlabArray& array)
+		{
+			if constexpr (std::is_same<E, double>::value) return array.isDouble();
+			else if constexpr (std::is_same<E, float>::value) return array.isSingle();
+			else if constexpr (std::is_same<E, int8_t>::value) return array.isInt8();
+			else if constexpr (std::is_same<E, uint8_t>::value) return array.isUint8();
+			else if constexpr (std::is_same<E, int16_t>::value) return array.isInt16();
+			else if constexpr (std::is_same<E, uint16_t>::value) return array.isUint16();
+			else if constexpr (std::is_same<E, int32_t>::value) return array.isInt32();
+			else if constexpr (std::is_same<E, uint32_t>::value) return array.isUint32();
+			else if constexpr (std::is_same<E, int64_t>::value) return array.isInt64();
+			else if constexpr (std::is_same<E, uint64_t>::value) return array.isUint64();
+			else return array.isLogical();
+		}
+
+		// Elements of a real numeric or logical array, without a detour through double if the class matches
+		template<typename T>
+		std::vector<T> getElements(const MatlabArray& array)
+		{
+			typedef StructElementType<T> E;
+			size_t count = array.getNumberOfElements();
+			if (hasElementType<E>(array))
+			{
+				const E* data = array.view<E>().data();
+				return std::vector<T>(data, data + count);
+			}
+			if (!(array.isNumeric() || array.isLogical()) || array.isComplex())
+				throw std::runtime_error("Field '" + array.getName() + "' of class " + array.getClassName() + " is not real numeric");
+			std::vector<double> converted(count);
+			array.copyAsDouble(converted.data());
+			return std::vector<T>(converted.begin(), converted.end());
+		}
+	}
+
+	template<typename T>
+	struct StructFieldValue<T, typename std::enable_if<std::is_arithmetic<T>::value && !std::is_same<T, bool>::value>::type>
+	{
+		static MatlabArray toArray(const std::string& name, T value)
+		{
+			typedef Internal::StructElementType<T> E;
+			ArrayBuffer<E> buffer = MatlabArray::createBuffer<E>(1);
+			buffer.data()[0] = (E)value;
+			return MatlabArray(name, std::move(buffer), { 1, 1 });
+		}
+		static void fromArray(const MatlabArray& array, T& value)
+		{
+			if (array.getNumberOfElements() != 1)
+				throw std::runtime_error("Field '" + array.getName() + "' is not a scalar");
+			value = Internal::getElements<T>(array)[0];
+		}
+	};
+
+	template<>
+	struct StructFieldValue<bool>
+	{
+		static MatlabArray toArray(const std::string& name, bool value)
+		{
+			ArrayBuffer<bool> buffer = MatlabArray::createBuffer<bool>(1);
+			buffer.data()[0] = value;
+			return MatlabArray(name, std::move(buffer), { 1, 1 });
+		}
+		static void fromArray(const MatlabArray& array, bool& value)
+		{
+			if (array.getNumberOfElements() != 1)
+				throw std::runtime_error("Field '" + array.getName() + "' is not a scalar");
+			value = array.isLogical() ? array.view<bool>().data()[0] : Internal::getElements<double>(array)[0] != 0.0;
+		}
+	};
+
+	template<>
+	struct StructFieldValue<std::string>
+	{
+		static MatlabArray toArray(const std::string& name, const std::string& value) { return MatlabArray(name, value); }
+		static void fromArray(const MatlabArray& array, std::string& value) { value = array.getString(); }
+	};
+
+	template<typename T>
+	struct StructFieldValue<std::vector<T>, typename std::enable_if<std::is_arithmetic<T>::value && !std::is_same<T, bool>::value>::type>
+	{
+		static MatlabArray toArray(const std::string& name, const std::vector<T>& value)
+		{
+			typedef Internal::StructElementType<T> E;
+			ArrayBuffer<E> buffer = MatlabArray::createBuffer<E>(value.size());
+			for (size_t i = 0; i < value.size(); ++i)
+				buffer.data()[i] = (E)value[i];
+			return MatlabArray(name, std::move(buffer), { value.size(), 1 });
+		}
+		static void fromArray(const MatlabArray& array, std::vector<T>& value) { value = Internal::getElements<T>(array); }
+	};
+
+	template<>
+	struct StructFieldValue<std::vector<bool>>
+	{
+		static MatlabArray toArray(const std::string& name, const std::vector<bool>& value) { return MatlabArray(name, value); }
+		static void fromArray(const MatlabArray& array, std::vector<bool>& value) { value = array.getLogicalVector(); }
+	};
+
+	template<>
+	struct StructFieldValue<std::vector<std::string>>
+	{
+		static MatlabArray toArray(const std::string& name, const std::vector<std::string>& value)
+		{
+			MatlabArray cell = MatlabArray::createCell(name, value.size(), 1);
+			for (size_t i = 0; i < value.size(); ++i)
+				cell.setCell(i, MatlabArray(name, value[i]));
+			return cell;
+		}
+		static void fromArray(const MatlabArray& array, std::vector<std::string>& value)
+		{
+			value.clear();
+			if (array.isEmpty())
+				return;
+			if (!array.isCell())
+				throw std::runtime_error("Field '" + array.getName() + "' is not a cell array");
+			value.reserve(array.getNumberOfElements());
+			for (size_t i = 0; i < array.getNumberOfElements(); ++i)
+				value.push_back(array.getCell(i).getString());
+		}
+	};
+
+	template<>
+	struct StructFieldValue<Matrix>
+	{
+		static MatlabArray toArray(const std::string& name, const Matrix& value)
+		{
+			std::unique_ptr<MatlabArray> array(value.toMatlabArray(name));
+			return std::move(*array);
+		}
+		static void fromArray(const MatlabArray& array, Matrix& value)
+		{
+			MatlabArray shared(array);
+			value = Matrix(&shared);
+		}
+	};
+
+	template<>
+	struct StructFieldValue<MatlabArray>
+	{
+		static MatlabArray toArray(const std::string& name, const MatlabArray& value)
+		{
+			MatlabArray array(value);
+			array.setName(name);
+			return array;
+		}
+		static void fromArray(const MatlabArray& array, MatlabArray& value) { value = array; }
+	};
+
+	template<typename T>
+	struct StructFieldValue<T, typename std::enable_if<HasStructSchema<T>::value>::type>
+	{
+		static MatlabArray toArray(const std::string& name, const T& value) { return StructMarshaller::toStruct(name, value); }
+		static void fromArray(const MatlabArray& array, T& value) { StructMarshaller::fromStruct(array, value); }
+	};
+
+	template<typename T>
+	struct StructFieldValue<std::vector<T>, typename std::enable_if<HasStructSchema<T>::value>::type>
+	{
+		static MatlabArray toArray(const std::string& name, const std::vector<T>& value) { return StructMarshaller::toStructArray(name, value); }
+		static void fromArray(const MatlabArray& array, std::vector<T>& value)
+		{
+			// Fields that were never set are []
+			if (array.isEmpty() && !array.isStruct())
+				value.clear();
+			else
+				value = StructMarshaller::fromStructArray<T>(array);
+		}
+	};
+
+	// ===== StructMarshaller =====
+
+	template<typename T>
+	const std::vector<std::string>& StructMarshaller::getFieldNames()
+	{
+		static_assert(HasStructSchema<T>::value, "T has no StructSchema, declare it with MATLAB_API_STRUCT_SCHEMA()");
+		static const std::vector<std::string> names = std::apply([](const auto&... field) {
+			return std::vector<std::string>{ field.name... };
+			}, StructSchema<T>::fields);
+		return names;
+	}
+
+	template<typename T>
+	std::vector<MatlabArray> StructMarshaller::toFields(const T& value)
+	{
+		std::vector<MatlabArray> fields;
+		fields.reserve(std::tuple_size<typename std::decay<decltype(StructSchema<T>::fields)>::type>::value);
+		std::apply([&](const auto&... field) {
+			(fields.push_back(StructFieldValue<typename std::decay<decltype(value.*(field.member))>::type>::toArray(
+				field.name, value.*(field.member))), ...);
+			}, StructSchema<T>::fields);
+		return fields;
+	}
+
+	template<typename T>
+	MatlabArray StructMarshaller::toStruct(const std::string& name, const T& value)
+	{
+		// The struct is created with the fields in schema order, so the values need no lookup
+		const std::vector<std::string>& names = getFieldNames<T>();
+		MatlabArray array = MatlabArray::createStruct(name, 1, 1, names);
+		array.setFields(0, toFields(value), names);
+		return array;
+	}
+
+	template<typename T>
+	MatlabArray StructMarshaller::toStructArray(const std::string& name, const std::vector<T>& values)
+	{
+		const std::vector<std::string>& names = getFieldNames<T>();
+		MatlabArray array = MatlabArray::createStruct(name, 1, values.size(), names);
+		for (size_t i = 0; i < values.size(); ++i)
+			array.setFields(i, toFields(values[i]), names);
+		return array;
+	}
+
+	template<typename T>
+	std::vector<size_t> StructMarshaller::getFieldIndices(const MatlabArray& array, const std::vector<std::string>& arrayFields)
+	{
+		std::unordered_map<std::string, size_t> positions;
+		for (size_t i = 0; i < arrayFields.size(); ++i)
+			positions.emplace(arrayFields[i], i);
+
+		const std::vector<std::string>& names = getFieldNames<T>();
+		std::vector<size_t> indices;
+		indices.reserve(names.size());
+		for (const std::string& name : names)
+		{
+			auto it = positions.find(name);
+			if (it == positions.end())
+				throw std::runtime_error("Struct '" + array.getName() + "' has no field '" + name + "'");
+			indices.push_back(it->second);
+		}
+		return indices;
+	}
+
+	template<typename T>
+	void StructMarshaller::fromFields(const std::vector<MatlabArray>& fields, const std::vector<size_t>& indices, T& value)
+	{
+		size_t i = 0;
+		std::apply([&](const auto&... field) {
+			(StructFieldValue<typename std::decay<decltype(value.*(field.member))>::type>::fromArray(
+				fields[indices[i++]], value.*(field.member)), ...);
+			}, StructSchema<T>::fields);
+	}
+
+	template<typename T>
+	void StructMarshaller::fromStruct(const MatlabArray& array, T& value, size_t index)
+	{
+		std::vector<std::string> arrayFields = array.getFieldNames();
+		std::vector<size_t> indices = getFieldIndices<T>(array, arrayFields);
+		fromFields(array.getFields(index, arrayFields), indices, value);
+	}
+
+	template<typename T>
+	T StructMarshaller::fromStruct(const MatlabArray& array, size_t index)
+	{
+		T value{};
+		fromStruct(array, value, index);
+		return value;
+	}
+
+	template<typename T>
+	std::vector<T> StructMarshaller::fromStructArray(const MatlabArray& array)
+	{
+		// The field names are resolved once, the elements are read by position
+		std::vector<std::string> arrayFields = array.getFieldNames();
+		std::vector<size_t> indices = getFieldIndices<T>(array, arrayFields);
+		std::vector<T> values(array.getNumberOfElements());
+		for (size_t i = 0; i < values.size(); ++i)
+			fromFields(array.getFields(i, arrayFields), indices, values[i]);
+		return values;
+	}
+}
+
+/**
+ * @brief Declares the StructSchema of Type, use it at global namespace scope:
+ *        MATLAB_API_STRUCT_SCHEMA(Type, MATLAB_API_FIELD(member), MATLAB_API_FIELD_AS(member, "matlabName"), ...)
+ */
+#define MATLAB_API_STRUCT_SCHEMA(Type, ...) \
+	template<> struct MatlabAPI::StructSchema<Type> \
+	{ \
+		typedef Type type; \
+		static constexpr auto fields = std::make_tuple(__VA_ARGS__); \
+	}
+
+#define MATLAB_API_FIELD(member) MatlabAPI::makeStructField(#member, &type::member)
+#define MATLAB_API_FIELD_AS(member, matlabName) MatlabAPI::makeStructField(matlabName, &type::member)
@@ -0,0 +1,37 @@
+#pragma once
+#include "MatlabAPI_base.h"
+#include <string>
+
+namespace MatlabAPI
+{
+	/**
+	 * @brief Portable UTF-8 <-> UTF-16 transcoding.
+	 *
+	 * Runs of ASCII characters are converted 16 (SSE2) or 32 (AVX2) characters at a time,
+	 * everything else by a scalar decoder. Invalid input (truncated or overlong sequences,
+	 * unpaired surrogates) is replaced by U+FFFD instead of throwing.
+	 */
+	class MATLAB_API Utf
+	{
+	public:
+		static std::u16string toUtf16(const char* data, size_t size);
+		static std::u16string toUtf16(const char* text);
+		static std::u16string toUtf16(const std::string& text);
+
+		static std::string toUtf8(const char16_t* data, size_t size);
+		static std::string toUtf8(const std::u16string& text);
+
+		/**
+		 * @brief UTF-16 version of a variable, function or property name from a process wide cache.
+		 *        Repeated lookups of the same name neither convert nor allocate.
+		 *        The returned reference stays valid for the lifetime of the process.
+		 *        Names longer than maxInternedNameLength or beyond maxInternedNames are not cached;
+		 *        those are returned in a thread local buffer that is valid until the next call on the same thread.
+		 */
+		static const std::u16string& toUtf16Name(const std::string& name);
+
+		static constexpr size_t maxInternedNameLength = 63; // namelengthmax of MATLAB
+		static constexpr size_t maxInternedNames = 4096;
+		static size_t getInternedNameCount();
+	};
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include "MatlabAPI_base.h"
+#include <vector>
+#include <memory>
+
+namespace MatlabAPI
+{
+	/**
+	 * @brief Contiguous storage for the numerator/denominator coefficients of many transfer functions.
+	 *
+	 * All coefficients live in one std::vector<double>. Each entry is described by an
+	 * offset/length pair for its numerator and its denominator.
+	 * Copies share the same storage (copy-on-write): copying an arena is O(1) and the
+	 * coefficients are only duplicated when a shared arena is modified.
+	 */
+	class MATLAB_API CoefficientArena
+	{
+	public:
+		struct Entry
+		{
+			size_t numeratorOffset = 0;
+			size_t numeratorLength = 0;
+			size_t denominatorOffset = 0;
+			size_t denominatorLength = 0;
+		};
+
+		CoefficientArena();
+
+		/**
+		 * @brief Creates an arena with entryCount empty entries
+		 * @param entryCount number of entries
+		 * @param coefficientCapacity number of coefficients to reserve in the contiguous buffer
+		 */
+		explicit CoefficientArena(size_t entryCount, size_t coefficientCapacity = 0);
+
+		/**
+		 * @brief Creates an arena from an already packed coefficient buffer, for example after deserialisation
+		 * @param coefficients contiguous coefficient buffer
+		 * @param entries offset/length descriptors into the coefficient buffer
+		 */
+		CoefficientArena(std::vector<double> coefficients, std::vector<Entry> entries);
+
+		CoefficientArena(const CoefficientArena& other);
+		CoefficientArena(CoefficientArena&& other) noexcept;
+		~CoefficientArena();
+
+		CoefficientArena& operator=(const CoefficientArena& other);
+		CoefficientArena& operator=(CoefficientArena&& other) noexcept;
+
+		size_t getEntryCount() const { return m_storage ? m_storage->entries.size() : 0; }
+
+		const Entry& getEntry(size_t index) const;
+
+		const double* getNumerator(size_t index) const;
+		size_t getNumeratorLength(size_t index) const { return getEntry(index).numeratorLength; }
+
+		const double* getDenominator(size_t index) const;
+		size_t getDenominatorLength(size_t index) const { return getEntry(index).denominatorLength; }
+
+		/**
+		 * @brief Overwrites the coefficients of one entry.
+		 *        The old slot is reused if the new coefficients fit into it,
+		 *        otherwise the coefficients get appended to the end of the buffer.
+		 */
+		void set(size_t index, const double* numerator, size_t numeratorLength, const double* denominator, size_t denominatorLength);
+
+		/**
+		 * @brief Removes unused gaps from the coefficient buffer that were left behind by set()
+		 */
+		void compact();
+
+		/**
+		 * @brief Access to the whole contiguous coefficient buffer
+		 */
+		const std::vector<double>& getCoefficients() const;
+		const std::vector<Entry>& getEntries() const;
+
+		/**
+		 * @brief true if the storage is shared with another arena
+		 */
+		bool isShared() const { return m_storage && m_storage.use_count() > 1; }
+
+	private:
+		struct Storage
+		{
+			std::vector<double> coefficients;
+			std::vector<Entry> entries;
+		};
+
+		void detach();
+
+		std::shared_ptr<Storage> m_storage;
+	};
+}
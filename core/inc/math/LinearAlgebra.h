@@ -0,0 +1,79 @@
+#pragma once
+#include "MatlabAPI_base.h"
+#include "Matrix.h"
+#include <vector>
+
+namespace MatlabAPI
+{
+	/**
+	 * @brief Native dense linear algebra routines that do not need the MATLAB engine.
+	 */
+	class MATLAB_API LinearAlgebra
+	{
+	public:
+		/**
+		 * @brief Cache friendly matrix product A * B
+		 */
+		static Matrix multiply(const Matrix& A, const Matrix& B);
+
+		/**
+		 * @brief Matrix product A * B^T without forming the transposed matrix
+		 */
+		static Matrix multiplyTransposed(const Matrix& A, const Matrix& B);
+
+		/**
+		 * @brief Writes the transpose of the rows x cols row-major matrix source to target (cols x rows).
+		 *        This also converts between MATLAB's column-major and the row-major layout of Matrix.
+		 *        Cache-blocked with a SSE2 kernel, source and target must not overlap.
+		 */
+		static void transpose(const double* source, size_t rows, size_t cols, double* target);
+
+		/**
+		 * @brief Solves A * X = B using a LU decomposition with partial pivoting
+		 * @throws std::runtime_error if A is singular
+		 */
+		static Matrix solve(const Matrix& A, const Matrix& B);
+		static Matrix inverse(const Matrix& A);
+
+		static double frobeniusNorm(const Matrix& A);
+
+		/**
+		 * @brief Eigen decomposition of a symmetric matrix S = V * diag(eigenvalues) * V^T (cyclic Jacobi)
+		 * @param eigenvalues column vector, sorted in descending order
+		 * @param eigenvectors columns are the eigenvectors
+		 */
+		static void symmetricEigen(const Matrix& S, Matrix& eigenvalues, Matrix& eigenvectors);
+
+		/**
+		 * @brief Singular value decomposition A = U * diag(singularValues) * V^T (one-sided Jacobi)
+		 * @param singularValues column vector, sorted in descending order
+		 */
+		static void svd(const Matrix& A, Matrix& U, Matrix& singularValues, Matrix& V);
+
+		/**
+		 * @brief Solves the continuous-time Lyapunov equation A*X + X*A^T + Q = 0.
+		 *        A must be Hurwitz. The equation is mapped to a Stein equation
+		 *        using a Cayley transform and solved using the squared Smith iteration.
+		 * @throws std::runtime_error if the iteration does not converge
+		 */
+		static Matrix solveLyapunov(const Matrix& A, const Matrix& Q, double tolerance = 1e-12, size_t maxIterations = 60);
+
+		/**
+		 * @brief Solves the discrete-time Lyapunov (Stein) equation A*X*A^T - X + Q = 0.
+		 *        The spectral radius of A must be smaller than 1. Uses the squared Smith iteration.
+		 * @throws std::runtime_error if the iteration does not converge
+		 */
+		static Matrix solveStein(const Matrix& A, const Matrix& Q, double tolerance = 1e-12, size_t maxIterations = 60);
+
+		/**
+		 * @brief Computes a factor L with P = L * L^T for a symmetric positive semidefinite matrix P.
+		 *        Negative eigenvalues caused by rounding errors are clipped to zero.
+		 */
+		static Matrix semidefiniteFactor(const Matrix& P);
+
+		/**
+		 * @brief Matrix exponential e^A using scaling and squaring with a [6/6] Pade approximant
+		 */
+		static Matrix expm(const Matrix& A);
+	};
+}
@@ -1,14 +1,26 @@
 #pragma once
 #include "MatlabAPI_base.h"
 #include "TransferFunction.h"
+#include "CoefficientArena.h"
 #include <vector>
 
 namespace MatlabAPI
 {
+	/**
+	 * @brief Matrix of transfer functions, one for each output/input pair.
+	 *        The coefficients of all transfer functions are stored in one contiguous CoefficientArena.
+	 *        Copies share the arena until one of them gets modified.
+	 */
 	class MATLAB_API MIMOSystem
 	{
 	public:
 		MIMOSystem(const std::vector<std::vector<TransferFunction>>& systemMatrix);
+
+		/**
+		 * @brief Creates a MIMO system from a packed arena.
+		 *        Entry (output, input) is located at index output * numInputs + input.
+		 */
+		MIMOSystem(size_t numOutputs, size_t numInputs, const CoefficientArena& arena);
 		MIMOSystem(const MIMOSystem& other);
 		MIMOSystem(MIMOSystem&& other) noexcept;
 		~MIMOSystem();
@@ -16,8 +28,15 @@ namespace MatlabAPI
 		size_t getNumInputs() const { return m_numInputs; }
 		size_t getNumOutputs() const { return m_numOutputs; }
 
-		const TransferFunction& getTransferFunction(size_t inputIndex, size_t outputIndex) const;
-		TransferFunction& getTransferFunction(size_t inputIndex, size_t outputIndex);
+		TransferFunction getTransferFunction(size_t inputIndex, size_t outputIndex) const;
+		void setTransferFunction(size_t inputIndex, size_t outputIndex, const TransferFunction& tf);
+
+		const double* getNumerator(size_t inputIndex, size_t outputIndex) const { return m_arena.getNumerator(getIndex(inputIndex, outputIndex)); }
+		size_t getNumeratorLength(size_t inputIndex, size_t outputIndex) const { return m_arena.getNumeratorLength(getIndex(inputIndex, outputIndex)); }
+		const double* getDenominator(size_t inputIndex, size_t outputIndex) const { return m_arena.getDenominator(getIndex(inputIndex, outputIndex)); }
+		size_t getDenominatorLength(size_t inputIndex, size_t outputIndex) const { return m_arena.getDenominatorLength(getIndex(inputIndex, outputIndex)); }
+
+		const CoefficientArena& getCoefficientArena() const { return m_arena; }
 
 		MIMOSystem& operator=(const MIMOSystem& other);
 		MIMOSystem& operator=(MIMOSystem&& other) noexcept;
@@ -25,8 +44,10 @@ namespace MatlabAPI
 		StateSpaceModel toStateSpaceModel(double timeStep, StateSpaceModel::C2DMethod methode = StateSpaceModel::C2DMethod::ZeroOrderHold) const;
 
 	private:
-		TransferFunction* m_systemMatrix = nullptr;
+		size_t getIndex(size_t inputIndex, size_t outputIndex) const;
+
+		CoefficientArena m_arena;
 		size_t m_numInputs = 0;
 		size_t m_numOutputs = 0;
 	};
-}
\ No newline at end of file
+}
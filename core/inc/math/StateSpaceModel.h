@@ -74,6 +74,16 @@ namespace MatlabAPI
 		StateSpaceModel(const StateSpaceModel& other);
 		~StateSpaceModel();
 
+		/**
+		 * @brief Creates a StateSpaceModel from a MATLAB LTI object (ss, tf, zpk), for example the return value of
+		 *        MatlabEngine::feval("tf", 1, num, den). The conversion uses typed engine calls only.
+		 * @param sys MATLAB LTI object
+		 * @param timeStep timestep in seconds used in the c2d conversion by matlab
+		 * @param method C2DMethod used in the c2d conversion by matlab
+		 * @throws std::runtime_error if the conversion fails in MATLAB
+		 */
+		static StateSpaceModel fromMatlabSystem(const MatlabArray& sys, double timeStep, C2DMethod method = ZeroOrderHold);
+
 		void setIntegrationSolver(IntegrationSolver solver);
 		IntegrationSolver getIntegrationSolver() const { return solver; }
 
@@ -142,6 +152,41 @@ namespace MatlabAPI
 
 		size_t getInputCount() const { return B.getCols(); }
 		size_t getOutputCount() const { return C.getRows(); }  
+		size_t getStateCount() const { return A.getRows(); }
+
+		/**
+		 * @brief Computes the Hankel singular values of the continuous-time model (A, B, C).
+		 *        The controllability and observability Gramians are computed natively, no MATLAB engine is needed.
+		 *        A must be Hurwitz.
+		 * @return Hankel singular values in descending order
+		 */
+		std::vector<double> getHankelSingularValues() const;
+
+		/**
+		 * @brief Upper bound of the H-infinity error of a balanced truncation to the given order:
+		 *        2 * sum of the truncated Hankel singular values
+		 * @param hankelSingularValues Hankel singular values in descending order
+		 * @param order number of states that are kept
+		 */
+		static double getReductionErrorBound(const std::vector<double>& hankelSingularValues, size_t order);
+
+		/**
+		 * @brief Creates a reduced model using balanced truncation (square root method) of the continuous matrices.
+		 *        If this model has discrete matrices, the reduced continuous model is discretized again
+		 *        with the same time step and C2DMethod (zoh and tustin natively, other methods by MATLAB).
+		 *        Its discrete response approximates the discrete response of this model, it is not a
+		 *        reduction of the original Ad, Bd, Cd, Dd.
+		 * @param order number of states of the reduced model
+		 * @param errorBound if not nullptr, receives the H-infinity error bound of the reduction
+		 */
+		StateSpaceModel reduceToOrder(size_t order, double* errorBound = nullptr) const;
+
+		/**
+		 * @brief Creates the smallest balanced truncation whose error bound does not exceed tolerance
+		 * @param tolerance maximum allowed H-infinity error bound
+		 * @param errorBound if not nullptr, receives the H-infinity error bound of the reduction
+		 */
+		StateSpaceModel reduceToTolerance(double tolerance, double* errorBound = nullptr) const;
 
 		std::string toString() const;
 
@@ -191,6 +236,16 @@ namespace MatlabAPI
 			return "Unknown Solver"s;
 		}
 	private:
+		// Returns the state space matrices of the MATLAB LTI object, optionally after a c2d conversion
+		static void ssdata(const MatlabArray& sys, Matrix& A, Matrix& B, Matrix& C, Matrix& D);
+		static MatlabArray c2d(const MatlabArray& sys, double timeStep, C2DMethod method);
+		// Discretizes the continuous matrices, natively for ZeroOrderHold and Tustin
+		static void discretize(const Matrix& A, const Matrix& B, const Matrix& C, const Matrix& D, double timeStep, C2DMethod method,
+			Matrix& Ad, Matrix& Bd, Matrix& Cd, Matrix& Dd);
+
+		void computeBalancingFactors(Matrix& Lp, Matrix& Lq, Matrix& U, Matrix& hankelSingularValues, Matrix& V) const;
+		StateSpaceModel balancedTruncation(size_t order, const Matrix& Lp, const Matrix& Lq, const Matrix& U, const Matrix& hankelSingularValues, const Matrix& V) const;
+
 		Matrix A; // System matrix
 		Matrix B; // Input matrix
 		Matrix C; // Output matrix
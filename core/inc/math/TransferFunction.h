@@ -17,9 +17,17 @@ namespace MatlabAPI
 
 		TransferFunction();
 		TransferFunction(const std::vector<double>& num, const std::vector<double>& den);
+		TransferFunction(std::vector<double>&& num, std::vector<double>&& den);
+
+		/**
+		 * @brief Creates a transfer function from raw coefficient ranges, for example a slice of a CoefficientArena
+		 */
+		TransferFunction(const double* num, size_t numSize, const double* den, size_t denSize);
 		TransferFunction(const TransferFunction& other);
+		TransferFunction(TransferFunction&& other) noexcept;
 
-		void operator=(const TransferFunction& other);
+		TransferFunction& operator=(const TransferFunction& other);
+		TransferFunction& operator=(TransferFunction&& other) noexcept;
 
 
 		// Accessors
@@ -47,7 +47,6 @@ namespace MatlabAPI
 
     private:
 
-        void sendVectorToMatlab(const QString& varName, const std::vector<double>& data);
         bool embedMatlabWindow();
 
 #ifdef _WIN32
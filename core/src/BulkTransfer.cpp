@@ -0,0 +1,320 @@
+#include "BulkTransfer.h"
+#include "MatlabEngine.h"
+#include "MatlabAPI_debug.h"
+#include <atomic>
+#include <filesystem>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace MatlabAPI
+{
+	// Workspace variables used by the transfer scripts
+	static const std::string s_mapVar = "matlab_api_bulk_map";
+	static const std::string s_fileVar = "matlab_api_bulk_fid";
+
+	// Size of the dimension header written by MATLAB in front of the received data
+	static const size_t s_headerSize = 2 * sizeof(double);
+
+	/**
+	 * @brief Mapped file used to exchange the data with MATLAB
+	 */
+	struct BulkTransfer::Mapping
+	{
+		std::string path;
+		void* address = nullptr;
+		size_t size = 0;
+#ifdef _WIN32
+		HANDLE file = INVALID_HANDLE_VALUE;
+		HANDLE mapping = nullptr;
+#else
+		int file = -1;
+#endif
+
+		Mapping()
+			: path(createPath())
+		{}
+		~Mapping()
+		{
+			unmap();
+			std::error_code error;
+			std::filesystem::remove(path, error);
+		}
+
+		// Creates the file with the given size and maps it writable
+		bool create(size_t bytes)
+		{
+			size = bytes;
+#ifdef _WIN32
+			file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+				nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_TEMPORARY, nullptr);
+			if (file == INVALID_HANDLE_VALUE)
+				return false;
+			mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, (DWORD)((uint64_t)bytes >> 32), (DWORD)(bytes & 0xFFFFFFFF), nullptr);
+			if (!mapping)
+				return false;
+			address = MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, bytes);
+#else
+			file = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+			if (file < 0)
+				return false;
+			if (::ftruncate(file, (off_t)bytes) != 0)
+				return false;
+			address = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+			if (address == MAP_FAILED)
+				address = nullptr;
+#endif
+			return address != nullptr;
+		}
+
+		// Maps the file written by MATLAB read only
+		bool open()
+		{
+#ifdef _WIN32
+			file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+				nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+			if (file == INVALID_HANDLE_VALUE)
+				return false;
+			LARGE_INTEGER fileSize;
+			if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+				return false;
+			size = (size_t)fileSize.QuadPart;
+			mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (!mapping)
+				return false;
+			address = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+			file = ::open(path.c_str(), O_RDONLY);
+			if (file < 0)
+				return false;
+			struct stat info;
+			if (::fstat(file, &info) != 0 || info.st_size == 0)
+				return false;
+			size = (size_t)info.st_size;
+			address = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, file, 0);
+			if (address == MAP_FAILED)
+				address = nullptr;
+#endif
+			return address != nullptr;
+		}
+
+		void unmap()
+		{
+#ifdef _WIN32
+			if (address)
+				UnmapViewOfFile(address);
+			if (mapping)
+				CloseHandle(mapping);
+			if (file != INVALID_HANDLE_VALUE)
+				CloseHandle(file);
+			mapping = nullptr;
+			file = INVALID_HANDLE_VALUE;
+#else
+			if (address)
+				::munmap(address, size);
+			if (file >= 0)
+				::close(file);
+			file = -1;
+#endif
+			address = nullptr;
+		}
+
+		// Path for MATLAB, inside a single quoted char array
+		std::string getMatlabPath() const
+		{
+			std::string quoted;
+			for (char c : std::filesystem::path(path).generic_string())
+			{
+				quoted += c;
+				if (c == '\'')
+					quoted += '\'';
+			}
+			return quoted;
+		}
+
+		static std::string createPath()
+		{
+			static std::atomic<uint64_t> counter(0);
+#ifdef _WIN32
+			unsigned long processId = GetCurrentProcessId();
+#else
+			unsigned long processId = (unsigned long)::getpid();
+#endif
+			std::string fileName = "matlab_api_bulk_" + std::to_string(processId) + "_" + std::to_string(counter++) + ".bin";
+			std::error_code error;
+#ifndef _WIN32
+			// tmpfs keeps the data in memory
+			if (std::filesystem::is_directory("/dev/shm", error))
+				return "/dev/shm/" + fileName;
+#endif
+			return (std::filesystem::temp_directory_path(error) / fileName).string();
+		}
+	};
+
+
+	// ===== Region =====
+
+	BulkTransfer::Region::Region(Region&& other) noexcept
+		: m_name(std::move(other.m_name))
+		, m_className(other.m_className)
+		, m_elementSize(other.m_elementSize)
+		, m_rows(other.m_rows)
+		, m_cols(other.m_cols)
+		, m_layout(other.m_layout)
+		, m_mapping(other.m_mapping)
+		, m_data(other.m_data)
+	{
+		other.m_mapping = nullptr;
+		other.m_data = nullptr;
+	}
+	BulkTransfer::Region& BulkTransfer::Region::operator=(Region&& other) noexcept
+	{
+		if (this != &other)
+		{
+			release();
+			m_name = std::move(other.m_name);
+			m_className = other.m_className;
+			m_elementSize = other.m_elementSize;
+			m_rows = other.m_rows;
+			m_cols = other.m_cols;
+			m_layout = other.m_layout;
+			m_mapping = other.m_mapping;
+			m_data = other.m_data;
+			other.m_mapping = nullptr;
+			other.m_data = nullptr;
+		}
+		return *this;
+	}
+	BulkTransfer::Region::~Region()
+	{
+		release();
+	}
+
+	bool BulkTransfer::Region::commit()
+	{
+		if (!isValid())
+		{
+			Logger::logError("BulkTransfer: Region of '" + m_name + "' is not valid");
+			return false;
+		}
+		std::string script;
+		if (m_rows * m_cols == 0)
+		{
+			// memmapfile can't map an empty file
+			script = m_name + " = zeros(" + std::to_string(m_rows) + ", " + std::to_string(m_cols) + ", '" + m_className + "');";
+		}
+		else
+		{
+			bool rowMajor = m_layout == Layout::RowMajor;
+			std::string dimensions = rowMajor ? std::to_string(m_cols) + " " + std::to_string(m_rows)
+				: std::to_string(m_rows) + " " + std::to_string(m_cols);
+			script = s_mapVar + " = memmapfile('" + m_mapping->getMatlabPath() + "', 'Format', {'" + m_className + "', [" + dimensions + "], 'x'}, 'Repeat', 1);\n"
+				+ m_name + " = " + s_mapVar + ".Data.x" + (rowMajor ? ".'" : "") + ";\n"
+				+ "clear " + s_mapVar;
+		}
+		// The data is already in the mapped file, only the script travels through the engine
+		bool success = MatlabEngine::eval(script.c_str()) == 0;
+		if (!success)
+			Logger::logError("BulkTransfer: Failed to create variable '" + m_name + "' from the mapped file");
+		release();
+		return success;
+	}
+
+	void BulkTransfer::Region::release()
+	{
+		delete m_mapping;
+		m_mapping = nullptr;
+		m_data = nullptr;
+	}
+
+
+	// ===== BulkTransfer =====
+
+	BulkTransfer::Region BulkTransfer::allocate(const std::string& name, const char* className, size_t elementSize, size_t rows, size_t cols, Layout layout)
+	{
+		Region region;
+		region.m_name = name;
+		region.m_className = className;
+		region.m_elementSize = elementSize;
+		region.m_rows = rows;
+		region.m_cols = cols;
+		region.m_layout = layout;
+		if (name.empty())
+		{
+			Logger::logError("BulkTransfer: Variable name is empty");
+			return region;
+		}
+		region.m_mapping = new Mapping();
+		if (region.getSizeInBytes() == 0)
+			return region;
+		if (!region.m_mapping->create(region.getSizeInBytes()))
+		{
+			Logger::logError("BulkTransfer: Failed to map " + std::to_string(region.getSizeInBytes()) + " bytes in '" + region.m_mapping->path + "'");
+			region.release();
+			return region;
+		}
+		region.m_data = region.m_mapping->address;
+		return region;
+	}
+
+	bool BulkTransfer::receive(const std::string& name, const char* className, size_t elementSize, bool transpose,
+		const std::function<void* (size_t rows, size_t cols)>& allocator)
+	{
+		if (name.empty())
+			return false;
+		Mapping mapping;
+		std::string value = transpose ? name + ".'" : name;
+		// MATLAB writes the dimensions followed by the values converted to the requested class
+		// An error leaves the file incomplete, which is detected below
+		std::string script = s_fileVar + " = fopen('" + mapping.getMatlabPath() + "', 'w');\n"
+			+ "try\n"
+			+ "fwrite(" + s_fileVar + ", [size(" + value + ", 1), size(" + value + ", 2)], 'double');\n"
+			+ "fwrite(" + s_fileVar + ", " + value + ", '" + className + "');\n"
+			+ "catch\n"
+			+ "end\n"
+			+ "fclose(" + s_fileVar + ");\n"
+			+ "clear " + s_fileVar;
+		if (MatlabEngine::eval(script.c_str()) != 0 || !mapping.open() || mapping.size < s_headerSize)
+		{
+			Logger::logError("BulkTransfer: Failed to receive variable '" + name + "'");
+			return false;
+		}
+
+		double dimensions[2];
+		std::memcpy(dimensions, mapping.address, s_headerSize);
+		size_t rows = (size_t)dimensions[0];
+		size_t cols = (size_t)dimensions[1];
+		size_t bytes = rows * cols * elementSize;
+		if (mapping.size != s_headerSize + bytes)
+		{
+			// Arrays with more than two dimensions or non numeric values
+			Logger::logError("BulkTransfer: Variable '" + name + "' is not a numeric matrix");
+			return false;
+		}
+		void* destination = allocator(rows, cols);
+		if (!destination && bytes > 0)
+			return false;
+		if (bytes > 0)
+			std::memcpy(destination, static_cast<const char*>(mapping.address) + s_headerSize, bytes);
+		return true;
+	}
+
+	Matrix BulkTransfer::receiveMatrix(const std::string& name)
+	{
+		// MATLAB transposes the values, so the file holds the row-major layout of Matrix
+		Matrix matrix;
+		receive(name, "double", sizeof(double), true, [&matrix](size_t cols, size_t rows) -> void* {
+			matrix = Matrix(rows, cols);
+			return matrix.data();
+			});
+		return matrix;
+	}
+}
@@ -0,0 +1,158 @@
+#include "ChunkedTransfer.h"
+#include "math/LinearAlgebra.h"
+#include "MatlabAPI_debug.h"
+#include <algorithm>
+#include <deque>
+#include <utility>
+
+namespace MatlabAPI
+{
+	// Blocks queued on the engine thread while the caller produces or consumes the next one
+	static const size_t s_blocksInFlight = 2;
+
+	size_t ChunkedTransfer::getRowsPerChunk(size_t rowBytes, size_t chunkSize)
+	{
+		return std::max<size_t>(1, chunkSize / std::max<size_t>(rowBytes, 1));
+	}
+
+	bool ChunkedTransfer::send(const std::string& name, size_t rows, size_t cols, size_t elementSize, const RowProducer& produce,
+		size_t chunkSize)
+	{
+		if (name.empty())
+		{
+			Logger::logError("ChunkedTransfer: Variable name is empty");
+			return false;
+		}
+		auto produceBlock = [&](size_t first, size_t count) {
+			MatlabArray block = produce(first, count);
+			if (!block.isValid() || block.getM() != count || block.getNumberOfElements() != count * cols)
+			{
+				Logger::logError("ChunkedTransfer: Rows " + std::to_string(first) + " to " + std::to_string(first + count)
+					+ " of '" + name + "' are not a " + std::to_string(count) + " x " + std::to_string(cols) + " array");
+				return MatlabArray(name);
+			}
+			return block;
+		};
+
+		// The first block creates the variable with all rows, the others are written into it
+		size_t rowsPerChunk = getRowsPerChunk(cols * elementSize, chunkSize);
+		MatlabArray block = produceBlock(0, std::min(rows, rowsPerChunk));
+		if (!block.isValid())
+			return false;
+		block.setName(name);
+		if (!MatlabEngine::preallocateVariable(block, rows))
+			return false;
+
+		std::deque<MatlabFuture<bool>> pending;
+		bool success = true;
+		for (size_t first = block.getM(); first < rows && success; first += rowsPerChunk)
+		{
+			block = produceBlock(first, std::min(rowsPerChunk, rows - first));
+			if (!block.isValid())
+			{
+				success = false;
+				break;
+			}
+			if (pending.size() == s_blocksInFlight)
+			{
+				success = pending.front().get();
+				pending.pop_front();
+			}
+			if (success)
+				pending.push_back(MatlabEngine::setVariableSliceAsync(name, EngineBackend::Slice::Rows, first, block));
+		}
+		for (const MatlabFuture<bool>& transfer : pending)
+			success &= transfer.get();
+		if (!success)
+			Logger::logError("ChunkedTransfer: Failed to send '" + name + "'");
+		return success;
+	}
+
+	bool ChunkedTransfer::send(const std::string& name, const Matrix& matrix, size_t chunkSize)
+	{
+		size_t cols = matrix.getCols();
+		return send(name, matrix.getRows(), cols, sizeof(double), [&](size_t first, size_t count) {
+			// The rows are contiguous in the row-major Matrix, transposed they are a column-major block
+			ArrayBuffer<double> buffer = MatlabArray::createBuffer<double>(count * cols);
+			if (count > 0)
+				LinearAlgebra::transpose(matrix.data() + first * cols, count, cols, buffer.data());
+			return MatlabArray(name, std::move(buffer), { count, cols });
+			}, chunkSize);
+	}
+
+	bool ChunkedTransfer::receive(const std::string& name, const RowConsumer& consume, size_t chunkSize)
+	{
+		MatlabEngine::RemoteVariable variable = MatlabEngine::getRemoteVariable(name);
+		if (!variable.isValid())
+			return false;
+		return receive(variable, consume, chunkSize);
+	}
+
+	bool ChunkedTransfer::receive(const MatlabEngine::RemoteVariable& variable, const RowConsumer& consume, size_t chunkSize)
+	{
+		const std::string& name = variable.getName();
+		size_t rows = variable.getRows();
+		size_t elements = variable.getNumberOfElements();
+		size_t elementSize = elements > 0 ? std::max<size_t>(variable.getSizeInBytes() / elements, 1) : 1;
+		size_t rowsPerChunk = getRowsPerChunk(variable.getCols() * elementSize, chunkSize);
+
+		std::deque<std::pair<size_t, MatlabFuture<MatlabArray>>> pending;
+		size_t next = 0;
+		bool success = true;
+		while (success && (next < rows || !pending.empty()))
+		{
+			// Keep the engine busy while the oldest block is consumed
+			while (next < rows && pending.size() < s_blocksInFlight)
+			{
+				size_t count = std::min(rowsPerChunk, rows - next);
+				pending.emplace_back(next, MatlabEngine::getVariableRowsAsync(name, next, count));
+				next += count;
+			}
+			size_t first = pending.front().first;
+			MatlabArray block = pending.front().second.get();
+			pending.pop_front();
+			if (!block.isValid())
+			{
+				Logger::logError("ChunkedTransfer: Failed to receive rows " + std::to_string(first) + " of '" + name + "'");
+				success = false;
+			}
+			else
+				success = consume(first, block);
+		}
+		for (auto& transfer : pending)
+			transfer.second.cancel();
+		return success;
+	}
+
+	Matrix ChunkedTransfer::receiveMatrix(const std::string& name, size_t chunkSize)
+	{
+		MatlabEngine::RemoteVariable variable = MatlabEngine::getRemoteVariable(name);
+		if (!variable.isValid())
+			return Matrix();
+		size_t cols = variable.getCols();
+		Matrix matrix(variable.getRows(), cols);
+		std::vector<double> converted; // one block of a variable that is not double
+		bool success = receive(variable, [&](size_t first, const MatlabArray& rows) {
+			try {
+				size_t count = rows.getM();
+				const double* source = nullptr;
+				if (rows.isDouble())
+					source = rows.view<double>().data();
+				else
+				{
+					converted.resize(count * cols);
+					rows.copyAsDouble(converted.data());
+					source = converted.data();
+				}
+				// A column-major count x cols block is the row-major cols x count matrix
+				LinearAlgebra::transpose(source, cols, count, matrix.data() + first * cols);
+			}
+			catch (const std::exception& e) {
+				Logger::logError("ChunkedTransfer: " + std::string(e.what()));
+				return false;
+			}
+			return true;
+			}, chunkSize);
+		return success ? matrix : Matrix();
+	}
+}
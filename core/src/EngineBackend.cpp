@@ -0,0 +1,548 @@
+#include "EngineBackend.h"
+#include "MatlabAPI_debug.h"
+#include "Utf.h"
+#ifdef MATLAB_API_USE_CPP_API
+#include "MatlabEngine.hpp"
+#include "MatlabDataArray.hpp"
+#else
+#include "engine.h" // Matlab Engine API
+#endif
+#include <algorithm>
+#include <cctype>
+#include <functional>
+#include <random>
+
+namespace MatlabAPI
+{
+	/**
+	 * @brief Bookkeeping of one backend call: operation id for cancel() and the statistics
+	 */
+	class EngineBackend::Operation
+	{
+	public:
+		Operation(EngineBackend& backend, size_t Statistics::* counter)
+			: m_backend(backend)
+			, m_counter(counter)
+			, m_start(std::chrono::steady_clock::now())
+		{
+			uint64_t id;
+			{
+				std::lock_guard<std::mutex> lock(m_backend.m_operationMutex);
+				id = m_backend.m_runningOperation = ++m_backend.m_operationCount;
+			}
+			if (m_backend.m_operationListener)
+				m_backend.m_operationListener(id);
+		}
+		~Operation()
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_backend.m_operationMutex);
+				m_backend.m_runningOperation = 0;
+			}
+			auto elapsed = std::chrono::steady_clock::now() - m_start;
+			std::lock_guard<std::mutex> lock(m_backend.m_statisticsMutex);
+			Statistics& statistics = m_backend.m_statistics;
+			++statistics.roundTrips;
+			++(statistics.*m_counter);
+			if (m_failed)
+				++statistics.errors;
+			statistics.busyTime += std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed);
+		}
+
+		void setFailed(bool failed) { m_failed = failed; }
+
+	private:
+		EngineBackend& m_backend;
+		size_t Statistics::* m_counter;
+		std::chrono::steady_clock::time_point m_start;
+		bool m_failed = false;
+	};
+
+
+	size_t EngineBackend::VariableInfo::getCols() const
+	{
+		if (dimensions.size() < 2)
+			return dimensions.empty() ? 0 : 1;
+		size_t cols = 1;
+		for (size_t i = 1; i < dimensions.size(); ++i)
+			cols *= dimensions[i];
+		return cols;
+	}
+	size_t EngineBackend::VariableInfo::getNumberOfElements() const
+	{
+		return getRows() * getCols();
+	}
+
+
+	EngineBackend::EngineBackend()
+	{
+
+	}
+	EngineBackend::~EngineBackend()
+	{
+
+	}
+
+	int EngineBackend::eval(const std::string& command)
+	{
+		Operation operation(*this, &Statistics::evals);
+		int ret = doEval(command);
+		operation.setFailed(ret != 0);
+		return ret;
+	}
+	std::vector<MatlabArray> EngineBackend::feval(const std::string& function, size_t nargout, const std::vector<MatlabArray>& args)
+	{
+		Operation operation(*this, &Statistics::fevals);
+		std::vector<MatlabArray> outputs = doFeval(function, nargout, args);
+		operation.setFailed(outputs.size() != nargout);
+		return outputs;
+	}
+	bool EngineBackend::setVariable(const std::string& name, const MatlabArray& value)
+	{
+		Operation operation(*this, &Statistics::puts);
+		bool success = doSetVariable(name, value);
+		operation.setFailed(!success);
+		return success;
+	}
+	MatlabArray EngineBackend::getVariable(const std::string& name)
+	{
+		Operation operation(*this, &Statistics::gets);
+		MatlabArray value = doGetVariable(name);
+		operation.setFailed(!value.isValid());
+		return value;
+	}
+	MatlabArray EngineBackend::getProperty(const MatlabArray& object, const std::string& property)
+	{
+		Operation operation(*this, &Statistics::gets);
+		MatlabArray value = doGetProperty(object, property);
+		operation.setFailed(!value.isValid());
+		return value;
+	}
+
+	bool EngineBackend::getVariableInfo(const std::string& name, VariableInfo& info)
+	{
+		Operation operation(*this, &Statistics::gets);
+		bool success = doGetVariableInfo(name, info);
+		operation.setFailed(!success);
+		return success;
+	}
+	MatlabArray EngineBackend::getVariableRows(const std::string& name, size_t first, size_t count)
+	{
+		Operation operation(*this, &Statistics::gets);
+		MatlabArray value = doGetVariableRows(name, first, count);
+		operation.setFailed(!value.isValid());
+		return value;
+	}
+	bool EngineBackend::setVariableSlice(const std::string& name, Slice slice, size_t first, const MatlabArray& values)
+	{
+		Operation operation(*this, &Statistics::puts);
+		bool success = doSetVariableSlice(name, slice, first, values);
+		operation.setFailed(!success);
+		return success;
+	}
+	bool EngineBackend::resizeVariableRows(const std::string& name, size_t rows)
+	{
+		Operation operation(*this, &Statistics::puts);
+		bool success = doResizeVariableRows(name, rows);
+		operation.setFailed(!success);
+		return success;
+	}
+
+	bool EngineBackend::cancel(uint64_t operation)
+	{
+		std::lock_guard<std::mutex> lock(m_operationMutex);
+		if (operation == 0 || operation != m_runningOperation)
+			return false;
+		return doCancel();
+	}
+
+	EngineBackend::Statistics EngineBackend::getStatistics() const
+	{
+		std::lock_guard<std::mutex> lock(m_statisticsMutex);
+		return m_statistics;
+	}
+	void EngineBackend::resetStatistics()
+	{
+		std::lock_guard<std::mutex> lock(m_statisticsMutex);
+		m_statistics = Statistics();
+	}
+
+	MatlabArray EngineBackend::doGetProperty(const MatlabArray& object, const std::string& property)
+	{
+		Logger::logError(getName() + " backend does not support reading the property '" + property + "' of '" + object.getName() + "'");
+		return MatlabArray(object.getName() + "." + property);
+	}
+
+	// The default implementations interpolate the name into commands, so it has to be a plain variable name
+	static bool checkVariableName(const std::string& name)
+	{
+		bool valid = !name.empty() && name.size() <= 63 && std::isalpha(static_cast<unsigned char>(name[0]))
+			&& std::all_of(name.begin(), name.end(), [](char c) { return std::isalnum(static_cast<unsigned char>(c)) || c == '_'; });
+		if (!valid)
+			Logger::logError("'" + name + "' is not a valid MATLAB variable name");
+		return valid;
+	}
+
+	// Temporary workspace variable of the default implementations. Unique per call and process,
+	// so it neither overwrites a user variable nor one of another process sharing the session.
+	static std::string getTemporaryName()
+	{
+		static const unsigned int process = std::random_device()();
+		static std::atomic<uint64_t> count{ 0 };
+		return "matlab_api_tmp" + std::to_string(process) + "_" + std::to_string(++count);
+	}
+
+	bool EngineBackend::doGetVariableInfo(const std::string& name, VariableInfo& info)
+	{
+		if (!checkVariableName(name))
+			return false;
+		// whos returns an empty struct for unknown names, which gives an empty cell
+		std::string temp = getTemporaryName();
+		std::string command = temp + " = whos('" + name + "'); " + temp + " = {"
+			+ temp + ".class, " + temp + ".size, " + temp + ".complex, "
+			+ temp + ".sparse, " + temp + ".bytes};";
+		if (doEval(command) != 0)
+		{
+			doEval("clear " + temp);
+			return false;
+		}
+		MatlabArray value = doGetVariable(temp);
+		doEval("clear " + temp);
+		if (!value.isCell() || value.getNumberOfElements() != 5)
+		{
+			Logger::logError("Variable '" + name + "' does not exist in the MATLAB workspace");
+			return false;
+		}
+		try {
+			info.className = value.getCell(0).getString();
+			std::vector<double> size = value.getCell(1).getDoubleVector();
+			info.dimensions.assign(size.begin(), size.end());
+			info.complex = value.getCell(2).getLogicalVector().at(0);
+			info.sparse = value.getCell(3).getLogicalVector().at(0);
+			info.bytes = static_cast<size_t>(value.getCell(4).getScalar());
+		}
+		catch (const std::exception& e) {
+			Logger::logError("Unexpected result of whos for '" + name + "': " + std::string(e.what()));
+			return false;
+		}
+		return true;
+	}
+	MatlabArray EngineBackend::doGetVariableRows(const std::string& name, size_t first, size_t count)
+	{
+		if (!checkVariableName(name))
+			return MatlabArray(name);
+		std::string temp = getTemporaryName();
+		std::string command = temp + " = " + name + "(" + std::to_string(first + 1) + ":" + std::to_string(first + count) + ", :);";
+		if (doEval(command) != 0)
+			return MatlabArray(name);
+		MatlabArray value = doGetVariable(temp);
+		doEval("clear " + temp);
+		value.setName(name);
+		return value;
+	}
+	bool EngineBackend::doSetVariableSlice(const std::string& name, Slice slice, size_t first, const MatlabArray& values)
+	{
+		if (!checkVariableName(name))
+			return false;
+		if (!values.isValid())
+		{
+			Logger::logError("Invalid values for a slice of '" + name + "'");
+			return false;
+		}
+		size_t rows = values.getM();
+		size_t cols = rows > 0 ? values.getNumberOfElements() / rows : 0;
+		std::string range;
+		switch (slice)
+		{
+		case Slice::Rows:     range = std::to_string(first + 1) + ":" + std::to_string(first + rows) + ", :"; break;
+		case Slice::Columns:  range = ":, " + std::to_string(first + 1) + ":" + std::to_string(first + cols); break;
+		case Slice::Elements: range = std::to_string(first + 1) + ":" + std::to_string(first + values.getNumberOfElements()); break;
+		}
+		std::string temp = getTemporaryName();
+		if (!doSetVariable(temp, values))
+			return false;
+		int ret = doEval(name + "(" + range + ") = " + temp + ";");
+		doEval("clear " + temp);
+		return ret == 0;
+	}
+	bool EngineBackend::doResizeVariableRows(const std::string& name, size_t rows)
+	{
+		if (!checkVariableName(name))
+			return false;
+		std::string count = std::to_string(rows);
+		return doEval("if size(" + name + ", 1) < " + count + ", " + name + "(" + count + ", :) = 0; else, "
+			+ name + "(" + count + "+1:end, :) = []; end") == 0;
+	}
+
+
+#ifdef MATLAB_API_USE_CPP_API
+	/**
+	 * @brief Backend for the MATLAB C++ engine API.
+	 *        All calls use the asynchronous API, so that a running call can be interrupted by cancel().
+	 */
+	class CppEngineBackend : public EngineBackend
+	{
+	public:
+		explicit CppEngineBackend(std::unique_ptr<matlab::engine::MATLABEngine> engine)
+			: m_engine(std::move(engine))
+		{}
+		~CppEngineBackend()
+		{
+			m_engine.reset();
+		}
+
+		std::string getName() const override { return "MATLAB C++ engine"; }
+		bool isNative() const override { return true; }
+
+	protected:
+		int doEval(const std::string& command) override
+		{
+			try {
+				wait(m_engine->evalAsync(Utf::toUtf16(command)));
+			}
+			catch (const matlab::engine::CancelledException&) {
+				Logger::logWarning("Evaluation of \"" + command + "\" was cancelled");
+				return -1;
+			}
+			catch (const std::exception& e) {
+				Logger::logError("Failed to evaluate \"" + command + "\" in MATLAB engine. Exception: " + std::string(e.what()));
+				return -1;
+			}
+			Logger::logDebug("Evaluated command: \n\"" + command + "\"");
+			return 0;
+		}
+		std::vector<MatlabArray> doFeval(const std::string& function, size_t nargout, const std::vector<MatlabArray>& args) override
+		{
+			std::vector<matlab::data::Array> apiArgs;
+			apiArgs.reserve(args.size());
+			for (const MatlabArray& arg : args)
+				apiArgs.push_back(arg.getAPIArray());
+
+			std::vector<MatlabArray> outputs;
+			try {
+				std::vector<matlab::data::Array> values = wait(m_engine->fevalAsync(Utf::toUtf16Name(function), nargout, apiArgs));
+				outputs.reserve(values.size());
+				for (const matlab::data::Array& value : values)
+					outputs.emplace_back("ans", value);
+			}
+			catch (const matlab::engine::CancelledException&) {
+				Logger::logWarning("Call of '" + function + "' was cancelled");
+				return {};
+			}
+			catch (const std::exception& e) {
+				Logger::logError("Failed to call '" + function + "' in MATLAB engine. Exception: " + std::string(e.what()));
+				return {};
+			}
+			Logger::logDebug("Called function '" + function + "' with " + std::to_string(args.size()) + " arguments");
+			return outputs;
+		}
+		bool doSetVariable(const std::string& name, const MatlabArray& value) override
+		{
+			try {
+				wait(m_engine->setVariableAsync(Utf::toUtf16Name(name), value.getAPIArray()));
+			}
+			catch (const std::exception& e) {
+				Logger::logError("Failed to put variable '" + name + "' into MATLAB engine. Exception: " + std::string(e.what()));
+				return false;
+			}
+			return true;
+		}
+		MatlabArray doGetVariable(const std::string& name) override
+		{
+			try {
+				return MatlabArray(name, wait(m_engine->getVariableAsync(Utf::toUtf16Name(name))));
+			}
+			catch (const std::exception& e) {
+				Logger::logError("Failed to get variable '" + name + "' from MATLAB engine. Exception: " + std::string(e.what()));
+				return MatlabArray(name);
+			}
+		}
+		MatlabArray doGetProperty(const MatlabArray& object, const std::string& property) override
+		{
+			std::string name = object.getName() + "." + property;
+			try {
+				return MatlabArray(name, m_engine->getProperty(object.getAPIArray(), Utf::toUtf16Name(property)));
+			}
+			catch (const std::exception& e) {
+				Logger::logError("Failed to get property '" + name + "' from MATLAB engine. Exception: " + std::string(e.what()));
+				return MatlabArray(name);
+			}
+		}
+		bool doCancel() override
+		{
+			std::lock_guard<std::mutex> lock(m_cancelMutex);
+			return m_cancelRunning && m_cancelRunning();
+		}
+
+	private:
+		// Waits for the result and lets doCancel() interrupt the call in the meantime
+		template<typename T>
+		T wait(matlab::engine::FutureResult<T>&& future)
+		{
+			auto result = std::make_shared<matlab::engine::FutureResult<T>>(std::move(future));
+			setCanceller([result]() { return result->cancel(true); });
+			struct ResetCanceller
+			{
+				CppEngineBackend* backend;
+				~ResetCanceller() { backend->setCanceller(nullptr); }
+			} reset{ this };
+			return result->get();
+		}
+		void setCanceller(std::function<bool()>&& canceller)
+		{
+			std::lock_guard<std::mutex> lock(m_cancelMutex);
+			m_cancelRunning = std::move(canceller);
+		}
+
+		std::unique_ptr<matlab::engine::MATLABEngine> m_engine;
+		std::mutex m_cancelMutex;
+		std::function<bool()> m_cancelRunning;
+	};
+#else
+	/**
+	 * @brief Backend for the MATLAB C engine API
+	 */
+	class CEngineBackend : public EngineBackend
+	{
+	public:
+		explicit CEngineBackend(Engine* engine)
+			: m_engine(engine)
+		{}
+		~CEngineBackend()
+		{
+			engClose(m_engine);
+		}
+
+		std::string getName() const override { return "MATLAB C engine"; }
+		bool isNative() const override { return true; }
+
+	protected:
+		int doEval(const std::string& command) override
+		{
+			int ret = engEvalString(m_engine, command.c_str());
+			Logger::logDebug("Evaluated command: \n\"" + command + "\"\n -> return code: " + std::to_string(ret));
+			return ret;
+		}
+
+		// The C engine API has no feval, the arguments and results are passed through temporary workspace variables
+		std::vector<MatlabArray> doFeval(const std::string& function, size_t nargout, const std::vector<MatlabArray>& args) override
+		{
+			// Names of the slots that were created, cleared exactly so that user variables are not touched
+			std::vector<std::string> slots;
+			auto clearSlots = [&]() {
+				if (slots.empty())
+					return;
+				std::string command = "clear";
+				for (const std::string& slot : slots)
+					command += " " + slot;
+				engEvalString(m_engine, command.c_str());
+			};
+			std::string argList;
+			for (size_t i = 0; i < args.size(); ++i)
+			{
+				std::string name = getTemporaryName();
+				if (engPutVariable(m_engine, name.c_str(), args[i].getAPIArray()) != 0)
+				{
+					Logger::logError("Failed to put argument " + std::to_string(i) + " of '" + function + "' into MATLAB engine.");
+					clearSlots();
+					return {};
+				}
+				slots.push_back(name);
+				argList += (i > 0 ? "," : "") + name;
+			}
+			std::vector<std::string> outputs;
+			std::string outList;
+			for (size_t i = 0; i < nargout; ++i)
+			{
+				outputs.push_back(getTemporaryName());
+				slots.push_back(outputs.back());
+				outList += (i > 0 ? "," : "") + outputs.back();
+			}
+
+			std::string command = (nargout > 0 ? "[" + outList + "] = " : "") + function + "(" + argList + ");";
+			std::vector<MatlabArray> results;
+			if (engEvalString(m_engine, command.c_str()) == 0)
+			{
+				results.reserve(nargout);
+				for (size_t i = 0; i < nargout; ++i)
+				{
+					mxArray* arr = engGetVariable(m_engine, outputs[i].c_str());
+					if (!arr)
+					{
+						Logger::logError("Failed to get return value " + std::to_string(i) + " of '" + function + "' from MATLAB engine.");
+						results.clear();
+						break;
+					}
+					results.emplace_back("ans", arr, true);
+				}
+			}
+			else
+				Logger::logError("Failed to evaluate '" + function + "' in MATLAB engine.");
+			clearSlots();
+			return results;
+		}
+		bool doSetVariable(const std::string& name, const MatlabArray& value) override
+		{
+			if (engPutVariable(m_engine, name.c_str(), value.getAPIArray()) != 0)
+			{
+				Logger::logError("Failed to put variable '" + name + "' into MATLAB engine.");
+				return false;
+			}
+			return true;
+		}
+		MatlabArray doGetVariable(const std::string& name) override
+		{
+			mxArray* arr = engGetVariable(m_engine, name.c_str());
+			if (!arr)
+			{
+				Logger::logError("Failed to get variable '" + name + "' from MATLAB engine.");
+				return MatlabArray(name);
+			}
+			return MatlabArray(name, arr, true); // engGetVariable returns a copy owned by the caller
+		}
+
+	private:
+		Engine* m_engine;
+	};
+#endif
+
+	std::unique_ptr<EngineBackend> EngineBackend::createNative(const std::u16string& startcmd, bool singleUse)
+	{
+#ifdef MATLAB_API_USE_CPP_API
+		(void)singleUse; // startMATLAB always starts a separate process
+		std::unique_ptr<matlab::engine::MATLABEngine> engine;
+		try {
+			if (startcmd.empty())
+				engine = matlab::engine::startMATLAB(); // start a new MATLAB engine
+			else
+				engine = matlab::engine::connectMATLAB(startcmd);
+		}
+		catch (const std::exception& e) {
+			Logger::logError("Can't start MATLAB engine. Exception: " + std::string(e.what()));
+			return nullptr;
+		}
+		if (!engine)
+			return nullptr;
+		return std::unique_ptr<EngineBackend>(new CppEngineBackend(std::move(engine)));
+#else
+		std::string cmd = Utf::toUtf8(startcmd);
+		Engine* engine = nullptr;
+#ifdef _WIN32
+		if (singleUse)
+		{
+			// engOpen would attach every engine to the same MATLAB process on Windows
+			int status = 0;
+			engine = engOpenSingleUse(cmd.empty() ? nullptr : cmd.c_str(), nullptr, &status);
+		}
+		else
+#endif
+			engine = engOpen(cmd.c_str()); // open a MATLAB engine
+		if (!engine)
+		{
+			Logger::logError("Can't start MATLAB engine");
+			return nullptr;
+		}
+		return std::unique_ptr<EngineBackend>(new CEngineBackend(engine));
+#endif
+	}
+}
@@ -0,0 +1,230 @@
+#include "EnginePool.h"
+#include "MatlabAPI_debug.h"
+
+namespace MatlabAPI
+{
+	// ===== Session =====
+
+	EnginePool::Session::Session(size_t index)
+		: m_index(index)
+	{
+
+	}
+	EnginePool::Session::~Session()
+	{
+		close();
+	}
+
+	bool EnginePool::Session::open(std::unique_ptr<EngineBackend> backend)
+	{
+		m_backend = std::move(backend);
+		if (!m_backend)
+			Logger::logError("EnginePool: Failed to start session " + std::to_string(m_index));
+		return isOpen();
+	}
+	void EnginePool::Session::close()
+	{
+		m_backend.reset();
+	}
+	bool EnginePool::Session::isOpen() const
+	{
+		return m_backend != nullptr;
+	}
+
+	int EnginePool::Session::eval(const std::string& command)
+	{
+		return m_backend->eval(command);
+	}
+
+	bool EnginePool::Session::setVariable(const std::string& name, const MatlabArray& value)
+	{
+		if (name.empty() || !value.isValid())
+			return false;
+		return m_backend->setVariable(name, value);
+	}
+	bool EnginePool::Session::setVariable(const std::string& name, const Matrix& value)
+	{
+		std::unique_ptr<MatlabArray> array(value.toMatlabArray(name));
+		return setVariable(name, *array);
+	}
+
+	MatlabArray EnginePool::Session::getVariable(const std::string& name)
+	{
+		return m_backend->getVariable(name);
+	}
+	Matrix EnginePool::Session::getMatrix(const std::string& name)
+	{
+		MatlabArray array = getVariable(name);
+		return Matrix(&array);
+	}
+
+	void EnginePool::Session::clearWorkspace()
+	{
+		eval("clear");
+	}
+
+
+	// ===== EnginePool =====
+
+	EnginePool::EnginePool(size_t sessionCount)
+		: m_createBackend([](size_t) { return EngineBackend::createNative(u"", true); }) // a new MATLAB process for each session
+		, m_idleCount(0)
+	{
+		start(sessionCount);
+	}
+	EnginePool::EnginePool(const std::vector<std::u16string>& sessionNames)
+		: m_createBackend([sessionNames](size_t index) -> std::unique_ptr<EngineBackend> {
+#ifndef MATLAB_API_USE_CPP_API
+			if (!sessionNames[index].empty())
+			{
+				Logger::logError("EnginePool: Connecting to shared MATLAB sessions requires the MATLAB C++ engine API");
+				return nullptr;
+			}
+#endif
+			return EngineBackend::createNative(sessionNames[index], true);
+			})
+		, m_idleCount(0)
+	{
+		start(sessionNames.size());
+	}
+	EnginePool::EnginePool(size_t sessionCount, BackendFactory createBackend)
+		: m_createBackend(std::move(createBackend))
+		, m_idleCount(0)
+	{
+		start(sessionCount);
+	}
+	EnginePool::~EnginePool()
+	{
+		std::deque<Job> pending;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stop = true;
+			pending.swap(m_jobs);
+		}
+		m_jobAvailable.notify_all();
+		m_stateChanged.notify_all();
+		// Before joining, the workers may still be busy with long running jobs
+		failJobs(pending, "EnginePool: The pool was destroyed before the job was executed");
+		for (std::thread& worker : m_workers)
+		{
+			if (worker.joinable())
+				worker.join();
+		}
+		for (Session* session : m_sessions)
+			delete session;
+	}
+
+	void EnginePool::waitForAll()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_stateChanged.wait(lock, [this]() {
+			return (m_jobs.empty() && m_runningJobs == 0) || (m_pendingStartups == 0 && m_startedSessions == 0);
+			});
+	}
+	size_t EnginePool::waitForStartup()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_stateChanged.wait(lock, [this]() { return m_pendingStartups == 0; });
+		return m_startedSessions;
+	}
+	size_t EnginePool::getQueuedJobCount() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_jobs.size();
+	}
+
+	void EnginePool::start(size_t sessionCount)
+	{
+		m_pendingStartups = sessionCount;
+		m_sessions.reserve(sessionCount);
+		m_workers.reserve(sessionCount);
+		for (size_t i = 0; i < sessionCount; ++i)
+		{
+			Session* session = new Session(i);
+			m_sessions.push_back(session);
+			// The sessions are started in parallel by their worker threads
+			m_workers.emplace_back(&EnginePool::workerLoop, this, session);
+		}
+	}
+
+	void EnginePool::enqueue(Job&& job)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (m_pendingStartups == 0 && m_startedSessions == 0)
+			{
+				Logger::logError("EnginePool: No MATLAB session is available, job is dropped.");
+				job.fail("EnginePool: No MATLAB session is available");
+				return;
+			}
+			m_jobs.emplace_back(std::move(job));
+		}
+		m_jobAvailable.notify_one();
+	}
+
+	void EnginePool::failJobs(std::deque<Job>& jobs, const std::string& reason)
+	{
+		for (Job& job : jobs)
+			job.fail(reason);
+		jobs.clear();
+	}
+
+	void EnginePool::workerLoop(Session* session)
+	{
+		std::unique_ptr<EngineBackend> backend;
+		try {
+			backend = m_createBackend(session->getIndex());
+		}
+		catch (const std::exception& e) {
+			Logger::logError("EnginePool: Exception while starting session " + std::to_string(session->getIndex()) + ": " + e.what());
+		}
+		bool opened = session->open(std::move(backend));
+		std::deque<Job> orphaned;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			--m_pendingStartups;
+			if (opened)
+			{
+				++m_startedSessions;
+				++m_idleCount;
+			}
+			else if (m_pendingStartups == 0 && m_startedSessions == 0)
+			{
+				// No session will ever pick up the queued jobs
+				orphaned.swap(m_jobs);
+			}
+		}
+		m_stateChanged.notify_all();
+		failJobs(orphaned, "EnginePool: No MATLAB session could be started");
+		if (!opened)
+			return;
+		Logger::logInfo("EnginePool: Session " + std::to_string(session->getIndex()) + " started");
+
+		while (true)
+		{
+			Job job;
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_jobAvailable.wait(lock, [this]() { return m_stop || !m_jobs.empty(); });
+				if (m_stop)
+					break;
+				job = std::move(m_jobs.front());
+				m_jobs.pop_front();
+				++m_runningJobs;
+				--m_idleCount;
+			}
+
+			// Exceptions thrown by the job are stored in its future
+			job.run(*session);
+			session->clearWorkspace();
+
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				--m_runningJobs;
+				++m_idleCount;
+			}
+			m_stateChanged.notify_all();
+		}
+		session->close();
+	}
+}
@@ -0,0 +1,258 @@
+#include "EngineTelemetry.h"
+#include "MatlabAPI_debug.h"
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <cmath>
+#include <cstdio>
+#include <sstream>
+
+namespace MatlabAPI
+{
+	static std::mutex s_telemetryMutex;
+	static std::atomic<bool> s_telemetryEnabled{ true };
+	static EngineTelemetry::Snapshot s_telemetry;
+	static std::chrono::steady_clock::time_point s_telemetryStart = std::chrono::steady_clock::now();
+
+	const char* EngineTelemetry::getOperationName(Operation operation)
+	{
+		switch (operation)
+		{
+		case Operation::Eval:             return "eval";
+		case Operation::Feval:            return "feval";
+		case Operation::AddVariable:      return "addVariable";
+		case Operation::GetVariable:      return "getVariable";
+		case Operation::RemoveVariable:   return "removeVariable";
+		case Operation::SendVariable:     return "sendVariableToEngine";
+		case Operation::UpdateVariable:   return "updateVariableFromEngine";
+		case Operation::QueryVariable:    return "queryVariable";
+		case Operation::SetVariableSlice: return "setVariableSlice";
+		case Operation::ResizeVariable:   return "resizeVariable";
+		default:                          return "unknown";
+		}
+	}
+
+	// ===== LatencyHistogram =====
+
+	void EngineTelemetry::LatencyHistogram::add(std::chrono::nanoseconds latency)
+	{
+		uint64_t micros = static_cast<uint64_t>(std::max<int64_t>(0, std::chrono::duration_cast<std::chrono::microseconds>(latency).count()));
+		size_t bucket = 0;
+		while (micros > 1 && bucket + 1 < bucketCount)
+		{
+			micros >>= 1;
+			++bucket;
+		}
+		++buckets[bucket];
+	}
+	void EngineTelemetry::LatencyHistogram::add(const LatencyHistogram& other)
+	{
+		for (size_t i = 0; i < bucketCount; ++i)
+			buckets[i] += other.buckets[i];
+	}
+	uint64_t EngineTelemetry::LatencyHistogram::getCount() const
+	{
+		uint64_t count = 0;
+		for (uint64_t bucket : buckets)
+			count += bucket;
+		return count;
+	}
+	std::chrono::microseconds EngineTelemetry::LatencyHistogram::getPercentile(double percent) const
+	{
+		uint64_t count = getCount();
+		if (count == 0)
+			return std::chrono::microseconds(0);
+		uint64_t rank = static_cast<uint64_t>(std::ceil(std::clamp(percent, 0.0, 100.0) / 100.0 * count));
+		uint64_t seen = 0;
+		for (size_t i = 0; i < bucketCount; ++i)
+		{
+			seen += buckets[i];
+			if (seen >= std::max<uint64_t>(rank, 1))
+				return getBucketUpperBound(i);
+		}
+		return getBucketUpperBound(bucketCount - 1);
+	}
+	std::chrono::microseconds EngineTelemetry::LatencyHistogram::getBucketUpperBound(size_t bucket)
+	{
+		return std::chrono::microseconds(2LL << std::min(bucket, bucketCount - 1));
+	}
+
+	// ===== Counters / Snapshot =====
+
+	void EngineTelemetry::Counters::add(const Counters& other)
+	{
+		calls += other.calls;
+		errors += other.errors;
+		bytesToEngine += other.bytesToEngine;
+		bytesFromEngine += other.bytesFromEngine;
+		totalTime += other.totalTime;
+		maxTime = std::max(maxTime, other.maxTime);
+		latency.add(other.latency);
+	}
+
+	EngineTelemetry::Counters EngineTelemetry::Snapshot::getTotal() const
+	{
+		Counters total;
+		for (const Counters& counters : operations)
+			total.add(counters);
+		return total;
+	}
+
+	static std::string escapeJson(const std::string& text)
+	{
+		std::string escaped;
+		escaped.reserve(text.size());
+		for (char c : text)
+		{
+			switch (c)
+			{
+			case '"':  escaped += "\\\""; break;
+			case '\\': escaped += "\\\\"; break;
+			case '\n': escaped += "\\n"; break;
+			case '\t': escaped += "\\t"; break;
+			default:
+				if (static_cast<unsigned char>(c) < 0x20)
+				{
+					char buffer[8];
+					snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+					escaped += buffer;
+				}
+				else
+					escaped += c;
+			}
+		}
+		return escaped;
+	}
+	static void writeJson(std::ostringstream& os, const EngineTelemetry::Counters& counters)
+	{
+		using std::chrono::duration_cast;
+		using std::chrono::microseconds;
+		os << "{\"calls\":" << counters.calls
+			<< ",\"errors\":" << counters.errors
+			<< ",\"bytesToEngine\":" << counters.bytesToEngine
+			<< ",\"bytesFromEngine\":" << counters.bytesFromEngine
+			<< ",\"totalUs\":" << duration_cast<microseconds>(counters.totalTime).count()
+			<< ",\"meanUs\":" << (counters.calls ? duration_cast<microseconds>(counters.totalTime).count() / (long long)counters.calls : 0)
+			<< ",\"maxUs\":" << duration_cast<microseconds>(counters.maxTime).count()
+			<< ",\"p50Us\":" << counters.latency.getPercentile(50).count()
+			<< ",\"p90Us\":" << counters.latency.getPercentile(90).count()
+			<< ",\"p99Us\":" << counters.latency.getPercentile(99).count()
+			<< ",\"histogram\":{";
+		// Only the buckets that were hit, keyed by their upper bound in microseconds
+		bool first = true;
+		for (size_t i = 0; i < EngineTelemetry::LatencyHistogram::bucketCount; ++i)
+		{
+			if (counters.latency.buckets[i] == 0)
+				continue;
+			os << (first ? "" : ",") << "\"" << EngineTelemetry::LatencyHistogram::getBucketUpperBound(i).count() << "\":" << counters.latency.buckets[i];
+			first = false;
+		}
+		os << "}}";
+	}
+	static void writeJson(std::ostringstream& os, const EngineTelemetry::OperationCounters& operations, bool skipUnused)
+	{
+		os << "{";
+		bool first = true;
+		for (size_t i = 0; i < EngineTelemetry::operationCount; ++i)
+		{
+			if (skipUnused && operations[i].calls == 0)
+				continue;
+			os << (first ? "" : ",") << "\"" << EngineTelemetry::getOperationName(static_cast<EngineTelemetry::Operation>(i)) << "\":";
+			writeJson(os, operations[i]);
+			first = false;
+		}
+		os << "}";
+	}
+
+	std::string EngineTelemetry::Snapshot::toJson() const
+	{
+		std::ostringstream os;
+		os << "{\"durationUs\":" << std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+		os << ",\"total\":";
+		writeJson(os, getTotal());
+		os << ",\"operations\":";
+		writeJson(os, operations, false);
+		os << ",\"variables\":{";
+		bool first = true;
+		for (const auto& pair : variables)
+		{
+			os << (first ? "" : ",") << "\"" << escapeJson(pair.first) << "\":";
+			writeJson(os, pair.second, true);
+			first = false;
+		}
+		os << "}}";
+		return os.str();
+	}
+
+	// ===== Scope =====
+
+	EngineTelemetry::Scope::Scope(Operation operation, const std::string& variable)
+		: m_operation(operation)
+		, m_variable(variable)
+		, m_active(isEnabled())
+		, m_start(std::chrono::steady_clock::now())
+	{
+		MATLAB_API_ENGINE_PROFILING_NONSCOPED_BLOCK(getOperationName(operation), MATLAB_API_COLOR_STAGE_5);
+	}
+	EngineTelemetry::Scope::~Scope()
+	{
+		MATLAB_API_ENGINE_PROFILING_VALUE("MATLAB bytes to engine", m_bytesToEngine);
+		MATLAB_API_ENGINE_PROFILING_VALUE("MATLAB bytes from engine", m_bytesFromEngine);
+		MATLAB_API_ENGINE_PROFILING_END_BLOCK;
+		if (m_active)
+			record(m_operation, m_variable, std::chrono::steady_clock::now() - m_start, m_bytesToEngine, m_bytesFromEngine, m_failed);
+	}
+
+	// ===== EngineTelemetry =====
+
+	void EngineTelemetry::setEnabled(bool enable)
+	{
+		s_telemetryEnabled = enable;
+	}
+	bool EngineTelemetry::isEnabled()
+	{
+		return s_telemetryEnabled;
+	}
+
+	void EngineTelemetry::record(Operation operation, const std::string& variable, std::chrono::nanoseconds latency,
+								 uint64_t bytesToEngine, uint64_t bytesFromEngine, bool failed)
+	{
+		size_t index = static_cast<size_t>(operation);
+		if (index >= operationCount)
+			return;
+		Counters call;
+		call.calls = 1;
+		call.errors = failed ? 1 : 0;
+		call.bytesToEngine = bytesToEngine;
+		call.bytesFromEngine = bytesFromEngine;
+		call.totalTime = latency;
+		call.maxTime = latency;
+		call.latency.add(latency);
+
+		std::lock_guard<std::mutex> lock(s_telemetryMutex);
+		s_telemetry.operations[index].add(call);
+		if (variable.empty())
+			return;
+		auto it = s_telemetry.variables.find(variable);
+		if (it == s_telemetry.variables.end())
+		{
+			std::string name = s_telemetry.variables.size() < maxTrackedVariables ? variable : otherVariables;
+			it = s_telemetry.variables.emplace(name, OperationCounters()).first;
+		}
+		it->second[index].add(call);
+	}
+
+	EngineTelemetry::Snapshot EngineTelemetry::getSnapshot()
+	{
+		std::lock_guard<std::mutex> lock(s_telemetryMutex);
+		Snapshot snapshot = s_telemetry;
+		snapshot.duration = std::chrono::steady_clock::now() - s_telemetryStart;
+		return snapshot;
+	}
+	void EngineTelemetry::reset()
+	{
+		std::lock_guard<std::mutex> lock(s_telemetryMutex);
+		s_telemetry = Snapshot();
+		s_telemetryStart = std::chrono::steady_clock::now();
+	}
+}
@@ -0,0 +1,919 @@
+#include "InProcessBackend.h"
+#include "math/LinearAlgebra.h"
+#include "MatlabAPI_debug.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+namespace MatlabAPI
+{
+	// ===== Parsing helpers =====
+
+	static std::string trim(const std::string& text)
+	{
+		size_t begin = text.find_first_not_of(" \t\r\n");
+		if (begin == std::string::npos)
+			return "";
+		size_t end = text.find_last_not_of(" \t\r\n");
+		return text.substr(begin, end - begin + 1);
+	}
+
+	static bool isIdentifier(const std::string& text)
+	{
+		if (text.empty() || !std::isalpha((unsigned char)text[0]))
+			return false;
+		return std::all_of(text.begin(), text.end(), [](char c) { return std::isalnum((unsigned char)c) || c == '_'; });
+	}
+
+	// A quote directly after one of these characters is the transpose operator, not the start of a char array
+	static bool endsOperand(char c)
+	{
+		return std::isalnum((unsigned char)c) || c == '_' || c == ')' || c == ']' || c == '}' || c == '\'' || c == '.';
+	}
+
+	/**
+	 * @brief Splits text at separators that are not enclosed in brackets or quotes
+	 */
+	static std::vector<std::string> splitTopLevel(const std::string& text, const std::string& separators)
+	{
+		std::vector<std::string> parts;
+		std::string current;
+		int depth = 0;
+		bool inString = false;
+		for (size_t i = 0; i < text.size(); ++i)
+		{
+			char c = text[i];
+			if (inString)
+			{
+				if (c == '\'')
+				{
+					if (i + 1 < text.size() && text[i + 1] == '\'')
+						current += text[i++]; // escaped quote
+					else
+						inString = false;
+				}
+				current += c;
+				continue;
+			}
+			if (c == '\'' && (current.empty() || !endsOperand(current.back())))
+				inString = true;
+			else if (c == '(' || c == '[' || c == '{')
+				++depth;
+			else if (c == ')' || c == ']' || c == '}')
+				--depth;
+			else if (depth == 0 && separators.find(c) != std::string::npos)
+			{
+				parts.push_back(current);
+				current.clear();
+				continue;
+			}
+			current += c;
+		}
+		if (inString || depth != 0)
+			throw std::runtime_error("Unbalanced brackets or quotes in '" + text + "'");
+		parts.push_back(current);
+		return parts;
+	}
+
+	/**
+	 * @brief Position of the last binary operator out of operators on the top level, npos if there is none
+	 */
+	static size_t findBinaryOperator(const std::string& text, const std::string& operators)
+	{
+		int depth = 0;
+		bool inString = false;
+		size_t found = std::string::npos;
+		for (size_t i = 0; i < text.size(); ++i)
+		{
+			char c = text[i];
+			if (inString)
+			{
+				if (c == '\'')
+				{
+					if (i + 1 < text.size() && text[i + 1] == '\'')
+						++i;
+					else
+						inString = false;
+				}
+				continue;
+			}
+			if (c == '\'' && (i == 0 || !endsOperand(text[i - 1])))
+				inString = true;
+			else if (c == '(' || c == '[' || c == '{')
+				++depth;
+			else if (c == ')' || c == ']' || c == '}')
+				--depth;
+			else if (depth == 0 && operators.find(c) != std::string::npos)
+			{
+				size_t previous = text.find_last_not_of(" \t", i == 0 ? std::string::npos : i - 1);
+				if (i == 0 || previous == std::string::npos)
+					continue; // unary sign
+				char before = text[previous];
+				if (!endsOperand(before))
+					continue; // unary sign after another operator
+				// Exponent of a number literal like 1e-3
+				if ((c == '+' || c == '-') && (before == 'e' || before == 'E') && previous == i - 1)
+				{
+					size_t start = previous;
+					while (start > 0 && (std::isdigit((unsigned char)text[start - 1]) || text[start - 1] == '.'))
+						--start;
+					if (start < previous && (start == 0 || !endsOperand(text[start - 1])))
+						continue;
+				}
+				found = i;
+			}
+		}
+		return found;
+	}
+
+	static bool parseNumber(const std::string& text, double& value)
+	{
+		if (text.empty())
+			return false;
+		char* end = nullptr;
+		value = std::strtod(text.c_str(), &end);
+		return end == text.c_str() + text.size();
+	}
+
+	// ===== Value helpers =====
+
+	static MatlabArray toArray(const Matrix& matrix, const std::string& name = "ans")
+	{
+		std::unique_ptr<MatlabArray> array(matrix.toMatlabArray(name));
+		return std::move(*array);
+	}
+	static Matrix toMatrix(const MatlabArray& value)
+	{
+		if (!value.isDouble())
+			throw std::runtime_error("Expected a double array, got '" + value.getClassName() + "'");
+		return Matrix(const_cast<MatlabArray*>(&value));
+	}
+	static double toScalar(const MatlabArray& value)
+	{
+		if (!value.isDouble() || value.getNumberOfElements() != 1)
+			throw std::runtime_error("Expected a scalar");
+		return value.getScalar();
+	}
+	static std::string toText(const MatlabArray& value)
+	{
+		if (!value.isChar())
+			throw std::runtime_error("Expected a char array");
+		return value.getString();
+	}
+
+	// ss and tf objects are stored as cell arrays that start with their class name
+	static bool isObject(const MatlabArray& value, const std::string& className)
+	{
+		return value.isCell() && value.getNumberOfElements() > 0
+			&& value.getCell(0).isChar() && value.getCell(0).getString() == className;
+	}
+	static MatlabArray makeObject(const std::string& className, const std::vector<MatlabArray>& fields)
+	{
+		MatlabArray object = MatlabArray::createCell("ans", 1, fields.size() + 1);
+		object.setCell(0, MatlabArray("class", className));
+		for (size_t i = 0; i < fields.size(); ++i)
+			object.setCell(i + 1, fields[i]);
+		return object;
+	}
+
+	static Matrix block(const Matrix& source, size_t row, size_t col, size_t rows, size_t cols)
+	{
+		Matrix result(rows, cols);
+		for (size_t r = 0; r < rows; ++r)
+			for (size_t c = 0; c < cols; ++c)
+				result(r, c) = source(row + r, col + c);
+		return result;
+	}
+
+	struct StateSpace
+	{
+		Matrix A, B, C, D;
+		double Ts = 0.0;
+	};
+
+	static MatlabArray toObject(const StateSpace& sys)
+	{
+		return makeObject("ss", { toArray(sys.A), toArray(sys.B), toArray(sys.C), toArray(sys.D), MatlabArray("Ts", sys.Ts) });
+	}
+
+	// Controllable canonical form of a proper SISO transfer function, the same form as tf2ss
+	static StateSpace realize(std::vector<double> num, std::vector<double> den)
+	{
+		while (!den.empty() && den.front() == 0.0)
+			den.erase(den.begin());
+		if (den.empty())
+			throw std::runtime_error("The denominator must not be zero");
+		while (num.size() > 1 && num.front() == 0.0)
+			num.erase(num.begin());
+		if (num.size() > den.size())
+			throw std::runtime_error("The transfer function must be proper");
+		size_t n = den.size() - 1;
+		double a0 = den.front();
+		num.insert(num.begin(), den.size() - num.size(), 0.0);
+
+		StateSpace sys;
+		sys.A = Matrix(n, n);
+		sys.B = Matrix(n, 1);
+		sys.C = Matrix(1, n);
+		sys.D = Matrix(1, 1);
+		double b0 = num[0] / a0;
+		sys.D(0, 0) = b0;
+		for (size_t j = 0; j < n; ++j)
+		{
+			sys.A(0, j) = -den[j + 1] / a0;
+			sys.C(0, j) = num[j + 1] / a0 - den[j + 1] / a0 * b0;
+			if (j > 0)
+				sys.A(j, j - 1) = 1.0;
+		}
+		if (n > 0)
+			sys.B(0, 0) = 1.0;
+		return sys;
+	}
+
+	// Block diagonal realization of a MIMO transfer function given as outputs x inputs cell arrays
+	static StateSpace realize(const MatlabArray& num, const MatlabArray& den)
+	{
+		if (!num.isCell())
+			return realize(num.getDoubleVector(), den.getDoubleVector());
+		size_t outputs = num.getM();
+		size_t inputs = num.getN();
+		if (!den.isCell() || den.getM() != outputs || den.getN() != inputs)
+			throw std::runtime_error("Numerator and denominator cell arrays must have the same size");
+
+		std::vector<StateSpace> channels;
+		size_t states = 0;
+		for (size_t i = 0; i < inputs; ++i)
+		{
+			for (size_t o = 0; o < outputs; ++o)
+			{
+				size_t index = i * outputs + o; // column-major
+				channels.push_back(realize(num.getCell(index).getDoubleVector(), den.getCell(index).getDoubleVector()));
+				states += channels.back().A.getRows();
+			}
+		}
+		StateSpace sys;
+		sys.A = Matrix(states, states);
+		sys.B = Matrix(states, inputs);
+		sys.C = Matrix(outputs, states);
+		sys.D = Matrix(outputs, inputs);
+		size_t offset = 0;
+		for (size_t i = 0; i < inputs; ++i)
+		{
+			for (size_t o = 0; o < outputs; ++o)
+			{
+				const StateSpace& channel = channels[i * outputs + o];
+				size_t n = channel.A.getRows();
+				for (size_t r = 0; r < n; ++r)
+				{
+					for (size_t c = 0; c < n; ++c)
+						sys.A(offset + r, offset + c) = channel.A(r, c);
+					sys.B(offset + r, i) = channel.B(r, 0);
+					sys.C(o, offset + r) = channel.C(0, r);
+				}
+				sys.D(o, i) = channel.D(0, 0);
+				offset += n;
+			}
+		}
+		return sys;
+	}
+
+	static StateSpace toStateSpace(const MatlabArray& value)
+	{
+		if (isObject(value, "ss"))
+		{
+			StateSpace sys;
+			sys.A = toMatrix(value.getCell(1));
+			sys.B = toMatrix(value.getCell(2));
+			sys.C = toMatrix(value.getCell(3));
+			sys.D = toMatrix(value.getCell(4));
+			sys.Ts = toScalar(value.getCell(5));
+			return sys;
+		}
+		if (isObject(value, "tf"))
+		{
+			StateSpace sys = realize(value.getCell(1), value.getCell(2));
+			sys.Ts = toScalar(value.getCell(3));
+			return sys;
+		}
+		throw std::runtime_error("Expected an ss or tf object");
+	}
+
+	static StateSpace discretize(const StateSpace& sys, double Ts, const std::string& method)
+	{
+		if (sys.Ts != 0.0)
+			throw std::runtime_error("The system is already discrete");
+		if (Ts <= 0.0)
+			throw std::runtime_error("The sample time must be positive");
+		size_t n = sys.A.getRows();
+		size_t m = sys.B.getCols();
+		StateSpace result = sys;
+		result.Ts = Ts;
+		if (n == 0)
+			return result;
+
+		if (method == "zoh")
+		{
+			// expm([A B; 0 0] * Ts) = [Ad Bd; 0 I]
+			Matrix M(n + m, n + m);
+			for (size_t r = 0; r < n; ++r)
+			{
+				for (size_t c = 0; c < n; ++c)
+					M(r, c) = sys.A(r, c) * Ts;
+				for (size_t c = 0; c < m; ++c)
+					M(r, n + c) = sys.B(r, c) * Ts;
+			}
+			Matrix E = LinearAlgebra::expm(M);
+			result.A = block(E, 0, 0, n, n);
+			result.B = block(E, 0, n, n, m);
+		}
+		else if (method == "tustin")
+		{
+			// Same scaling of B and C as MATLAB
+			Matrix I = Matrix::identity(n);
+			Matrix inverse = LinearAlgebra::inverse(I - sys.A * (Ts / 2.0));
+			double root = std::sqrt(Ts);
+			result.A = inverse * (I + sys.A * (Ts / 2.0));
+			result.B = inverse * sys.B * root;
+			result.C = sys.C * inverse * root;
+			result.D = sys.D + sys.C * inverse * sys.B * (Ts / 2.0);
+		}
+		else
+			throw std::runtime_error("c2d method '" + method + "' is not supported");
+		return result;
+	}
+
+	// Element-wise operation with scalar expansion
+	template<typename Operation>
+	static Matrix elementWise(const Matrix& left, const Matrix& right, Operation operation)
+	{
+		bool leftScalar = left.getRows() * left.getCols() == 1;
+		bool rightScalar = right.getRows() * right.getCols() == 1;
+		if (!leftScalar && !rightScalar && (left.getRows() != right.getRows() || left.getCols() != right.getCols()))
+			throw std::runtime_error("Matrix dimensions must agree");
+		const Matrix& shape = leftScalar ? right : left;
+		Matrix result(shape.getRows(), shape.getCols());
+		for (size_t i = 0; i < result.getRows() * result.getCols(); ++i)
+			result.data()[i] = operation(left.data()[leftScalar ? 0 : i], right.data()[rightScalar ? 0 : i]);
+		return result;
+	}
+
+
+	// ===== Indexed assignment =====
+
+	// Replaces target by a rows x cols array that keeps the overlapping elements, new elements are zero
+	template<typename T>
+	static void resizeElements(MatlabArray& target, size_t rows, size_t cols)
+	{
+		ArrayView<const T> current = std::as_const(target).view<T>();
+		if (current.getRows() == rows && current.getCols() == cols)
+			return;
+		ArrayBuffer<T> buffer = MatlabArray::createBuffer<T>(rows * cols);
+		std::fill(buffer.begin(), buffer.end(), T());
+		size_t keptRows = std::min(rows, current.getRows());
+		for (size_t c = 0; c < std::min(cols, current.getCols()); ++c)
+			std::copy(current.data() + c * current.getRows(), current.data() + c * current.getRows() + keptRows, buffer.data() + c * rows);
+		target = MatlabArray(target.getName(), std::move(buffer), { rows, cols });
+	}
+
+	// target(...) = values for the slices of EngineBackend::Slice, grows target like MATLAB
+	template<typename T>
+	static void assignElements(MatlabArray& target, EngineBackend::Slice slice, size_t first, const MatlabArray& values)
+	{
+		ArrayView<const T> source = values.view<T>();
+		ArrayView<const T> current = std::as_const(target).view<T>();
+		size_t rows = current.getRows();
+		size_t cols = current.getCols();
+		bool empty = rows == 0 && cols == 0;
+		switch (slice)
+		{
+		case EngineBackend::Slice::Rows:
+			if (!empty && source.getCols() != cols)
+				throw std::runtime_error("Subscripted assignment dimension mismatch: " + std::to_string(source.getCols())
+					+ " columns assigned to " + std::to_string(cols));
+			resizeElements<T>(target, std::max(rows, first + source.getRows()), source.getCols());
+			break;
+		case EngineBackend::Slice::Columns:
+			if (!empty && source.getRows() != rows)
+				throw std::runtime_error("Subscripted assignment dimension mismatch: " + std::to_string(source.getRows())
+					+ " rows assigned to " + std::to_string(rows));
+			resizeElements<T>(target, source.getRows(), std::max(cols, first + source.getCols()));
+			break;
+		case EngineBackend::Slice::Elements:
+			if (first + source.size() <= current.size())
+				break;
+			if (rows <= 1)
+				resizeElements<T>(target, 1, first + source.size());
+			else if (cols == 1)
+				resizeElements<T>(target, first + source.size(), 1);
+			else
+				throw std::runtime_error("Attempt to grow array along ambiguous dimension");
+			break;
+		}
+
+		ArrayView<T> data = target.view<T>();
+		if (slice == EngineBackend::Slice::Rows)
+		{
+			for (size_t c = 0; c < source.getCols(); ++c)
+				std::copy(source.data() + c * source.getRows(), source.data() + (c + 1) * source.getRows(), data.data() + c * data.getRows() + first);
+		}
+		else // columns and element ranges are contiguous in column-major order
+			std::copy(source.data(), source.data() + source.size(), data.data() + (slice == EngineBackend::Slice::Columns ? first * data.getRows() : first));
+	}
+
+
+	// ===== InProcessBackend =====
+
+	InProcessBackend::InProcessBackend()
+	{
+
+	}
+	InProcessBackend::~InProcessBackend()
+	{
+
+	}
+
+	bool InProcessBackend::hasVariable(const std::string& name) const
+	{
+		return m_variables.find(name) != m_variables.end();
+	}
+	std::vector<std::string> InProcessBackend::getVariableNames() const
+	{
+		std::vector<std::string> names;
+		names.reserve(m_variables.size());
+		for (const auto& pair : m_variables)
+			names.push_back(pair.first);
+		std::sort(names.begin(), names.end());
+		return names;
+	}
+
+	int InProcessBackend::doEval(const std::string& command)
+	{
+		simulateLatency();
+		try {
+			for (const std::string& statement : splitTopLevel(command, ";,\n"))
+				executeStatement(statement);
+		}
+		catch (const std::exception& e) {
+			Logger::logError("InProcessBackend: " + std::string(e.what()) + "\n in \"" + command + "\"");
+			return -1;
+		}
+		Logger::logDebug("Evaluated command: \n\"" + command + "\"");
+		return 0;
+	}
+	std::vector<MatlabArray> InProcessBackend::doFeval(const std::string& function, size_t nargout, const std::vector<MatlabArray>& args)
+	{
+		simulateLatency();
+		try {
+			std::vector<MatlabArray> outputs = callFunction(function, nargout, args);
+			outputs.resize(std::min(outputs.size(), nargout), MatlabArray("ans"));
+			return outputs;
+		}
+		catch (const std::exception& e) {
+			Logger::logError("InProcessBackend: Failed to call '" + function + "': " + std::string(e.what()));
+			return {};
+		}
+	}
+	bool InProcessBackend::doSetVariable(const std::string& name, const MatlabArray& value)
+	{
+		simulateLatency();
+		if (!isIdentifier(name) || !value.isValid())
+		{
+			Logger::logError("InProcessBackend: Invalid variable '" + name + "'");
+			return false;
+		}
+		MatlabArray copy(value);
+		copy.setName(name);
+		m_variables.insert_or_assign(name, std::move(copy));
+		return true;
+	}
+	MatlabArray InProcessBackend::doGetVariable(const std::string& name)
+	{
+		simulateLatency();
+		auto it = m_variables.find(name);
+		if (it == m_variables.end())
+		{
+			Logger::logError("InProcessBackend: Undefined variable '" + name + "'");
+			return MatlabArray(name);
+		}
+		return it->second;
+	}
+
+	bool InProcessBackend::doGetVariableInfo(const std::string& name, VariableInfo& info)
+	{
+		simulateLatency();
+		auto it = m_variables.find(name);
+		if (it == m_variables.end())
+		{
+			Logger::logError("InProcessBackend: Undefined variable '" + name + "'");
+			return false;
+		}
+		const MatlabArray& value = it->second;
+		info.className = value.getClassName();
+		// whos reports complex and sparse separately from the class
+		for (const std::string& prefix : { std::string("sparse "), std::string("complex ") })
+		{
+			if (info.className.compare(0, prefix.size(), prefix) == 0)
+				info.className.erase(0, prefix.size());
+		}
+		info.dimensions = value.getDimensions();
+		info.complex = value.isComplex();
+		info.sparse = value.isSparse();
+		info.bytes = value.getSizeInBytes();
+		return true;
+	}
+
+	MatlabArray InProcessBackend::doGetVariableRows(const std::string& name, size_t first, size_t count)
+	{
+		simulateLatency();
+		auto it = m_variables.find(name);
+		if (it == m_variables.end())
+		{
+			Logger::logError("InProcessBackend: Undefined variable '" + name + "'");
+			return MatlabArray(name);
+		}
+		try {
+			return it->second.getRowRange(first, count);
+		}
+		catch (const std::exception& e) {
+			Logger::logError("InProcessBackend: " + std::string(e.what()));
+			return MatlabArray(name);
+		}
+	}
+
+	bool InProcessBackend::doSetVariableSlice(const std::string& name, Slice slice, size_t first, const MatlabArray& values)
+	{
+		simulateLatency();
+		auto it = m_variables.find(name);
+		if (it == m_variables.end())
+		{
+			Logger::logError("InProcessBackend: Undefined variable '" + name + "'");
+			return false;
+		}
+		MatlabArray& target = it->second;
+		try {
+			if (!values.isValid() || values.getClassName() != target.getClassName())
+				throw std::runtime_error("Only values of class " + target.getClassName() + " can be assigned to '" + name + "'");
+			if (target.isDouble())       assignElements<double>(target, slice, first, values);
+			else if (target.isSingle())  assignElements<float>(target, slice, first, values);
+			else if (target.isInt8())    assignElements<int8_t>(target, slice, first, values);
+			else if (target.isUint8())   assignElements<uint8_t>(target, slice, first, values);
+			else if (target.isInt16())   assignElements<int16_t>(target, slice, first, values);
+			else if (target.isUint16())  assignElements<uint16_t>(target, slice, first, values);
+			else if (target.isInt32())   assignElements<int32_t>(target, slice, first, values);
+			else if (target.isUint32())  assignElements<uint32_t>(target, slice, first, values);
+			else if (target.isInt64())   assignElements<int64_t>(target, slice, first, values);
+			else if (target.isUint64())  assignElements<uint64_t>(target, slice, first, values);
+			else if (target.isLogical()) assignElements<bool>(target, slice, first, values);
+			else
+				throw std::runtime_error("Indexed assignment to '" + name + "' of class " + target.getClassName() + " is not supported");
+		}
+		catch (const std::exception& e) {
+			Logger::logError("InProcessBackend: " + std::string(e.what()));
+			return false;
+		}
+		return true;
+	}
+
+	bool InProcessBackend::doResizeVariableRows(const std::string& name, size_t rows)
+	{
+		simulateLatency();
+		auto it = m_variables.find(name);
+		if (it == m_variables.end())
+		{
+			Logger::logError("InProcessBackend: Undefined variable '" + name + "'");
+			return false;
+		}
+		MatlabArray& target = it->second;
+		size_t cols = target.getM() > 0 ? target.getNumberOfElements() / target.getM() : target.getN();
+		if (target.isDouble())       resizeElements<double>(target, rows, cols);
+		else if (target.isSingle())  resizeElements<float>(target, rows, cols);
+		else if (target.isInt8())    resizeElements<int8_t>(target, rows, cols);
+		else if (target.isUint8())   resizeElements<uint8_t>(target, rows, cols);
+		else if (target.isInt16())   resizeElements<int16_t>(target, rows, cols);
+		else if (target.isUint16())  resizeElements<uint16_t>(target, rows, cols);
+		else if (target.isInt32())   resizeElements<int32_t>(target, rows, cols);
+		else if (target.isUint32())  resizeElements<uint32_t>(target, rows, cols);
+		else if (target.isInt64())   resizeElements<int64_t>(target, rows, cols);
+		else if (target.isUint64())  resizeElements<uint64_t>(target, rows, cols);
+		else if (target.isLogical()) resizeElements<bool>(target, rows, cols);
+		else
+		{
+			Logger::logError("InProcessBackend: '" + name + "' of class " + target.getClassName() + " can't be resized");
+			return false;
+		}
+		return true;
+	}
+
+	void InProcessBackend::simulateLatency() const
+	{
+		long long latency = m_latency;
+		if (latency <= 0)
+			return;
+		// Busy waiting, sleep_for is far too coarse for latencies in the microsecond range
+		auto end = std::chrono::steady_clock::now() + std::chrono::microseconds(latency);
+		while (std::chrono::steady_clock::now() < end)
+			std::this_thread::yield();
+	}
+
+	void InProcessBackend::executeStatement(const std::string& text)
+	{
+		std::string statement = trim(text);
+		if (statement.empty())
+			return;
+
+		// clear / clearvars with optional names
+		std::vector<std::string> words;
+		for (const std::string& word : splitTopLevel(statement, " \t"))
+		{
+			if (!word.empty())
+				words.push_back(word);
+		}
+		if (words[0] == "clear" || words[0] == "clearvars")
+		{
+			clear(std::vector<std::string>(words.begin() + 1, words.end()));
+			return;
+		}
+
+		std::vector<std::string> sides = splitTopLevel(statement, "=");
+		if (sides.size() == 1)
+		{
+			MatlabArray value = evaluateExpression(statement);
+			value.setName("ans");
+			m_variables.insert_or_assign("ans", std::move(value));
+			return;
+		}
+		if (sides.size() != 2)
+			throw std::runtime_error("Unsupported statement '" + statement + "'");
+
+		std::string target = trim(sides[0]);
+		std::string expression = trim(sides[1]);
+		if (target.size() >= 2 && target.front() == '[' && target.back() == ']')
+		{
+			// [a, b] = function(args)
+			std::vector<std::string> names;
+			for (const std::string& name : splitTopLevel(target.substr(1, target.size() - 2), ", "))
+			{
+				if (!trim(name).empty())
+					names.push_back(trim(name));
+			}
+			size_t open = expression.find('(');
+			std::string function = trim(expression.substr(0, open));
+			if (open == std::string::npos || expression.back() != ')' || !isIdentifier(function))
+				throw std::runtime_error("Multiple return values require a function call");
+			std::vector<MatlabArray> args;
+			std::string argList = expression.substr(open + 1, expression.size() - open - 2);
+			if (!trim(argList).empty())
+			{
+				for (const std::string& arg : splitTopLevel(argList, ","))
+					args.push_back(evaluateExpression(arg));
+			}
+			std::vector<MatlabArray> outputs = callFunction(function, names.size(), args);
+			for (size_t i = 0; i < names.size(); ++i)
+			{
+				if (names[i] == "~")
+					continue;
+				if (!isIdentifier(names[i]))
+					throw std::runtime_error("Invalid variable name '" + names[i] + "'");
+				outputs[i].setName(names[i]);
+				m_variables.insert_or_assign(names[i], std::move(outputs[i]));
+			}
+			return;
+		}
+		if (!isIdentifier(target))
+			throw std::runtime_error("Unsupported assignment target '" + target + "'");
+		MatlabArray value = evaluateExpression(expression);
+		value.setName(target);
+		m_variables.insert_or_assign(target, std::move(value));
+	}
+
+	MatlabArray InProcessBackend::evaluateExpression(const std::string& text)
+	{
+		std::string expression = trim(text);
+		if (expression.empty())
+			throw std::runtime_error("Empty expression");
+
+		size_t position = findBinaryOperator(expression, "+-");
+		if (position == std::string::npos)
+			position = findBinaryOperator(expression, "*/");
+		if (position != std::string::npos)
+		{
+			char op = expression[position];
+			bool elementWise = position > 0 && expression[position - 1] == '.';
+			Matrix left = toMatrix(evaluateExpression(expression.substr(0, elementWise ? position - 1 : position)));
+			Matrix right = toMatrix(evaluateExpression(expression.substr(position + 1)));
+			bool scalar = left.getRows() * left.getCols() == 1 || right.getRows() * right.getCols() == 1;
+			switch (op)
+			{
+			case '+': return toArray(MatlabAPI::elementWise(left, right, [](double a, double b) { return a + b; }));
+			case '-': return toArray(MatlabAPI::elementWise(left, right, [](double a, double b) { return a - b; }));
+			case '*':
+				if (!elementWise && !scalar)
+					return toArray(LinearAlgebra::multiply(left, right));
+				return toArray(MatlabAPI::elementWise(left, right, [](double a, double b) { return a * b; }));
+			default:
+				if (!elementWise && right.getRows() * right.getCols() != 1)
+					throw std::runtime_error("Matrix division is not supported");
+				return toArray(MatlabAPI::elementWise(left, right, [](double a, double b) { return a / b; }));
+			}
+		}
+		if (expression[0] == '-' || expression[0] == '+')
+		{
+			Matrix value = toMatrix(evaluateExpression(expression.substr(1)));
+			return toArray(expression[0] == '-' ? value * -1.0 : value);
+		}
+		return evaluateOperand(expression);
+	}
+
+	MatlabArray InProcessBackend::evaluateOperand(const std::string& text)
+	{
+		std::string operand = trim(text);
+		double number = 0.0;
+		if (parseNumber(operand, number))
+			return MatlabArray("ans", number);
+
+		// Char array, unless the closing quote is followed by a transpose
+		if (operand.front() == '\'' || operand.front() == '"')
+		{
+			std::string value;
+			size_t i = 1;
+			for (; i < operand.size(); ++i)
+			{
+				if (operand[i] == operand.front())
+				{
+					if (i + 1 < operand.size() && operand[i + 1] == operand.front())
+						++i; // escaped quote
+					else
+						break;
+				}
+				value += operand[i];
+			}
+			if (i + 1 == operand.size())
+				return MatlabArray("ans", value);
+		}
+		// Transpose
+		if (operand.size() > 1 && operand.back() == '\'' && endsOperand(operand[operand.size() - 2]))
+		{
+			size_t length = operand.size() - (operand[operand.size() - 2] == '.' ? 2 : 1);
+			return toArray(toMatrix(evaluateOperand(operand.substr(0, length))).getTransposed());
+		}
+		// Parentheses
+		if (operand.front() == '(' && operand.back() == ')')
+			return evaluateExpression(operand.substr(1, operand.size() - 2));
+		// Matrix literal of scalars
+		if (operand.front() == '[' && operand.back() == ']')
+		{
+			std::vector<std::vector<double>> rows;
+			for (const std::string& row : splitTopLevel(operand.substr(1, operand.size() - 2), ";\n"))
+			{
+				std::vector<double> values;
+				for (const std::string& element : splitTopLevel(row, ", \t"))
+				{
+					if (!trim(element).empty())
+						values.push_back(toScalar(evaluateExpression(element)));
+				}
+				if (values.empty())
+					continue;
+				if (!rows.empty() && rows.front().size() != values.size())
+					throw std::runtime_error("Dimensions of arrays being concatenated are not consistent");
+				rows.push_back(values);
+			}
+			Matrix matrix(rows.size(), rows.empty() ? 0 : rows.front().size());
+			for (size_t r = 0; r < rows.size(); ++r)
+				for (size_t c = 0; c < rows[r].size(); ++c)
+					matrix(r, c) = rows[r][c];
+			return toArray(matrix);
+		}
+		// Function call
+		size_t open = operand.find('(');
+		if (open != std::string::npos && operand.back() == ')')
+		{
+			std::string function = trim(operand.substr(0, open));
+			if (!isIdentifier(function))
+				throw std::runtime_error("Unsupported expression '" + operand + "'");
+			if (hasVariable(function))
+				throw std::runtime_error("Indexing of '" + function + "' is not supported");
+			std::vector<MatlabArray> args;
+			std::string argList = operand.substr(open + 1, operand.size() - open - 2);
+			if (!trim(argList).empty())
+			{
+				for (const std::string& arg : splitTopLevel(argList, ","))
+					args.push_back(evaluateExpression(arg));
+			}
+			return callFunction(function, 1, args)[0];
+		}
+		// Variable
+		if (isIdentifier(operand))
+		{
+			auto it = m_variables.find(operand);
+			if (it != m_variables.end())
+				return it->second;
+			std::vector<MatlabArray> outputs = callFunction(operand, 1, {}); // function without arguments
+			return outputs[0];
+		}
+		throw std::runtime_error("Unsupported expression '" + operand + "'");
+	}
+
+	std::vector<MatlabArray> InProcessBackend::callFunction(const std::string& function, size_t nargout, const std::vector<MatlabArray>& args)
+	{
+		std::vector<MatlabArray> outputs;
+		size_t maxOutputs = 1;
+		if (function == "ss")
+		{
+			if (args.size() == 1)
+				outputs.push_back(toObject(toStateSpace(args[0])));
+			else if (args.size() == 4 || args.size() == 5)
+			{
+				StateSpace sys;
+				sys.A = toMatrix(args[0]);
+				sys.B = toMatrix(args[1]);
+				sys.C = toMatrix(args[2]);
+				sys.D = toMatrix(args[3]);
+				sys.Ts = args.size() == 5 ? toScalar(args[4]) : 0.0;
+				size_t n = sys.A.getRows();
+				if (sys.A.getCols() != n || sys.B.getRows() != n || sys.C.getCols() != n
+					|| sys.D.getRows() != sys.C.getRows() || sys.D.getCols() != sys.B.getCols())
+					throw std::runtime_error("The A, B, C and D matrices must have consistent dimensions");
+				outputs.push_back(toObject(sys));
+			}
+			else
+				throw std::runtime_error("ss expects 1, 4 or 5 arguments");
+		}
+		else if (function == "tf")
+		{
+			if (args.size() != 2 && args.size() != 3)
+				throw std::runtime_error("tf expects 2 or 3 arguments");
+			realize(args[0], args[1]); // validates the coefficients
+			outputs.push_back(makeObject("tf", { args[0], args[1], MatlabArray("Ts", args.size() == 3 ? toScalar(args[2]) : 0.0) }));
+		}
+		else if (function == "c2d")
+		{
+			if (args.size() != 2 && args.size() != 3)
+				throw std::runtime_error("c2d expects 2 or 3 arguments");
+			std::string method = args.size() == 3 ? toText(args[2]) : "zoh";
+			outputs.push_back(toObject(discretize(toStateSpace(args[0]), toScalar(args[1]), method)));
+		}
+		else if (function == "ssdata")
+		{
+			if (args.size() != 1)
+				throw std::runtime_error("ssdata expects 1 argument");
+			StateSpace sys = toStateSpace(args[0]);
+			outputs = { toArray(sys.A), toArray(sys.B), toArray(sys.C), toArray(sys.D), MatlabArray("ans", sys.Ts) };
+			maxOutputs = outputs.size();
+		}
+		else if (function == "zeros" || function == "eye")
+		{
+			if (args.size() != 1 && args.size() != 2)
+				throw std::runtime_error(function + " expects 1 or 2 arguments");
+			size_t rows = (size_t)toScalar(args[0]);
+			size_t cols = args.size() == 2 ? (size_t)toScalar(args[1]) : rows;
+			Matrix matrix(rows, cols);
+			if (function == "eye")
+			{
+				for (size_t i = 0; i < std::min(rows, cols); ++i)
+					matrix(i, i) = 1.0;
+			}
+			outputs.push_back(toArray(matrix));
+		}
+		else if (function == "size")
+		{
+			if (args.size() != 1)
+				throw std::runtime_error("size expects 1 argument");
+			outputs.push_back(MatlabArray("ans", 1, 2, { (double)args[0].getM(), (double)args[0].getN() }));
+		}
+		else
+			throw std::runtime_error("Undefined function '" + function + "'");
+
+		if (nargout > maxOutputs)
+			throw std::runtime_error("Too many output arguments for '" + function + "'");
+		return outputs;
+	}
+
+	void InProcessBackend::clear(const std::vector<std::string>& patterns)
+	{
+		if (patterns.empty())
+		{
+			m_variables.clear();
+			return;
+		}
+		for (const std::string& pattern : patterns)
+		{
+			if (!pattern.empty() && pattern.back() == '*')
+			{
+				std::string prefix = pattern.substr(0, pattern.size() - 1);
+				for (auto it = m_variables.begin(); it != m_variables.end();)
+				{
+					if (it->first.compare(0, prefix.size(), prefix) == 0)
+						it = m_variables.erase(it);
+					else
+						++it;
+				}
+			}
+			else
+				m_variables.erase(pattern);
+		}
+	}
+}
@@ -0,0 +1,1125 @@
+#include "MatFile.h"
+#include "MatlabAPI_debug.h"
+#include "Utf.h"
+#include <algorithm>
+#include <ctime>
+#include <cstring>
+#include <filesystem>
+#ifdef ZLIB_AVAILABLE
+#include <zlib.h>
+#endif
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace MatlabAPI
+{
+	// Layout of the file header
+	static const size_t s_headerSize = 128;
+	static const size_t s_headerTextSize = 116;
+	static const size_t s_tagSize = 8;
+
+	// Array flags
+	static const uint32_t s_flagComplex = 0x0800;
+	static const uint32_t s_flagLogical = 0x0200;
+
+	// Compressed variables are listed by inflating only their beginning
+	static const size_t s_compressedHeaderPeek = 1024;
+
+	// Size of the blocks in which streamed rows are transposed and compressed
+	static const size_t s_blockBytes = size_t(4) << 20;
+
+	static bool isLittleEndian()
+	{
+		const uint16_t value = 1;
+		return *reinterpret_cast<const uint8_t*>(&value) == 1;
+	}
+	static size_t padded(size_t bytes)
+	{
+		return (bytes + 7) & ~size_t(7);
+	}
+	static uint32_t load32(const uint8_t* data)
+	{
+		uint32_t value;
+		std::memcpy(&value, data, sizeof(value));
+		return value;
+	}
+	static size_t getDataTypeSize(uint32_t type)
+	{
+		switch (type)
+		{
+		case MatFileFormat::miINT8:
+		case MatFileFormat::miUINT8:
+		case MatFileFormat::miUTF8:   return 1;
+		case MatFileFormat::miINT16:
+		case MatFileFormat::miUINT16:
+		case MatFileFormat::miUTF16:  return 2;
+		case MatFileFormat::miINT32:
+		case MatFileFormat::miUINT32:
+		case MatFileFormat::miSINGLE:
+		case MatFileFormat::miUTF32:  return 4;
+		case MatFileFormat::miDOUBLE:
+		case MatFileFormat::miINT64:
+		case MatFileFormat::miUINT64: return 8;
+		default:                      return 0;
+		}
+	}
+
+	const char* MatFileFormat::getClassName(ArrayClass arrayClass)
+	{
+		switch (arrayClass)
+		{
+		case mxCELL:   return "cell";
+		case mxSTRUCT: return "struct";
+		case mxOBJECT: return "object";
+		case mxCHAR:   return "char";
+		case mxSPARSE: return "sparse";
+		case mxDOUBLE: return "double";
+		case mxSINGLE: return "single";
+		case mxINT8:   return "int8";
+		case mxUINT8:  return "uint8";
+		case mxINT16:  return "int16";
+		case mxUINT16: return "uint16";
+		case mxINT32:  return "int32";
+		case mxUINT32: return "uint32";
+		case mxINT64:  return "int64";
+		case mxUINT64: return "uint64";
+		default:       return "unknown";
+		}
+	}
+	bool MatFileFormat::isCompressionAvailable()
+	{
+#ifdef ZLIB_AVAILABLE
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	// ===== Element encoding =====
+
+	static void append32(std::string& out, uint32_t value)
+	{
+		out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+	}
+	static void appendPadding(std::string& out)
+	{
+		out.append(padded(out.size()) - out.size(), '\0');
+	}
+	// Sizes are stored in 32 bit tags, larger elements can't be written in the v5 format
+	static bool checkElementSize(uint64_t bytes, const std::string& name)
+	{
+		if (bytes <= UINT32_MAX)
+			return true;
+		Logger::logError("MatFileWriter: '" + name + "' exceeds the 4 GB element limit of the v5 format");
+		return false;
+	}
+
+	static bool appendSubElement(std::string& out, uint32_t type, const void* data, size_t bytes, const std::string& name)
+	{
+		if (!checkElementSize(bytes, name))
+			return false;
+		append32(out, type);
+		append32(out, static_cast<uint32_t>(bytes));
+		out.append(static_cast<const char*>(data), bytes);
+		appendPadding(out);
+		return true;
+	}
+
+	/**
+	 * @brief Array flags, dimensions and name: the start of every miMATRIX element
+	 */
+	static bool encodeArrayHeader(MatFileFormat::ArrayClass arrayClass, uint32_t flags, const std::vector<size_t>& dimensions, const std::string& name,
+		std::string& out)
+	{
+		uint32_t arrayFlags[2] = { arrayClass | flags, 0 };
+		appendSubElement(out, MatFileFormat::miUINT32, arrayFlags, sizeof(arrayFlags), name);
+		std::vector<int32_t> dims;
+		for (size_t dimension : dimensions)
+		{
+			if (dimension > INT32_MAX)
+			{
+				Logger::logError("MatFileWriter: a dimension of '" + name + "' exceeds the limit of the v5 format");
+				return false;
+			}
+			dims.push_back(static_cast<int32_t>(dimension));
+		}
+		return appendSubElement(out, MatFileFormat::miINT32, dims.data(), dims.size() * sizeof(int32_t), name)
+			&& appendSubElement(out, MatFileFormat::miINT8, name.data(), name.size(), name);
+	}
+
+	/**
+	 * @brief Tag of a miMATRIX element with the given content size
+	 */
+	static bool encodeMatrixTag(uint64_t contentBytes, const std::string& name, std::string& out)
+	{
+		if (!checkElementSize(contentBytes, name))
+			return false;
+		append32(out, MatFileFormat::miMATRIX);
+		append32(out, static_cast<uint32_t>(contentBytes));
+		return true;
+	}
+
+	/**
+	 * @brief Complete miMATRIX element of an array, for the types MatlabArray gives access to
+	 */
+	static bool encodeArray(const MatlabArray& array, const std::string& name, std::string& out)
+	{
+		if (!array.isValid())
+		{
+			Logger::logError("MatFileWriter: array '" + array.getName() + "' is not valid");
+			return false;
+		}
+		std::vector<size_t> dimensions = array.getDimensions();
+		if (dimensions.size() < 2)
+			dimensions.resize(2, 1);
+		std::string content;
+		if (array.isCell())
+		{
+			if (!encodeArrayHeader(MatFileFormat::mxCELL, 0, dimensions, name, content))
+				return false;
+			for (size_t i = 0; i < array.getNumberOfElements(); ++i)
+				if (!encodeArray(array.getCell(i), "", content))
+					return false;
+		}
+		else if (array.isChar())
+		{
+			std::u16string text = Utf::toUtf16(array.getString());
+			if (!encodeArrayHeader(MatFileFormat::mxCHAR, 0, { text.empty() ? 0 : size_t(1), text.size() }, name, content)
+				|| !appendSubElement(content, MatFileFormat::miUINT16, text.data(), text.size() * sizeof(char16_t), name))
+				return false;
+		}
+		else if (array.isLogical())
+		{
+			std::vector<bool> values = array.getLogicalVector();
+			std::vector<uint8_t> bytes(values.begin(), values.end());
+			if (!encodeArrayHeader(MatFileFormat::mxUINT8, s_flagLogical, dimensions, name, content)
+				|| !appendSubElement(content, MatFileFormat::miUINT8, bytes.data(), bytes.size(), name))
+				return false;
+		}
+		else if (array.isDouble() && !array.isComplex() && !array.isSparse())
+		{
+			std::vector<double> values = array.getDoubleVector();
+			if (!encodeArrayHeader(MatFileFormat::mxDOUBLE, 0, dimensions, name, content)
+				|| !appendSubElement(content, MatFileFormat::miDOUBLE, values.data(), values.size() * sizeof(double), name))
+				return false;
+		}
+		else
+		{
+			Logger::logError("MatFileWriter: arrays of class " + array.getClassName() + " are not supported, use the typed write functions");
+			return false;
+		}
+		if (!encodeMatrixTag(content.size(), name, out))
+			return false;
+		out += content;
+		return true;
+	}
+
+	// ===== Compression =====
+
+#ifdef ZLIB_AVAILABLE
+	/**
+	 * @brief Streams deflated data into a file
+	 */
+	class Deflater
+	{
+	public:
+		explicit Deflater(std::fstream& out)
+			: m_out(out)
+			, m_buffer(256 * 1024)
+		{
+			std::memset(&m_stream, 0, sizeof(m_stream));
+			m_ok = deflateInit(&m_stream, Z_DEFAULT_COMPRESSION) == Z_OK;
+		}
+		~Deflater()
+		{
+			deflateEnd(&m_stream);
+		}
+		bool feed(const void* data, size_t bytes)
+		{
+			const uint8_t* input = static_cast<const uint8_t*>(data);
+			while (m_ok && bytes > 0)
+			{
+				// avail_in is 32 bit
+				uInt chunk = static_cast<uInt>(std::min<size_t>(bytes, 1u << 30));
+				m_stream.next_in = const_cast<Bytef*>(input);
+				m_stream.avail_in = chunk;
+				m_ok = run(Z_NO_FLUSH);
+				input += chunk;
+				bytes -= chunk;
+			}
+			return m_ok;
+		}
+		bool finish()
+		{
+			m_stream.next_in = nullptr;
+			m_stream.avail_in = 0;
+			return m_ok && run(Z_FINISH);
+		}
+
+	private:
+		bool run(int flush)
+		{
+			int status;
+			do
+			{
+				m_stream.next_out = m_buffer.data();
+				m_stream.avail_out = static_cast<uInt>(m_buffer.size());
+				status = deflate(&m_stream, flush);
+				if (status == Z_STREAM_ERROR)
+					return false;
+				m_out.write(reinterpret_cast<const char*>(m_buffer.data()), m_buffer.size() - m_stream.avail_out);
+			} while (m_stream.avail_out == 0 || (flush == Z_FINISH && status != Z_STREAM_END));
+			return m_out.good();
+		}
+
+		std::fstream& m_out;
+		std::vector<Bytef> m_buffer;
+		z_stream m_stream;
+		bool m_ok;
+	};
+
+	/**
+	 * @brief Inflates a zlib stream, stops after maxBytes output bytes
+	 */
+	static bool inflateData(const uint8_t* data, size_t bytes, std::vector<uint8_t>& out, size_t maxBytes)
+	{
+		z_stream stream;
+		std::memset(&stream, 0, sizeof(stream));
+		if (inflateInit(&stream) != Z_OK)
+			return false;
+		stream.next_in = const_cast<Bytef*>(data);
+		stream.avail_in = static_cast<uInt>(std::min<size_t>(bytes, UINT32_MAX));
+		out.resize(std::min<size_t>(std::max<size_t>(bytes * 4, 4096), maxBytes));
+		size_t produced = 0;
+		int status = Z_OK;
+		while (status == Z_OK && produced < maxBytes)
+		{
+			if (produced == out.size())
+				out.resize(std::min(out.size() * 2, maxBytes));
+			stream.next_out = out.data() + produced;
+			stream.avail_out = static_cast<uInt>(std::min<size_t>(out.size() - produced, UINT32_MAX));
+			status = inflate(&stream, Z_NO_FLUSH);
+			produced = static_cast<size_t>(stream.next_out - out.data());
+		}
+		inflateEnd(&stream);
+		out.resize(produced);
+		return status == Z_STREAM_END || status == Z_OK;
+	}
+#endif
+
+	// ===== MatFileWriter =====
+
+	struct MatFileWriter::RowStream
+	{
+		std::string name;
+		size_t cols = 0;
+		size_t rows = 0;
+		std::string tempPath;
+		std::fstream temp; // appended rows in row-major order
+
+		~RowStream()
+		{
+			if (temp.is_open())
+				temp.close();
+			std::error_code error;
+			std::filesystem::remove(tempPath, error);
+		}
+
+		/**
+		 * @brief Writes the rows in column-major order to target, starting at dataStart
+		 */
+		bool transpose(std::fstream& target, uint64_t dataStart)
+		{
+			size_t blockRows = std::max<size_t>(1, s_blockBytes / (cols * sizeof(double)));
+			std::vector<double> block(blockRows * cols);
+			std::vector<double> column(blockRows);
+			temp.seekg(0);
+			for (size_t first = 0; first < rows; first += blockRows)
+			{
+				size_t count = std::min(blockRows, rows - first);
+				if (!temp.read(reinterpret_cast<char*>(block.data()), count * cols * sizeof(double)))
+					return false;
+				for (size_t col = 0; col < cols; ++col)
+				{
+					for (size_t row = 0; row < count; ++row)
+						column[row] = block[row * cols + col];
+					target.seekp(static_cast<std::streamoff>(dataStart + (uint64_t(col) * rows + first) * sizeof(double)));
+					target.write(reinterpret_cast<const char*>(column.data()), count * sizeof(double));
+				}
+			}
+			target.seekp(static_cast<std::streamoff>(dataStart + uint64_t(rows) * cols * sizeof(double)));
+			return target.good();
+		}
+	};
+
+	MatFileWriter::MatFileWriter(const std::string& path, Compression compression)
+		: m_path(path)
+		, m_compression(compression)
+	{
+		if (!isLittleEndian())
+		{
+			Logger::logError("MatFileWriter: big endian platforms are not supported");
+			return;
+		}
+		if (m_compression == Compression::Zlib && !MatFileFormat::isCompressionAvailable())
+		{
+			Logger::logWarning("MatFileWriter: zlib is not available, writing '" + path + "' uncompressed");
+			m_compression = Compression::None;
+		}
+		m_file.open(path, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!m_file.is_open())
+		{
+			Logger::logError("MatFileWriter: can't create '" + path + "'");
+			return;
+		}
+
+		char created[64] = "";
+		std::time_t now = std::time(nullptr);
+		std::strftime(created, sizeof(created), "%a %b %d %H:%M:%S %Y", std::localtime(&now));
+		std::string header = std::string("MATLAB 5.0 MAT-file, Platform: MatlabAPI, Created on: ") + created;
+		header.resize(s_headerTextSize, ' ');
+		header.append(8, '\0');   // no subsystem data
+		header += '\x00';         // version 0x0100
+		header += '\x01';
+		header += "IM";           // little endian
+		m_file.write(header.data(), header.size());
+		m_failed = !m_file.good();
+	}
+	MatFileWriter::~MatFileWriter()
+	{
+		close();
+	}
+
+	bool MatFileWriter::checkWritable()
+	{
+		if (!m_file.is_open())
+		{
+			Logger::logError("MatFileWriter: '" + m_path + "' is not open");
+			return false;
+		}
+		if (m_rowStream)
+		{
+			Logger::logError("MatFileWriter: call endRows() before writing the next variable");
+			return false;
+		}
+		return true;
+	}
+
+	bool MatFileWriter::writeElement(const std::string& name, const std::string& element)
+	{
+#ifdef ZLIB_AVAILABLE
+		if (m_compression == Compression::Zlib)
+		{
+			std::streamoff tagPosition = m_file.tellp();
+			std::string tag;
+			append32(tag, MatFileFormat::miCOMPRESSED);
+			append32(tag, 0); // patched below
+			m_file.write(tag.data(), tag.size());
+			Deflater deflater(m_file);
+			if (!deflater.feed(element.data(), element.size()) || !deflater.finish())
+			{
+				m_failed = true;
+				return false;
+			}
+			std::streamoff end = m_file.tellp();
+			if (!checkElementSize(end - tagPosition - s_tagSize, name))
+			{
+				m_failed = true;
+				return false;
+			}
+			uint32_t size = static_cast<uint32_t>(end - tagPosition - s_tagSize);
+			m_file.seekp(tagPosition + 4);
+			m_file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+			m_file.seekp(end);
+			m_failed |= !m_file.good();
+			return m_file.good();
+		}
+#endif
+		(void)name; // only reported for compressed elements
+		m_file.write(element.data(), element.size());
+		m_failed |= !m_file.good();
+		return m_file.good();
+	}
+
+	bool MatFileWriter::writeNumeric(const std::string& name, MatFileFormat::ArrayClass arrayClass, MatFileFormat::DataType type,
+		size_t elementSize, const void* real, const void* imag, size_t rows, size_t cols)
+	{
+		MATLAB_API_GENERAL_PROFILING_FUNCTION(MATLAB_API_COLOR_STAGE_2);
+		if (!checkWritable())
+			return false;
+		size_t bytes = rows * cols * elementSize;
+		std::string content;
+		if (!checkElementSize(uint64_t(imag ? 2 : 1) * (s_tagSize + padded(bytes)), name)
+			|| !encodeArrayHeader(arrayClass, imag ? s_flagComplex : 0, { rows, cols }, name, content))
+		{
+			m_failed = true;
+			return false;
+		}
+		content.reserve(content.size() + 2 * (s_tagSize + padded(bytes)));
+		std::string element;
+		if (!appendSubElement(content, type, real, bytes, name) || (imag && !appendSubElement(content, type, imag, bytes, name))
+			|| !encodeMatrixTag(content.size(), name, element))
+		{
+			m_failed = true;
+			return false;
+		}
+		return writeElement(name, element + content);
+	}
+
+	bool MatFileWriter::write(const std::string& name, const Matrix& matrix)
+	{
+		// Matrix is row-major
+		std::vector<double> columnMajor(matrix.getRows() * matrix.getCols());
+		for (size_t row = 0; row < matrix.getRows(); ++row)
+			for (size_t col = 0; col < matrix.getCols(); ++col)
+				columnMajor[col * matrix.getRows() + row] = matrix(row, col);
+		return write(name, columnMajor.data(), matrix.getRows(), matrix.getCols());
+	}
+	bool MatFileWriter::write(const std::string& name, const std::string& text)
+	{
+		if (!checkWritable())
+			return false;
+		std::u16string utf16 = Utf::toUtf16(text);
+		std::string content;
+		std::string element;
+		if (!encodeArrayHeader(MatFileFormat::mxCHAR, 0, { utf16.empty() ? 0 : size_t(1), utf16.size() }, name, content)
+			|| !appendSubElement(content, MatFileFormat::miUINT16, utf16.data(), utf16.size() * sizeof(char16_t), name)
+			|| !encodeMatrixTag(content.size(), name, element))
+		{
+			m_failed = true;
+			return false;
+		}
+		return writeElement(name, element + content);
+	}
+	bool MatFileWriter::write(const std::string& name, const std::vector<bool>& values)
+	{
+		if (!checkWritable())
+			return false;
+		std::vector<uint8_t> bytes(values.begin(), values.end());
+		std::string content;
+		std::string element;
+		if (!encodeArrayHeader(MatFileFormat::mxUINT8, s_flagLogical, { size_t(1), bytes.size() }, name, content)
+			|| !appendSubElement(content, MatFileFormat::miUINT8, bytes.data(), bytes.size(), name)
+			|| !encodeMatrixTag(content.size(), name, element))
+		{
+			m_failed = true;
+			return false;
+		}
+		return writeElement(name, element + content);
+	}
+	bool MatFileWriter::write(const MatlabArray& array)
+	{
+		if (!checkWritable())
+			return false;
+		std::string element;
+		if (!encodeArray(array, array.getName(), element))
+		{
+			m_failed = true;
+			return false;
+		}
+		return writeElement(array.getName(), element);
+	}
+
+	bool MatFileWriter::beginRows(const std::string& name, size_t cols)
+	{
+		if (!checkWritable())
+			return false;
+		if (cols == 0)
+		{
+			Logger::logError("MatFileWriter: '" + name + "' needs at least one column");
+			return false;
+		}
+		std::unique_ptr<RowStream> stream(new RowStream());
+		stream->name = name;
+		stream->cols = cols;
+		stream->tempPath = m_path + "." + name + ".rows";
+		stream->temp.open(stream->tempPath, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!stream->temp.is_open())
+		{
+			Logger::logError("MatFileWriter: can't create the temporary file '" + stream->tempPath + "'");
+			return false;
+		}
+		m_rowStream = std::move(stream);
+		return true;
+	}
+	bool MatFileWriter::appendRows(const double* data, size_t rows)
+	{
+		if (!m_rowStream)
+		{
+			Logger::logError("MatFileWriter: call beginRows() before appendRows()");
+			return false;
+		}
+		m_rowStream->temp.write(reinterpret_cast<const char*>(data), rows * m_rowStream->cols * sizeof(double));
+		if (!m_rowStream->temp.good())
+		{
+			m_failed = true;
+			return false;
+		}
+		m_rowStream->rows += rows;
+		return true;
+	}
+	bool MatFileWriter::appendRows(const Matrix& block)
+	{
+		if (m_rowStream && block.getCols() != m_rowStream->cols)
+		{
+			Logger::logError("MatFileWriter: '" + m_rowStream->name + "' has " + std::to_string(m_rowStream->cols)
+				+ " columns, the block has " + std::to_string(block.getCols()));
+			return false;
+		}
+		return appendRows(block.data(), block.getRows());
+	}
+	bool MatFileWriter::endRows()
+	{
+		MATLAB_API_GENERAL_PROFILING_FUNCTION(MATLAB_API_COLOR_STAGE_2);
+		if (!m_rowStream)
+			return false;
+		std::unique_ptr<RowStream> stream = std::move(m_rowStream);
+		stream->temp.flush();
+
+		uint64_t dataBytes = uint64_t(stream->rows) * stream->cols * sizeof(double);
+		std::string header;
+		std::string prefix;
+		if (!encodeArrayHeader(MatFileFormat::mxDOUBLE, 0, { stream->rows, stream->cols }, stream->name, header)
+			|| !checkElementSize(header.size() + s_tagSize + padded(dataBytes), stream->name))
+		{
+			m_failed = true;
+			return false;
+		}
+		append32(header, MatFileFormat::miDOUBLE);
+		append32(header, static_cast<uint32_t>(dataBytes));
+		encodeMatrixTag(header.size() + padded(dataBytes), stream->name, prefix);
+		prefix += header;
+		std::string padding(padded(dataBytes) - dataBytes, '\0');
+
+#ifdef ZLIB_AVAILABLE
+		if (m_compression == Compression::Zlib)
+		{
+			// Transposed into a second temporary file, then compressed in one sequential pass
+			std::string transposedPath = stream->tempPath + ".t";
+			std::fstream transposed(transposedPath, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+			bool ok = transposed.is_open() && stream->transpose(transposed, 0);
+			if (ok)
+			{
+				transposed.flush();
+				transposed.seekg(0);
+				std::streamoff tagPosition = m_file.tellp();
+				std::string tag;
+				append32(tag, MatFileFormat::miCOMPRESSED);
+				append32(tag, 0);
+				m_file.write(tag.data(), tag.size());
+				Deflater deflater(m_file);
+				ok = deflater.feed(prefix.data(), prefix.size());
+				std::vector<char> chunk(s_blockBytes);
+				for (uint64_t remaining = dataBytes; ok && remaining > 0;)
+				{
+					size_t count = static_cast<size_t>(std::min<uint64_t>(remaining, chunk.size()));
+					ok = transposed.read(chunk.data(), count) && deflater.feed(chunk.data(), count);
+					remaining -= count;
+				}
+				ok = ok && deflater.feed(padding.data(), padding.size()) && deflater.finish();
+				std::streamoff end = m_file.tellp();
+				ok = ok && checkElementSize(end - tagPosition - s_tagSize, stream->name);
+				uint32_t size = static_cast<uint32_t>(end - tagPosition - s_tagSize);
+				m_file.seekp(tagPosition + 4);
+				m_file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+				m_file.seekp(end);
+			}
+			transposed.close();
+			std::error_code error;
+			std::filesystem::remove(transposedPath, error);
+			m_failed |= !ok || !m_file.good();
+			return ok && m_file.good();
+		}
+#endif
+		m_file.write(prefix.data(), prefix.size());
+		bool ok = stream->transpose(m_file, static_cast<uint64_t>(m_file.tellp()));
+		m_file.write(padding.data(), padding.size());
+		m_failed |= !ok || !m_file.good();
+		return ok && m_file.good();
+	}
+
+	bool MatFileWriter::close()
+	{
+		if (!m_file.is_open())
+			return !m_failed;
+		if (m_rowStream)
+			endRows();
+		m_file.close();
+		if (m_failed)
+			Logger::logError("MatFileWriter: writing '" + m_path + "' failed");
+		return !m_failed;
+	}
+
+	// ===== MatFileReader =====
+
+	/**
+	 * @brief Read only mapping of the whole file
+	 */
+	struct MatFileReader::Mapping
+	{
+		const uint8_t* address = nullptr;
+		size_t size = 0;
+#ifdef _WIN32
+		HANDLE file = INVALID_HANDLE_VALUE;
+		HANDLE mapping = nullptr;
+#else
+		int file = -1;
+#endif
+
+		~Mapping()
+		{
+#ifdef _WIN32
+			if (address)
+				UnmapViewOfFile(address);
+			if (mapping)
+				CloseHandle(mapping);
+			if (file != INVALID_HANDLE_VALUE)
+				CloseHandle(file);
+#else
+			if (address)
+				::munmap(const_cast<uint8_t*>(address), size);
+			if (file >= 0)
+				::close(file);
+#endif
+		}
+
+		bool open(const std::string& path)
+		{
+#ifdef _WIN32
+			file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+			if (file == INVALID_HANDLE_VALUE)
+				return false;
+			LARGE_INTEGER fileSize;
+			if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+				return false;
+			size = (size_t)fileSize.QuadPart;
+			mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (!mapping)
+				return false;
+			address = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+			file = ::open(path.c_str(), O_RDONLY);
+			if (file < 0)
+				return false;
+			struct stat info;
+			if (::fstat(file, &info) != 0 || info.st_size == 0)
+				return false;
+			size = (size_t)info.st_size;
+			void* mapped = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, file, 0);
+			address = mapped == MAP_FAILED ? nullptr : static_cast<const uint8_t*>(mapped);
+#endif
+			return address != nullptr;
+		}
+	};
+
+	/**
+	 * @brief Reads the sub-element at pos and advances pos, supports the small data element format
+	 */
+	static bool readSubElement(const uint8_t* data, size_t size, size_t& pos, uint32_t& type, size_t& bytes, const uint8_t*& content)
+	{
+		if (pos + s_tagSize > size)
+			return false;
+		uint32_t first = load32(data + pos);
+		if (first >> 16)
+		{
+			// Small data element: type and size in the first 4 bytes, the data in the next 4
+			type = first & 0xFFFF;
+			bytes = first >> 16;
+			content = data + pos + 4;
+			pos += s_tagSize;
+			return bytes <= 4;
+		}
+		type = first;
+		bytes = load32(data + pos + 4);
+		content = data + pos + s_tagSize;
+		if (pos + s_tagSize + bytes > size)
+			return false;
+		pos += s_tagSize + padded(bytes);
+		return true;
+	}
+
+	/**
+	 * @brief Decoded start of a miMATRIX element
+	 */
+	struct ArrayHeader
+	{
+		MatFileReader::Variable info;
+		size_t dataPosition = 0; // of the first sub-element behind the name
+	};
+	static bool parseArrayHeader(const uint8_t* data, size_t size, ArrayHeader& header)
+	{
+		size_t pos = 0;
+		uint32_t type;
+		size_t bytes;
+		const uint8_t* content;
+		if (!readSubElement(data, size, pos, type, bytes, content) || type != MatFileFormat::miUINT32 || bytes < 8)
+			return false;
+		uint32_t flags = load32(content);
+		header.info.arrayClass = static_cast<MatFileFormat::ArrayClass>(flags & 0xFF);
+		header.info.complex = (flags & s_flagComplex) != 0;
+		header.info.logical = (flags & s_flagLogical) != 0;
+		if (!readSubElement(data, size, pos, type, bytes, content) || type != MatFileFormat::miINT32)
+			return false;
+		header.info.dimensions.clear();
+		for (size_t i = 0; i + 4 <= bytes; i += 4)
+			header.info.dimensions.push_back(static_cast<size_t>(static_cast<int32_t>(load32(content + i))));
+		if (!readSubElement(data, size, pos, type, bytes, content) || (type != MatFileFormat::miINT8 && type != MatFileFormat::miUINT8))
+			return false;
+		header.info.name.assign(reinterpret_cast<const char*>(content), bytes);
+		header.dataPosition = pos;
+		return true;
+	}
+
+	template<typename S, typename T>
+	static void convertElements(const uint8_t* source, size_t count, T* target)
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			S value;
+			std::memcpy(&value, source + i * sizeof(S), sizeof(S));
+			target[i] = static_cast<T>(value);
+		}
+	}
+	template<typename T>
+	static bool convertData(uint32_t type, const uint8_t* source, size_t count, T* target)
+	{
+		switch (type)
+		{
+		case MatFileFormat::miINT8:   convertElements<int8_t>(source, count, target); return true;
+		case MatFileFormat::miUINT8:  convertElements<uint8_t>(source, count, target); return true;
+		case MatFileFormat::miINT16:  convertElements<int16_t>(source, count, target); return true;
+		case MatFileFormat::miUINT16: convertElements<uint16_t>(source, count, target); return true;
+		case MatFileFormat::miINT32:  convertElements<int32_t>(source, count, target); return true;
+		case MatFileFormat::miUINT32: convertElements<uint32_t>(source, count, target); return true;
+		case MatFileFormat::miSINGLE: convertElements<float>(source, count, target); return true;
+		case MatFileFormat::miDOUBLE: convertElements<double>(source, count, target); return true;
+		case MatFileFormat::miINT64:  convertElements<int64_t>(source, count, target); return true;
+		case MatFileFormat::miUINT64: convertElements<uint64_t>(source, count, target); return true;
+		default:                      return false;
+		}
+	}
+	static bool convertData(MatFileFormat::ArrayClass targetClass, uint32_t type, const uint8_t* source, size_t count, void* target)
+	{
+		switch (targetClass)
+		{
+		case MatFileFormat::mxDOUBLE: return convertData(type, source, count, static_cast<double*>(target));
+		case MatFileFormat::mxSINGLE: return convertData(type, source, count, static_cast<float*>(target));
+		case MatFileFormat::mxINT8:   return convertData(type, source, count, static_cast<int8_t*>(target));
+		case MatFileFormat::mxUINT8:  return convertData(type, source, count, static_cast<uint8_t*>(target));
+		case MatFileFormat::mxINT16:  return convertData(type, source, count, static_cast<int16_t*>(target));
+		case MatFileFormat::mxUINT16: return convertData(type, source, count, static_cast<uint16_t*>(target));
+		case MatFileFormat::mxINT32:  return convertData(type, source, count, static_cast<int32_t*>(target));
+		case MatFileFormat::mxUINT32: return convertData(type, source, count, static_cast<uint32_t*>(target));
+		case MatFileFormat::mxINT64:  return convertData(type, source, count, static_cast<int64_t*>(target));
+		case MatFileFormat::mxUINT64: return convertData(type, source, count, static_cast<uint64_t*>(target));
+		default:                      return false;
+		}
+	}
+	static bool isNumericClass(MatFileFormat::ArrayClass arrayClass)
+	{
+		return arrayClass >= MatFileFormat::mxDOUBLE && arrayClass <= MatFileFormat::mxUINT64;
+	}
+
+	/**
+	 * @brief Converts the content of a miMATRIX element into a MatlabArray
+	 */
+	static MatlabArray decodeArray(const uint8_t* data, size_t size, const std::string& name)
+	{
+		ArrayHeader header;
+		if (!parseArrayHeader(data, size, header))
+			return MatlabArray(name);
+		const MatFileReader::Variable& info = header.info;
+		size_t rows = info.getRows();
+		size_t cols = info.getCols();
+		size_t pos = header.dataPosition;
+		uint32_t type;
+		size_t bytes;
+		const uint8_t* content;
+
+		if (info.arrayClass == MatFileFormat::mxCELL)
+		{
+			MatlabArray cell = MatlabArray::createCell(name, rows, cols);
+			for (size_t i = 0; i < rows * cols; ++i)
+			{
+				if (!readSubElement(data, size, pos, type, bytes, content) || type != MatFileFormat::miMATRIX)
+					return MatlabArray(name);
+				MatlabArray element = decodeArray(content, bytes, "");
+				if (!element.isValid())
+					return MatlabArray(name);
+				cell.setCell(i, element);
+			}
+			return cell;
+		}
+		if (!readSubElement(data, size, pos, type, bytes, content))
+			return MatlabArray(name);
+		if (info.arrayClass == MatFileFormat::mxCHAR)
+		{
+			if (type == MatFileFormat::miUTF8 || type == MatFileFormat::miUINT8 || type == MatFileFormat::miINT8)
+				return MatlabArray(name, std::string(reinterpret_cast<const char*>(content), bytes));
+			if (type != MatFileFormat::miUINT16 && type != MatFileFormat::miUTF16)
+				return MatlabArray(name);
+			std::u16string text(bytes / 2, u'\0');
+			std::memcpy(&text[0], content, text.size() * 2);
+			return MatlabArray(name, Utf::toUtf8(text));
+		}
+		if (!isNumericClass(info.arrayClass) || info.complex)
+		{
+			Logger::logError("MatFileReader: '" + info.name + "' of class " + info.getClassName() + (info.complex ? " (complex)" : "") + " can't be converted to a MatlabArray");
+			return MatlabArray(name);
+		}
+		size_t count = info.getNumberOfElements();
+		size_t typeSize = getDataTypeSize(type);
+		if (typeSize == 0 || bytes < count * typeSize)
+			return MatlabArray(name);
+		if (info.logical)
+		{
+			ArrayBuffer<bool> values = MatlabArray::createBuffer<bool>(count);
+			convertData(type, content, count, values.data());
+			return MatlabArray(name, std::move(values), { rows, cols });
+		}
+		ArrayBuffer<double> values = MatlabArray::createBuffer<double>(count);
+		convertData(type, content, count, values.data());
+		return MatlabArray(name, std::move(values), { rows, cols });
+	}
+
+	size_t MatFileReader::Variable::getCols() const
+	{
+		size_t cols = dimensions.size() > 1 ? 1 : 0;
+		for (size_t i = 1; i < dimensions.size(); ++i)
+			cols *= dimensions[i];
+		return cols;
+	}
+	size_t MatFileReader::Variable::getNumberOfElements() const
+	{
+		return getRows() * getCols();
+	}
+
+	MatFileReader::MatFileReader(const std::string& path)
+		: m_path(path)
+	{
+		if (!isLittleEndian())
+		{
+			Logger::logError("MatFileReader: big endian platforms are not supported");
+			return;
+		}
+		Mapping* mapping = new Mapping();
+		if (!mapping->open(path))
+		{
+			Logger::logError("MatFileReader: can't open '" + path + "'");
+			delete mapping;
+			return;
+		}
+		m_mapping = mapping;
+		if (!parse())
+		{
+			delete m_mapping;
+			m_mapping = nullptr;
+			m_variables.clear();
+			m_entries.clear();
+		}
+	}
+	MatFileReader::~MatFileReader()
+	{
+		delete m_mapping;
+	}
+
+	bool MatFileReader::parse()
+	{
+		const uint8_t* data = m_mapping->address;
+		size_t size = m_mapping->size;
+		if (size < s_headerSize || data[126] != 'I' || data[127] != 'M')
+		{
+			Logger::logError("MatFileReader: '" + m_path + "' is not a little endian MAT-file v5");
+			return false;
+		}
+		size_t pos = s_headerSize;
+		while (pos + s_tagSize <= size)
+		{
+			uint32_t type = load32(data + pos);
+			size_t bytes = load32(data + pos + 4);
+			size_t offset = pos + s_tagSize;
+			if (offset + bytes > size)
+			{
+				Logger::logWarning("MatFileReader: '" + m_path + "' is truncated");
+				break;
+			}
+			ArrayHeader header;
+			bool listed = false;
+			if (type == MatFileFormat::miMATRIX)
+			{
+				listed = parseArrayHeader(data + offset, bytes, header);
+				pos = offset + padded(bytes);
+			}
+			else if (type == MatFileFormat::miCOMPRESSED)
+			{
+#ifdef ZLIB_AVAILABLE
+				std::vector<uint8_t> peek;
+				if (inflateData(data + offset, bytes, peek, s_compressedHeaderPeek) && peek.size() > s_tagSize
+					&& load32(peek.data()) == MatFileFormat::miMATRIX)
+				{
+					listed = parseArrayHeader(peek.data() + s_tagSize, peek.size() - s_tagSize, header);
+					header.info.compressed = true;
+				}
+#else
+				Logger::logWarning("MatFileReader: '" + m_path + "' contains compressed variables, zlib is not available");
+#endif
+				pos = offset + bytes;
+			}
+			else
+			{
+				pos = offset + padded(bytes);
+			}
+			if (listed)
+			{
+				m_variables.push_back(header.info);
+				Entry entry;
+				entry.offset = offset;
+				entry.size = bytes;
+				m_entries.push_back(entry);
+			}
+		}
+		return true;
+	}
+
+	const MatFileReader::Variable* MatFileReader::find(const std::string& name) const
+	{
+		for (const Variable& variable : m_variables)
+			if (variable.name == name)
+				return &variable;
+		return nullptr;
+	}
+
+	const uint8_t* MatFileReader::getElement(size_t index, size_t& size, std::vector<uint8_t>& buffer) const
+	{
+		const Entry& entry = m_entries[index];
+		if (!m_variables[index].compressed)
+		{
+			size = entry.size;
+			return m_mapping->address + entry.offset;
+		}
+#ifdef ZLIB_AVAILABLE
+		if (!inflateData(m_mapping->address + entry.offset, entry.size, buffer, SIZE_MAX) || buffer.size() < s_tagSize)
+		{
+			Logger::logError("MatFileReader: can't decompress '" + m_variables[index].name + "'");
+			return nullptr;
+		}
+		size = std::min<size_t>(load32(buffer.data() + 4), buffer.size() - s_tagSize);
+		return buffer.data() + s_tagSize;
+#else
+		(void)buffer;
+		Logger::logError("MatFileReader: '" + m_variables[index].name + "' is compressed, zlib is not available");
+		return nullptr;
+#endif
+	}
+
+	bool MatFileReader::readNumeric(const std::string& name, MatFileFormat::ArrayClass targetClass, size_t elementSize, size_t& rows, size_t& cols,
+		const std::function<void* (size_t count)>& allocate) const
+	{
+		MATLAB_API_GENERAL_PROFILING_FUNCTION(MATLAB_API_COLOR_STAGE_2);
+		(void)elementSize;
+		const Variable* variable = find(name);
+		if (!variable)
+		{
+			Logger::logError("MatFileReader: '" + m_path + "' has no variable '" + name + "'");
+			return false;
+		}
+		if (!isNumericClass(variable->arrayClass) || variable->complex)
+		{
+			Logger::logError("MatFileReader: '" + name + "' is not a real numeric array");
+			return false;
+		}
+		std::vector<uint8_t> buffer;
+		size_t size = 0;
+		const uint8_t* element = getElement(variable - m_variables.data(), size, buffer);
+		ArrayHeader header;
+		if (!element || !parseArrayHeader(element, size, header))
+			return false;
+		size_t pos = header.dataPosition;
+		uint32_t type;
+		size_t bytes;
+		const uint8_t* content;
+		size_t count = variable->getNumberOfElements();
+		if (!readSubElement(element, size, pos, type, bytes, content) || getDataTypeSize(type) == 0 || bytes < count * getDataTypeSize(type))
+		{
+			Logger::logError("MatFileReader: '" + name + "' is corrupt");
+			return false;
+		}
+		void* target = allocate(count);
+		if (count > 0 && !target)
+			return false;
+		rows = variable->getRows();
+		cols = variable->getCols();
+		return convertData(targetClass, type, content, count, target);
+	}
+
+	Matrix MatFileReader::readMatrix(const std::string& name) const
+	{
+		std::vector<double> columnMajor;
+		size_t rows = 0;
+		size_t cols = 0;
+		if (!read(name, columnMajor, rows, cols))
+			return Matrix();
+		Matrix matrix(rows, cols);
+		for (size_t row = 0; row < rows; ++row)
+			for (size_t col = 0; col < cols; ++col)
+				matrix(row, col) = columnMajor[col * rows + row];
+		return matrix;
+	}
+
+	std::string MatFileReader::readString(const std::string& name) const
+	{
+		const Variable* variable = find(name);
+		if (!variable || variable->arrayClass != MatFileFormat::mxCHAR)
+			return "";
+		return read(name).getString();
+	}
+
+	MatlabArray MatFileReader::read(const std::string& name) const
+	{
+		const Variable* variable = find(name);
+		if (!variable)
+		{
+			Logger::logError("MatFileReader: '" + m_path + "' has no variable '" + name + "'");
+			return MatlabArray(name);
+		}
+		std::vector<uint8_t> buffer;
+		size_t size = 0;
+		const uint8_t* element = getElement(variable - m_variables.data(), size, buffer);
+		if (!element)
+			return MatlabArray(name);
+		return decodeArray(element, size, name);
+	}
+
+	const void* MatFileReader::mapNumeric(const std::string& name, MatFileFormat::ArrayClass arrayClass, MatFileFormat::DataType type, size_t& rows, size_t& cols) const
+	{
+		const Variable* variable = find(name);
+		if (!variable || variable->compressed || variable->complex || variable->arrayClass != arrayClass)
+			return nullptr;
+		const Entry& entry = m_entries[variable - m_variables.data()];
+		const uint8_t* element = m_mapping->address + entry.offset;
+		ArrayHeader header;
+		if (!parseArrayHeader(element, entry.size, header))
+			return nullptr;
+		size_t pos = header.dataPosition;
+		uint32_t storedType;
+		size_t bytes;
+		const uint8_t* content;
+		size_t count = variable->getNumberOfElements();
+		// Small data elements are not aligned, MATLAB also stores doubles with integer values in smaller types
+		if (!readSubElement(element, entry.size, pos, storedType, bytes, content) || storedType != type
+			|| load32(element + header.dataPosition) >> 16 || bytes < count * getDataTypeSize(type))
+			return nullptr;
+		rows = variable->getRows();
+		cols = variable->getCols();
+		return content;
+	}
+}
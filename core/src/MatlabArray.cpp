@@ -1,5 +1,8 @@
 #include "MatlabArray.h"
 #include "MatlabEngine.h"
+#include "Utf.h"
+#include "NumericConversion.h"
+#include "math/LinearAlgebra.h"
 #ifdef MATLAB_API_USE_CPP_API
 #include "MatlabDataArray.hpp"
 #else
@@ -11,54 +14,297 @@
 #include <stdexcept>
 #include <algorithm>
 #include <iostream>
+#include <cstring>
+#include <cstdint>
+#include <complex>
 
 namespace MatlabAPI
 {
+    // FNV offset basis as seed, every 64 bit word is mixed into the hash with the splitmix64 finalizer.
+    // Plain FNV on whole words only carries changes upwards, so sign flips of two doubles cancel out.
+    static const uint64_t s_hashOffset = 14695981039346656037ULL;
+
+    static inline uint64_t mixWord(uint64_t value)
+    {
+        value ^= value >> 30;
+        value *= 0xbf58476d1ce4e5b9ULL;
+        value ^= value >> 27;
+        value *= 0x94d049bb133111ebULL;
+        return value ^ (value >> 31);
+    }
+    static void hashValue(uint64_t& hash, uint64_t value)
+    {
+        hash = mixWord(hash ^ mixWord(value));
+    }
+    static void hashBytes(uint64_t& hash, const void* data, size_t size)
+    {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        size_t i = 0;
+        for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t))
+        {
+            uint64_t word;
+            std::memcpy(&word, bytes + i, sizeof(uint64_t));
+            hashValue(hash, word);
+        }
+        if (i < size)
+        {
+            uint64_t word = 0;
+            std::memcpy(&word, bytes + i, size - i);
+            hashValue(hash, word);
+        }
+        hashValue(hash, size);
+    }
+
+    static size_t getElementCount(const std::vector<size_t>& dimensions)
+    {
+        size_t count = 1;
+        for (size_t dimension : dimensions)
+            count *= dimension;
+        return count;
+    }
+    static void checkBufferDimensions(size_t count, const std::vector<size_t>& dimensions)
+    {
+        if (dimensions.size() < 2 || getElementCount(dimensions) != count)
+            throw std::invalid_argument("Buffer of " + std::to_string(count) + " elements doesn't match the array dimensions");
+    }
+
+    template<typename T>
+    static bool copyElementsAsDouble(const MatlabArray& array, double* target, double scale, double offset)
+    {
+        ArrayView<const T> data = array.view<T>();
+        NumericConversion::toDouble(data.data(), data.size(), target, scale, offset);
+        return true;
+    }
+
+    void MatlabArray::copyAsDouble(double* target, double scale, double offset) const
+    {
+        if (isDouble())       copyElementsAsDouble<double>(*this, target, scale, offset);
+        else if (isSingle())  copyElementsAsDouble<float>(*this, target, scale, offset);
+        else if (isInt8())    copyElementsAsDouble<int8_t>(*this, target, scale, offset);
+        else if (isUint8())   copyElementsAsDouble<uint8_t>(*this, target, scale, offset);
+        else if (isInt16())   copyElementsAsDouble<int16_t>(*this, target, scale, offset);
+        else if (isUint16())  copyElementsAsDouble<uint16_t>(*this, target, scale, offset);
+        else if (isInt32())   copyElementsAsDouble<int32_t>(*this, target, scale, offset);
+        else if (isUint32())  copyElementsAsDouble<uint32_t>(*this, target, scale, offset);
+        else if (isInt64())   copyElementsAsDouble<int64_t>(*this, target, scale, offset);
+        else if (isUint64())  copyElementsAsDouble<uint64_t>(*this, target, scale, offset);
+        else if (isLogical()) copyElementsAsDouble<bool>(*this, target, scale, offset);
+        else
+            throw std::runtime_error("Array '" + m_name + "' of class " + getClassName() + " can't be converted to double");
+    }
+
+    void MatlabArray::copyAsSingle(float* target) const
+    {
+        if (isSingle())
+        {
+            ArrayView<const float> data = view<float>();
+            std::copy(data.data(), data.data() + data.size(), target);
+        }
+        else if (isDouble())
+        {
+            ArrayView<const double> data = view<double>();
+            NumericConversion::toSingle(data.data(), data.size(), target);
+        }
+        else
+            throw std::runtime_error("Array '" + m_name + "' of class " + getClassName() + " can't be converted to single");
+    }
+
+    template<typename T>
+    static MatlabArray copyRowRange(const MatlabArray& array, size_t first, size_t count)
+    {
+        ArrayView<const T> data = array.view<T>();
+        size_t rows = data.getRows();
+        size_t cols = data.getCols();
+        ArrayBuffer<T> buffer = MatlabArray::createBuffer<T>(count * cols);
+        for (size_t c = 0; c < cols; ++c)
+            std::copy(data.data() + c * rows + first, data.data() + c * rows + first + count, buffer.data() + c * count);
+        return MatlabArray(array.getName(), std::move(buffer), { count, cols });
+    }
+
+    MatlabArray MatlabArray::getRowRange(size_t first, size_t count) const
+    {
+        if (first + count > getM())
+            throw std::out_of_range("Rows " + std::to_string(first) + " to " + std::to_string(first + count) + " exceed the "
+                                    + std::to_string(getM()) + " rows of array '" + m_name + "'");
+        if (isDouble())       return copyRowRange<double>(*this, first, count);
+        if (isSingle())       return copyRowRange<float>(*this, first, count);
+        if (isInt8())         return copyRowRange<int8_t>(*this, first, count);
+        if (isUint8())        return copyRowRange<uint8_t>(*this, first, count);
+        if (isInt16())        return copyRowRange<int16_t>(*this, first, count);
+        if (isUint16())       return copyRowRange<uint16_t>(*this, first, count);
+        if (isInt32())        return copyRowRange<int32_t>(*this, first, count);
+        if (isUint32())       return copyRowRange<uint32_t>(*this, first, count);
+        if (isInt64())        return copyRowRange<int64_t>(*this, first, count);
+        if (isUint64())       return copyRowRange<uint64_t>(*this, first, count);
+        if (isLogical())      return copyRowRange<bool>(*this, first, count);
+        throw std::runtime_error("Array '" + m_name + "' of class " + getClassName() + " has no row ranges");
+    }
+
+    /**
+     * @brief Get matrix data as one contiguous row-major buffer
+     */
+    std::vector<double> MatlabArray::getDoubleMatrixRowMajor() const
+    {
+        if (!isDouble()) {
+            throw std::runtime_error("Array is not double type");
+        }
+        ArrayView<const double> data = view<double>();
+        size_t rows = data.getRows();
+        size_t cols = data.getCols();
+        std::vector<double> result(rows * cols);
+        LinearAlgebra::transpose(data.data(), cols, rows, result.data()); // column-major rows x cols = row-major cols x rows
+        return result;
+    }
+
 #ifdef MATLAB_API_USE_CPP_API
-    static matlab::data::ArrayFactory* s_factory = nullptr; // Factory for creating MATLAB data arrays
+    // Factory for creating MATLAB data arrays, created on first use.
+    // Arrays are constructed on the engine thread and on the calling threads, the initialization is thread-safe.
+    static matlab::data::ArrayFactory* getFactory()
+    {
+        static matlab::data::ArrayFactory* factory = new matlab::data::ArrayFactory();
+        return factory;
+    }
+
+    template<typename T>
+    static void hashElements(uint64_t& hash, const matlab::data::Array& arr)
+    {
+        for (const T& value : matlab::data::getReadOnlyElements<T>(arr))
+            hashBytes(hash, &value, sizeof(T));
+    }
+
+    static bool hashArray(uint64_t& hash, const matlab::data::Array& arr)
+    {
+        matlab::data::ArrayType type = arr.getType();
+        hashValue(hash, static_cast<uint64_t>(type));
+        for (size_t dim : arr.getDimensions())
+            hashValue(hash, dim);
+
+        switch (type)
+        {
+        case matlab::data::ArrayType::LOGICAL: hashElements<bool>(hash, arr); return true;
+        case matlab::data::ArrayType::CHAR: hashElements<char16_t>(hash, arr); return true;
+        case matlab::data::ArrayType::DOUBLE: hashElements<double>(hash, arr); return true;
+        case matlab::data::ArrayType::SINGLE: hashElements<float>(hash, arr); return true;
+        case matlab::data::ArrayType::INT8: hashElements<int8_t>(hash, arr); return true;
+        case matlab::data::ArrayType::UINT8: hashElements<uint8_t>(hash, arr); return true;
+        case matlab::data::ArrayType::INT16: hashElements<int16_t>(hash, arr); return true;
+        case matlab::data::ArrayType::UINT16: hashElements<uint16_t>(hash, arr); return true;
+        case matlab::data::ArrayType::INT32: hashElements<int32_t>(hash, arr); return true;
+        case matlab::data::ArrayType::UINT32: hashElements<uint32_t>(hash, arr); return true;
+        case matlab::data::ArrayType::INT64: hashElements<int64_t>(hash, arr); return true;
+        case matlab::data::ArrayType::UINT64: hashElements<uint64_t>(hash, arr); return true;
+        case matlab::data::ArrayType::COMPLEX_DOUBLE: hashElements<std::complex<double>>(hash, arr); return true;
+        case matlab::data::ArrayType::COMPLEX_SINGLE: hashElements<std::complex<float>>(hash, arr); return true;
+        case matlab::data::ArrayType::CELL:
+            for (size_t i = 0; i < arr.getNumberOfElements(); ++i)
+            {
+                if (!hashArray(hash, arr[i]))
+                    return false;
+            }
+            return true;
+        case matlab::data::ArrayType::STRUCT:
+        {
+            matlab::data::StructArray structArray(arr);
+            std::vector<std::string> fields;
+            for (const auto& field : structArray.getFieldNames())
+            {
+                fields.push_back(field);
+                hashBytes(hash, fields.back().data(), fields.back().size());
+            }
+            for (size_t i = 0; i < structArray.getNumberOfElements(); ++i)
+            {
+                for (const std::string& field : fields)
+                {
+                    if (!hashArray(hash, structArray[i][field]))
+                        return false;
+                }
+            }
+            return true;
+        }
+        default:
+            return false; // objects, sparse arrays, strings and function handles are not hashed
+        }
+    }
+
+    static size_t dataSize(const matlab::data::Array& arr)
+    {
+        size_t elementSize = 0;
+        switch (arr.getType())
+        {
+        case matlab::data::ArrayType::LOGICAL:
+        case matlab::data::ArrayType::INT8:
+        case matlab::data::ArrayType::UINT8: elementSize = 1; break;
+        case matlab::data::ArrayType::CHAR:
+        case matlab::data::ArrayType::INT16:
+        case matlab::data::ArrayType::UINT16: elementSize = 2; break;
+        case matlab::data::ArrayType::SINGLE:
+        case matlab::data::ArrayType::INT32:
+        case matlab::data::ArrayType::UINT32: elementSize = 4; break;
+        case matlab::data::ArrayType::DOUBLE:
+        case matlab::data::ArrayType::INT64:
+        case matlab::data::ArrayType::UINT64:
+        case matlab::data::ArrayType::COMPLEX_SINGLE: elementSize = 8; break;
+        case matlab::data::ArrayType::COMPLEX_DOUBLE: elementSize = 16; break;
+        case matlab::data::ArrayType::CELL:
+        {
+            size_t size = 0;
+            for (size_t i = 0; i < arr.getNumberOfElements(); ++i)
+                size += dataSize(arr[i]);
+            return size;
+        }
+        case matlab::data::ArrayType::STRUCT:
+        {
+            matlab::data::StructArray structArray(arr);
+            std::vector<std::string> fields;
+            for (const auto& field : structArray.getFieldNames())
+                fields.push_back(field);
+            size_t size = 0;
+            for (size_t i = 0; i < structArray.getNumberOfElements(); ++i)
+            {
+                for (const std::string& field : fields)
+                    size += dataSize(structArray[i][field]);
+            }
+            return size;
+        }
+        default:
+            return 0;
+        }
+        return elementSize * arr.getNumberOfElements();
+    }
 
 
     MatlabArray::MatlabArray(const std::string& name)
-        : array_(nullptr)
-        , m_name(name)
+        : m_name(name)
     {
-        if (!s_factory)
-            s_factory = new matlab::data::ArrayFactory();
     }
 
     /**
      * @brief Constructor from existing mxArray (takes ownership)
      */
     MatlabArray::MatlabArray(const std::string& name, const matlab::data::Array& arr)
-        : array_(new matlab::data::Array(arr))
-        , m_name(name)
+        : m_name(name)
     {
-        if (!s_factory)
-            s_factory = new matlab::data::ArrayFactory();
+        attach(arr);
     }
 
     /**
      * @brief Create double scalar
      */
     MatlabArray::MatlabArray(const std::string& name, double value)
-        : array_(nullptr)
-        , m_name(name)
+        : m_name(name)
     {
-        if (!s_factory)
-            s_factory = new matlab::data::ArrayFactory();
-        array_ = new matlab::data::Array(s_factory->createScalar(value));
+        attach(getFactory()->createScalar(value));
     }
 
     /**
      * @brief Create double vector from std::vector
      */
     MatlabArray::MatlabArray(const std::string& name, const std::vector<double>& data)
-        : array_(nullptr)
-        , m_name(name)
+        : m_name(name)
     {
-        if (!s_factory)
-            s_factory = new matlab::data::ArrayFactory();
-        array_ = new matlab::data::Array(s_factory->createArray({ data.size(), 1 }, data.begin(), data.end()));
+        matlab::data::buffer_ptr_t<double> buffer = getFactory()->createBuffer<double>(data.size());
+        std::copy(data.begin(), data.end(), buffer.get());
+        attach(getFactory()->createArrayFromBuffer({ data.size(), 1 }, std::move(buffer)));
     }
 
     /**
@@ -67,12 +313,12 @@ namespace MatlabAPI
     MatlabArray::MatlabArray(const std::string& name, size_t rows, size_t cols, const std::vector<double>& data)
         : m_name(name)
     {
-        if (!s_factory)
-            s_factory = new matlab::data::ArrayFactory();
         if (data.size() != rows * cols) {
             throw std::invalid_argument("Data size doesn't match matrix dimensions");
         }
-        array_ = new matlab::data::Array(s_factory->createArray({ rows, cols }, data.begin(), data.end()));
+        matlab::data::buffer_ptr_t<double> buffer = getFactory()->createBuffer<double>(data.size());
+        std::copy(data.begin(), data.end(), buffer.get());
+        attach(getFactory()->createArrayFromBuffer({ rows, cols }, std::move(buffer)));
     }
 
     /**
@@ -81,9 +327,7 @@ namespace MatlabAPI
     MatlabArray::MatlabArray(const std::string& name, const std::string& str)
         : m_name(name)
     {
-        if (!s_factory)
-            s_factory = new matlab::data::ArrayFactory();
-        array_ = new matlab::data::Array(s_factory->createCharArray(str));
+        attach(getFactory()->createCharArray(Utf::toUtf16(str)));
     }
 
     /**
@@ -92,42 +336,32 @@ namespace MatlabAPI
     MatlabArray::MatlabArray(const std::string& name, const std::vector<bool>& data)
         : m_name(name)
     {
-        if (!s_factory)
-            s_factory = new matlab::data::ArrayFactory();
-        array_ = new matlab::data::Array(s_factory->createArray({ data.size(), 1 }, data.begin(), data.end()));
+        attach(getFactory()->createArray({ data.size(), 1 }, data.begin(), data.end()));
     }
 
-    // Copy constructor
+    // Copy constructor, shares the data
     MatlabArray::MatlabArray(const MatlabArray& other)
         : m_name(other.m_name)
     {
-        if (other.array_) {
-            array_ = new matlab::data::Array(*(other.array_));
-        }
-        else {
-            array_ = nullptr;
-        }
+        share(other);
     }
 
     // Move constructor
     MatlabArray::MatlabArray(MatlabArray&& other) noexcept
         : array_(other.array_)
+        , m_references(other.m_references)
         , m_name(std::move(other.m_name))
     {
         other.array_ = nullptr;
+        other.m_references = nullptr;
     }
 
-    // Copy assignment
+    // Copy assignment, shares the data
     MatlabArray& MatlabArray:: operator=(const MatlabArray& other)
     {
         if (this != &other) {
-            delete array_;
-            if (other.array_) {
-                array_ = new matlab::data::Array(*(other.array_));
-            }
-            else {
-                array_ = nullptr;
-            }
+            dropReference();
+            share(other);
             m_name = other.m_name;
         }
         return *this;
@@ -137,9 +371,11 @@ namespace MatlabAPI
     MatlabArray& MatlabArray::operator=(MatlabArray&& other) noexcept
     {
         if (this != &other) {
-            delete array_;
+            dropReference();
             array_ = other.array_;
+            m_references = other.m_references;
             other.array_ = nullptr;
+            other.m_references = nullptr;
             m_name = std::move(other.m_name);
         }
         return *this;
@@ -148,54 +384,160 @@ namespace MatlabAPI
     // Destructor
     MatlabArray::~MatlabArray()
     {
-        delete array_;
+        dropReference();
+    }
+
+    // ===== Shared Ownership =====
+
+    void MatlabArray::attach(matlab::data::Array arr)
+    {
+        array_ = new matlab::data::Array(std::move(arr));
+        m_references = new std::atomic<size_t>(1);
+    }
+
+    void MatlabArray::share(const MatlabArray& other)
+    {
+        array_ = other.array_;
+        m_references = other.m_references;
+        if (m_references)
+            m_references->fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void MatlabArray::dropReference()
+    {
+        if (m_references && m_references->fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            delete array_;
+            delete m_references;
+        }
+        array_ = nullptr;
+        m_references = nullptr;
+    }
+
+    void MatlabArray::detach()
+    {
+        if (!m_references || m_references->load(std::memory_order_acquire) == 1)
+            return;
+        // Copies of a matlab::data::Array share the elements until getWritableElements() or an element assignment
+        matlab::data::Array copy = *array_;
+        dropReference();
+        attach(std::move(copy));
+    }
+
+    bool MatlabArray::isShared() const
+    {
+        return m_references && m_references->load(std::memory_order_acquire) > 1;
     }
 
     // ===== Static Factory Methods =====
 
     MatlabArray MatlabArray::createDouble(const std::string& name, size_t rows, size_t cols)
     {
-        if (!s_factory)
-            s_factory = new matlab::data::ArrayFactory();
-        auto array = s_factory->createArray<double>({ rows, cols });
+        auto array = getFactory()->createArray<double>({ rows, cols });
         return MatlabArray(name, array);
     }
 
     MatlabArray MatlabArray::createComplex(const std::string& name, size_t rows, size_t cols)
     {
-        if (!s_factory)
-            s_factory = new matlab::data::ArrayFactory();
-        auto array = s_factory->createArray<std::complex<double>>({ rows, cols });
+        auto array = getFactory()->createArray<std::complex<double>>({ rows, cols });
         return MatlabArray(name, array);
     }
 
     MatlabArray MatlabArray::createLogical(const std::string& name, size_t rows, size_t cols)
     {
-        if (!s_factory)
-            s_factory = new matlab::data::ArrayFactory();
-        auto array = s_factory->createArray<bool>({ rows, cols });
+        auto array = getFactory()->createArray<bool>({ rows, cols });
         return MatlabArray(name, array);
     }
 
     MatlabArray MatlabArray::createCell(const std::string& name, size_t rows, size_t cols)
     {
-        if (!s_factory)
-            s_factory = new matlab::data::ArrayFactory();
-        auto array = s_factory->createCellArray({ rows, cols });
+        auto array = getFactory()->createCellArray({ rows, cols });
         return MatlabArray(name, array);
     }
 
+    MatlabArray MatlabArray::createStruct(const std::string& name, size_t rows, size_t cols, const std::vector<std::string>& fieldNames)
+    {
+        auto array = getFactory()->createStructArray({ rows, cols }, fieldNames);
+        return MatlabArray(name, array);
+    }
+
+    template<typename T>
+    static void* allocateTypedBuffer(size_t count, void*& data)
+    {
+        matlab::data::buffer_ptr_t<T>* buffer = new matlab::data::buffer_ptr_t<T>(getFactory()->createBuffer<T>(count));
+        data = buffer->get();
+        return buffer;
+    }
+    template<typename T>
+    static matlab::data::Array adoptTypedBuffer(void* handle, const std::vector<size_t>& dimensions)
+    {
+        std::unique_ptr<matlab::data::buffer_ptr_t<T>> buffer(static_cast<matlab::data::buffer_ptr_t<T>*>(handle));
+        return getFactory()->createArrayFromBuffer(matlab::data::ArrayDimensions(dimensions.begin(), dimensions.end()), std::move(*buffer));
+    }
+
+// Expands F(T) for every element type of ArrayElementType
+#define MATLAB_API_SWITCH_ELEMENT_TYPE(type, F) \
+        switch (type) \
+        { \
+        case ArrayElementType::Double:  F(double); \
+        case ArrayElementType::Single:  F(float); \
+        case ArrayElementType::Int8:    F(int8_t); \
+        case ArrayElementType::Uint8:   F(uint8_t); \
+        case ArrayElementType::Int16:   F(int16_t); \
+        case ArrayElementType::Uint16:  F(uint16_t); \
+        case ArrayElementType::Int32:   F(int32_t); \
+        case ArrayElementType::Uint32:  F(uint32_t); \
+        case ArrayElementType::Int64:   F(int64_t); \
+        case ArrayElementType::Uint64:  F(uint64_t); \
+        case ArrayElementType::Logical: F(bool); \
+        }
+
+    void* MatlabArray::allocateBuffer(ArrayElementType type, size_t count, void*& data)
+    {
+#define MATLAB_API_ALLOCATE(T) return allocateTypedBuffer<T>(count, data)
+        MATLAB_API_SWITCH_ELEMENT_TYPE(type, MATLAB_API_ALLOCATE)
+#undef MATLAB_API_ALLOCATE
+        return nullptr;
+    }
+    void MatlabArray::freeBuffer(ArrayElementType type, void* handle)
+    {
+#define MATLAB_API_FREE(T) delete static_cast<matlab::data::buffer_ptr_t<T>*>(handle); return
+        MATLAB_API_SWITCH_ELEMENT_TYPE(type, MATLAB_API_FREE)
+#undef MATLAB_API_FREE
+    }
+    void MatlabArray::adoptBuffer(ArrayElementType type, void* handle, size_t count, const std::vector<size_t>& dimensions)
+    {
+        if (!handle)
+            throw std::invalid_argument("Buffer for array '" + m_name + "' is empty or was already adopted");
+        try
+        {
+            checkBufferDimensions(count, dimensions);
+        }
+        catch (...)
+        {
+            freeBuffer(type, handle);
+            throw;
+        }
+        matlab::data::Array array;
+#define MATLAB_API_ADOPT(T) array = adoptTypedBuffer<T>(handle, dimensions); break
+        MATLAB_API_SWITCH_ELEMENT_TYPE(type, MATLAB_API_ADOPT)
+#undef MATLAB_API_ADOPT
+        dropReference();
+        attach(std::move(array));
+    }
+
     // ===== Access to underlying mxArray =====
 
     matlab::data::Array* MatlabArray::release()
     {
+        detach();
         return array_;
     }
 
     void MatlabArray::overwrite(const matlab::data::Array& arr)
     {
-        delete array_;
-        array_ = new matlab::data::Array(arr);
+        // Copies made before keep the old data
+        dropReference();
+        attach(arr);
     }
 
     // ===== Type Checking =====
@@ -338,47 +680,37 @@ namespace MatlabAPI
 
     // ===== Data Access =====
 
-    //template<typename T>
-    //T* getData() {
-    //    return array_ ? static_cast<T*>(mxGetData(array_)) : nullptr;
-    //}
-    //
-    //template<typename T>
-    //const T* getData() const {
-    //    return array_ ? static_cast<const T*>(mxGetData(array_)) : nullptr;
-    //}
-
-    template<>
-    std::vector<double> MatlabArray::getRowData<double>(size_t row) const
+    template<typename T>
+    static void* getElementData(matlab::data::Array& arr, bool writable)
     {
-        std::vector<double> result;
-        if (!array_ || !isDouble())
-            return result;
-
-        size_t rows = getM();
-        size_t cols = getN();
-        if (row >= rows)
-            throw std::out_of_range("Row index out of range");
-        result.reserve(cols);
-        for (size_t col = 0; col < cols; col++)
-            result.push_back(array_[row][col]);
-        return result;
+        if (arr.isEmpty())
+            return nullptr;
+        // getWritableElements unshares the data if it is shared with other arrays
+        if (writable)
+            return &*matlab::data::getWritableElements<T>(arr).begin();
+        return const_cast<T*>(&*matlab::data::getReadOnlyElements<T>(arr).begin());
     }
 
-    template<>
-    std::vector<double> MatlabArray::getColData<double>(size_t col) const
+    void* MatlabArray::getViewData(ArrayElementType type, bool writable) const
     {
-        std::vector<double> result;
-        if (!array_ || !isDouble())
-            return result;
-        size_t rows = getM();
-        size_t cols = getN();
-        if (col >= cols)
-            throw std::out_of_range("Column index out of range");
-        result.reserve(rows);
-        for (size_t row = 0; row < rows; row++)
-            result.push_back(array_[row][col]);
-        return result;
+        if (!array_)
+            throw std::runtime_error("Array '" + m_name + "' is not valid");
+        matlab::data::ArrayType actual = array_->getType();
+        switch (type)
+        {
+        case ArrayElementType::Double: if (actual == matlab::data::ArrayType::DOUBLE) return getElementData<double>(*array_, writable); break;
+        case ArrayElementType::Single: if (actual == matlab::data::ArrayType::SINGLE) return getElementData<float>(*array_, writable); break;
+        case ArrayElementType::Int8:   if (actual == matlab::data::ArrayType::INT8) return getElementData<int8_t>(*array_, writable); break;
+        case ArrayElementType::Uint8:  if (actual == matlab::data::ArrayType::UINT8) return getElementData<uint8_t>(*array_, writable); break;
+        case ArrayElementType::Int16:  if (actual == matlab::data::ArrayType::INT16) return getElementData<int16_t>(*array_, writable); break;
+        case ArrayElementType::Uint16: if (actual == matlab::data::ArrayType::UINT16) return getElementData<uint16_t>(*array_, writable); break;
+        case ArrayElementType::Int32:  if (actual == matlab::data::ArrayType::INT32) return getElementData<int32_t>(*array_, writable); break;
+        case ArrayElementType::Uint32: if (actual == matlab::data::ArrayType::UINT32) return getElementData<uint32_t>(*array_, writable); break;
+        case ArrayElementType::Int64:  if (actual == matlab::data::ArrayType::INT64) return getElementData<int64_t>(*array_, writable); break;
+        case ArrayElementType::Uint64: if (actual == matlab::data::ArrayType::UINT64) return getElementData<uint64_t>(*array_, writable); break;
+        case ArrayElementType::Logical: if (actual == matlab::data::ArrayType::LOGICAL) return getElementData<bool>(*array_, writable); break;
+        }
+        throw std::runtime_error("Array '" + m_name + "' of class " + getClassName() + " can't be viewed as the requested element type");
     }
 
     // ===== Convenience Methods for Common Types =====
@@ -402,11 +734,7 @@ namespace MatlabAPI
         if (!isDouble()) {
             throw std::runtime_error("Array is not double type");
         }
-        size_t size = getNumberOfElements();
-        std::vector<double> data(size);
-        for (size_t i = 0; i < size; i++)
-            data[i] = (*array_)[i];
-        return data;
+        return view<double>().toVector();
     }
 
     /**
@@ -417,8 +745,8 @@ namespace MatlabAPI
         if (!isChar()) {
             throw std::runtime_error("Array is not char type");
         }
-        matlab::data::CharArray charArray = (*array_)[0]; // Assuming single string
-        return std::string(charArray.begin(), charArray.end());
+        matlab::data::CharArray charArray(*array_);
+        return Utf::toUtf8(charArray.toUTF16());
     }
 
     /**
@@ -446,14 +774,14 @@ namespace MatlabAPI
             throw std::runtime_error("Array is not double type");
         }
 
-        size_t rows = getM();
-        size_t cols = getN();
-
+        ArrayView<const double> data = view<double>();
+        size_t rows = data.getRows();
+        size_t cols = data.getCols();
 
         std::vector<std::vector<double>> result(rows, std::vector<double>(cols));
         for (size_t i = 0; i < rows; i++) {
             for (size_t j = 0; j < cols; j++) {
-                result[i][j] = (*array_)[i][j];  // Column-major to row-major
+                result[i][j] = data(i, j);  // Column-major to row-major
             }
         }
         return result;
@@ -482,6 +810,7 @@ namespace MatlabAPI
         if (index >= getNumberOfElements()) {
             throw std::out_of_range("Cell index out of range");
         }
+        detach();
         (*array_)[index] = *(value.array_);
     }
 
@@ -492,34 +821,105 @@ namespace MatlabAPI
         if (!isStruct()) {
             throw std::runtime_error("Array is not a struct");
         }
-
-        size_t nfields = array_->getNumberOfElements();
+        const matlab::data::StructArray structArray(*array_);
         std::vector<std::string> names;
-        for (size_t i = 0; i < nfields; i++) {
-            matlab::data::CharArray charArray = (*array_)[i]; // Assuming single string
-            names.push_back(std::string(charArray.begin(), charArray.end()));
+        for (const auto& field : structArray.getFieldNames()) {
+            names.push_back(field);
         }
         return names;
     }
 
-    /*MatlabArray MatlabArray::getField(const std::string& fieldname, size_t index) const
+    size_t MatlabArray::getNumberOfFields() const
     {
         if (!isStruct()) {
             throw std::runtime_error("Array is not a struct");
         }
-        std::string name = m_name + "_" + fieldname + "_" + std::to_string(index);
-        (*array_)[index]
+        return matlab::data::StructArray(*array_).getNumberOfFields();
+    }
 
-        return MatlabArray(name, , false);
+    // Throws if the array has no field fieldname or element index
+    static void checkField(const MatlabArray& array, const std::string& fieldname, size_t index)
+    {
+        std::vector<std::string> names = array.getFieldNames();
+        if (std::find(names.begin(), names.end(), fieldname) == names.end()) {
+            throw std::runtime_error("Struct '" + array.getName() + "' has no field '" + fieldname + "'");
+        }
+        if (index >= array.getNumberOfElements()) {
+            throw std::out_of_range("Struct index out of range");
+        }
+    }
+
+    MatlabArray MatlabArray::getField(const std::string& fieldname, size_t index) const
+    {
+        checkField(*this, fieldname, index);
+        const matlab::data::StructArray structArray(*array_);
+        matlab::data::Array value = structArray[index][fieldname];
+        return MatlabArray(m_name + "_" + fieldname + "_" + std::to_string(index), value);
     }
 
     void MatlabArray::setField(const std::string& fieldname, const MatlabArray& value, size_t index)
     {
-        if (!isStruct()) {
-            throw std::runtime_error("Array is not a struct");
+        checkField(*this, fieldname, index);
+        detach();
+        // Moved out of array_, so that the assignment does not unshare the data again
+        matlab::data::StructArray structArray(std::move(*array_));
+        structArray[index][fieldname] = value.getAPIArray();
+        *array_ = std::move(structArray);
+    }
+
+    // Throws if fieldNames can't be the names of the fields of array or index is not an element
+    static void checkFields(const MatlabArray& array, const std::vector<std::string>& fieldNames, size_t index)
+    {
+        size_t count = array.getNumberOfFields();
+        if (fieldNames.size() != count) {
+            throw std::invalid_argument(std::to_string(fieldNames.size()) + " names for the " + std::to_string(count)
+                                        + " fields of struct '" + array.getName() + "'");
+        }
+        if (index >= array.getNumberOfElements()) {
+            throw std::out_of_range("Struct index out of range");
         }
-        mxSetField(array_, index, fieldname.c_str(), mxDuplicateArray(value.get()));
-    }*/
+    }
+
+    std::vector<MatlabArray> MatlabArray::getFields(size_t index) const
+    {
+        return getFields(index, getFieldNames());
+    }
+
+    std::vector<MatlabArray> MatlabArray::getFields(size_t index, const std::vector<std::string>& fieldNames) const
+    {
+        checkFields(*this, fieldNames, index);
+        const matlab::data::StructArray structArray(*array_);
+        const matlab::data::Struct element = *(structArray.begin() + index);
+        std::vector<MatlabArray> values;
+        values.reserve(fieldNames.size());
+        std::string suffix = "_" + std::to_string(index);
+        size_t i = 0;
+        for (const matlab::data::Array& value : element) {
+            values.emplace_back(m_name + "_" + fieldNames[i++] + suffix, value);
+        }
+        return values;
+    }
+
+    void MatlabArray::setFields(size_t index, const std::vector<MatlabArray>& values)
+    {
+        setFields(index, values, getFieldNames());
+    }
+
+    void MatlabArray::setFields(size_t index, const std::vector<MatlabArray>& values, const std::vector<std::string>& fieldNames)
+    {
+        if (values.size() != fieldNames.size()) {
+            throw std::invalid_argument(std::to_string(values.size()) + " values for the " + std::to_string(fieldNames.size())
+                                        + " fields of struct '" + m_name + "'");
+        }
+        checkFields(*this, fieldNames, index);
+        detach();
+        matlab::data::StructArray structArray(std::move(*array_));
+        auto element = structArray[index];
+        for (size_t i = 0; i < fieldNames.size(); ++i) {
+            element[fieldNames[i]] = values[i].getAPIArray();
+        }
+        *array_ = std::move(structArray);
+    }
 
     // ===== Utility Methods =====
 
@@ -569,12 +969,26 @@ namespace MatlabAPI
     }
 
     /**
-     * @brief Clone the array
+     * @brief Clone the array, the data is shared until either array is modified
      */
     MatlabArray MatlabArray::clone() const {
         if (!array_)
             return MatlabArray("");
-        return MatlabArray(m_name, *array_);
+        return MatlabArray(*this);
+    }
+
+    bool MatlabArray::computeContentHash(uint64_t& hash) const
+    {
+        if (!array_)
+            return false;
+        hash = s_hashOffset;
+        return hashArray(hash, *array_);
+    }
+    size_t MatlabArray::getSizeInBytes() const
+    {
+        if (!array_)
+            return 0;
+        return dataSize(*array_);
     }
 
     bool MatlabArray::updateFromEngine()
@@ -589,6 +1003,12 @@ namespace MatlabAPI
             return m_owner->sendVariableToEngine(this);
         return false;
     }
+    bool MatlabArray::updateRowsToEngine(size_t first, size_t count)
+    {
+        if (m_owner)
+            return m_owner->sendRowsToEngine(this, first, count);
+        return false;
+    }
 
     // ===== Operators =====
 
@@ -615,41 +1035,124 @@ namespace MatlabAPI
 
 
 #else
+    static bool hashArray(uint64_t& hash, const mxArray* arr)
+    {
+        hashValue(hash, static_cast<uint64_t>(mxGetClassID(arr)));
+        hashValue(hash, mxIsComplex(arr) ? 1 : 0);
+        size_t ndims = mxGetNumberOfDimensions(arr);
+        const mwSize* dims = mxGetDimensions(arr);
+        for (size_t i = 0; i < ndims; ++i)
+            hashValue(hash, dims[i]);
+
+        if (mxIsSparse(arr) || mxIsFunctionHandle(arr) || mxIsClass(arr, "string"))
+            return false;
+        if (mxIsCell(arr))
+        {
+            for (size_t i = 0; i < mxGetNumberOfElements(arr); ++i)
+            {
+                const mxArray* cell = mxGetCell(arr, i);
+                if (cell)
+                {
+                    if (!hashArray(hash, cell))
+                        return false;
+                }
+                else
+                    hashValue(hash, 0);
+            }
+            return true;
+        }
+        if (mxIsStruct(arr))
+        {
+            int nfields = mxGetNumberOfFields(arr);
+            for (int f = 0; f < nfields; ++f)
+            {
+                const char* field = mxGetFieldNameByNumber(arr, f);
+                hashBytes(hash, field, std::strlen(field));
+            }
+            for (size_t i = 0; i < mxGetNumberOfElements(arr); ++i)
+            {
+                for (int f = 0; f < nfields; ++f)
+                {
+                    const mxArray* value = mxGetFieldByNumber(arr, i, f);
+                    if (value)
+                    {
+                        if (!hashArray(hash, value))
+                            return false;
+                    }
+                    else
+                        hashValue(hash, 0);
+                }
+            }
+            return true;
+        }
+        if (!mxIsNumeric(arr) && !mxIsLogical(arr) && !mxIsChar(arr))
+            return false;
+        // The interleaved complex API stores real and imaginary parts in one buffer
+        hashBytes(hash, mxGetData(arr), mxGetNumberOfElements(arr) * mxGetElementSize(arr));
+        return true;
+    }
+    static size_t dataSize(const mxArray* arr)
+    {
+        if (mxIsCell(arr))
+        {
+            size_t size = 0;
+            for (size_t i = 0; i < mxGetNumberOfElements(arr); ++i)
+            {
+                const mxArray* cell = mxGetCell(arr, i);
+                if (cell)
+                    size += dataSize(cell);
+            }
+            return size;
+        }
+        if (mxIsStruct(arr))
+        {
+            size_t size = 0;
+            int nfields = mxGetNumberOfFields(arr);
+            for (size_t i = 0; i < mxGetNumberOfElements(arr); ++i)
+            {
+                for (int f = 0; f < nfields; ++f)
+                {
+                    const mxArray* value = mxGetFieldByNumber(arr, i, f);
+                    if (value)
+                        size += dataSize(value);
+                }
+            }
+            return size;
+        }
+        if (mxIsSparse(arr) || (!mxIsNumeric(arr) && !mxIsLogical(arr) && !mxIsChar(arr)))
+            return 0;
+        return mxGetNumberOfElements(arr) * mxGetElementSize(arr);
+    }
+
     MatlabArray::MatlabArray(const std::string& name)
-        : array_(nullptr)
-        , owns_memory_(false)
-        , m_name(name)
+        : m_name(name)
     {}
 
     /**
      * @brief Constructor from existing mxArray (takes ownership)
      */
     MatlabArray::MatlabArray(const std::string& name, mxArray* arr, bool take_ownership)
-        : array_(arr)
-        , owns_memory_(take_ownership)
-        , m_name(name)
-    {}
+        : m_name(name)
+    {
+        attach(arr, take_ownership);
+    }
 
     /**
      * @brief Create double scalar
      */
     MatlabArray::MatlabArray(const std::string& name, double value)
-        : array_(nullptr)
-        , owns_memory_(false)
-        , m_name(name)
+        : m_name(name)
     {
-        array_ = mxCreateDoubleScalar(value);
+        attach(mxCreateDoubleScalar(value), true);
     }
 
     /**
      * @brief Create double vector from std::vector
      */
     MatlabArray::MatlabArray(const std::string& name, const std::vector<double>& data)
-        : array_(nullptr)
-        , owns_memory_(true)
-        , m_name(name)
+        : m_name(name)
     {
-        array_ = mxCreateDoubleMatrix(data.size(), 1, mxREAL);
+        attach(mxCreateDoubleMatrix(data.size(), 1, mxREAL), true);
         double* ptr = mxGetPr(array_);
         std::copy(data.begin(), data.end(), ptr);
     }
@@ -658,13 +1161,12 @@ namespace MatlabAPI
      * @brief Create double matrix
      */
     MatlabArray::MatlabArray(const std::string& name, size_t rows, size_t cols, const std::vector<double>& data)
-        : owns_memory_(true)
-        , m_name(name)
+        : m_name(name)
     {
         if (data.size() != rows * cols) {
             throw std::invalid_argument("Data size doesn't match matrix dimensions");
         }
-        array_ = mxCreateDoubleMatrix(rows, cols, mxREAL);
+        attach(mxCreateDoubleMatrix(rows, cols, mxREAL), true);
         double* ptr = mxGetPr(array_);
         std::copy(data.begin(), data.end(), ptr);
     }
@@ -673,65 +1175,49 @@ namespace MatlabAPI
      * @brief Create string array
      */
     MatlabArray::MatlabArray(const std::string& name, const std::string& str)
-        : owns_memory_(true)
-        , m_name(name)
+        : m_name(name)
     {
-        array_ = mxCreateString(str.c_str());
+        attach(mxCreateString(str.c_str()), true);
     }
 
     /**
      * @brief Create logical array
      */
     MatlabArray::MatlabArray(const std::string& name, const std::vector<bool>& data)
-        : owns_memory_(true)
-        , m_name(name)
+        : m_name(name)
     {
-        array_ = mxCreateLogicalMatrix(data.size(), 1);
+        attach(mxCreateLogicalMatrix(data.size(), 1), true);
         bool* ptr = (bool*)mxGetData(array_);
         for (size_t i = 0; i < data.size(); i++) {
             ptr[i] = data[i];
         }
     }
 
-    // Copy constructor
+    // Copy constructor, shares the data
     MatlabArray::MatlabArray(const MatlabArray& other)
-        : owns_memory_(true)
-        , m_name(other.m_name)
+        : m_name(other.m_name)
     {
-        if (other.array_) {
-            array_ = mxDuplicateArray(other.array_);
-        }
-        else {
-            array_ = nullptr;
-            owns_memory_ = false;
-        }
+        share(other);
     }
 
     // Move constructor
     MatlabArray::MatlabArray(MatlabArray&& other) noexcept
         : array_(other.array_)
-        , owns_memory_(other.owns_memory_)
+        , m_references(other.m_references)
+        , m_borrowed(other.m_borrowed)
         , m_name(std::move(other.m_name))
     {
         other.array_ = nullptr;
-        other.owns_memory_ = false;
+        other.m_references = nullptr;
+        other.m_borrowed = false;
     }
 
-    // Copy assignment
+    // Copy assignment, shares the data
     MatlabArray& MatlabArray:: operator=(const MatlabArray& other)
     {
         if (this != &other) {
-            if (owns_memory_ && array_) {
-                mxDestroyArray(array_);
-            }
-            if (other.array_) {
-                array_ = mxDuplicateArray(other.array_);
-                owns_memory_ = true;
-            }
-            else {
-                array_ = nullptr;
-                owns_memory_ = false;
-            }
+            dropReference();
+            share(other);
             m_name = other.m_name;
         }
         return *this;
@@ -741,13 +1227,13 @@ namespace MatlabAPI
     MatlabArray& MatlabArray::operator=(MatlabArray&& other) noexcept
     {
         if (this != &other) {
-            if (owns_memory_ && array_) {
-                mxDestroyArray(array_);
-            }
+            dropReference();
             array_ = other.array_;
-            owns_memory_ = other.owns_memory_;
+            m_references = other.m_references;
+            m_borrowed = other.m_borrowed;
             other.array_ = nullptr;
-            other.owns_memory_ = false;
+            other.m_references = nullptr;
+            other.m_borrowed = false;
             m_name = std::move(other.m_name);
         }
         return *this;
@@ -756,9 +1242,72 @@ namespace MatlabAPI
     // Destructor
     MatlabArray::~MatlabArray()
     {
-        if (owns_memory_ && array_) {
-            mxDestroyArray(array_);
+        dropReference();
+    }
+
+    // ===== Shared Ownership =====
+
+    void MatlabArray::attach(mxArray* arr, bool take_ownership)
+    {
+        array_ = arr;
+        m_references = arr && take_ownership ? new std::atomic<size_t>(1) : nullptr;
+        m_borrowed = false;
+    }
+
+    MatlabArray MatlabArray::borrow(const std::string& name, mxArray* child)
+    {
+        // Fields that were never set are [] as in MATLAB
+        if (!child)
+            return MatlabArray(name, mxCreateDoubleMatrix(0, 0, mxREAL), true);
+        MatlabArray array(name, child, false);
+        array.m_borrowed = true;
+        return array;
+    }
+
+    void MatlabArray::share(const MatlabArray& other)
+    {
+        if (other.m_references) {
+            array_ = other.array_;
+            m_references = other.m_references;
+            m_references->fetch_add(1, std::memory_order_relaxed);
+        }
+        else if (other.array_) {
+            // Not owned (a cell or field of another array), the owner may destroy it
+            attach(mxDuplicateArray(other.array_), true);
+        }
+        else {
+            attach(nullptr, false);
+        }
+    }
+
+    void MatlabArray::dropReference(bool destroy)
+    {
+        if (m_references && m_references->fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            if (destroy)
+                mxDestroyArray(array_);
+            delete m_references;
+        }
+        array_ = nullptr;
+        m_references = nullptr;
+        m_borrowed = false;
+    }
+
+    void MatlabArray::detach()
+    {
+        if (m_borrowed) {
+            attach(mxDuplicateArray(array_), true);
+            return;
         }
+        if (!m_references || m_references->load(std::memory_order_acquire) == 1)
+            return;
+        mxArray* copy = mxDuplicateArray(array_);
+        dropReference();
+        attach(copy, true);
+    }
+
+    bool MatlabArray::isShared() const
+    {
+        return m_references && m_references->load(std::memory_order_acquire) > 1;
     }
 
     // ===== Static Factory Methods =====
@@ -783,11 +1332,89 @@ namespace MatlabAPI
         return MatlabArray(name, mxCreateCellMatrix(rows, cols), true);
     }
 
+    MatlabArray MatlabArray::createStruct(const std::string& name, size_t rows, size_t cols, const std::vector<std::string>& fieldNames)
+    {
+        std::vector<const char*> names;
+        for (const std::string& field : fieldNames) {
+            names.push_back(field.c_str());
+        }
+        return MatlabArray(name, mxCreateStructMatrix(rows, cols, (int)names.size(), names.data()), true);
+    }
+
+    static mxClassID toClassID(ArrayElementType type)
+    {
+        switch (type)
+        {
+        case ArrayElementType::Double:  return mxDOUBLE_CLASS;
+        case ArrayElementType::Single:  return mxSINGLE_CLASS;
+        case ArrayElementType::Int8:    return mxINT8_CLASS;
+        case ArrayElementType::Uint8:   return mxUINT8_CLASS;
+        case ArrayElementType::Int16:   return mxINT16_CLASS;
+        case ArrayElementType::Uint16:  return mxUINT16_CLASS;
+        case ArrayElementType::Int32:   return mxINT32_CLASS;
+        case ArrayElementType::Uint32:  return mxUINT32_CLASS;
+        case ArrayElementType::Int64:   return mxINT64_CLASS;
+        case ArrayElementType::Uint64:  return mxUINT64_CLASS;
+        case ArrayElementType::Logical: return mxLOGICAL_CLASS;
+        }
+        return mxUNKNOWN_CLASS;
+    }
+
+    void* MatlabArray::allocateBuffer(ArrayElementType type, size_t count, void*& data)
+    {
+        // mxSetData only accepts memory from mxMalloc / mxCalloc
+        size_t elementSize = 8;
+        switch (type)
+        {
+        case ArrayElementType::Int8:
+        case ArrayElementType::Uint8:
+        case ArrayElementType::Logical: elementSize = 1; break;
+        case ArrayElementType::Int16:
+        case ArrayElementType::Uint16:  elementSize = 2; break;
+        case ArrayElementType::Single:
+        case ArrayElementType::Int32:
+        case ArrayElementType::Uint32:  elementSize = 4; break;
+        default:                        break;
+        }
+        data = mxMalloc(std::max<size_t>(count, 1) * elementSize);
+        return data;
+    }
+    void MatlabArray::freeBuffer(ArrayElementType type, void* handle)
+    {
+        (void)type;
+        mxFree(handle);
+    }
+    void MatlabArray::adoptBuffer(ArrayElementType type, void* handle, size_t count, const std::vector<size_t>& dimensions)
+    {
+        if (!handle)
+            throw std::invalid_argument("Buffer for array '" + m_name + "' is empty or was already adopted");
+        try
+        {
+            checkBufferDimensions(count, dimensions);
+        }
+        catch (...)
+        {
+            freeBuffer(type, handle);
+            throw;
+        }
+        std::vector<mwSize> dims(dimensions.begin(), dimensions.end());
+        mxArray* arr = type == ArrayElementType::Logical
+            ? mxCreateLogicalMatrix(0, 0)
+            : mxCreateNumericMatrix(0, 0, toClassID(type), mxREAL);
+        mxSetData(arr, handle);
+        mxSetDimensions(arr, dims.data(), dims.size());
+        dropReference();
+        attach(arr, true);
+    }
+
     // ===== Access to underlying mxArray =====
 
     mxArray* MatlabArray::release()
     {
-        owns_memory_ = false;
+        // The caller takes ownership, copies of this array keep their own data
+        detach();
+        delete m_references;
+        m_references = nullptr;
         return array_;
     }
 
@@ -795,11 +1422,8 @@ namespace MatlabAPI
     {
         if (arr == array_)
             return;
-        if (deleteOld && owns_memory_ && array_) {
-            mxDestroyArray(array_);
-        }
-        array_ = arr;
-        owns_memory_ = take_ownership;
+        dropReference(deleteOld);
+        attach(arr, take_ownership);
     }
 
     // ===== Type Checking =====
@@ -866,6 +1490,7 @@ namespace MatlabAPI
 
     void* MatlabArray::getDataRaw()
     {
+        detach();
         return array_ ? mxGetData(array_) : nullptr;
     }
     void* MatlabArray::getDataRawC() const
@@ -873,7 +1498,37 @@ namespace MatlabAPI
         return array_ ? mxGetData(array_) : nullptr;
     }
 
-    double* MatlabArray::getPr() const { return array_ ? mxGetPr(array_) : nullptr; }
+    double* MatlabArray::getPr()
+    {
+        detach();
+        return array_ ? mxGetPr(array_) : nullptr;
+    }
+    const double* MatlabArray::getPr() const { return array_ ? mxGetPr(array_) : nullptr; }
+
+    void* MatlabArray::getViewData(ArrayElementType type, bool writable) const
+    {
+        (void)writable;
+        if (!array_)
+            throw std::runtime_error("Array '" + m_name + "' is not valid");
+        mxClassID expected = mxUNKNOWN_CLASS;
+        switch (type)
+        {
+        case ArrayElementType::Double:  expected = mxDOUBLE_CLASS; break;
+        case ArrayElementType::Single:  expected = mxSINGLE_CLASS; break;
+        case ArrayElementType::Int8:    expected = mxINT8_CLASS; break;
+        case ArrayElementType::Uint8:   expected = mxUINT8_CLASS; break;
+        case ArrayElementType::Int16:   expected = mxINT16_CLASS; break;
+        case ArrayElementType::Uint16:  expected = mxUINT16_CLASS; break;
+        case ArrayElementType::Int32:   expected = mxINT32_CLASS; break;
+        case ArrayElementType::Uint32:  expected = mxUINT32_CLASS; break;
+        case ArrayElementType::Int64:   expected = mxINT64_CLASS; break;
+        case ArrayElementType::Uint64:  expected = mxUINT64_CLASS; break;
+        case ArrayElementType::Logical: expected = mxLOGICAL_CLASS; break;
+        }
+        if (mxGetClassID(array_) != expected || mxIsComplex(array_) || mxIsSparse(array_))
+            throw std::runtime_error("Array '" + m_name + "' of class " + getClassName() + " can't be viewed as the requested element type");
+        return mxGetData(array_);
+    }
 
     // ===== Convenience Methods for Common Types =====
 
@@ -896,7 +1551,7 @@ namespace MatlabAPI
         if (!isDouble()) {
             throw std::runtime_error("Array is not double type");
         }
-        double* data = getPr();
+        const double* data = getPr();
         size_t size = getNumberOfElements();
         return std::vector<double>(data, data + size);
     }
@@ -943,7 +1598,7 @@ namespace MatlabAPI
 
         size_t rows = getM();
         size_t cols = getN();
-        double* data = getPr();
+        const double* data = getPr();
 
         std::vector<std::vector<double>> result(rows, std::vector<double>(cols));
         for (size_t i = 0; i < rows; i++) {
@@ -964,7 +1619,7 @@ namespace MatlabAPI
         if (index >= getNumberOfElements()) {
             throw std::out_of_range("Cell index out of range");
         }
-        return MatlabArray(m_name + "_" + std::to_string(index), mxGetCell(array_, index), false);  // Don't take ownership
+        return borrow(m_name + "_" + std::to_string(index), mxGetCell(array_, index));
     }
 
     void MatlabArray::setCell(size_t index, const MatlabArray& value)
@@ -975,6 +1630,7 @@ namespace MatlabAPI
         if (index >= getNumberOfElements()) {
             throw std::out_of_range("Cell index out of range");
         }
+        detach();
         mxSetCell(array_, index, mxDuplicateArray(value.get()));
     }
 
@@ -994,20 +1650,94 @@ namespace MatlabAPI
         return names;
     }
 
-    MatlabArray MatlabArray::getField(const std::string& fieldname, size_t index) const
+    size_t MatlabArray::getNumberOfFields() const
     {
         if (!isStruct()) {
             throw std::runtime_error("Array is not a struct");
         }
-        return MatlabArray(m_name + "_" + fieldname + "_" + std::to_string(index), mxGetField(array_, index, fieldname.c_str()), false);
+        return mxGetNumberOfFields(array_);
     }
 
-    void MatlabArray::setField(const std::string& fieldname, const MatlabArray& value, size_t index)
+    // Number of the field fieldname, throws if the array has no such field or element index
+    static int getFieldNumber(const MatlabArray& array, const std::string& fieldname, size_t index)
     {
-        if (!isStruct()) {
+        if (!array.isStruct()) {
             throw std::runtime_error("Array is not a struct");
         }
-        mxSetField(array_, index, fieldname.c_str(), mxDuplicateArray(value.get()));
+        int number = mxGetFieldNumber(array.getAPIArray(), fieldname.c_str());
+        if (number < 0) {
+            throw std::runtime_error("Struct '" + array.getName() + "' has no field '" + fieldname + "'");
+        }
+        if (index >= array.getNumberOfElements()) {
+            throw std::out_of_range("Struct index out of range");
+        }
+        return number;
+    }
+
+    MatlabArray MatlabArray::getField(const std::string& fieldname, size_t index) const
+    {
+        int number = getFieldNumber(*this, fieldname, index);
+        return borrow(m_name + "_" + fieldname + "_" + std::to_string(index), mxGetFieldByNumber(array_, index, number));
+    }
+
+    void MatlabArray::setField(const std::string& fieldname, const MatlabArray& value, size_t index)
+    {
+        int number = getFieldNumber(*this, fieldname, index);
+        detach();
+        mxDestroyArray(mxGetFieldByNumber(array_, index, number));
+        mxSetFieldByNumber(array_, index, number, mxDuplicateArray(value.get()));
+    }
+
+    std::vector<MatlabArray> MatlabArray::getFields(size_t index) const
+    {
+        return getFields(index, getFieldNames());
+    }
+
+    std::vector<MatlabArray> MatlabArray::getFields(size_t index, const std::vector<std::string>& fieldNames) const
+    {
+        size_t count = getNumberOfFields();
+        if (fieldNames.size() != count) {
+            throw std::invalid_argument(std::to_string(fieldNames.size()) + " names for the " + std::to_string(count)
+                                        + " fields of struct '" + m_name + "'");
+        }
+        if (index >= getNumberOfElements()) {
+            throw std::out_of_range("Struct index out of range");
+        }
+        std::vector<MatlabArray> values;
+        values.reserve(count);
+        std::string suffix = "_" + std::to_string(index);
+        for (size_t i = 0; i < count; i++) {
+            values.push_back(borrow(m_name + "_" + fieldNames[i] + suffix, mxGetFieldByNumber(array_, index, (int)i)));
+        }
+        return values;
+    }
+
+    void MatlabArray::setFields(size_t index, const std::vector<MatlabArray>& values)
+    {
+        size_t count = getNumberOfFields();
+        if (values.size() != count) {
+            throw std::invalid_argument(std::to_string(values.size()) + " values for the " + std::to_string(count)
+                                        + " fields of struct '" + m_name + "'");
+        }
+        if (index >= getNumberOfElements()) {
+            throw std::out_of_range("Struct index out of range");
+        }
+        detach();
+        for (size_t i = 0; i < count; i++) {
+            mxDestroyArray(mxGetFieldByNumber(array_, index, (int)i));
+            mxSetFieldByNumber(array_, index, (int)i, mxDuplicateArray(values[i].get()));
+        }
+    }
+
+    void MatlabArray::setFields(size_t index, const std::vector<MatlabArray>& values, const std::vector<std::string>& fieldNames)
+    {
+        // The fields are set by number, the names are only checked
+        size_t count = getNumberOfFields();
+        if (fieldNames.size() != count) {
+            throw std::invalid_argument(std::to_string(fieldNames.size()) + " names for the " + std::to_string(count)
+                                        + " fields of struct '" + m_name + "'");
+        }
+        setFields(index, values);
     }
 
     // ===== Utility Methods =====
@@ -1036,7 +1766,7 @@ namespace MatlabAPI
         // Print some data
         if (isDouble() && !isEmpty()) {
             os << "Data preview: ";
-            double* data = getPr();
+            const double* data = getPr();
             size_t preview = std::min((size_t)5, getNumberOfElements());
             for (size_t i = 0; i < preview; i++) {
                 os << data[i] << " ";
@@ -1050,12 +1780,26 @@ namespace MatlabAPI
     }
 
     /**
-     * @brief Clone the array
+     * @brief Clone the array, the data is shared until either array is modified
      */
     MatlabArray MatlabArray::clone() const {
         if (!array_)
             return MatlabArray("");
-        return MatlabArray(m_name, mxDuplicateArray(array_), true);
+        return MatlabArray(*this);
+    }
+
+    bool MatlabArray::computeContentHash(uint64_t& hash) const
+    {
+        if (!array_)
+            return false;
+        hash = s_hashOffset;
+        return hashArray(hash, array_);
+    }
+    size_t MatlabArray::getSizeInBytes() const
+    {
+        if (!array_)
+            return 0;
+        return dataSize(array_);
     }
 
     bool MatlabArray::updateFromEngine()
@@ -1070,6 +1814,12 @@ namespace MatlabAPI
             return m_owner->sendVariableToEngine(this);
         return false;
     }
+    bool MatlabArray::updateRowsToEngine(size_t first, size_t count)
+    {
+        if (m_owner)
+            return m_owner->sendRowsToEngine(this, first, count);
+        return false;
+    }
 
     // ===== Operators =====
 
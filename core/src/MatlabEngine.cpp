@@ -4,248 +4,385 @@
 
 #include "QApplication.h"
 #include "MatlabAPI_debug.h"
+#include "Utf.h"
 #ifdef MATLAB_API_USE_CPP_API
 #include "MatlabEngine.hpp"
-#include "MatlabDataArray.hpp"
-#include <windows.h>
-#include <stdexcept>
-
 #else
-#include "engine.h" // Matlab Engine API
+#include "matrix.h"
 #endif
+#include <stdexcept>
 #include <QThread>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
 
 
 
 namespace MatlabAPI
 {
 
-	// Convert UTF-8 (char*) -> UTF-16 (std::u16string)
-	std::u16string to_u16string(const char* input) {
-		if (!input) return u"";
-
-		int size_needed = MultiByteToWideChar(
-			CP_UTF8,            // source encoding
-			0,                  // flags
-			input,              // input UTF-8 string
-			-1,                 // null-terminated
-			nullptr, 0          // get required size
-		);
-
-		if (size_needed <= 0) throw std::runtime_error("Failed MultiByteToWideChar");
-
-		std::u16string output(size_needed - 1, 0); // exclude null terminator
-
-		MultiByteToWideChar(
-			CP_UTF8,
-			0,
-			input,
-			-1,
-			reinterpret_cast<wchar_t*>(&output[0]),
-			size_needed
-		);
-
-		return output;
-	}
-
-	// Convert UTF-16 (std::u16string) -> UTF-8 (std::string)
-	std::string to_utf8(const std::u16string& input) {
-		if (input.empty()) return "";
-
-		int size_needed = WideCharToMultiByte(
-			CP_UTF8,
-			0,
-			reinterpret_cast<const wchar_t*>(input.data()),
-			static_cast<int>(input.size()),
-			nullptr, 0,
-			nullptr, nullptr
-		);
+	static std::shared_ptr<EngineBackend> s_backend = nullptr; // owned by the engine thread
+	static std::atomic<MatlabEngine*> s_instance{ nullptr }; // singleton instance
 
-		if (size_needed <= 0) throw std::runtime_error("Failed WideCharToMultiByte");
+	// Background start by instantiateAsync()
+	static std::mutex s_startMutex;
+	static std::atomic<bool> s_starting{ false };
+	static MatlabFuture<bool> s_startFuture;
 
-		std::string output(size_needed, 0);
+	// Engine thread: the only thread that touches the backend and the variable map.
+	// Public calls from other threads are posted to its command queue (multiple producers, one consumer).
+	static std::thread s_workerThread;
+	static std::atomic<std::thread::id> s_workerThreadId;
+	static std::mutex s_workerMutex;
+	static std::condition_variable s_workerCondition;
+	static std::deque<std::function<void()>> s_workerJobs;
+	static bool s_workerStop = false;
+	static bool s_workerFinished = false; // the loop has exited, the thread can be joined without blocking
 
-		WideCharToMultiByte(
-			CP_UTF8,
-			0,
-			reinterpret_cast<const wchar_t*>(input.data()),
-			static_cast<int>(input.size()),
-			output.data(),
-			size_needed,
-			nullptr, nullptr
-		);
-
-		return output;
+	static void workerLoop()
+	{
+		s_workerThreadId = std::this_thread::get_id();
+		while (true)
+		{
+			std::function<void()> job;
+			{
+				std::unique_lock<std::mutex> lock(s_workerMutex);
+				s_workerCondition.wait(lock, []() { return s_workerStop || !s_workerJobs.empty(); });
+				if (s_workerJobs.empty())
+				{
+					s_workerFinished = true;
+					break; // stop requested and all pending jobs are done
+				}
+				job = std::move(s_workerJobs.front());
+				s_workerJobs.pop_front();
+			}
+			job();
+		}
+		s_workerThreadId = std::thread::id();
 	}
 
-#ifdef MATLAB_API_USE_CPP_API
-	static std::unique_ptr<matlab::engine::MATLABEngine> s_engine = nullptr; // Matlab Engine instance (C++ API)
-	
-	// Read from a StreamBuffer into std::string
-	std::string streamBufferToString(matlab::engine::StreamBuffer* buffer) {
-		std::basic_istream<char16_t> in(buffer);
-		std::u16string u16;
-		std::getline(in, u16);   // or read all with std::istreambuf_iterator
+	// Joins the engine thread at program exit if terminate() was not called,
+	// a joinable std::thread would otherwise abort the program on destruction
+	static struct EngineThreadGuard
+	{
+		~EngineThreadGuard()
+		{
+			{
+				std::lock_guard<std::mutex> lock(s_workerMutex);
+				s_workerStop = true;
+			}
+			s_workerCondition.notify_all();
+			if (s_workerThread.joinable())
+				s_workerThread.join();
+		}
+	} s_workerThreadGuard;
 
-		return to_utf8(u16);
+	// Completes promise with the result of call and lets MatlabFuture::cancel() interrupt the backend
+	// operation started by call. The backend reports the id when the operation starts, so other
+	// backend calls made in between can't shift it.
+	template<typename T, typename Call>
+	static void runCancellable(MatlabPromise<T>& promise, Call&& call)
+	{
+		// Removes the listener before the continuations of promise run, also if call throws
+		struct ListenerScope
+		{
+			~ListenerScope()
+			{
+				if (s_backend)
+					s_backend->setOperationListener(nullptr);
+			}
+		};
+		auto result = [&]() {
+			ListenerScope scope;
+			s_backend->setOperationListener([&promise, backend = std::weak_ptr<EngineBackend>(s_backend)](uint64_t operation) {
+				promise.setCanceller([backend, operation]() {
+					std::shared_ptr<EngineBackend> locked = backend.lock();
+					return locked && locked->cancel(operation);
+					});
+				});
+			return call();
+		}();
+		promise.setValue(std::move(result));
 	}
 
-#else
-	static Engine* s_engine = nullptr; // Matlab Engine instance
-#endif	
-	static MatlabEngine* s_instance = nullptr; // singleton instance
-
 
-
-#ifdef MATLAB_API_USE_CPP_API
-	MatlabEngine::MatlabEngine(const std::u16string& startcmd)
-#else
-	MatlabEngine::MatlabEngine(const char* startcmd)
-#endif
+	MatlabEngine::MatlabEngine(std::shared_ptr<EngineBackend> backend)
 	{
-		// Start MATLAB engine
-#ifdef MATLAB_API_USE_CPP_API
-		//s_engine = matlab::engine::connectMATLAB(to_u16string(startcmd));
-		if (startcmd.empty())
-			s_engine = matlab::engine::startMATLAB(); // start a new MATLAB engine
-		else
-			s_engine = matlab::engine::connectMATLAB(startcmd);
-#else
-		s_engine = engOpen(startcmd); // open a MATLAB engine
-#endif	
-		if (!s_engine)
-		{
-			Logger::logError("Can't start MATLAB engine");
-		}
-		else
-		{
-			Logger::log("MATLAB engine started successfully", Log::info, Log::Colors::green);
-		}
+		s_backend = std::move(backend);
+		Logger::log("MATLAB engine started successfully using the " + s_backend->getName() + " backend", Log::info, Log::Colors::green);
 	}
 	MatlabEngine::~MatlabEngine()
 	{
-		if (s_engine)
+		if (s_backend)
 		{
 #ifdef MATLAB_API_USE_CPP_API
-			matlab::engine::terminateEngineClient();
+			bool native = s_backend->isNative();
+			s_backend.reset();
+			if (native)
+				matlab::engine::terminateEngineClient();
 #else
-			engClose(s_engine);
-#endif	
-
-			s_engine = nullptr;
+			s_backend.reset();
+#endif
 			Logger::log("MATLAB engine closed", Log::info, Log::Colors::yellow);
 		}
 
 		// clean up variables
 		for (auto& pair : m_variables)
 		{
-			if (pair.second)
-				delete pair.second;
+			if (pair.second.array)
+				delete pair.second.array;
 		}
 	}
 
 
 	bool MatlabEngine::instantiate()
 	{
-#ifdef MATLAB_API_USE_CPP_API
 		return instantiate(u"");
-#else
-		return instantiate("");
-#endif
 	}
-#ifdef MATLAB_API_USE_CPP_API
 	bool MatlabEngine::instantiate(const std::u16string& startcmd, int retryCount)
-#else
+	{
+		return start([startcmd]() { return std::shared_ptr<EngineBackend>(EngineBackend::createNative(startcmd)); }, retryCount);
+	}
+#ifndef MATLAB_API_USE_CPP_API
 	bool MatlabEngine::instantiate(const char* startcmd, int retryCount)
+	{
+		return instantiate(Utf::toUtf16(startcmd), retryCount);
+	}
 #endif
+	bool MatlabEngine::instantiate(std::unique_ptr<EngineBackend> backend)
 	{
-		int initialRetryCount = retryCount;
-		do {
-			if (s_instance != nullptr)
-				return true; // already instantiated
-			try{
-				s_instance = new MatlabEngine(startcmd);
-			}
-			catch (const std::exception& e) {
-				Logger::logError(std::string("Exception while starting MATLAB engine: ") + e.what());
-				s_instance = nullptr;
-			}
-			
-			if (s_engine == nullptr)
+		if (!backend)
+		{
+			Logger::logError("MatlabEngine::instantiate() needs a backend.");
+			return false;
+		}
+		if (isAvailable())
+			Logger::logWarning("MatlabEngine is already instantiated or starting, the " + backend->getName() + " backend is not used.");
+		std::shared_ptr<EngineBackend> shared(std::move(backend));
+		return start([shared]() { return shared; }, 1);
+	}
+	MatlabFuture<bool> MatlabEngine::instantiateAsync(const std::u16string& startcmd, int retryCount)
+	{
+		return startAsync([startcmd]() { return std::shared_ptr<EngineBackend>(EngineBackend::createNative(startcmd)); }, retryCount);
+	}
+	MatlabFuture<bool> MatlabEngine::instantiateAsync(std::unique_ptr<EngineBackend> backend)
+	{
+		if (!backend)
+		{
+			Logger::logError("MatlabEngine::instantiateAsync() needs a backend.");
+			return MatlabFuture<bool>::makeReady(false);
+		}
+		if (isAvailable())
+			Logger::logWarning("MatlabEngine is already instantiated or starting, the " + backend->getName() + " backend is not used.");
+		std::shared_ptr<EngineBackend> shared(std::move(backend));
+		return startAsync([shared]() { return shared; }, 1);
+	}
+	MatlabFuture<bool> MatlabEngine::instantiateAsync(std::function<std::unique_ptr<EngineBackend>()> createBackend, int retryCount)
+	{
+		if (!createBackend)
+		{
+			Logger::logError("MatlabEngine::instantiateAsync() needs a backend factory.");
+			return MatlabFuture<bool>::makeReady(false);
+		}
+		return startAsync([createBackend]() { return std::shared_ptr<EngineBackend>(createBackend()); }, retryCount);
+	}
+	bool MatlabEngine::start(const std::function<std::shared_ptr<EngineBackend>()>& createBackend, int retryCount)
+	{
+		if (isEngineThread())
+		{
+			Logger::logError("MatlabEngine::instantiate() can't be called from the engine thread.");
+			return false;
+		}
+		MatlabFuture<bool> pendingStart;
+		{
+			std::lock_guard<std::mutex> lock(s_startMutex);
+			if (s_starting)
+				pendingStart = s_startFuture;
+		}
+		if (pendingStart.isValid())
+		{
+			pendingStart.wait(); // started by instantiateAsync()
+			return isInstantiated();
+		}
+		bool started = false;
+		for (int attempt = 1; attempt <= retryCount && !started; ++attempt)
+		{
+			// The backend is created on the engine thread, which owns it from now on
+			started = invoke([&createBackend]() { return createInstance(createBackend); });
+			if (!started && attempt < retryCount)
 			{
-				delete s_instance;
-				s_instance = nullptr;
-				
-				size_t sleepMillis = 1000;
-				auto startTime = std::chrono::high_resolution_clock::now();
-				while (std::chrono::high_resolution_clock::now() - startTime < std::chrono::milliseconds(sleepMillis))
+				std::chrono::milliseconds delay = getRetryDelay(attempt);
+				Logger::logWarning("Retrying to start MATLAB engine in " + std::to_string(delay.count()) + " ms [" + std::to_string(attempt) + "/" + std::to_string(retryCount) + "]");
+				// Keep the GUI responsive while waiting
+				auto end = std::chrono::steady_clock::now() + delay;
+				while (std::chrono::steady_clock::now() < end)
+				{
 					QApplication::processEvents();
-				Logger::logWarning("Retrying to start MATLAB engine [" + std::to_string(initialRetryCount - retryCount) + "/" + std::to_string(initialRetryCount) + "]");
+					std::this_thread::sleep_for(std::chrono::milliseconds(10));
+				}
 			}
-		} while (s_engine == nullptr && --retryCount > 0);
-		if(!s_engine)
+		}
+		if(!started)
 		{
-			Logger::logError("Failed to start MATLAB engine after multiple attempts.");
+			Logger::logError("Failed to start MATLAB engine after " + std::to_string(retryCount) + " attempts.");
+			stopEngineThread();
 		}
-		return s_engine != nullptr;
+		return started;
 	}
-#ifndef MATLAB_API_USE_CPP_API
-	bool MatlabEngine::instantiate(const std::u16string& startcmd, int retryCount)
+	MatlabFuture<bool> MatlabEngine::startAsync(const std::function<std::shared_ptr<EngineBackend>()>& createBackend, int retryCount)
 	{
-		std::string cmd = to_utf8(startcmd);
-		return instantiate(cmd.c_str(), retryCount);
+		std::lock_guard<std::mutex> lock(s_startMutex);
+		if (s_instance != nullptr)
+			return MatlabFuture<bool>::makeReady(true); // already instantiated
+		if (s_starting)
+			return s_startFuture;
+
+		MatlabPromise<bool> promise;
+		s_startFuture = promise.getFuture();
+		s_starting = true;
+		Logger::logInfo("Starting MATLAB engine in the background");
+		// Calls posted after this job wait in the queue of the engine thread until the engine is ready
+		postJob([promise, createBackend, retryCount]() mutable {
+			bool started = false;
+			for (int attempt = 1; attempt <= retryCount && !started && !promise.isCancelled(); ++attempt)
+			{
+				started = createInstance(createBackend);
+				if (!started && attempt < retryCount)
+				{
+					std::chrono::milliseconds delay = getRetryDelay(attempt);
+					Logger::logWarning("Retrying to start MATLAB engine in " + std::to_string(delay.count()) + " ms [" + std::to_string(attempt) + "/" + std::to_string(retryCount) + "]");
+					auto end = std::chrono::steady_clock::now() + delay;
+					while (std::chrono::steady_clock::now() < end && !promise.isCancelled())
+						std::this_thread::sleep_for(std::chrono::milliseconds(10));
+				}
+			}
+			if (!started && promise.isCancelled())
+				Logger::logWarning("Background start of the MATLAB engine was cancelled.");
+			else if (!started)
+				Logger::logError("Failed to start MATLAB engine after " + std::to_string(retryCount) + " attempts.");
+			{
+				std::lock_guard<std::mutex> lock(s_startMutex);
+				s_starting = false;
+			}
+			// The engine thread can't join itself: it exits once the calls queued during the start have failed
+			if (!started)
+				finishEngineThread();
+			promise.setValue(started);
+			});
+		return s_startFuture;
+	}
+	bool MatlabEngine::createInstance(const std::function<std::shared_ptr<EngineBackend>()>& createBackend)
+	{
+		if (s_instance != nullptr)
+			return true; // started by a previous request
+		std::shared_ptr<EngineBackend> backend;
+		try {
+			backend = createBackend();
+		}
+		catch (const std::exception& e) {
+			Logger::logError(std::string("Exception while starting MATLAB engine: ") + e.what());
+		}
+		if (backend == nullptr)
+			return false;
+		s_instance = new MatlabEngine(std::move(backend));
+		return true;
+	}
+	std::chrono::milliseconds MatlabEngine::getRetryDelay(int attempt)
+	{
+		const std::chrono::milliseconds initialDelay(500);
+		const std::chrono::milliseconds maxDelay(8000);
+		if (attempt >= 5)
+			return maxDelay;
+		return std::min(initialDelay * (1 << (attempt - 1)), maxDelay);
 	}
-#endif
 	bool MatlabEngine::terminate()
 	{
-		if (s_instance == nullptr)
+		if (s_instance == nullptr && !isStarting())
 			return true; // already destroyed
-		delete s_instance;
-		s_instance = nullptr;
-		return s_engine == nullptr;
+		if (isEngineThread())
+		{
+			Logger::logError("MatlabEngine::terminate() can't be called from the engine thread.");
+			return false;
+		}
+		// Requests queued before this call are still executed
+		bool closed = invoke([]() {
+			delete s_instance.exchange(nullptr);
+			return s_backend == nullptr;
+			});
+		stopEngineThread();
+		return closed;
 	}
 	bool MatlabEngine::isInstantiated()
 	{
 		return s_instance != nullptr;
 	}
+	bool MatlabEngine::isStarting()
+	{
+		return s_starting;
+	}
 
 	MatlabEngine* MatlabEngine::getInstance()
 	{
 		return s_instance;
 	}
+	EngineBackend* MatlabEngine::getBackend()
+	{
+		if (isAvailable() && !isEngineThread())
+			return invoke([]() { return getBackend(); });
+		return s_backend.get();
+	}
 
 
 
 	int MatlabEngine::eval(const char* command)
 	{
-		if (s_engine == nullptr)
+		if (isAvailable() && !isEngineThread())
+			return invoke([&]() { return eval(command); });
+		if (s_backend == nullptr)
 		{
 			err_matlabNotStarted();
 			return -1;
 		}
-		int ret = 0;
-#ifdef MATLAB_API_USE_CPP_API
-		const std::shared_ptr<matlab::engine::StreamBuffer> output;
-		const std::shared_ptr<matlab::engine::StreamBuffer> error;
-		s_engine->eval(to_u16string(command), output, error);
-		std::string resultStr = streamBufferToString(output.get());
-		std::string errorStr = streamBufferToString(error.get());
-		Logger::logDebug("Evaluated command: \n\"" + std::string(command) + "\" result: " + resultStr + " error: " + errorStr);
-		if (errorStr.size() > 0)
-			ret = -1;
-#else
-		ret = engEvalString(s_engine, command);
-		Logger::logDebug("Evaluated command: \n\"" + std::string(command) + "\"\n -> return code: " + std::to_string(ret));
-#endif
+		EngineTelemetry::Scope telemetry(EngineTelemetry::Operation::Eval);
+		invalidateVariableCache();
+		int ret = s_backend->eval(command);
+		telemetry.setFailed(ret != 0);
 		return ret;
 	}
 
 
+	std::vector<MatlabArray> MatlabEngine::feval(const std::string& function, size_t nargout, const std::vector<MatlabArray>& args)
+	{
+		if (isAvailable() && !isEngineThread())
+			return invoke([&]() { return feval(function, nargout, args); });
+		if (s_backend == nullptr)
+		{
+			err_matlabNotStarted();
+			return {};
+		}
+		EngineTelemetry::Scope telemetry(EngineTelemetry::Operation::Feval);
+		for (const MatlabArray& arg : args)
+			telemetry.addBytesToEngine(arg.getSizeInBytes());
+		invalidateVariableCache(); // the function may have modified the workspace
+		std::vector<MatlabArray> outputs = s_backend->feval(function, nargout, args);
+		for (const MatlabArray& output : outputs)
+			telemetry.addBytesFromEngine(output.getSizeInBytes());
+		telemetry.setFailed(outputs.size() != nargout);
+		return outputs;
+	}
+
+
 	bool MatlabEngine::addVariable(MatlabArray* var)
 	{
+		// Tracked on the calling thread, before the call is forwarded to the engine thread
+		if (var && WorkspaceScope::getCurrent())
+			WorkspaceScope::getCurrent()->track(var->getName());
+		if (isAvailable() && !isEngineThread())
+			return invoke([&]() { return addVariable(var); });
 		if (!var)
 			return false;
-		if (s_engine == nullptr)
+		if (s_backend == nullptr)
 		{
 			err_matlabNotStarted();
 			return false;
@@ -256,251 +393,663 @@ namespace MatlabAPI
 			Logger::logError("Variable name is empty");
 			return false;
 		}
-		auto it = s_instance->m_variables.find(name);
-		if (it != s_instance->m_variables.end())
+		EngineTelemetry::Scope telemetry(EngineTelemetry::Operation::AddVariable, name);
+		auto it = s_instance.load()->m_variables.find(name);
+		if (it != s_instance.load()->m_variables.end())
 		{
-			Logger::logWarning("Variable with name '" + name + "' already exists, overwriting.");
+			if (it->second.array != var)
+			{
+				Logger::logWarning("Variable with name '" + name + "' already exists, overwriting.");
 #ifdef MATLAB_API_USE_CPP_API
 
 #else
-			mxArray* oldArray = it->second->release();
-			if (oldArray)
-				mxDestroyArray(oldArray);
+				mxArray* oldArray = it->second.array->release();
+				if (oldArray)
+					mxDestroyArray(oldArray);
 #endif	
 
-			delete it->second;
-			it->second = var;
+				delete it->second.array;
+				it->second.array = var;
+				var->m_owner = s_instance;
+			}
 		}
 		else
 		{
 			var->m_owner = s_instance;
-			s_instance->m_variables[name] = var;
-		}
-#ifdef MATLAB_API_USE_CPP_API
-		try {
-			s_engine->setVariable(to_u16string(name.c_str()), *(var->get()));
+			it = s_instance.load()->m_variables.emplace(name, CachedVariable()).first;
+			it->second.array = var;
 		}
-		catch (const matlab::engine::EngineException& e) {
-			Logger::logError("Failed to put variable '" + name + "' into MATLAB engine. Exception: " + std::string(e.what()));
-			return false;
-		}
-#else
-		if (engPutVariable(s_engine, name.c_str(), var->get()) != 0)
-		{
-			Logger::logError("Failed to put variable '" + name + "' into MATLAB engine.");
-			return false;
-		}
-#endif	
-
-		return true;
+		return s_instance.load()->pushVariable(it->second, telemetry);
 	}
 	bool MatlabEngine::removeVariable(const std::string& name)
 	{
+		if (isAvailable() && !isEngineThread())
+			return invoke([&]() { return removeVariable(name); });
 		if (name.empty())
 			return false;
-		if (s_engine == nullptr)
+		if (s_backend == nullptr)
 		{
 			err_matlabNotStarted();
 			return false;
 		}
-		auto it = s_instance->m_variables.find(name);
-		if (it == s_instance->m_variables.end())
+		EngineTelemetry::Scope telemetry(EngineTelemetry::Operation::RemoveVariable, name);
+		auto it = s_instance.load()->m_variables.find(name);
+		if (it == s_instance.load()->m_variables.end())
 		{
 			Logger::logWarning("Variable with name '" + name + "' does not exist.");
+			telemetry.setFailed();
 			return false;
 		}
-#ifdef MATLAB_API_USE_CPP_API
-		try {
-			s_engine->eval(to_u16string(("clear " + name).c_str()));
-		}
-		catch (const matlab::engine::EngineException& e) {
-			Logger::logError("Failed to clear variable '" + name + "' from MATLAB engine. Exception: " + std::string(e.what()));
-			return false;
-		}
-#else
-		if (engEvalString(s_engine, ("clear " + name).c_str()) != 0)
+		invalidateVariableCache(); // prepared commands and remote variables may refer to the name
+		if (s_backend->eval("clear " + name) != 0)
 		{
 			Logger::logError("Failed to clear variable '" + name + "' from MATLAB engine.");
+			telemetry.setFailed();
 			return false;
 		}
-#endif
 		//mxArray* oldArray = it->second->release();
 		//if (oldArray)
 		//	mxDestroyArray(oldArray);
-		delete it->second;
-		s_instance->m_variables.erase(it);
+		delete it->second.array;
+		s_instance.load()->m_variables.erase(it);
 		return true;
 	}
-	MatlabArray* MatlabEngine::getVariable(const std::string& name)
+	MatlabArray MatlabEngine::getVariable(const std::string& name)
 	{
+		if (isAvailable() && !isEngineThread())
+			return invoke([&]() { return getVariable(name); });
 		if (name.empty())
-			return nullptr;
-		if (s_engine == nullptr)
+			return MatlabArray(name);
+		if (s_backend == nullptr)
 		{
 			err_matlabNotStarted();
-			return nullptr;
-		}
-		auto it = s_instance->m_variables.find(name);
-#ifdef MATLAB_API_USE_CPP_API
-		matlab::data::Array arr;
-		try {
-			arr = s_engine->getVariable(to_u16string(name.c_str()));
+			return MatlabArray(name);
 		}
-		catch (const matlab::engine::EngineException& e) {
-			Logger::logError("Failed to get variable '" + name + "' from MATLAB engine. Exception: " + std::string(e.what()));
-			return nullptr;
-		}
-#else
-		mxArray* arr = engGetVariable(s_engine, name.c_str());
-		if (!arr)
+		EngineTelemetry::Scope telemetry(EngineTelemetry::Operation::GetVariable, name);
+		auto it = s_instance.load()->m_variables.find(name);
+		if (it != s_instance.load()->m_variables.end())
 		{
-			Logger::logError("Failed to get variable '" + name + "' from MATLAB engine.");
-			return nullptr;
+			if (!s_instance.load()->pullVariable(it->second, telemetry))
+				return MatlabArray(name);
+			Logger::logDebug("Variable with name '" + name + "' exists, updated MatlabArray: " + it->second.array->toString());
+			// The copy is made on the engine thread, later transfers replace the data of the map entry, not of the copy
+			return *it->second.array;
 		}
-#endif
-		if (it == s_instance->m_variables.end())
+
+		// create new MatlabArray to manage this variable
+		MatlabArray* var = new MatlabArray(name);
+		var->m_owner = s_instance;
+		CachedVariable entry;
+		entry.array = var;
+		if (!s_instance.load()->pullVariable(entry, telemetry))
 		{
-			// create new MatlabArray to manage this variable
-#ifdef MATLAB_API_USE_CPP_API
-			MatlabArray* var = new MatlabArray(name, arr);
-#else
-			MatlabArray* var = new MatlabArray(name, arr, false); // do not take ownership, as engGetVariable returns a copy
-#endif
-			var->m_owner = s_instance;
-			s_instance->m_variables[name] = var;
-			Logger::logDebug("Variable with name '" + name + "' did not exist, created new MatlabArray: " + var->toString());
-			return var;
+			delete var;
+			return MatlabArray(name);
 		}
-#ifdef MATLAB_API_USE_CPP_API
-		it->second->overwrite(arr);
-#else
-		it->second->overwrite(arr, false, true); // do not take ownership, as engGetVariable returns a copy
-#endif
-		Logger::logDebug("Variable with name '" + name + "' exists, updated MatlabArray: " + it->second->toString());
-		return it->second;
+		s_instance.load()->m_variables.emplace(name, entry);
+		Logger::logDebug("Variable with name '" + name + "' did not exist, created new MatlabArray: " + var->toString());
+		return *var;
 	}
 	Matrix MatlabEngine::getMatrix(const std::string& name)
 	{
-		return Matrix(getVariable(name));
+		MatlabArray var = getVariable(name);
+		return Matrix(&var);
 	}
-#ifdef MATLAB_API_USE_CPP_API
 	MatlabArray MatlabEngine::getProperty(MatlabArray* array, const std::u16string& property)
 	{
-		return MatlabArray(array->getName()+"."+to_utf8(property), s_engine->getProperty(array->getAPIArray(), property));
+		if (isAvailable() && !isEngineThread())
+			return invoke([&]() { return getProperty(array, property); });
+		if (s_backend == nullptr)
+		{
+			err_matlabNotStarted();
+			return MatlabArray(array->getName() + "." + Utf::toUtf8(property));
+		}
+		return s_backend->getProperty(*array, Utf::toUtf8(property));
 	}
-#endif
 	std::vector<std::string> MatlabEngine::listVariables()
 	{
-		if (s_engine == nullptr)
+		if (isAvailable() && !isEngineThread())
+			return invoke([&]() { return listVariables(); });
+		if (s_backend == nullptr)
 		{
 			err_matlabNotStarted();
 			return {};
 		}
 		std::vector<std::string> names;
-		for (const auto& pair : s_instance->m_variables)
+		for (const auto& pair : s_instance.load()->m_variables)
 		{
 			names.push_back(pair.first);
 		}
 		return names;
 	}
 
-#ifdef MATLAB_API_USE_CPP_API
-	const std::unique_ptr<matlab::engine::MATLABEngine> &MatlabEngine::getEngine()
+	MatlabFuture<int> MatlabEngine::evalAsync(const std::string& command)
+	{
+		if (!isAvailable())
+		{
+			err_matlabNotStarted();
+			return MatlabFuture<int>::makeReady(-1);
+		}
+		MatlabPromise<int> promise;
+		postJob([promise, command]() mutable {
+			if (promise.isCancelled())
+				return;
+			if (s_backend == nullptr)
+			{
+				err_matlabNotStarted();
+				promise.setValue(-1);
+				return;
+			}
+			invalidateVariableCache();
+			runCancellable(promise, [&]() { return s_backend->eval(command); });
+			});
+		return promise.getFuture();
+	}
+	MatlabFuture<std::vector<MatlabArray>> MatlabEngine::fevalAsync(const std::string& function, size_t nargout, const std::vector<MatlabArray>& args)
 	{
-		return s_engine;
+		if (!isAvailable())
+		{
+			err_matlabNotStarted();
+			return MatlabFuture<std::vector<MatlabArray>>::makeReady({});
+		}
+		MatlabPromise<std::vector<MatlabArray>> promise;
+		postJob([promise, function, nargout, args]() mutable {
+			if (promise.isCancelled())
+				return;
+			if (s_backend == nullptr)
+			{
+				err_matlabNotStarted();
+				promise.setValue({});
+				return;
+			}
+			invalidateVariableCache();
+			runCancellable(promise, [&]() { return s_backend->feval(function, nargout, args); });
+			});
+		return promise.getFuture();
 	}
-#else
-	Engine* MatlabEngine::getEngine()
+	MatlabFuture<MatlabArray> MatlabEngine::getVariableAsync(const std::string& name)
 	{
-		return s_engine;
+		if (name.empty() || !isAvailable())
+		{
+			if (!isAvailable())
+				err_matlabNotStarted();
+			return MatlabFuture<MatlabArray>::makeReady(MatlabArray(name));
+		}
+		MatlabPromise<MatlabArray> promise;
+		postJob([promise, name]() mutable {
+			if (promise.isCancelled())
+				return;
+			if (s_backend == nullptr)
+			{
+				err_matlabNotStarted();
+				promise.setValue(MatlabArray(name));
+				return;
+			}
+			runCancellable(promise, [&]() { return s_backend->getVariable(name); });
+			});
+		return promise.getFuture();
+	}
+	MatlabFuture<bool> MatlabEngine::setVariableAsync(const MatlabArray& var)
+	{
+		if (!isAvailable())
+		{
+			err_matlabNotStarted();
+			return MatlabFuture<bool>::makeReady(false);
+		}
+		if (var.getName().empty() || !var.isValid())
+		{
+			Logger::logError("Variable name is empty or the array is invalid");
+			return MatlabFuture<bool>::makeReady(false);
+		}
+		MatlabPromise<bool> promise;
+		// The array may be modified by the caller before the job runs, send a snapshot
+		postJob([promise, copy = MatlabArray(var)]() mutable {
+			if (promise.isCancelled())
+				return;
+			if (s_backend == nullptr)
+			{
+				err_matlabNotStarted();
+				promise.setValue(false);
+				return;
+			}
+			const std::string& name = copy.getName();
+			invalidateVariableCache(); // the cached copy of this name is outdated
+			runCancellable(promise, [&]() { return s_backend->setVariable(name, copy); });
+			});
+		return promise.getFuture();
+	}
+	MatlabFuture<bool> MatlabEngine::setVariableSliceAsync(const std::string& name, EngineBackend::Slice slice, size_t first, const MatlabArray& values)
+	{
+		if (!isAvailable())
+		{
+			err_matlabNotStarted();
+			return MatlabFuture<bool>::makeReady(false);
+		}
+		MatlabPromise<bool> promise;
+		postJob([promise, name, slice, first, copy = MatlabArray(values)]() mutable {
+			if (promise.isCancelled())
+				return;
+			if (s_backend == nullptr)
+			{
+				err_matlabNotStarted();
+				promise.setValue(false);
+				return;
+			}
+			invalidateVariableCache();
+			runCancellable(promise, [&]() { return s_backend->setVariableSlice(name, slice, first, copy); });
+			});
+		return promise.getFuture();
+	}
+	MatlabFuture<MatlabArray> MatlabEngine::getVariableRowsAsync(const std::string& name, size_t first, size_t count)
+	{
+		if (name.empty() || !isAvailable())
+		{
+			if (!isAvailable())
+				err_matlabNotStarted();
+			return MatlabFuture<MatlabArray>::makeReady(MatlabArray(name));
+		}
+		MatlabPromise<MatlabArray> promise;
+		postJob([promise, name, first, count]() mutable {
+			if (promise.isCancelled())
+				return;
+			if (s_backend == nullptr)
+			{
+				err_matlabNotStarted();
+				promise.setValue(MatlabArray(name));
+				return;
+			}
+			runCancellable(promise, [&]() { return s_backend->getVariableRows(name, first, count); });
+			});
+		return promise.getFuture();
 	}
-#endif
 
 	bool MatlabEngine::updateVariableFromEngine(MatlabArray* var)
 	{
-		if (!var)
-			return false;
-		if (s_engine == nullptr)
+		if (isAvailable() && !isEngineThread())
+			return invoke([&]() { return updateVariableFromEngine(var); });
+		EngineTelemetry::Scope telemetry(EngineTelemetry::Operation::UpdateVariable, var ? var->getName() : "");
+		CachedVariable* entry = findCachedVariable(var);
+		if (!entry)
 		{
-			err_matlabNotStarted();
+			telemetry.setFailed();
 			return false;
 		}
-		const std::string& name = var->getName();
-		if (name.empty())
+		return s_instance.load()->pullVariable(*entry, telemetry);
+	}
+	bool MatlabEngine::sendVariableToEngine(MatlabArray* var)
+	{
+		if (isAvailable() && !isEngineThread())
+			return invoke([&]() { return sendVariableToEngine(var); });
+		EngineTelemetry::Scope telemetry(EngineTelemetry::Operation::SendVariable, var ? var->getName() : "");
+		CachedVariable* entry = findCachedVariable(var);
+		if (!entry)
 		{
-			Logger::logError("Variable name is empty");
+			telemetry.setFailed();
 			return false;
 		}
-		auto it = s_instance->m_variables.find(name);
-		if (it == s_instance->m_variables.end())
+		return s_instance.load()->pushVariable(*entry, telemetry);
+	}
+
+	bool MatlabEngine::sendRowsToEngine(MatlabArray* var, size_t first, size_t count)
+	{
+		if (isAvailable() && !isEngineThread())
+			return invoke([&]() { return sendRowsToEngine(var, first, count); });
+		EngineTelemetry::Scope telemetry(EngineTelemetry::Operation::SetVariableSlice, var ? var->getName() : "");
+		CachedVariable* entry = findCachedVariable(var);
+		if (!entry)
 		{
-			Logger::logWarning("Variable with name '" + name + "' does not exist.");
+			telemetry.setFailed();
 			return false;
 		}
-#ifdef MATLAB_API_USE_CPP_API
-		matlab::data::Array arr;
+		MatlabArray rows(var->getName());
 		try {
-			arr = s_engine->getVariable(to_u16string(name.c_str()));
+			rows = var->getRowRange(first, count);
 		}
-		catch (const matlab::engine::EngineException& e) {
-			Logger::logError("Failed to get variable '" + name + "' from MATLAB engine. Exception: " + std::string(e.what()));
+		catch (const std::exception& e) {
+			Logger::logError(e.what());
+			telemetry.setFailed();
 			return false;
 		}
-		it->second->overwrite(arr);
-#else
-		mxArray* arr = engGetVariable(s_engine, name.c_str());
-		if (!arr)
+		// The engine copy now differs from the last full transfer, the next updateToEngine() sends everything
+		invalidateVariableCache();
+		if (!s_backend->setVariableSlice(var->getName(), EngineBackend::Slice::Rows, first, rows))
 		{
-			Logger::logError("Failed to get variable '" + name + "' from MATLAB engine.");
+			telemetry.setFailed();
 			return false;
 		}
-		it->second->overwrite(arr, false, true); // do not take ownership, as engGetVariable returns a copy
-#endif
+		telemetry.addBytesToEngine(rows.getSizeInBytes());
+		++entry->version;
 		return true;
 	}
-	bool MatlabEngine::sendVariableToEngine(MatlabArray* var)
+
+	MatlabEngine::CacheStatistics MatlabEngine::getCacheStatistics()
+	{
+		if (isAvailable() && !isEngineThread())
+			return invoke([&]() { return getCacheStatistics(); });
+		if (!s_instance)
+			return CacheStatistics();
+		return s_instance.load()->m_cacheStatistics;
+	}
+	void MatlabEngine::resetCacheStatistics()
+	{
+		if (isAvailable() && !isEngineThread())
+			return invoke([&]() { return resetCacheStatistics(); });
+		if (s_instance)
+			s_instance.load()->m_cacheStatistics = CacheStatistics();
+	}
+	void MatlabEngine::invalidateVariableCache()
+	{
+		if (s_instance)
+			++s_instance.load()->m_workspaceEpoch;
+	}
+	uint64_t MatlabEngine::getWorkspaceEpoch()
+	{
+		if (!s_instance)
+			return 0;
+		return s_instance.load()->m_workspaceEpoch;
+	}
+	uint64_t MatlabEngine::getVariableVersion(const std::string& name)
+	{
+		if (isAvailable() && !isEngineThread())
+			return invoke([&]() { return getVariableVersion(name); });
+		if (!s_instance)
+			return 0;
+		auto it = s_instance.load()->m_variables.find(name);
+		if (it == s_instance.load()->m_variables.end())
+			return 0;
+		return it->second.version;
+	}
+
+	MatlabEngine::CachedVariable* MatlabEngine::findCachedVariable(MatlabArray* var)
 	{
 		if (!var)
-			return false;
-		if (s_engine == nullptr)
+			return nullptr;
+		if (s_backend == nullptr)
 		{
 			err_matlabNotStarted();
-			return false;
+			return nullptr;
 		}
 		const std::string& name = var->getName();
 		if (name.empty())
 		{
 			Logger::logError("Variable name is empty");
-			return false;
+			return nullptr;
 		}
-		auto it = s_instance->m_variables.find(name);
-		if (it == s_instance->m_variables.end())
+		auto it = s_instance.load()->m_variables.find(name);
+		if (it == s_instance.load()->m_variables.end() || it->second.array != var)
 		{
 			Logger::logWarning("Variable with name '" + name + "' does not exist.");
-			return false;
+			return nullptr;
 		}
-#ifdef MATLAB_API_USE_CPP_API
-		try {
-			s_engine->setVariable(to_u16string(name.c_str()), *(var->get()));
+		return &it->second;
+	}
+	bool MatlabEngine::isInSync(const CachedVariable& entry, uint64_t& hash, bool& hashable) const
+	{
+		hashable = entry.array->computeContentHash(hash);
+		// Every eval may have changed the workspace, so the engine copy is only known after a transfer in the current epoch
+		return entry.synced && entry.epoch == m_workspaceEpoch
+			&& hashable && entry.hashValid && entry.contentHash == hash;
+	}
+	bool MatlabEngine::pushVariable(CachedVariable& entry, EngineTelemetry::Scope& telemetry)
+	{
+		uint64_t hash = 0;
+		bool hashable = false;
+		const std::string& name = entry.array->getName();
+		if (isInSync(entry, hash, hashable))
+		{
+			++m_cacheStatistics.hits;
+			Logger::logDebug("Variable '" + name + "' is unchanged, transfer to the engine skipped");
+			return true;
 		}
-		catch (const matlab::engine::EngineException& e) {
-			Logger::logError("Failed to put variable '" + name + "' into MATLAB engine. Exception: " + std::string(e.what()));
+		++m_cacheStatistics.misses;
+		if (!sendToEngine(*entry.array))
+		{
+			entry.synced = false;
+			telemetry.setFailed();
 			return false;
 		}
-#else
-		if (engPutVariable(s_engine, name.c_str(), var->get()) != 0)
+		telemetry.addBytesToEngine(entry.array->getSizeInBytes());
+		++entry.version;
+		entry.contentHash = hash;
+		entry.hashValid = hashable;
+		entry.epoch = m_workspaceEpoch;
+		entry.synced = true;
+		return true;
+	}
+	bool MatlabEngine::pullVariable(CachedVariable& entry, EngineTelemetry::Scope& telemetry)
+	{
+		uint64_t hash = 0;
+		bool hashable = false;
+		const std::string& name = entry.array->getName();
+		if (isInSync(entry, hash, hashable))
+		{
+			++m_cacheStatistics.hits;
+			Logger::logDebug("Variable '" + name + "' is unchanged, transfer from the engine skipped");
+			return true;
+		}
+		++m_cacheStatistics.misses;
+		MatlabArray value = s_backend->getVariable(name);
+		if (!value.isValid())
 		{
-			Logger::logError("Failed to put variable '" + name + "' into MATLAB engine.");
+			telemetry.setFailed();
 			return false;
 		}
+#ifdef MATLAB_API_USE_CPP_API
+		entry.array->overwrite(value.getAPIArray());
+#else
+		entry.array->overwrite(value.release(), true, true);
 #endif
+		telemetry.addBytesFromEngine(entry.array->getSizeInBytes());
+		hashable = entry.array->computeContentHash(hash);
+		if (!entry.synced || !hashable || !entry.hashValid || hash != entry.contentHash)
+			++entry.version;
+		entry.contentHash = hash;
+		entry.hashValid = hashable;
+		entry.epoch = m_workspaceEpoch;
+		entry.synced = true;
 		return true;
 	}
 
+	bool MatlabEngine::sendToEngine(const MatlabArray& var)
+	{
+		return s_backend->setVariable(var.getName(), var);
+	}
+	MatlabArray MatlabEngine::receiveFromEngine(const std::string& name)
+	{
+		return s_backend->getVariable(name);
+	}
+	bool MatlabEngine::queryVariable(const std::string& name, EngineBackend::VariableInfo& info)
+	{
+		if (isAvailable() && !isEngineThread())
+			return invoke([&]() { return queryVariable(name, info); });
+		if (name.empty())
+			return false;
+		if (s_backend == nullptr)
+		{
+			err_matlabNotStarted();
+			return false;
+		}
+		EngineTelemetry::Scope telemetry(EngineTelemetry::Operation::QueryVariable, name);
+		bool success = s_backend->getVariableInfo(name, info);
+		telemetry.setFailed(!success);
+		return success;
+	}
+	MatlabArray MatlabEngine::receiveVariable(const std::string& name)
+	{
+		if (isAvailable() && !isEngineThread())
+			return invoke([&]() { return receiveVariable(name); });
+		if (s_backend == nullptr)
+		{
+			err_matlabNotStarted();
+			return MatlabArray(name);
+		}
+		EngineTelemetry::Scope telemetry(EngineTelemetry::Operation::GetVariable, name);
+		MatlabArray value = s_backend->getVariable(name);
+		telemetry.addBytesFromEngine(value.getSizeInBytes());
+		telemetry.setFailed(!value.isValid());
+		return value;
+	}
+	MatlabArray MatlabEngine::receiveRows(const std::string& name, size_t first, size_t count)
+	{
+		if (isAvailable() && !isEngineThread())
+			return invoke([&]() { return receiveRows(name, first, count); });
+		if (s_backend == nullptr)
+		{
+			err_matlabNotStarted();
+			return MatlabArray(name);
+		}
+		EngineTelemetry::Scope telemetry(EngineTelemetry::Operation::GetVariable, name);
+		MatlabArray value = s_backend->getVariableRows(name, first, count);
+		telemetry.addBytesFromEngine(value.getSizeInBytes());
+		telemetry.setFailed(!value.isValid());
+		return value;
+	}
+	bool MatlabEngine::setVariableSlice(const std::string& name, EngineBackend::Slice slice, size_t first, const MatlabArray& values)
+	{
+		if (isAvailable() && !isEngineThread())
+			return invoke([&]() { return setVariableSlice(name, slice, first, values); });
+		if (s_backend == nullptr)
+		{
+			err_matlabNotStarted();
+			return false;
+		}
+		EngineTelemetry::Scope telemetry(EngineTelemetry::Operation::SetVariableSlice, name);
+		invalidateVariableCache(); // the cached copy of this name is outdated
+		bool success = s_backend->setVariableSlice(name, slice, first, values);
+		if (success)
+			telemetry.addBytesToEngine(values.getSizeInBytes());
+		telemetry.setFailed(!success);
+		return success;
+	}
+	bool MatlabEngine::preallocateVariable(const MatlabArray& values, size_t rows)
+	{
+		if (isAvailable() && !isEngineThread())
+			return invoke([&]() { return preallocateVariable(values, rows); });
+		if (s_backend == nullptr)
+		{
+			err_matlabNotStarted();
+			return false;
+		}
+		EngineTelemetry::Scope telemetry(EngineTelemetry::Operation::ResizeVariable, values.getName());
+		invalidateVariableCache();
+		bool success = s_backend->setVariable(values.getName(), values)
+			&& s_backend->resizeVariableRows(values.getName(), rows);
+		if (success)
+			telemetry.addBytesToEngine(values.getSizeInBytes());
+		telemetry.setFailed(!success);
+		return success;
+	}
+	bool MatlabEngine::resizeVariable(const std::string& name, size_t rows, bool wait)
+	{
+		if (isAvailable() && !isEngineThread())
+		{
+			if (wait)
+				return invoke([&]() { return resizeVariable(name, rows, true); });
+			postJob([name, rows]() { resizeVariable(name, rows, true); });
+			return true;
+		}
+		if (s_backend == nullptr)
+		{
+			err_matlabNotStarted();
+			return false;
+		}
+		EngineTelemetry::Scope telemetry(EngineTelemetry::Operation::ResizeVariable, name);
+		invalidateVariableCache();
+		bool success = s_backend->resizeVariableRows(name, rows);
+		telemetry.setFailed(!success);
+		return success;
+	}
+	int MatlabEngine::evalScript(const std::string& script)
+	{
+		invalidateVariableCache();
+		return s_backend->eval(script);
+	}
+	void MatlabEngine::discardVariable(const std::string& name)
+	{
+		// Queued behind the current job, the result is not needed
+		evalAsync("clear " + name);
+	}
+	bool MatlabEngine::removeVariables(const std::vector<std::string>& names, bool wait)
+	{
+		if (names.empty())
+			return true;
+		if (isAvailable() && !isEngineThread())
+		{
+			if (wait)
+				return invoke([&]() { return removeVariables(names, true); });
+			postJob([names]() { removeVariables(names, true); });
+			return true;
+		}
+		if (s_backend == nullptr)
+			return false;
+		std::string command = "clear";
+		for (const std::string& name : names)
+		{
+			command += " " + name;
+			auto it = s_instance.load()->m_variables.find(name);
+			if (it != s_instance.load()->m_variables.end())
+			{
+				delete it->second.array;
+				s_instance.load()->m_variables.erase(it);
+			}
+		}
+		invalidateVariableCache();
+		if (s_backend->eval(command) != 0)
+		{
+			Logger::logError("Failed to clear the variables: " + command);
+			return false;
+		}
+		return true;
+	}
 
 	void MatlabEngine::err_matlabNotStarted()
 	{
 		Logger::logError("MATLAB engine is not started, call MatlabEngine::instantiate() first.");
 	}
 
+	MatlabArray MatlabEngine::toArgument(const Matrix& value)
+	{
+		std::unique_ptr<MatlabArray> array(value.toMatlabArray("arg"));
+		return std::move(*array);
+	}
+
+	bool MatlabEngine::isEngineThread()
+	{
+		return std::this_thread::get_id() == s_workerThreadId.load();
+	}
+	void MatlabEngine::postJob(std::function<void()>&& job)
+	{
+		{
+			std::lock_guard<std::mutex> lock(s_workerMutex);
+			s_workerStop = false;
+			s_workerJobs.emplace_back(std::move(job));
+			if (s_workerFinished && s_workerThread.joinable())
+				s_workerThread.join(); // finished by finishEngineThread(), no longer waits for jobs
+			if (!s_workerThread.joinable())
+			{
+				s_workerFinished = false;
+				s_workerThread = std::thread(&workerLoop);
+			}
+		}
+		s_workerCondition.notify_one();
+	}
+	void MatlabEngine::finishEngineThread()
+	{
+		std::lock_guard<std::mutex> lock(s_workerMutex);
+		s_workerStop = true;
+	}
+	void MatlabEngine::stopEngineThread()
+	{
+		std::thread worker;
+		{
+			std::lock_guard<std::mutex> lock(s_workerMutex);
+			if (!s_workerThread.joinable())
+				return;
+			s_workerStop = true;
+			worker = std::move(s_workerThread);
+		}
+		s_workerCondition.notify_all();
+		worker.join();
+	}
+
 }
\ No newline at end of file
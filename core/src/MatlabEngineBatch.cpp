@@ -0,0 +1,242 @@
+#include "MatlabEngine.h"
+#include "MatlabAPI_debug.h"
+#ifdef MATLAB_API_USE_CPP_API
+#include "MatlabEngine.hpp"
+#include "MatlabDataArray.hpp"
+#else
+#include "engine.h" // Matlab Engine API
+#endif
+#include <memory>
+#include <stdexcept>
+
+namespace MatlabAPI
+{
+	// Workspace variables used by the batch script
+	static const std::string s_inputVar = "matlab_api_batch_in";
+	static const std::string s_errorVar = "matlab_api_batch_err";
+	static const std::string s_outputVar = "matlab_api_batch_out";
+	static const std::string s_resultVar = "matlab_api_batch_result";
+	static const std::string s_exceptionVar = "matlab_api_batch_e";
+
+	// Converts a command into a MATLAB char expression, so that syntax errors are caught per operation
+	static std::string toCharExpression(const std::string& command)
+	{
+		std::string expr = "['";
+		for (char c : command)
+		{
+			if (c == '\'')
+				expr += "''";
+			else if (c == '\n')
+				expr += "', newline, '";
+			else if (c != '\r')
+				expr += c;
+		}
+		expr += "']";
+		return expr;
+	}
+
+	static std::string tryBlock(const std::string& statement, size_t operation)
+	{
+		std::string index = std::to_string(operation + 1);
+		return "try\n" + statement + "\ncatch " + s_exceptionVar + "\n" + s_errorVar + "{" + index + "} = " + s_exceptionVar + ".message;\nend\n";
+	}
+
+	MatlabEngine::Batch::Batch()
+	{
+
+	}
+	MatlabEngine::Batch::~Batch()
+	{
+
+	}
+
+	size_t MatlabEngine::Batch::put(const MatlabArray& value)
+	{
+		Operation op;
+		op.type = OperationType::Put;
+		op.text = value.getName();
+		op.slot = m_inputs.size();
+		m_inputs.push_back(value);
+		m_operations.push_back(op);
+		return m_operations.size() - 1;
+	}
+	size_t MatlabEngine::Batch::put(const std::string& name, const Matrix& value)
+	{
+		std::unique_ptr<MatlabArray> array(value.toMatlabArray(name));
+		return put(*array);
+	}
+	size_t MatlabEngine::Batch::eval(const std::string& command)
+	{
+		Operation op;
+		op.type = OperationType::Eval;
+		op.text = command;
+		m_operations.push_back(op);
+		return m_operations.size() - 1;
+	}
+	size_t MatlabEngine::Batch::get(const std::string& name)
+	{
+		Operation op;
+		op.type = OperationType::Get;
+		op.text = name;
+		op.slot = m_results.size();
+		m_results.push_back(MatlabArray(name));
+		m_operations.push_back(op);
+		return m_operations.size() - 1;
+	}
+
+	bool MatlabEngine::Batch::flush()
+	{
+		if (m_firstPending == m_operations.size())
+			return true;
+		if (MatlabEngine::isAvailable() && !MatlabEngine::isEngineThread())
+			return MatlabEngine::invoke([this]() { return flush(); });
+		if (!MatlabEngine::isInstantiated())
+		{
+			err_matlabNotStarted();
+			failPending("MATLAB engine is not started");
+			return false;
+		}
+
+		// Index of the first input and result slot of the pending operations
+		size_t firstInput = m_inputs.size();
+		size_t firstResult = m_results.size();
+		for (size_t i = m_firstPending; i < m_operations.size(); ++i)
+		{
+			const Operation& op = m_operations[i];
+			if (op.type == OperationType::Put && op.slot < firstInput)
+				firstInput = op.slot;
+			else if (op.type == OperationType::Get && op.slot < firstResult)
+				firstResult = op.slot;
+		}
+
+		// 1. One packed transfer for all put values
+		if (firstInput < m_inputs.size())
+		{
+			MatlabArray packed = MatlabArray::createCell(s_inputVar, 1, m_inputs.size() - firstInput);
+			for (size_t i = firstInput; i < m_inputs.size(); ++i)
+				packed.setCell(i - firstInput, m_inputs[i]);
+			if (!MatlabEngine::sendToEngine(packed))
+			{
+				failPending("Failed to transfer the batch input values");
+				return false;
+			}
+		}
+
+		// 2. One script for all operations
+		std::string script = buildScript(firstInput, firstResult);
+		if (MatlabEngine::evalScript(script) != 0)
+		{
+			failPending("Failed to evaluate the batch script");
+			MatlabEngine::evalScript("clear " + s_inputVar + " " + s_errorVar + " " + s_outputVar + " " + s_exceptionVar);
+			return false;
+		}
+
+		// 3. One packed transfer for all errors and results
+		MatlabArray result = MatlabEngine::receiveFromEngine(s_resultVar);
+		MatlabEngine::discardVariable(s_resultVar);
+		if (!result.isValid() || !result.isCell() || result.getNumberOfElements() != 2)
+		{
+			failPending("Failed to read the batch results");
+			return false;
+		}
+		MatlabArray errors = result.getCell(0);
+		MatlabArray outputs = result.getCell(1);
+
+		bool allSucceeded = true;
+		for (size_t i = m_firstPending; i < m_operations.size(); ++i)
+		{
+			Operation& op = m_operations[i];
+			MatlabArray error = errors.getCell(i - m_firstPending);
+			op.executed = true;
+			op.success = !error.isChar();
+			if (!op.success)
+			{
+				op.error = error.getString();
+				allSucceeded = false;
+				Logger::logError("Batch operation " + std::to_string(i) + " failed: " + op.error);
+			}
+			else if (op.type == OperationType::Get)
+			{
+				m_results[op.slot] = outputs.getCell(op.slot - firstResult);
+				m_results[op.slot].setName(op.text);
+			}
+		}
+		m_firstPending = m_operations.size();
+		return allSucceeded;
+	}
+
+	void MatlabEngine::Batch::clear()
+	{
+		m_operations.clear();
+		m_inputs.clear();
+		m_results.clear();
+		m_firstPending = 0;
+	}
+
+	MatlabEngine::Batch::OperationType MatlabEngine::Batch::getOperationType(size_t operation) const
+	{
+		return getOperation(operation).type;
+	}
+	bool MatlabEngine::Batch::succeeded(size_t operation) const
+	{
+		const Operation& op = getOperation(operation);
+		return op.executed && op.success;
+	}
+	const std::string& MatlabEngine::Batch::getError(size_t operation) const
+	{
+		return getOperation(operation).error;
+	}
+	const MatlabArray& MatlabEngine::Batch::getResult(size_t operation) const
+	{
+		const Operation& op = getOperation(operation);
+		if (op.type != OperationType::Get)
+			throw std::invalid_argument("Batch operation " + std::to_string(operation) + " is not a get operation");
+		return m_results[op.slot];
+	}
+
+	const MatlabEngine::Batch::Operation& MatlabEngine::Batch::getOperation(size_t operation) const
+	{
+		if (operation >= m_operations.size())
+			throw std::out_of_range("Batch operation index out of range");
+		return m_operations[operation];
+	}
+
+	std::string MatlabEngine::Batch::buildScript(size_t firstInput, size_t firstResult) const
+	{
+		size_t count = m_operations.size() - m_firstPending;
+		std::string script = s_errorVar + " = cell(1, " + std::to_string(count) + ");\n"
+			+ s_outputVar + " = cell(1, " + std::to_string(m_results.size() - firstResult) + ");\n";
+		for (size_t i = m_firstPending; i < m_operations.size(); ++i)
+		{
+			const Operation& op = m_operations[i];
+			size_t index = i - m_firstPending;
+			switch (op.type)
+			{
+			case OperationType::Put:
+				script += tryBlock(op.text + " = " + s_inputVar + "{" + std::to_string(op.slot - firstInput + 1) + "};", index);
+				break;
+			case OperationType::Eval:
+				script += tryBlock("eval(" + toCharExpression(op.text) + ");", index);
+				break;
+			case OperationType::Get:
+				script += tryBlock(s_outputVar + "{" + std::to_string(op.slot - firstResult + 1) + "} = " + op.text + ";", index);
+				break;
+			}
+		}
+		script += s_resultVar + " = {" + s_errorVar + ", " + s_outputVar + "};\n";
+		script += "clear " + s_inputVar + " " + s_errorVar + " " + s_outputVar + " " + s_exceptionVar + "\n";
+		return script;
+	}
+
+	void MatlabEngine::Batch::failPending(const std::string& error)
+	{
+		for (size_t i = m_firstPending; i < m_operations.size(); ++i)
+		{
+			m_operations[i].executed = true;
+			m_operations[i].success = false;
+			m_operations[i].error = error;
+		}
+		m_firstPending = m_operations.size();
+		Logger::logError("Batch: " + error);
+	}
+}
@@ -0,0 +1,68 @@
+#include "MatlabEngine.h"
+#include "MatlabAPI_debug.h"
+#include <algorithm>
+
+namespace MatlabAPI
+{
+	MatlabEngine::GrowingVariable::GrowingVariable(const std::string& name, size_t initialCapacity)
+		: m_name(name)
+		, m_initialCapacity(std::max<size_t>(initialCapacity, 1))
+	{}
+	MatlabEngine::GrowingVariable::~GrowingVariable()
+	{
+		if (m_rows < m_capacity && isAvailable())
+			MatlabEngine::resizeVariable(m_name, m_rows, false);
+	}
+
+	bool MatlabEngine::GrowingVariable::append(const MatlabArray& rows)
+	{
+		if (!rows.isValid())
+		{
+			Logger::logError("GrowingVariable '" + m_name + "': invalid rows");
+			return false;
+		}
+		size_t count = rows.getM();
+		if (count == 0)
+			return true;
+		size_t cols = rows.getNumberOfElements() / count;
+		if (m_capacity == 0)
+		{
+			size_t capacity = std::max(m_initialCapacity, count);
+			MatlabArray values(rows);
+			values.setName(m_name);
+			if (!preallocateVariable(values, capacity))
+				return false;
+			m_rows = count;
+			m_cols = cols;
+			m_capacity = capacity;
+			return true;
+		}
+		if (cols != m_cols)
+		{
+			Logger::logError("GrowingVariable '" + m_name + "': " + std::to_string(cols) + " columns appended to "
+				+ std::to_string(m_cols));
+			return false;
+		}
+		if (m_rows + count > m_capacity)
+		{
+			size_t capacity = std::max(2 * m_capacity, m_rows + count);
+			if (!resizeVariable(m_name, capacity, true))
+				return false;
+			m_capacity = capacity;
+		}
+		if (!setVariableSlice(m_name, EngineBackend::Slice::Rows, m_rows, rows))
+			return false;
+		m_rows += count;
+		return true;
+	}
+
+	bool MatlabEngine::GrowingVariable::trim()
+	{
+		if (m_rows == m_capacity)
+			return true;
+		if (!resizeVariable(m_name, m_rows, true))
+			return false;
+		m_capacity = m_rows;
+		return true;
+	}
+}
@@ -0,0 +1,326 @@
+#include "MatlabEngine.h"
+#include "MatlabAPI_debug.h"
+#include <atomic>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+
+namespace MatlabAPI
+{
+	// Prefix of the generated scripts and of the workspace variables holding the parameter values
+	static const std::string s_preparedPrefix = "matlab_api_prepared_";
+	static std::atomic<size_t> s_preparedCount{ 0 };
+
+	struct MatlabEngine::PreparedCommand::State
+	{
+		std::string command;                 // template as passed to prepare()
+		std::vector<std::string> parameters; // names without $
+		std::vector<MatlabArray> values;     // named after the workspace variables
+		std::vector<bool> bound;
+		std::vector<bool> dirty;             // bound to another value since the last transfer
+		std::vector<bool> hashed;            // content hash of the transferred value is known
+		std::vector<uint64_t> hashes;
+		uint64_t epoch = 0;                  // workspace epoch after the last execution
+
+		std::string name;      // name of the generated script and prefix of the variables
+		std::string statement; // template with the parameters replaced by the workspace variables
+		std::filesystem::path script;
+		bool compiled = false;
+
+		~State();
+		std::string getVariableName(size_t parameter) const { return name + "_p" + std::to_string(parameter + 1); }
+		size_t indexOf(const std::string& parameter) const;
+		void rewrite();
+		bool compile();
+		int execute();
+	};
+
+	static bool isIdentifierChar(char c)
+	{
+		return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+	}
+
+	// Random token of this process in the names of the scripts, variables and the script directory.
+	// Processes sharing one MATLAB session (connectMATLAB) must not run each other's scripts.
+	static const std::string& getProcessToken()
+	{
+		static const std::string token = []() {
+			std::random_device random;
+			std::ostringstream oss;
+			oss << std::hex << ((static_cast<uint64_t>(random()) << 32) | random());
+			return oss.str();
+		}();
+		return token;
+	}
+
+	// Directory of the generated scripts, one per process, added to the MATLAB path by compile()
+	// and removed when the process exits
+	struct ScriptDirectory
+	{
+		std::filesystem::path path;
+
+		ScriptDirectory()
+		{
+			std::error_code error;
+			path = std::filesystem::temp_directory_path(error) / ("matlab_api_" + getProcessToken());
+			if (error || !std::filesystem::create_directories(path, error))
+				path.clear();
+		}
+		~ScriptDirectory()
+		{
+			std::error_code error;
+			if (!path.empty())
+				std::filesystem::remove_all(path, error);
+		}
+	};
+	static const std::filesystem::path& getScriptDirectory()
+	{
+		static const ScriptDirectory directory;
+		return directory.path;
+	}
+
+	// Converts a path into a MATLAB char literal
+	static std::string toCharLiteral(const std::string& text)
+	{
+		std::string literal = "'";
+		for (char c : text)
+		{
+			if (c == '\'')
+				literal += "''";
+			else
+				literal += c;
+		}
+		return literal + "'";
+	}
+
+	MatlabEngine::PreparedCommand::State::~State()
+	{
+		if (!script.empty())
+		{
+			std::error_code error;
+			std::filesystem::remove(script, error);
+		}
+		if (!MatlabEngine::isAvailable())
+			return;
+		std::string variables;
+		for (size_t i = 0; i < parameters.size(); ++i)
+			variables += " " + getVariableName(i);
+		if (!variables.empty())
+			MatlabEngine::evalAsync("clear" + variables);
+	}
+
+	size_t MatlabEngine::PreparedCommand::State::indexOf(const std::string& parameter) const
+	{
+		for (size_t i = 0; i < parameters.size(); ++i)
+			if (parameters[i] == parameter)
+				return i;
+		throw std::invalid_argument("Prepared command '" + command + "' has no parameter $" + parameter);
+	}
+
+	void MatlabEngine::PreparedCommand::State::rewrite()
+	{
+		// Replaces $name outside of char and string literals
+		statement.clear();
+		char quote = 0;
+		for (size_t i = 0; i < command.size(); ++i)
+		{
+			char c = command[i];
+			if (quote)
+			{
+				statement += c;
+				if (c == quote)
+					quote = 0;
+				continue;
+			}
+			if (c == '"' || (c == '\'' && (statement.empty() || !(isIdentifierChar(statement.back()) || std::string(")]}.'").find(statement.back()) != std::string::npos))))
+			{
+				quote = c; // otherwise ' is the transpose operator
+				statement += c;
+				continue;
+			}
+			if (c != '$' || i + 1 >= command.size() || !(std::isalpha(static_cast<unsigned char>(command[i + 1])) || command[i + 1] == '_'))
+			{
+				statement += c;
+				continue;
+			}
+			size_t end = i + 1;
+			while (end < command.size() && isIdentifierChar(command[end]))
+				++end;
+			std::string parameter = command.substr(i + 1, end - i - 1);
+			size_t index = parameters.size();
+			for (size_t j = 0; j < parameters.size(); ++j)
+				if (parameters[j] == parameter)
+					index = j;
+			if (index == parameters.size())
+				parameters.push_back(parameter);
+			statement += getVariableName(index);
+			i = end - 1;
+		}
+		values.clear();
+		for (size_t i = 0; i < parameters.size(); ++i)
+			values.emplace_back(getVariableName(i));
+		bound.assign(parameters.size(), false);
+		dirty.assign(parameters.size(), false);
+		hashed.assign(parameters.size(), false);
+		hashes.assign(parameters.size(), 0);
+	}
+
+	bool MatlabEngine::PreparedCommand::State::compile()
+	{
+		// Scripts are only visible to a MATLAB process on this machine
+		if (!MatlabEngine::getBackend()->isNative())
+			return false;
+		const std::filesystem::path& directory = getScriptDirectory();
+		if (directory.empty())
+			return false;
+		std::filesystem::path path = directory / (name + ".m");
+		{
+			std::ofstream file(path);
+			if (!file)
+				return false;
+			file << "% Generated by MatlabAPI from: " << command.substr(0, command.find('\n')) << "\n";
+			file << statement << "\n";
+			if (!file)
+				return false;
+		}
+		script = path;
+		// rehash picks up the new file even if the directory is already on the path
+		if (MatlabEngine::evalScript("addpath(" + toCharLiteral(directory.string()) + "); rehash;") != 0)
+		{
+			Logger::logWarning("Prepared command: failed to add the script directory to the MATLAB path, evaluating '" + command + "' instead");
+			return false;
+		}
+		return true;
+	}
+
+	int MatlabEngine::PreparedCommand::State::execute()
+	{
+		EngineTelemetry::Scope telemetry(EngineTelemetry::Operation::Eval);
+		// Other commands may have cleared or overwritten the parameter variables since the last execution
+		if (epoch != MatlabEngine::getWorkspaceEpoch())
+			dirty.assign(parameters.size(), true);
+		for (size_t i = 0; i < parameters.size(); ++i)
+		{
+			if (!bound[i])
+			{
+				Logger::logError("Prepared command '" + command + "': parameter $" + parameters[i] + " is not bound");
+				telemetry.setFailed();
+				return -1;
+			}
+			if (!dirty[i])
+				continue;
+			if (!MatlabEngine::sendToEngine(values[i]))
+			{
+				telemetry.setFailed();
+				return -1;
+			}
+			telemetry.addBytesToEngine(values[i].getSizeInBytes());
+			dirty[i] = false;
+			hashed[i] = values[i].computeContentHash(hashes[i]);
+		}
+		int ret = MatlabEngine::evalScript(compiled ? name : statement);
+		epoch = MatlabEngine::getWorkspaceEpoch();
+		if (ret != 0)
+		{
+			// The command may have cleared the parameter variables, transfer all of them next time
+			dirty.assign(parameters.size(), true);
+			hashed.assign(parameters.size(), false);
+			telemetry.setFailed();
+		}
+		return ret;
+	}
+
+	// ===== PreparedCommand =====
+
+	MatlabEngine::PreparedCommand::PreparedCommand()
+	{
+
+	}
+	MatlabEngine::PreparedCommand::PreparedCommand(std::shared_ptr<State> state)
+		: m_state(std::move(state))
+	{
+
+	}
+	MatlabEngine::PreparedCommand::~PreparedCommand()
+	{
+
+	}
+
+	bool MatlabEngine::PreparedCommand::isCompiled() const
+	{
+		return m_state && m_state->compiled;
+	}
+	const std::string& MatlabEngine::PreparedCommand::getCommand() const
+	{
+		static const std::string empty;
+		return m_state ? m_state->command : empty;
+	}
+	const std::vector<std::string>& MatlabEngine::PreparedCommand::getParameterNames() const
+	{
+		static const std::vector<std::string> empty;
+		return m_state ? m_state->parameters : empty;
+	}
+
+	MatlabEngine::PreparedCommand& MatlabEngine::PreparedCommand::bind(const std::string& parameter, const MatlabArray& value)
+	{
+		if (!m_state)
+			throw std::invalid_argument("Prepared command is not valid");
+		size_t index = m_state->indexOf(parameter);
+		m_state->values[index] = value;
+		m_state->values[index].setName(m_state->getVariableName(index));
+		m_state->bound[index] = true;
+		// A value equal to the one in the workspace is not transferred again
+		uint64_t hash = 0;
+		m_state->dirty[index] = !m_state->hashed[index] || !value.computeContentHash(hash) || hash != m_state->hashes[index];
+		return *this;
+	}
+
+	int MatlabEngine::PreparedCommand::execute()
+	{
+		if (!m_state)
+		{
+			Logger::logError("Prepared command is not valid");
+			return -1;
+		}
+		if (MatlabEngine::isAvailable() && !MatlabEngine::isEngineThread())
+			return MatlabEngine::invoke([this]() { return execute(); });
+		if (!MatlabEngine::isInstantiated())
+		{
+			err_matlabNotStarted();
+			return -1;
+		}
+		return m_state->execute();
+	}
+	int MatlabEngine::PreparedCommand::execute(const std::vector<MatlabArray>& values)
+	{
+		if (!m_state)
+			throw std::invalid_argument("Prepared command is not valid");
+		if (values.size() != m_state->parameters.size())
+			throw std::invalid_argument("Prepared command '" + m_state->command + "' expects " + std::to_string(m_state->parameters.size())
+										+ " values, got " + std::to_string(values.size()));
+		for (size_t i = 0; i < values.size(); ++i)
+			bind(m_state->parameters[i], values[i]);
+		return execute();
+	}
+
+	MatlabEngine::PreparedCommand MatlabEngine::prepare(const std::string& command)
+	{
+		if (isAvailable() && !isEngineThread())
+			return invoke([&]() { return prepare(command); });
+		if (getBackend() == nullptr)
+		{
+			err_matlabNotStarted();
+			return PreparedCommand();
+		}
+		std::shared_ptr<PreparedCommand::State> state = std::make_shared<PreparedCommand::State>();
+		state->command = command;
+		state->name = s_preparedPrefix + getProcessToken() + "_" + std::to_string(++s_preparedCount);
+		state->rewrite();
+		state->compiled = state->compile();
+		Logger::logDebug("Prepared command '" + command + "' as " + (state->compiled ? "script " + state->name : "'" + state->statement + "'"));
+		return PreparedCommand(state);
+	}
+}
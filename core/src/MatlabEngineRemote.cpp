@@ -0,0 +1,71 @@
+#include "MatlabEngine.h"
+#include "MatlabAPI_debug.h"
+
+namespace MatlabAPI
+{
+	MatlabEngine::RemoteVariable::RemoteVariable()
+		: m_data("")
+	{}
+	MatlabEngine::RemoteVariable::RemoteVariable(const std::string& name)
+		: m_name(name)
+		, m_data(name)
+	{}
+
+	MatlabEngine::RemoteVariable MatlabEngine::getRemoteVariable(const std::string& name)
+	{
+		RemoteVariable variable(name);
+		variable.refresh();
+		return variable;
+	}
+
+	bool MatlabEngine::RemoteVariable::isCurrent() const
+	{
+		return m_valid && m_epoch == getWorkspaceEpoch();
+	}
+
+	const MatlabArray& MatlabEngine::RemoteVariable::getData()
+	{
+		if (m_valid && !m_data.isValid())
+		{
+			MatlabArray value = receiveVariable(m_name);
+			value.setName(m_name);
+			m_data = std::move(value);
+		}
+		return m_data;
+	}
+
+	MatlabArray MatlabEngine::RemoteVariable::getRowRange(size_t first, size_t count) const
+	{
+		if (!m_valid)
+		{
+			Logger::logError("RemoteVariable '" + m_name + "' does not exist");
+			return MatlabArray(m_name);
+		}
+		if (first + count > getRows())
+		{
+			Logger::logError("Rows " + std::to_string(first) + " to " + std::to_string(first + count) + " exceed the "
+				+ std::to_string(getRows()) + " rows of '" + m_name + "'");
+			return MatlabArray(m_name);
+		}
+		if (m_data.isValid())
+		{
+			try {
+				return m_data.getRowRange(first, count);
+			}
+			catch (const std::exception& e) {
+				Logger::logError(e.what());
+				return MatlabArray(m_name);
+			}
+		}
+		return receiveRows(m_name, first, count);
+	}
+
+	bool MatlabEngine::RemoteVariable::refresh()
+	{
+		m_data = MatlabArray(m_name);
+		m_epoch = getWorkspaceEpoch();
+		m_info = EngineBackend::VariableInfo();
+		m_valid = queryVariable(m_name, m_info);
+		return m_valid;
+	}
+}
@@ -0,0 +1,58 @@
+#include "MatlabEngine.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+
+namespace MatlabAPI
+{
+	static std::atomic<size_t> s_scopeCount{ 0 };
+	static thread_local MatlabEngine::WorkspaceScope* s_currentScope = nullptr;
+
+	// namelengthmax of MATLAB
+	static const size_t s_maxNameLength = 63;
+
+	MatlabEngine::WorkspaceScope::WorkspaceScope()
+		: m_prefix("matlab_api_ws" + std::to_string(++s_scopeCount) + "_")
+		, m_parent(s_currentScope)
+	{
+		s_currentScope = this;
+	}
+	MatlabEngine::WorkspaceScope::~WorkspaceScope()
+	{
+		if (s_currentScope == this)
+			s_currentScope = m_parent;
+		else
+			Logger::logWarning("WorkspaceScope: scopes destroyed out of order");
+		MatlabEngine::removeVariables(m_names, false);
+	}
+
+	std::string MatlabEngine::WorkspaceScope::getName(const std::string& hint)
+	{
+		std::string name = m_prefix;
+		for (char c : hint)
+			name += std::isalnum(static_cast<unsigned char>(c)) ? c : '_';
+		if (name.size() > s_maxNameLength)
+			name.resize(s_maxNameLength);
+		track(name);
+		return name;
+	}
+
+	void MatlabEngine::WorkspaceScope::track(const std::string& name)
+	{
+		if (name.empty() || std::find(m_names.begin(), m_names.end(), name) != m_names.end())
+			return;
+		m_names.push_back(name);
+	}
+
+	bool MatlabEngine::WorkspaceScope::clear()
+	{
+		bool success = MatlabEngine::removeVariables(m_names, true);
+		m_names.clear();
+		return success;
+	}
+
+	MatlabEngine::WorkspaceScope* MatlabEngine::WorkspaceScope::getCurrent()
+	{
+		return s_currentScope;
+	}
+}
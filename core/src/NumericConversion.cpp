@@ -0,0 +1,302 @@
+#include "NumericConversion.h"
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define MATLAB_API_CONVERSION_AVX2
+#define MATLAB_API_CONVERSION_SSE2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MATLAB_API_CONVERSION_SSE2
+#endif
+
+namespace MatlabAPI
+{
+	static_assert(sizeof(bool) == 1, "logical arrays are converted as uint8");
+
+	// ===== Scalar tails =====
+
+	template<typename T>
+	static void convertScalar(const T* source, size_t begin, size_t count, double* target, double scale, double offset)
+	{
+		for (size_t i = begin; i < count; ++i)
+			target[i] = static_cast<double>(source[i]) * scale + offset;
+	}
+
+	// ===== Vector kernels =====
+	// Each kernel converts the largest multiple of its width and returns the number of converted elements
+
+#if defined(MATLAB_API_CONVERSION_AVX2)
+	static const size_t s_width = 8;
+
+	// 8 int32 lanes -> 8 doubles
+	static inline void storeInt32(__m256i values, double* target, __m256d scale, __m256d offset)
+	{
+		__m256d low = _mm256_cvtepi32_pd(_mm256_castsi256_si128(values));
+		__m256d high = _mm256_cvtepi32_pd(_mm256_extracti128_si256(values, 1));
+		_mm256_storeu_pd(target, _mm256_add_pd(_mm256_mul_pd(low, scale), offset));
+		_mm256_storeu_pd(target + 4, _mm256_add_pd(_mm256_mul_pd(high, scale), offset));
+	}
+
+	// 8 uint32 lanes -> 8 doubles. x ^ 2^31 fits into int32, adding 2^31 back as double is exact
+	// and keeps the rounding of x * scale + offset
+	static inline void storeUInt32(__m256i values, double* target, __m256d scale, __m256d offset)
+	{
+		__m256i biased = _mm256_xor_si256(values, _mm256_set1_epi32(INT32_MIN));
+		__m256d bias = _mm256_set1_pd(2147483648.0);
+		__m256d low = _mm256_add_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(biased)), bias);
+		__m256d high = _mm256_add_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(biased, 1)), bias);
+		_mm256_storeu_pd(target, _mm256_add_pd(_mm256_mul_pd(low, scale), offset));
+		_mm256_storeu_pd(target + 4, _mm256_add_pd(_mm256_mul_pd(high, scale), offset));
+	}
+
+	template<typename T>
+	static inline __m256i loadInt32(const T* source);
+	template<> inline __m256i loadInt32(const int8_t* source)   { return _mm256_cvtepi8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(source))); }
+	template<> inline __m256i loadInt32(const uint8_t* source)  { return _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(source))); }
+	template<> inline __m256i loadInt32(const int16_t* source)  { return _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(source))); }
+	template<> inline __m256i loadInt32(const uint16_t* source) { return _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(source))); }
+	template<> inline __m256i loadInt32(const int32_t* source)  { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source)); }
+
+	template<typename T>
+	static size_t convertVector(const T* source, size_t count, double* target, double scale, double offset)
+	{
+		__m256d s = _mm256_set1_pd(scale);
+		__m256d o = _mm256_set1_pd(offset);
+		size_t i = 0;
+		for (; i + s_width <= count; i += s_width)
+			storeInt32(loadInt32(source + i), target + i, s, o);
+		return i;
+	}
+	static size_t convertVector(const uint32_t* source, size_t count, double* target, double scale, double offset)
+	{
+		__m256d s = _mm256_set1_pd(scale);
+		__m256d o = _mm256_set1_pd(offset);
+		size_t i = 0;
+		for (; i + s_width <= count; i += s_width)
+			storeUInt32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i)), target + i, s, o);
+		return i;
+	}
+	static size_t convertVector(const float* source, size_t count, double* target, double scale, double offset)
+	{
+		__m256d s = _mm256_set1_pd(scale);
+		__m256d o = _mm256_set1_pd(offset);
+		size_t i = 0;
+		for (; i + s_width <= count; i += s_width)
+		{
+			__m256d low = _mm256_cvtps_pd(_mm_loadu_ps(source + i));
+			__m256d high = _mm256_cvtps_pd(_mm_loadu_ps(source + i + 4));
+			_mm256_storeu_pd(target + i, _mm256_add_pd(_mm256_mul_pd(low, s), o));
+			_mm256_storeu_pd(target + i + 4, _mm256_add_pd(_mm256_mul_pd(high, s), o));
+		}
+		return i;
+	}
+	static size_t convertVector(const double* source, size_t count, double* target, double scale, double offset)
+	{
+		__m256d s = _mm256_set1_pd(scale);
+		__m256d o = _mm256_set1_pd(offset);
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4)
+			_mm256_storeu_pd(target + i, _mm256_add_pd(_mm256_mul_pd(_mm256_loadu_pd(source + i), s), o));
+		return i;
+	}
+	static size_t convertVector(const double* source, size_t count, float* target)
+	{
+		size_t i = 0;
+		for (; i + s_width <= count; i += s_width)
+		{
+			_mm_storeu_ps(target + i, _mm256_cvtpd_ps(_mm256_loadu_pd(source + i)));
+			_mm_storeu_ps(target + i + 4, _mm256_cvtpd_ps(_mm256_loadu_pd(source + i + 4)));
+		}
+		return i;
+	}
+#elif defined(MATLAB_API_CONVERSION_SSE2)
+	static const size_t s_width = 4;
+
+	// 4 int32 lanes -> 4 doubles
+	static inline void storeInt32(__m128i values, double* target, __m128d scale, __m128d offset)
+	{
+		__m128d low = _mm_cvtepi32_pd(values);
+		__m128d high = _mm_cvtepi32_pd(_mm_shuffle_epi32(values, 0x4E));
+		_mm_storeu_pd(target, _mm_add_pd(_mm_mul_pd(low, scale), offset));
+		_mm_storeu_pd(target + 2, _mm_add_pd(_mm_mul_pd(high, scale), offset));
+	}
+
+	// 4 uint32 lanes -> 4 doubles. x ^ 2^31 fits into int32, adding 2^31 back as double is exact
+	// and keeps the rounding of x * scale + offset
+	static inline void storeUInt32(__m128i values, double* target, __m128d scale, __m128d offset)
+	{
+		__m128i biased = _mm_xor_si128(values, _mm_set1_epi32(INT32_MIN));
+		__m128d bias = _mm_set1_pd(2147483648.0);
+		__m128d low = _mm_add_pd(_mm_cvtepi32_pd(biased), bias);
+		__m128d high = _mm_add_pd(_mm_cvtepi32_pd(_mm_shuffle_epi32(biased, 0x4E)), bias);
+		_mm_storeu_pd(target, _mm_add_pd(_mm_mul_pd(low, scale), offset));
+		_mm_storeu_pd(target + 2, _mm_add_pd(_mm_mul_pd(high, scale), offset));
+	}
+
+	static inline __m128i loadLow32(const void* source)
+	{
+		int32_t bits;
+		std::memcpy(&bits, source, sizeof(bits));
+		return _mm_cvtsi32_si128(bits);
+	}
+
+	// SSE2 has no sign or zero extension instructions, the lanes are widened by interleaving
+	template<typename T>
+	static inline __m128i loadInt32(const T* source);
+	template<> inline __m128i loadInt32(const int8_t* source)
+	{
+		__m128i bytes = loadLow32(source);
+		__m128i words = _mm_unpacklo_epi8(bytes, bytes);
+		return _mm_srai_epi32(_mm_unpacklo_epi16(words, words), 24);
+	}
+	template<> inline __m128i loadInt32(const uint8_t* source)
+	{
+		__m128i zero = _mm_setzero_si128();
+		return _mm_unpacklo_epi16(_mm_unpacklo_epi8(loadLow32(source), zero), zero);
+	}
+	template<> inline __m128i loadInt32(const int16_t* source)
+	{
+		__m128i words = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(source));
+		return _mm_srai_epi32(_mm_unpacklo_epi16(words, words), 16);
+	}
+	template<> inline __m128i loadInt32(const uint16_t* source)
+	{
+		return _mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(source)), _mm_setzero_si128());
+	}
+	template<> inline __m128i loadInt32(const int32_t* source)
+	{
+		return _mm_loadu_si128(reinterpret_cast<const __m128i*>(source));
+	}
+
+	template<typename T>
+	static size_t convertVector(const T* source, size_t count, double* target, double scale, double offset)
+	{
+		__m128d s = _mm_set1_pd(scale);
+		__m128d o = _mm_set1_pd(offset);
+		size_t i = 0;
+		for (; i + s_width <= count; i += s_width)
+			storeInt32(loadInt32(source + i), target + i, s, o);
+		return i;
+	}
+	static size_t convertVector(const uint32_t* source, size_t count, double* target, double scale, double offset)
+	{
+		__m128d s = _mm_set1_pd(scale);
+		__m128d o = _mm_set1_pd(offset);
+		size_t i = 0;
+		for (; i + s_width <= count; i += s_width)
+			storeUInt32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i)), target + i, s, o);
+		return i;
+	}
+	static size_t convertVector(const float* source, size_t count, double* target, double scale, double offset)
+	{
+		__m128d s = _mm_set1_pd(scale);
+		__m128d o = _mm_set1_pd(offset);
+		size_t i = 0;
+		for (; i + s_width <= count; i += s_width)
+		{
+			__m128 values = _mm_loadu_ps(source + i);
+			__m128d low = _mm_cvtps_pd(values);
+			__m128d high = _mm_cvtps_pd(_mm_movehl_ps(values, values));
+			_mm_storeu_pd(target + i, _mm_add_pd(_mm_mul_pd(low, s), o));
+			_mm_storeu_pd(target + i + 2, _mm_add_pd(_mm_mul_pd(high, s), o));
+		}
+		return i;
+	}
+	static size_t convertVector(const double* source, size_t count, double* target, double scale, double offset)
+	{
+		__m128d s = _mm_set1_pd(scale);
+		__m128d o = _mm_set1_pd(offset);
+		size_t i = 0;
+		for (; i + 2 <= count; i += 2)
+			_mm_storeu_pd(target + i, _mm_add_pd(_mm_mul_pd(_mm_loadu_pd(source + i), s), o));
+		return i;
+	}
+	static size_t convertVector(const double* source, size_t count, float* target)
+	{
+		size_t i = 0;
+		for (; i + s_width <= count; i += s_width)
+		{
+			__m128 low = _mm_cvtpd_ps(_mm_loadu_pd(source + i));
+			__m128 high = _mm_cvtpd_ps(_mm_loadu_pd(source + i + 2));
+			_mm_storeu_ps(target + i, _mm_movelh_ps(low, high));
+		}
+		return i;
+	}
+#else
+	template<typename T>
+	static size_t convertVector(const T*, size_t, double*, double, double)
+	{
+		return 0;
+	}
+	static size_t convertVector(const double*, size_t, float*)
+	{
+		return 0;
+	}
+#endif
+
+	template<typename T>
+	static void convert(const T* source, size_t count, double* target, double scale, double offset)
+	{
+		size_t converted = convertVector(source, count, target, scale, offset);
+		convertScalar(source, converted, count, target, scale, offset);
+	}
+
+	void NumericConversion::toDouble(const double* source, size_t count, double* target, double scale, double offset)
+	{
+		if (scale == 1.0 && offset == 0.0)
+		{
+			if (count > 0 && source != target)
+				std::memcpy(target, source, count * sizeof(double));
+			return;
+		}
+		convert(source, count, target, scale, offset);
+	}
+	void NumericConversion::toDouble(const float* source, size_t count, double* target, double scale, double offset)
+	{
+		convert(source, count, target, scale, offset);
+	}
+	void NumericConversion::toDouble(const int8_t* source, size_t count, double* target, double scale, double offset)
+	{
+		convert(source, count, target, scale, offset);
+	}
+	void NumericConversion::toDouble(const uint8_t* source, size_t count, double* target, double scale, double offset)
+	{
+		convert(source, count, target, scale, offset);
+	}
+	void NumericConversion::toDouble(const int16_t* source, size_t count, double* target, double scale, double offset)
+	{
+		convert(source, count, target, scale, offset);
+	}
+	void NumericConversion::toDouble(const uint16_t* source, size_t count, double* target, double scale, double offset)
+	{
+		convert(source, count, target, scale, offset);
+	}
+	void NumericConversion::toDouble(const int32_t* source, size_t count, double* target, double scale, double offset)
+	{
+		convert(source, count, target, scale, offset);
+	}
+	void NumericConversion::toDouble(const uint32_t* source, size_t count, double* target, double scale, double offset)
+	{
+		convert(source, count, target, scale, offset);
+	}
+	void NumericConversion::toDouble(const int64_t* source, size_t count, double* target, double scale, double offset)
+	{
+		convertScalar(source, 0, count, target, scale, offset);
+	}
+	void NumericConversion::toDouble(const uint64_t* source, size_t count, double* target, double scale, double offset)
+	{
+		convertScalar(source, 0, count, target, scale, offset);
+	}
+	void NumericConversion::toDouble(const bool* source, size_t count, double* target, double scale, double offset)
+	{
+		convert(reinterpret_cast<const uint8_t*>(source), count, target, scale, offset);
+	}
+
+	void NumericConversion::toSingle(const double* source, size_t count, float* target)
+	{
+		size_t i = convertVector(source, count, target);
+		for (; i < count; ++i)
+			target[i] = static_cast<float>(source[i]);
+	}
+}
@@ -0,0 +1,284 @@
+#include "Utf.h"
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define MATLAB_API_UTF_AVX2
+#define MATLAB_API_UTF_SSE2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MATLAB_API_UTF_SSE2
+#endif
+
+namespace MatlabAPI
+{
+	static const char32_t s_replacementCharacter = 0xFFFD;
+
+	// ===== Scalar decoder / encoder =====
+
+	/**
+	 * @brief Decodes the code point at data[pos] and advances pos.
+	 *        Invalid sequences yield U+FFFD and consume one byte.
+	 */
+	static char32_t decodeUtf8(const unsigned char* data, size_t size, size_t& pos)
+	{
+		unsigned char lead = data[pos];
+		if (lead < 0x80)
+		{
+			++pos;
+			return lead;
+		}
+		size_t length;
+		char32_t codePoint;
+		char32_t minimum;
+		if ((lead & 0xE0) == 0xC0)      { length = 2; codePoint = lead & 0x1F; minimum = 0x80; }
+		else if ((lead & 0xF0) == 0xE0) { length = 3; codePoint = lead & 0x0F; minimum = 0x800; }
+		else if ((lead & 0xF8) == 0xF0) { length = 4; codePoint = lead & 0x07; minimum = 0x10000; }
+		else
+		{
+			++pos;
+			return s_replacementCharacter;
+		}
+		if (pos + length > size)
+		{
+			++pos;
+			return s_replacementCharacter;
+		}
+		for (size_t i = 1; i < length; ++i)
+		{
+			unsigned char next = data[pos + i];
+			if ((next & 0xC0) != 0x80)
+			{
+				++pos;
+				return s_replacementCharacter;
+			}
+			codePoint = (codePoint << 6) | (next & 0x3F);
+		}
+		if (codePoint < minimum || codePoint > 0x10FFFF || (codePoint >= 0xD800 && codePoint <= 0xDFFF))
+		{
+			++pos;
+			return s_replacementCharacter;
+		}
+		pos += length;
+		return codePoint;
+	}
+	static char16_t* encodeUtf16(char32_t codePoint, char16_t* out)
+	{
+		if (codePoint < 0x10000)
+		{
+			*out++ = static_cast<char16_t>(codePoint);
+			return out;
+		}
+		codePoint -= 0x10000;
+		*out++ = static_cast<char16_t>(0xD800 | (codePoint >> 10));
+		*out++ = static_cast<char16_t>(0xDC00 | (codePoint & 0x3FF));
+		return out;
+	}
+
+	/**
+	 * @brief Decodes the code point at data[pos] and advances pos.
+	 *        Unpaired surrogates yield U+FFFD.
+	 */
+	static char32_t decodeUtf16(const char16_t* data, size_t size, size_t& pos)
+	{
+		char32_t unit = data[pos++];
+		if (unit < 0xD800 || unit > 0xDFFF)
+			return unit;
+		if (unit <= 0xDBFF && pos < size && data[pos] >= 0xDC00 && data[pos] <= 0xDFFF)
+			return 0x10000 + ((unit - 0xD800) << 10) + (data[pos++] - 0xDC00);
+		return s_replacementCharacter;
+	}
+	static char* encodeUtf8(char32_t codePoint, char* out)
+	{
+		if (codePoint < 0x80)
+		{
+			*out++ = static_cast<char>(codePoint);
+		}
+		else if (codePoint < 0x800)
+		{
+			*out++ = static_cast<char>(0xC0 | (codePoint >> 6));
+			*out++ = static_cast<char>(0x80 | (codePoint & 0x3F));
+		}
+		else if (codePoint < 0x10000)
+		{
+			*out++ = static_cast<char>(0xE0 | (codePoint >> 12));
+			*out++ = static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+			*out++ = static_cast<char>(0x80 | (codePoint & 0x3F));
+		}
+		else
+		{
+			*out++ = static_cast<char>(0xF0 | (codePoint >> 18));
+			*out++ = static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+			*out++ = static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+			*out++ = static_cast<char>(0x80 | (codePoint & 0x3F));
+		}
+		return out;
+	}
+
+	// ===== ASCII fast paths =====
+
+	/**
+	 * @brief Widens the leading ASCII characters of in into out, in whole blocks
+	 * @return number of converted characters
+	 */
+	static size_t widenAscii(const unsigned char* in, size_t size, char16_t* out)
+	{
+		size_t pos = 0;
+#ifdef MATLAB_API_UTF_AVX2
+		for (; pos + 32 <= size; pos += 32)
+		{
+			__m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + pos));
+			if (_mm256_movemask_epi8(bytes) != 0)
+				return pos;
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + pos), _mm256_cvtepu8_epi16(_mm256_castsi256_si128(bytes)));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + pos + 16), _mm256_cvtepu8_epi16(_mm256_extracti128_si256(bytes, 1)));
+		}
+#endif
+#ifdef MATLAB_API_UTF_SSE2
+		const __m128i zero = _mm_setzero_si128();
+		for (; pos + 16 <= size; pos += 16)
+		{
+			__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + pos));
+			if (_mm_movemask_epi8(bytes) != 0)
+				return pos;
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + pos), _mm_unpacklo_epi8(bytes, zero));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + pos + 8), _mm_unpackhi_epi8(bytes, zero));
+		}
+#else
+		(void)in; (void)size; (void)out;
+#endif
+		return pos;
+	}
+
+	/**
+	 * @brief Narrows the leading ASCII characters of in into out, in whole blocks
+	 * @return number of converted characters
+	 */
+	static size_t narrowAscii(const char16_t* in, size_t size, char* out)
+	{
+		size_t pos = 0;
+#ifdef MATLAB_API_UTF_AVX2
+		const __m256i nonAscii256 = _mm256_set1_epi16(static_cast<short>(0xFF80));
+		for (; pos + 32 <= size; pos += 32)
+		{
+			__m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + pos));
+			__m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + pos + 16));
+			if (!_mm256_testz_si256(_mm256_or_si256(low, high), nonAscii256))
+				return pos;
+			// packus works per 128 bit lane, restore the order of the 64 bit quarters
+			__m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(low, high), 0xD8);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + pos), packed);
+		}
+#endif
+#ifdef MATLAB_API_UTF_SSE2
+		const __m128i nonAscii = _mm_set1_epi16(static_cast<short>(0xFF80));
+		const __m128i zero = _mm_setzero_si128();
+		for (; pos + 16 <= size; pos += 16)
+		{
+			__m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + pos));
+			__m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + pos + 8));
+			__m128i masked = _mm_and_si128(_mm_or_si128(low, high), nonAscii);
+			if (_mm_movemask_epi8(_mm_cmpeq_epi16(masked, zero)) != 0xFFFF)
+				return pos;
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + pos), _mm_packus_epi16(low, high));
+		}
+#else
+		(void)in; (void)size; (void)out;
+#endif
+		return pos;
+	}
+
+	// ===== Utf =====
+
+	std::u16string Utf::toUtf16(const char* data, size_t size)
+	{
+		if (!data || size == 0)
+			return u"";
+		// Every byte produces at most one UTF-16 unit (4 byte sequences produce 2)
+		std::u16string output(size, u'\0');
+		const unsigned char* in = reinterpret_cast<const unsigned char*>(data);
+		char16_t* out = &output[0];
+		size_t pos = 0;
+		while (pos < size)
+		{
+			size_t ascii = widenAscii(in + pos, size - pos, out);
+			pos += ascii;
+			out += ascii;
+			// Scalar until the next block boundary, the block contained a non ASCII byte
+			size_t blockEnd = std::min(size, pos + 16);
+			while (pos < blockEnd)
+				out = encodeUtf16(decodeUtf8(in, size, pos), out);
+		}
+		output.resize(out - output.data());
+		return output;
+	}
+	std::u16string Utf::toUtf16(const char* text)
+	{
+		return text ? toUtf16(text, std::strlen(text)) : u"";
+	}
+	std::u16string Utf::toUtf16(const std::string& text)
+	{
+		return toUtf16(text.data(), text.size());
+	}
+
+	std::string Utf::toUtf8(const char16_t* data, size_t size)
+	{
+		if (!data || size == 0)
+			return "";
+		// Every UTF-16 unit produces at most 3 bytes (surrogate pairs produce 4 for 2 units)
+		std::string output(size * 3, '\0');
+		char* out = &output[0];
+		size_t pos = 0;
+		while (pos < size)
+		{
+			size_t ascii = narrowAscii(data + pos, size - pos, out);
+			pos += ascii;
+			out += ascii;
+			size_t blockEnd = std::min(size, pos + 16);
+			while (pos < blockEnd)
+				out = encodeUtf8(decodeUtf16(data, size, pos), out);
+		}
+		output.resize(out - output.data());
+		return output;
+	}
+	std::string Utf::toUtf8(const std::u16string& text)
+	{
+		return toUtf8(text.data(), text.size());
+	}
+
+	// ===== Name cache =====
+
+	static std::shared_mutex s_nameMutex;
+	static std::unordered_map<std::string, std::u16string> s_names; // nodes are never erased, references stay valid
+
+	const std::u16string& Utf::toUtf16Name(const std::string& name)
+	{
+		if (name.size() <= maxInternedNameLength)
+		{
+			{
+				std::shared_lock<std::shared_mutex> lock(s_nameMutex);
+				auto it = s_names.find(name);
+				if (it != s_names.end())
+					return it->second;
+			}
+			std::unique_lock<std::shared_mutex> lock(s_nameMutex);
+			if (s_names.size() < maxInternedNames)
+				return s_names.emplace(name, toUtf16(name)).first->second;
+			auto it = s_names.find(name);
+			if (it != s_names.end())
+				return it->second;
+		}
+		thread_local std::u16string s_uncached;
+		s_uncached = toUtf16(name);
+		return s_uncached;
+	}
+	size_t Utf::getInternedNameCount()
+	{
+		std::shared_lock<std::shared_mutex> lock(s_nameMutex);
+		return s_names.size();
+	}
+}
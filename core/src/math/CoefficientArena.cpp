@@ -0,0 +1,167 @@
+#include "math/CoefficientArena.h"
+#include <stdexcept>
+#include <algorithm>
+
+namespace MatlabAPI
+{
+	static const std::vector<double> s_emptyCoefficients;
+	static const std::vector<CoefficientArena::Entry> s_emptyEntries;
+
+	CoefficientArena::CoefficientArena()
+		: m_storage(nullptr)
+	{
+
+	}
+	CoefficientArena::CoefficientArena(size_t entryCount, size_t coefficientCapacity)
+		: m_storage(std::make_shared<Storage>())
+	{
+		m_storage->entries.resize(entryCount);
+		m_storage->coefficients.reserve(coefficientCapacity);
+	}
+	CoefficientArena::CoefficientArena(std::vector<double> coefficients, std::vector<Entry> entries)
+		: m_storage(std::make_shared<Storage>())
+	{
+		for (const Entry& entry : entries)
+		{
+			if (entry.numeratorOffset + entry.numeratorLength > coefficients.size() ||
+				entry.denominatorOffset + entry.denominatorLength > coefficients.size())
+			{
+				throw std::out_of_range("Coefficient entry exceeds the coefficient buffer.");
+			}
+		}
+		m_storage->coefficients = std::move(coefficients);
+		m_storage->entries = std::move(entries);
+	}
+	CoefficientArena::CoefficientArena(const CoefficientArena& other)
+		: m_storage(other.m_storage)
+	{
+
+	}
+	CoefficientArena::CoefficientArena(CoefficientArena&& other) noexcept
+		: m_storage(std::move(other.m_storage))
+	{
+
+	}
+	CoefficientArena::~CoefficientArena()
+	{
+
+	}
+
+	CoefficientArena& CoefficientArena::operator=(const CoefficientArena& other)
+	{
+		if (this != &other)
+		{
+			m_storage = other.m_storage;
+		}
+		return *this;
+	}
+	CoefficientArena& CoefficientArena::operator=(CoefficientArena&& other) noexcept
+	{
+		if (this != &other)
+		{
+			m_storage = std::move(other.m_storage);
+		}
+		return *this;
+	}
+
+	const CoefficientArena::Entry& CoefficientArena::getEntry(size_t index) const
+	{
+		if (!m_storage || index >= m_storage->entries.size())
+		{
+			throw std::out_of_range("Coefficient entry index out of range");
+		}
+		return m_storage->entries[index];
+	}
+
+	const double* CoefficientArena::getNumerator(size_t index) const
+	{
+		const Entry& entry = getEntry(index);
+		return m_storage->coefficients.data() + entry.numeratorOffset;
+	}
+	const double* CoefficientArena::getDenominator(size_t index) const
+	{
+		const Entry& entry = getEntry(index);
+		return m_storage->coefficients.data() + entry.denominatorOffset;
+	}
+
+	void CoefficientArena::set(size_t index, const double* numerator, size_t numeratorLength, const double* denominator, size_t denominatorLength)
+	{
+		if (!m_storage || index >= m_storage->entries.size())
+		{
+			throw std::out_of_range("Coefficient entry index out of range");
+		}
+		detach();
+		std::vector<double>& coefficients = m_storage->coefficients;
+		Entry& entry = m_storage->entries[index];
+
+		// The numerator and denominator of one entry are stored back to back
+		size_t oldLength = entry.numeratorLength + entry.denominatorLength;
+		size_t newLength = numeratorLength + denominatorLength;
+		size_t offset = entry.numeratorOffset;
+		if (newLength > oldLength || oldLength == 0)
+		{
+			// Inputs may point into our own buffer, copy them before the buffer can reallocate
+			std::vector<double> tmp(newLength);
+			std::copy(numerator, numerator + numeratorLength, tmp.begin());
+			std::copy(denominator, denominator + denominatorLength, tmp.begin() + numeratorLength);
+			offset = coefficients.size();
+			coefficients.insert(coefficients.end(), tmp.begin(), tmp.end());
+		}
+		else
+		{
+			std::copy(numerator, numerator + numeratorLength, coefficients.begin() + offset);
+			std::copy(denominator, denominator + denominatorLength, coefficients.begin() + offset + numeratorLength);
+		}
+		entry.numeratorOffset = offset;
+		entry.numeratorLength = numeratorLength;
+		entry.denominatorOffset = offset + numeratorLength;
+		entry.denominatorLength = denominatorLength;
+	}
+
+	void CoefficientArena::compact()
+	{
+		if (!m_storage)
+			return;
+		size_t used = 0;
+		for (const Entry& entry : m_storage->entries)
+			used += entry.numeratorLength + entry.denominatorLength;
+		if (used == m_storage->coefficients.size())
+			return;
+
+		std::shared_ptr<Storage> compacted = std::make_shared<Storage>();
+		compacted->coefficients.reserve(used);
+		compacted->entries = m_storage->entries;
+		for (Entry& entry : compacted->entries)
+		{
+			const double* num = m_storage->coefficients.data() + entry.numeratorOffset;
+			const double* den = m_storage->coefficients.data() + entry.denominatorOffset;
+			entry.numeratorOffset = compacted->coefficients.size();
+			compacted->coefficients.insert(compacted->coefficients.end(), num, num + entry.numeratorLength);
+			entry.denominatorOffset = compacted->coefficients.size();
+			compacted->coefficients.insert(compacted->coefficients.end(), den, den + entry.denominatorLength);
+		}
+		m_storage = std::move(compacted);
+	}
+
+	const std::vector<double>& CoefficientArena::getCoefficients() const
+	{
+		return m_storage ? m_storage->coefficients : s_emptyCoefficients;
+	}
+	const std::vector<CoefficientArena::Entry>& CoefficientArena::getEntries() const
+	{
+		return m_storage ? m_storage->entries : s_emptyEntries;
+	}
+
+	void CoefficientArena::detach()
+	{
+		if (!m_storage)
+		{
+			m_storage = std::make_shared<Storage>();
+			return;
+		}
+		if (m_storage.use_count() > 1)
+		{
+			m_storage = std::make_shared<Storage>(*m_storage);
+		}
+	}
+}
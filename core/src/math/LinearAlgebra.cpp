@@ -0,0 +1,476 @@
+#include "math/LinearAlgebra.h"
+#include <cmath>
+#include <stdexcept>
+#include <algorithm>
+#include <numeric>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MATLAB_API_TRANSPOSE_SSE2
+#endif
+
+namespace MatlabAPI
+{
+	// Edge length of the blocks of the transpose, two 32 x 32 blocks of doubles fit into the L1 cache
+	static const size_t s_transposeBlock = 32;
+
+#if defined(MATLAB_API_TRANSPOSE_SSE2)
+	static const size_t s_transposeKernel = 2;
+
+	// 2 x 2 block at source -> target
+	static inline void transposeKernel(const double* source, size_t sourceStride, double* target, size_t targetStride)
+	{
+		__m128d r0 = _mm_loadu_pd(source);
+		__m128d r1 = _mm_loadu_pd(source + sourceStride);
+		_mm_storeu_pd(target, _mm_unpacklo_pd(r0, r1));
+		_mm_storeu_pd(target + targetStride, _mm_unpackhi_pd(r0, r1));
+	}
+#else
+	static const size_t s_transposeKernel = 1;
+
+	static inline void transposeKernel(const double* source, size_t sourceStride, double* target, size_t targetStride)
+	{
+		(void)sourceStride;
+		(void)targetStride;
+		*target = *source;
+	}
+#endif
+
+	void LinearAlgebra::transpose(const double* source, size_t rows, size_t cols, double* target)
+	{
+		const size_t k = s_transposeKernel;
+		for (size_t rowBlock = 0; rowBlock < rows; rowBlock += s_transposeBlock)
+		{
+			size_t rowEnd = std::min(rowBlock + s_transposeBlock, rows);
+			for (size_t colBlock = 0; colBlock < cols; colBlock += s_transposeBlock)
+			{
+				size_t colEnd = std::min(colBlock + s_transposeBlock, cols);
+				size_t r = rowBlock;
+				for (; r + k <= rowEnd; r += k)
+				{
+					size_t c = colBlock;
+					for (; c + k <= colEnd; c += k)
+						transposeKernel(source + r * cols + c, cols, target + c * rows + r, rows);
+					for (; c < colEnd; ++c)
+						for (size_t i = r; i < r + k; ++i)
+							target[c * rows + i] = source[i * cols + c];
+				}
+				for (; r < rowEnd; ++r)
+					for (size_t c = colBlock; c < colEnd; ++c)
+						target[c * rows + r] = source[r * cols + c];
+			}
+		}
+	}
+
+	Matrix LinearAlgebra::multiply(const Matrix& A, const Matrix& B)
+	{
+		if (A.getCols() != B.getRows())
+		{
+			throw std::invalid_argument("Matrix dimensions must agree for multiplication.");
+		}
+		size_t n = A.getRows();
+		size_t m = A.getCols();
+		size_t p = B.getCols();
+		Matrix result(n, p);
+		const double* a = A.data();
+		const double* b = B.data();
+		double* r = result.data();
+		// i-k-j order: the inner loop streams over contiguous rows of B and the result
+		for (size_t i = 0; i < n; i++)
+		{
+			double* rRow = r + i * p;
+			for (size_t k = 0; k < m; k++)
+			{
+				double aik = a[i * m + k];
+				if (aik == 0.0)
+					continue;
+				const double* bRow = b + k * p;
+				for (size_t j = 0; j < p; j++)
+					rRow[j] += aik * bRow[j];
+			}
+		}
+		return result;
+	}
+	Matrix LinearAlgebra::multiplyTransposed(const Matrix& A, const Matrix& B)
+	{
+		if (A.getCols() != B.getCols())
+		{
+			throw std::invalid_argument("Matrix dimensions must agree for multiplication.");
+		}
+		size_t n = A.getRows();
+		size_t m = A.getCols();
+		size_t p = B.getRows();
+		Matrix result(n, p);
+		const double* a = A.data();
+		const double* b = B.data();
+		for (size_t i = 0; i < n; i++)
+		{
+			const double* aRow = a + i * m;
+			for (size_t j = 0; j < p; j++)
+			{
+				const double* bRow = b + j * m;
+				double sum = 0.0;
+				for (size_t k = 0; k < m; k++)
+					sum += aRow[k] * bRow[k];
+				result(i, j) = sum;
+			}
+		}
+		return result;
+	}
+
+	Matrix LinearAlgebra::solve(const Matrix& A, const Matrix& B)
+	{
+		size_t n = A.getRows();
+		if (A.getCols() != n || B.getRows() != n)
+		{
+			throw std::invalid_argument("Matrix dimensions must agree for solve.");
+		}
+		Matrix LU(A);
+		Matrix X(B);
+		size_t m = X.getCols();
+		double scale = 0.0;
+		for (size_t i = 0; i < n * n; i++)
+			scale = std::max(scale, std::abs(LU.data()[i]));
+
+		for (size_t k = 0; k < n; k++)
+		{
+			// Partial pivoting
+			size_t pivot = k;
+			double pivotValue = std::abs(LU(k, k));
+			for (size_t r = k + 1; r < n; r++)
+			{
+				if (std::abs(LU(r, k)) > pivotValue)
+				{
+					pivotValue = std::abs(LU(r, k));
+					pivot = r;
+				}
+			}
+			if (pivotValue <= scale * 1e-14 || pivotValue == 0.0)
+			{
+				throw std::runtime_error("Matrix is singular to working precision.");
+			}
+			if (pivot != k)
+			{
+				for (size_t c = 0; c < n; c++)
+					std::swap(LU(k, c), LU(pivot, c));
+				for (size_t c = 0; c < m; c++)
+					std::swap(X(k, c), X(pivot, c));
+			}
+			for (size_t r = k + 1; r < n; r++)
+			{
+				double factor = LU(r, k) / LU(k, k);
+				if (factor == 0.0)
+					continue;
+				LU(r, k) = factor;
+				for (size_t c = k + 1; c < n; c++)
+					LU(r, c) -= factor * LU(k, c);
+				for (size_t c = 0; c < m; c++)
+					X(r, c) -= factor * X(k, c);
+			}
+		}
+		// Back substitution
+		for (size_t kk = n; kk-- > 0;)
+		{
+			for (size_t c = 0; c < m; c++)
+			{
+				double sum = X(kk, c);
+				for (size_t j = kk + 1; j < n; j++)
+					sum -= LU(kk, j) * X(j, c);
+				X(kk, c) = sum / LU(kk, kk);
+			}
+		}
+		return X;
+	}
+	Matrix LinearAlgebra::inverse(const Matrix& A)
+	{
+		return solve(A, Matrix::identity(A.getRows()));
+	}
+
+	double LinearAlgebra::frobeniusNorm(const Matrix& A)
+	{
+		double sum = 0.0;
+		const double* a = A.data();
+		for (size_t i = 0; i < A.getRows() * A.getCols(); i++)
+			sum += a[i] * a[i];
+		return std::sqrt(sum);
+	}
+
+	void LinearAlgebra::symmetricEigen(const Matrix& S, Matrix& eigenvalues, Matrix& eigenvectors)
+	{
+		size_t n = S.getRows();
+		if (S.getCols() != n)
+		{
+			throw std::invalid_argument("Eigen decomposition needs a square matrix.");
+		}
+		Matrix a(S);
+		Matrix v = Matrix::identity(n);
+		const size_t maxSweeps = 100;
+		for (size_t sweep = 0; sweep < maxSweeps; sweep++)
+		{
+			double offDiagonal = 0.0;
+			double diagonal = 0.0;
+			for (size_t p = 0; p < n; p++)
+			{
+				diagonal += a(p, p) * a(p, p);
+				for (size_t q = p + 1; q < n; q++)
+					offDiagonal += a(p, q) * a(p, q);
+			}
+			if (offDiagonal <= 1e-30 * diagonal || offDiagonal == 0.0)
+				break;
+
+			for (size_t p = 0; p < n; p++)
+			{
+				for (size_t q = p + 1; q < n; q++)
+				{
+					double apq = a(p, q);
+					if (apq == 0.0)
+						continue;
+					double theta = (a(q, q) - a(p, p)) / (2.0 * apq);
+					double t = (theta >= 0 ? 1.0 : -1.0) / (std::abs(theta) + std::sqrt(theta * theta + 1.0));
+					double c = 1.0 / std::sqrt(t * t + 1.0);
+					double s = t * c;
+					for (size_t k = 0; k < n; k++)
+					{
+						double akp = a(k, p);
+						double akq = a(k, q);
+						a(k, p) = c * akp - s * akq;
+						a(k, q) = s * akp + c * akq;
+					}
+					for (size_t k = 0; k < n; k++)
+					{
+						double apk = a(p, k);
+						double aqk = a(q, k);
+						a(p, k) = c * apk - s * aqk;
+						a(q, k) = s * apk + c * aqk;
+					}
+					for (size_t k = 0; k < n; k++)
+					{
+						double vkp = v(k, p);
+						double vkq = v(k, q);
+						v(k, p) = c * vkp - s * vkq;
+						v(k, q) = s * vkp + c * vkq;
+					}
+				}
+			}
+		}
+
+		std::vector<size_t> order(n);
+		std::iota(order.begin(), order.end(), 0);
+		std::sort(order.begin(), order.end(), [&a](size_t i, size_t j) { return a(i, i) > a(j, j); });
+		eigenvalues = Matrix(n, 1);
+		eigenvectors = Matrix(n, n);
+		for (size_t i = 0; i < n; i++)
+		{
+			eigenvalues(i, 0) = a(order[i], order[i]);
+			for (size_t k = 0; k < n; k++)
+				eigenvectors(k, i) = v(k, order[i]);
+		}
+	}
+
+	void LinearAlgebra::svd(const Matrix& A, Matrix& U, Matrix& singularValues, Matrix& V)
+	{
+		size_t m = A.getRows();
+		size_t n = A.getCols();
+		// Work on the columns of A^T so that the rotated columns are contiguous rows
+		Matrix w = A.getTransposed(); // n x m, row i is column i of A
+		Matrix vt = Matrix::identity(n); // row i is column i of V
+		const size_t maxSweeps = 100;
+		const double eps = 1e-15;
+		for (size_t sweep = 0; sweep < maxSweeps; sweep++)
+		{
+			bool rotated = false;
+			for (size_t p = 0; p + 1 < n; p++)
+			{
+				for (size_t q = p + 1; q < n; q++)
+				{
+					double* wp = w.data() + p * m;
+					double* wq = w.data() + q * m;
+					double alpha = 0.0, beta = 0.0, gamma = 0.0;
+					for (size_t k = 0; k < m; k++)
+					{
+						alpha += wp[k] * wp[k];
+						beta += wq[k] * wq[k];
+						gamma += wp[k] * wq[k];
+					}
+					if (gamma == 0.0 || std::abs(gamma) <= eps * std::sqrt(alpha * beta))
+						continue;
+					rotated = true;
+					double zeta = (beta - alpha) / (2.0 * gamma);
+					double t = (zeta >= 0 ? 1.0 : -1.0) / (std::abs(zeta) + std::sqrt(1.0 + zeta * zeta));
+					double c = 1.0 / std::sqrt(1.0 + t * t);
+					double s = c * t;
+					for (size_t k = 0; k < m; k++)
+					{
+						double xp = wp[k];
+						double xq = wq[k];
+						wp[k] = c * xp - s * xq;
+						wq[k] = s * xp + c * xq;
+					}
+					double* vp = vt.data() + p * n;
+					double* vq = vt.data() + q * n;
+					for (size_t k = 0; k < n; k++)
+					{
+						double xp = vp[k];
+						double xq = vq[k];
+						vp[k] = c * xp - s * xq;
+						vq[k] = s * xp + c * xq;
+					}
+				}
+			}
+			if (!rotated)
+				break;
+		}
+
+		std::vector<double> norms(n);
+		for (size_t i = 0; i < n; i++)
+		{
+			const double* wi = w.data() + i * m;
+			double sum = 0.0;
+			for (size_t k = 0; k < m; k++)
+				sum += wi[k] * wi[k];
+			norms[i] = std::sqrt(sum);
+		}
+		std::vector<size_t> order(n);
+		std::iota(order.begin(), order.end(), 0);
+		std::sort(order.begin(), order.end(), [&norms](size_t i, size_t j) { return norms[i] > norms[j]; });
+
+		U = Matrix(m, n);
+		singularValues = Matrix(n, 1);
+		V = Matrix(n, n);
+		for (size_t i = 0; i < n; i++)
+		{
+			size_t src = order[i];
+			double sigma = norms[src];
+			singularValues(i, 0) = sigma;
+			const double* wi = w.data() + src * m;
+			if (sigma > 0.0)
+			{
+				for (size_t k = 0; k < m; k++)
+					U(k, i) = wi[k] / sigma;
+			}
+			const double* vi = vt.data() + src * n;
+			for (size_t k = 0; k < n; k++)
+				V(k, i) = vi[k];
+		}
+	}
+
+	Matrix LinearAlgebra::solveLyapunov(const Matrix& A, const Matrix& Q, double tolerance, size_t maxIterations)
+	{
+		size_t n = A.getRows();
+		if (A.getCols() != n || Q.getRows() != n || Q.getCols() != n)
+		{
+			throw std::invalid_argument("Matrix dimensions must agree for the Lyapunov equation.");
+		}
+		if (n == 0)
+			return Matrix();
+
+		// Cayley transform with shift s > 0:
+		//   X = Ad*X*Ad^T + 2s * M*Q*M^T,  M = (A - sI)^-1,  Ad = M*(A + sI)
+		// The shift is placed at the geometric mean of the estimated spectral extremes.
+		Matrix Ainv = inverse(A);
+		double s = std::sqrt(frobeniusNorm(A) / frobeniusNorm(Ainv));
+		Matrix I = Matrix::identity(n);
+		Matrix M = inverse(A - I * s);
+		Matrix Ad = multiply(M, A + I * s);
+		Matrix Qd = multiplyTransposed(multiply(M, Q), M) * (2.0 * s);
+		return solveStein(Ad, Qd, tolerance, maxIterations);
+	}
+
+	Matrix LinearAlgebra::solveStein(const Matrix& A, const Matrix& Q, double tolerance, size_t maxIterations)
+	{
+		size_t n = A.getRows();
+		if (A.getCols() != n || Q.getRows() != n || Q.getCols() != n)
+		{
+			throw std::invalid_argument("Matrix dimensions must agree for the Stein equation.");
+		}
+		// Squared Smith iteration:
+		//   X_{k+1} = X_k + A_k * X_k * A_k^T,  A_{k+1} = A_k^2
+		// After k steps X_k contains the first 2^k terms of the series sum(A^i * Q * A^i^T)
+		Matrix X(Q);
+		Matrix Ak(A);
+		for (size_t i = 0; i < maxIterations; i++)
+		{
+			Matrix increment = multiplyTransposed(multiply(Ak, X), Ak);
+			X += increment;
+			double incrementNorm = frobeniusNorm(increment);
+			double xNorm = frobeniusNorm(X);
+			if (!std::isfinite(xNorm))
+				break;
+			if (incrementNorm <= tolerance * xNorm)
+			{
+				// Symmetrize to remove rounding asymmetries
+				for (size_t r = 0; r < n; r++)
+				{
+					for (size_t c = r + 1; c < n; c++)
+					{
+						double avg = 0.5 * (X(r, c) + X(c, r));
+						X(r, c) = avg;
+						X(c, r) = avg;
+					}
+				}
+				return X;
+			}
+			Ak = multiply(Ak, Ak);
+		}
+		throw std::runtime_error("Smith iteration did not converge, the system is not stable.");
+	}
+
+	Matrix LinearAlgebra::semidefiniteFactor(const Matrix& P)
+	{
+		size_t n = P.getRows();
+		Matrix eigenvalues;
+		Matrix eigenvectors;
+		symmetricEigen(P, eigenvalues, eigenvectors);
+		Matrix L(n, n);
+		for (size_t c = 0; c < n; c++)
+		{
+			double lambda = std::max(eigenvalues(c, 0), 0.0);
+			double root = std::sqrt(lambda);
+			for (size_t r = 0; r < n; r++)
+				L(r, c) = eigenvectors(r, c) * root;
+		}
+		return L;
+	}
+
+	Matrix LinearAlgebra::expm(const Matrix& A)
+	{
+		size_t n = A.getRows();
+		if (A.getCols() != n)
+		{
+			throw std::invalid_argument("expm requires a square matrix.");
+		}
+		// Scale A until its infinity norm is below 0.5, where the Pade approximant is accurate
+		double norm = 0.0;
+		for (size_t i = 0; i < n; i++)
+		{
+			double rowSum = 0.0;
+			for (size_t j = 0; j < n; j++)
+				rowSum += std::abs(A(i, j));
+			norm = std::max(norm, rowSum);
+		}
+		int squarings = 0;
+		if (norm > 0.5)
+			squarings = (int)std::ceil(std::log2(norm / 0.5));
+		Matrix X = A * std::ldexp(1.0, -squarings);
+
+		const int q = 6;
+		double c = 1.0;
+		Matrix power = Matrix::identity(n);
+		Matrix N = Matrix::identity(n);
+		Matrix D = Matrix::identity(n);
+		for (int k = 1; k <= q; k++)
+		{
+			c *= (double)(q - k + 1) / (double)(k * (2 * q - k + 1));
+			power = multiply(power, X);
+			N += power * c;
+			if (k % 2 == 0)
+				D += power * c;
+			else
+				D -= power * c;
+		}
+		Matrix E = solve(D, N);
+		for (int i = 0; i < squarings; i++)
+			E = multiply(E, E);
+		return E;
+	}
+}
@@ -1,5 +1,6 @@
 #include "math/MIMOSystem.h"
 #include "MatlabEngine.h"
+#include <algorithm>
 
 
 namespace MatlabAPI
@@ -8,71 +9,80 @@ namespace MatlabAPI
 	{
 		size_t rows = systemMatrix.size();
 		size_t cols = 0;
+		size_t coefficientCount = 0;
 		for (const auto& row : systemMatrix)
 		{
 			cols = std::max(cols, row.size());
+			for (const auto& tf : row)
+				coefficientCount += tf.getNumerator().size() + tf.getDenominator().size();
 		}
 		m_numOutputs = rows;
 		m_numInputs = cols;
-		m_systemMatrix = new TransferFunction[rows * cols];
+		// Reserve for the given transfer functions plus the padding ZERO entries
+		coefficientCount += (rows * cols) * 2;
+		m_arena = CoefficientArena(rows * cols, coefficientCount);
 		for (size_t r = 0; r < rows; r++)
 		{
 			for (size_t c = 0; c < cols; c++)
 			{
-				if (c < systemMatrix[r].size())
-					m_systemMatrix[r * cols + c] = systemMatrix[r][c];
-				else
-					m_systemMatrix[r * cols + c] = TransferFunction::ZERO;
+				const TransferFunction& tf = c < systemMatrix[r].size() ? systemMatrix[r][c] : TransferFunction::ZERO;
+				const std::vector<double>& num = tf.getNumerator();
+				const std::vector<double>& den = tf.getDenominator();
+				m_arena.set(r * cols + c, num.data(), num.size(), den.data(), den.size());
 			}
 		}
 	}
+	MIMOSystem::MIMOSystem(size_t numOutputs, size_t numInputs, const CoefficientArena& arena)
+		: m_arena(arena)
+		, m_numInputs(numInputs)
+		, m_numOutputs(numOutputs)
+	{
+		if (m_arena.getEntryCount() != numOutputs * numInputs)
+		{
+			throw std::invalid_argument("Coefficient arena entry count does not match the system dimensions.");
+		}
+	}
 	MIMOSystem::MIMOSystem(const MIMOSystem& other)
-		: m_numInputs(other.m_numInputs)
+		: m_arena(other.m_arena)
+		, m_numInputs(other.m_numInputs)
 		, m_numOutputs(other.m_numOutputs)
-		, m_systemMatrix(new TransferFunction[other.m_numInputs * other.m_numOutputs])
 	{
-		memcpy(m_systemMatrix, other.m_systemMatrix, sizeof(TransferFunction) * other.m_numInputs * other.m_numOutputs);
+
 	}
 	MIMOSystem::MIMOSystem(MIMOSystem&& other) noexcept
-		: m_numInputs(other.m_numInputs)
+		: m_arena(std::move(other.m_arena))
+		, m_numInputs(other.m_numInputs)
 		, m_numOutputs(other.m_numOutputs)
-		, m_systemMatrix(other.m_systemMatrix)
 	{
 		other.m_numInputs = 0;
 		other.m_numOutputs = 0;
-		other.m_systemMatrix = nullptr;
 	}
 	MIMOSystem::~MIMOSystem()
 	{
-		delete[] m_systemMatrix;
+
 	}
 
-	const TransferFunction& MIMOSystem::getTransferFunction(size_t inputIndex, size_t outputIndex) const
+	TransferFunction MIMOSystem::getTransferFunction(size_t inputIndex, size_t outputIndex) const
 	{
-		if (inputIndex >= m_numInputs || outputIndex >= m_numOutputs)
-		{
-			throw std::out_of_range("Input or output index out of range");
-		}
-		return m_systemMatrix[outputIndex * m_numInputs + inputIndex];
+		size_t index = getIndex(inputIndex, outputIndex);
+		return TransferFunction(m_arena.getNumerator(index), m_arena.getNumeratorLength(index),
+			m_arena.getDenominator(index), m_arena.getDenominatorLength(index));
 	}
-	TransferFunction& MIMOSystem::getTransferFunction(size_t inputIndex, size_t outputIndex)
-	{ 
-		if (inputIndex >= m_numInputs || outputIndex >= m_numOutputs)
-		{
-			throw std::out_of_range("Input or output index out of range");
-		}
-		return m_systemMatrix[outputIndex * m_numInputs + inputIndex];
+	void MIMOSystem::setTransferFunction(size_t inputIndex, size_t outputIndex, const TransferFunction& tf)
+	{
+		size_t index = getIndex(inputIndex, outputIndex);
+		const std::vector<double>& num = tf.getNumerator();
+		const std::vector<double>& den = tf.getDenominator();
+		m_arena.set(index, num.data(), num.size(), den.data(), den.size());
 	}
 
 	MIMOSystem& MIMOSystem::operator=(const MIMOSystem& other)
 	{
 		if (this != &other)
 		{
-			delete[] m_systemMatrix;
+			m_arena = other.m_arena;
 			m_numInputs = other.m_numInputs;
 			m_numOutputs = other.m_numOutputs;
-			m_systemMatrix = new TransferFunction[other.m_numInputs * other.m_numOutputs];
-			memcpy(m_systemMatrix, other.m_systemMatrix, sizeof(TransferFunction) * other.m_numInputs * other.m_numOutputs);
 		}
 		return *this;
 	}
@@ -80,63 +90,56 @@ namespace MatlabAPI
 	{
 		if (this != &other)
 		{
-			delete[] m_systemMatrix;
+			m_arena = std::move(other.m_arena);
 			m_numInputs = other.m_numInputs;
 			m_numOutputs = other.m_numOutputs;
-			m_systemMatrix = other.m_systemMatrix;
 
 			other.m_numInputs = 0;
 			other.m_numOutputs = 0;
-			other.m_systemMatrix = nullptr;
 		}
 		return *this;
 	}
 
 	StateSpaceModel MIMOSystem::toStateSpaceModel(double timeStep, StateSpaceModel::C2DMethod methode) const
 	{
-		if (!MatlabEngine::isInstantiated())
+		if (!MatlabEngine::isAvailable())
 		{
 			throw std::runtime_error("Matlab engine is not instantiated.");
 		}
 
-		for (size_t i = 0; i < m_numOutputs; i++)
+		// Build the numerator/denominator cell arrays directly from the arena and pass them to tf in one call
+		MatlabArray numCells = MatlabArray::createCell("num", m_numOutputs, m_numInputs);
+		MatlabArray denCells = MatlabArray::createCell("den", m_numOutputs, m_numInputs);
+		for (size_t output = 0; output < m_numOutputs; ++output)
 		{
-			for (size_t j = 0; j < m_numInputs; j++)
+			for (size_t input = 0; input < m_numInputs; ++input)
 			{
-				std::string tfVarName = "tf_" + std::to_string(i) + "_" + std::to_string(j);
-				m_systemMatrix[i * m_numInputs + j].putInMatlabWorkspace(tfVarName);
+				size_t index = getIndex(input, output);
+				const double* num = m_arena.getNumerator(index);
+				const double* den = m_arena.getDenominator(index);
+				size_t numLength = m_arena.getNumeratorLength(index);
+				size_t denLength = m_arena.getDenominatorLength(index);
+
+				// Cell arrays are column-major
+				size_t cellIndex = input * m_numOutputs + output;
+				numCells.setCell(cellIndex, MatlabArray("num", 1, numLength, std::vector<double>(num, num + numLength)));
+				denCells.setCell(cellIndex, MatlabArray("den", 1, denLength, std::vector<double>(den, den + denLength)));
 			}
 		}
-
-		// Construct the MIMO transfer function in MATLAB
-		std::string mimoVarName = "mimo_sys_temp";
-		std::string mimoExpr = mimoVarName + " = [";
-		for (size_t i = 0; i < m_numOutputs; i++)
+		std::vector<MatlabArray> sys = MatlabEngine::feval("tf", 1, numCells, denCells);
+		if (sys.empty())
 		{
-			for (size_t j = 0; j < m_numInputs; j++)
-			{
-				std::string tfVarName = "tf_" + std::to_string(i) + "_" + std::to_string(j);
-				mimoExpr += tfVarName;
-				if (j < m_numInputs - 1)
-					mimoExpr += ", ";
-			}
-			if (i < m_numOutputs - 1)
-				mimoExpr += "; ";
+			throw std::runtime_error("Failed to create the MIMO transfer function in MATLAB.");
 		}
-		mimoExpr += "];";
-		MatlabEngine::eval(mimoExpr.c_str());
-		MatlabEngine::eval(("mimo_sysd = c2d(" + mimoVarName + ", " + std::to_string(timeStep) + ", '"+StateSpaceModel::c2dMethodToMatlabString(methode)+"'); [Ad,Bd,Cd,Dd] = ssdata(ss(mimo_sysd)); [A,B,C,D] = ssdata(ss(mimo_sys_temp));").c_str());
-
-		Matrix Ad = MatlabEngine::getMatrix("Ad");
-		Matrix Bd = MatlabEngine::getMatrix("Bd");
-		Matrix Cd = MatlabEngine::getMatrix("Cd");
-		Matrix Dd = MatlabEngine::getMatrix("Dd");
-
-		Matrix A = MatlabEngine::getMatrix("A");
-		Matrix B = MatlabEngine::getMatrix("B");
-		Matrix C = MatlabEngine::getMatrix("C");
-		Matrix D = MatlabEngine::getMatrix("D");
+		return StateSpaceModel::fromMatlabSystem(sys[0], timeStep, methode);
+	}
 
-		return StateSpaceModel(A, B, C, D, Ad, Bd, Cd, Dd, Matrix(B.getRows(), 1), timeStep, methode);
+	size_t MIMOSystem::getIndex(size_t inputIndex, size_t outputIndex) const
+	{
+		if (inputIndex >= m_numInputs || outputIndex >= m_numOutputs)
+		{
+			throw std::out_of_range("Input or output index out of range");
+		}
+		return outputIndex * m_numInputs + inputIndex;
 	}
-}
\ No newline at end of file
+}
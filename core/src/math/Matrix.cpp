@@ -1,9 +1,7 @@
 #include "math/Matrix.h"
+#include "math/LinearAlgebra.h"
 #include <memory>
-
-#ifdef MATLAB_API_USE_CPP_API
-#include "MatlabDataArray.hpp"
-#endif
+#include <cstring>
 
 namespace MatlabAPI
 {
@@ -23,34 +21,22 @@ namespace MatlabAPI
 	}
 	Matrix::Matrix(MatlabArray* array)
 	{
-		if (array == nullptr || !array->isDouble())
+		if (array == nullptr || !(array->isNumeric() || array->isLogical()) || array->isComplex() || array->isSparse())
 		{
-			throw std::invalid_argument("Matrix can only be constructed from a valid double MatlabArray.");
+			throw std::invalid_argument("Matrix can only be constructed from a valid real numeric or logical MatlabArray.");
 		}
 		m_rows = array->getM();
 		m_cols = array->getN();
 		m_data = new double[m_rows * m_cols];
-		// Matlab uses column-major order, so we need to transpose while copying
-#ifdef MATLAB_API_USE_CPP_API
-		const auto& arrayData = array->getAPIArray();
-		matlab::data::TypedArray<double> d = arrayData;
-		for (size_t r = 0; r < m_rows; r++)
+		// Matlab uses column-major order: a rows x cols column-major matrix is the row-major cols x rows transpose
+		if (array->isDouble())
 		{
-			for (size_t c = 0; c < m_cols; c++)
-			{
-				m_data[r * m_cols + c] = d[r][c];
-			}
+			LinearAlgebra::transpose(array->cview<double>().data(), m_cols, m_rows, m_data);
+			return;
 		}
-#else
-		const double* arrayData = array->getPr();
-		for (size_t r = 0; r < m_rows; r++)
-		{
-			for (size_t c = 0; c < m_cols; c++)
-			{
-				m_data[r * m_cols + c] = arrayData[c * m_rows + r];
-			}
-		}
-#endif
+		std::unique_ptr<double[]> colMajorData(new double[m_rows * m_cols]);
+		array->copyAsDouble(colMajorData.get());
+		LinearAlgebra::transpose(colMajorData.get(), m_cols, m_rows, m_data);
 	}
 	Matrix::Matrix(const std::vector<std::vector<double>>& mat)
 	{
@@ -298,41 +284,27 @@ namespace MatlabAPI
 	}
 	Matrix& Matrix::transpose()
 	{
-		for (size_t r = 0; r < m_rows; r++)
-		{
-			for (size_t c = r + 1; c < m_cols; c++)
-			{
-				std::swap((*this)(r, c), (*this)(c, r));
-			}
-		}
+		double* transposed = new double[m_rows * m_cols];
+		LinearAlgebra::transpose(m_data, m_rows, m_cols, transposed);
+		delete[] m_data;
+		m_data = transposed;
 		std::swap(m_rows, m_cols);
 		return *this;
 	}
 	Matrix Matrix::getTransposed() const
 	{
 		Matrix result(m_cols, m_rows);
-		for (size_t r = 0; r < m_rows; r++)
-		{
-			for (size_t c = 0; c < m_cols; c++)
-			{
-				result(c, r) = (*this)(r, c);
-			}
-		}
+		LinearAlgebra::transpose(m_data, m_rows, m_cols, result.m_data);
 		return result;
 	}
 
 	MatlabArray* Matrix::toMatlabArray(const std::string& name) const
 	{
-		// Matlab uses column-major order, so we need to transpose while copying
-		std::vector<double> colMajorData(m_rows * m_cols);
-		for (size_t r = 0; r < m_rows; r++)
-		{
-			for (size_t c = 0; c < m_cols; c++)
-			{
-				colMajorData[c * m_rows + r] = m_data[r * m_cols + c];
-			}
-		}
-		MatlabArray* array = new MatlabArray(name, m_rows, m_cols, colMajorData);
+		// Matlab uses column-major order, so we need to transpose while copying.
+		// The transpose writes directly into the memory the array adopts.
+		ArrayBuffer<double> colMajorData = MatlabArray::createBuffer<double>(m_rows * m_cols);
+		LinearAlgebra::transpose(m_data, m_rows, m_cols, colMajorData.data());
+		MatlabArray* array = new MatlabArray(name, std::move(colMajorData), { m_rows, m_cols });
 		return array;
 	}
 
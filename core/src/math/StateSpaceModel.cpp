@@ -1,5 +1,7 @@
 #include "math/StateSpaceModel.h"
 #include "MatlabEngine.h"
+#include "math/LinearAlgebra.h"
+#include <cmath>
 
 namespace MatlabAPI
 {
@@ -20,21 +22,17 @@ namespace MatlabAPI
 		, solver(defaultSolver)
 	{
 		setIntegrationSolver(solver);
-		if (!MatlabEngine::isInstantiated())
+		if (!MatlabEngine::isAvailable())
 		{
 			throw std::runtime_error("Matlab engine is not instantiated.");
 		}
 		
-		MatlabEngine::addVariable(A.toMatlabArray("A"));
-		MatlabEngine::addVariable(B.toMatlabArray("B"));
-		MatlabEngine::addVariable(C.toMatlabArray("C"));
-		MatlabEngine::addVariable(D.toMatlabArray("D"));
-		std::string methode = c2dMethodToMatlabString(method);
-		MatlabEngine::eval(("sys = ss(A, B, C, D); sysd = c2d(sys, " + std::to_string(timeStep) + ", '"+ methode+"'); [Ad,Bd,Cd,Dd] = ssdata(sysd);").c_str());
-		Ad = MatlabEngine::getMatrix("Ad");
-		Bd = MatlabEngine::getMatrix("Bd");
-		Cd = MatlabEngine::getMatrix("Cd");
-		Dd = MatlabEngine::getMatrix("Dd");
+		std::vector<MatlabArray> sys = MatlabEngine::feval("ss", 1, A, B, C, D);
+		if (sys.empty())
+		{
+			throw std::runtime_error("Failed to create the state space model in MATLAB.");
+		}
+		ssdata(c2d(sys[0], timeStep, method), Ad, Bd, Cd, Dd);
 
 		if (x0.getRows() != A.getRows() || x0.getCols() != 1)
 		{
@@ -87,6 +85,92 @@ namespace MatlabAPI
 
 	}
 
+	StateSpaceModel StateSpaceModel::fromMatlabSystem(const MatlabArray& sys, double timeStep, C2DMethod method)
+	{
+		if (!MatlabEngine::isAvailable())
+		{
+			throw std::runtime_error("Matlab engine is not instantiated.");
+		}
+		Matrix A, B, C, D;
+		Matrix Ad, Bd, Cd, Dd;
+		ssdata(sys, A, B, C, D);
+		ssdata(c2d(sys, timeStep, method), Ad, Bd, Cd, Dd);
+		return StateSpaceModel(A, B, C, D, Ad, Bd, Cd, Dd, Matrix(B.getRows(), 1), timeStep, method);
+	}
+
+	void StateSpaceModel::ssdata(const MatlabArray& sys, Matrix& A, Matrix& B, Matrix& C, Matrix& D)
+	{
+		std::vector<MatlabArray> matrices = MatlabEngine::feval("ssdata", 4, sys);
+		if (matrices.size() != 4)
+		{
+			throw std::runtime_error("ssdata failed in MATLAB.");
+		}
+		A = Matrix(&matrices[0]);
+		B = Matrix(&matrices[1]);
+		C = Matrix(&matrices[2]);
+		D = Matrix(&matrices[3]);
+	}
+	MatlabArray StateSpaceModel::c2d(const MatlabArray& sys, double timeStep, C2DMethod method)
+	{
+		// The time step is passed as double, without the precision loss of a string conversion
+		std::vector<MatlabArray> sysd = MatlabEngine::feval("c2d", 1, sys, timeStep, c2dMethodToMatlabString(method));
+		if (sysd.empty())
+		{
+			throw std::runtime_error("c2d failed in MATLAB.");
+		}
+		return sysd[0];
+	}
+	void StateSpaceModel::discretize(const Matrix& A, const Matrix& B, const Matrix& C, const Matrix& D, double timeStep, C2DMethod method,
+		Matrix& Ad, Matrix& Bd, Matrix& Cd, Matrix& Dd)
+	{
+		size_t n = A.getRows();
+		size_t m = B.getCols();
+		if (method == ZeroOrderHold)
+		{
+			// expm([A B; 0 0] * Ts) = [Ad Bd; 0 I]
+			Matrix M(n + m, n + m);
+			for (size_t r = 0; r < n; ++r)
+			{
+				for (size_t c = 0; c < n; ++c)
+					M(r, c) = A(r, c) * timeStep;
+				for (size_t c = 0; c < m; ++c)
+					M(r, n + c) = B(r, c) * timeStep;
+			}
+			Matrix E = LinearAlgebra::expm(M);
+			Ad = Matrix(n, n);
+			Bd = Matrix(n, m);
+			for (size_t r = 0; r < n; ++r)
+			{
+				for (size_t c = 0; c < n; ++c)
+					Ad(r, c) = E(r, c);
+				for (size_t c = 0; c < m; ++c)
+					Bd(r, c) = E(r, n + c);
+			}
+			Cd = C;
+			Dd = D;
+		}
+		else if (method == Tustin)
+		{
+			// Same scaling of B and C as the c2d function of MATLAB
+			Matrix I = Matrix::identity(n);
+			Matrix inverse = LinearAlgebra::inverse(I - A * (timeStep / 2.0));
+			double root = std::sqrt(timeStep);
+			Ad = LinearAlgebra::multiply(inverse, I + A * (timeStep / 2.0));
+			Bd = LinearAlgebra::multiply(inverse, B) * root;
+			Cd = LinearAlgebra::multiply(C, inverse) * root;
+			Dd = D + LinearAlgebra::multiply(LinearAlgebra::multiply(C, inverse), B) * (timeStep / 2.0);
+		}
+		else
+		{
+			if (!MatlabEngine::isAvailable())
+				throw std::runtime_error("Matlab engine is not instantiated, " + c2dMethodToString(method) + " needs MATLAB.");
+			std::vector<MatlabArray> sys = MatlabEngine::feval("ss", 1, A, B, C, D);
+			if (sys.empty())
+				throw std::runtime_error("Failed to create the state space model in MATLAB.");
+			ssdata(c2d(sys[0], timeStep, method), Ad, Bd, Cd, Dd);
+		}
+	}
+
 	void StateSpaceModel::setIntegrationSolver(IntegrationSolver solver) 
 	{ 
 		this->solver = solver; 
@@ -146,6 +230,110 @@ namespace MatlabAPI
 	}
 
 
+	std::vector<double> StateSpaceModel::getHankelSingularValues() const
+	{
+		Matrix Lp, Lq, U, hsv, V;
+		computeBalancingFactors(Lp, Lq, U, hsv, V);
+		std::vector<double> values(hsv.getRows());
+		for (size_t i = 0; i < values.size(); ++i)
+			values[i] = hsv(i, 0);
+		return values;
+	}
+
+	double StateSpaceModel::getReductionErrorBound(const std::vector<double>& hankelSingularValues, size_t order)
+	{
+		double bound = 0.0;
+		for (size_t i = order; i < hankelSingularValues.size(); ++i)
+			bound += hankelSingularValues[i];
+		return 2.0 * bound;
+	}
+
+	StateSpaceModel StateSpaceModel::reduceToOrder(size_t order, double* errorBound) const
+	{
+		Matrix Lp, Lq, U, hsv, V;
+		computeBalancingFactors(Lp, Lq, U, hsv, V);
+		std::vector<double> values(hsv.getRows());
+		for (size_t i = 0; i < values.size(); ++i)
+			values[i] = hsv(i, 0);
+		order = std::min(order, values.size());
+		if (errorBound)
+			*errorBound = getReductionErrorBound(values, order);
+		return balancedTruncation(order, Lp, Lq, U, hsv, V);
+	}
+
+	StateSpaceModel StateSpaceModel::reduceToTolerance(double tolerance, double* errorBound) const
+	{
+		Matrix Lp, Lq, U, hsv, V;
+		computeBalancingFactors(Lp, Lq, U, hsv, V);
+		std::vector<double> values(hsv.getRows());
+		for (size_t i = 0; i < values.size(); ++i)
+			values[i] = hsv(i, 0);
+
+		size_t order = values.size();
+		while (order > 0 && getReductionErrorBound(values, order - 1) <= tolerance)
+			--order;
+		if (errorBound)
+			*errorBound = getReductionErrorBound(values, order);
+		return balancedTruncation(order, Lp, Lq, U, hsv, V);
+	}
+
+	void StateSpaceModel::computeBalancingFactors(Matrix& Lp, Matrix& Lq, Matrix& U, Matrix& hankelSingularValues, Matrix& V) const
+	{
+		// Controllability Gramian: A*P + P*A^T + B*B^T = 0
+		// Observability Gramian:   A^T*Q + Q*A + C^T*C = 0
+		Matrix At = A.getTransposed();
+		Matrix Ct = C.getTransposed();
+		Matrix P = LinearAlgebra::solveLyapunov(A, LinearAlgebra::multiplyTransposed(B, B));
+		Matrix Q = LinearAlgebra::solveLyapunov(At, LinearAlgebra::multiplyTransposed(Ct, Ct));
+
+		Lp = LinearAlgebra::semidefiniteFactor(P);
+		Lq = LinearAlgebra::semidefiniteFactor(Q);
+
+		// The singular values of Lq^T * Lp are the Hankel singular values
+		LinearAlgebra::svd(LinearAlgebra::multiply(Lq.getTransposed(), Lp), U, hankelSingularValues, V);
+	}
+
+	StateSpaceModel StateSpaceModel::balancedTruncation(size_t order, const Matrix& Lp, const Matrix& Lq, const Matrix& U, const Matrix& hankelSingularValues, const Matrix& V) const
+	{
+		size_t n = A.getRows();
+
+		// States with a vanishing Hankel singular value are neither controllable nor observable
+		double sigmaMax = hankelSingularValues.getRows() > 0 ? hankelSingularValues(0, 0) : 0.0;
+		size_t rank = 0;
+		while (rank < hankelSingularValues.getRows() && hankelSingularValues(rank, 0) > sigmaMax * 1e-14)
+			++rank;
+		order = std::min(order, rank);
+
+		// Right projection T = Lp * V_r * S_r^-1/2, left projection W = Lq * U_r * S_r^-1/2
+		Matrix Vr(V.getRows(), order);
+		Matrix Ur(U.getRows(), order);
+		for (size_t c = 0; c < order; ++c)
+		{
+			double scale = 1.0 / std::sqrt(hankelSingularValues(c, 0));
+			for (size_t r = 0; r < V.getRows(); ++r)
+				Vr(r, c) = V(r, c) * scale;
+			for (size_t r = 0; r < U.getRows(); ++r)
+				Ur(r, c) = U(r, c) * scale;
+		}
+		Matrix T = LinearAlgebra::multiply(Lp, Vr);
+		Matrix Wt = LinearAlgebra::multiply(Lq, Ur).getTransposed();
+
+		Matrix Ar = LinearAlgebra::multiply(LinearAlgebra::multiply(Wt, A), T);
+		Matrix Br = LinearAlgebra::multiply(Wt, B);
+		Matrix Cr = LinearAlgebra::multiply(C, T);
+
+		// Projecting Ad, Bd, Cd would mix the truncation with the discretization of the full model,
+		// the reduced continuous model is discretized again instead
+		Matrix Adr, Bdr, Cdr, Ddr;
+		if (Ad.getRows() == n && Ad.getCols() == n)
+			discretize(Ar, Br, Cr, D, timeStep, c2dMethod, Adr, Bdr, Cdr, Ddr);
+		Matrix x0r = (x0.getRows() == n) ? LinearAlgebra::multiply(Wt, x0) : Matrix(order, 1);
+
+		StateSpaceModel reduced(Ar, Br, Cr, D, Adr, Bdr, Cdr, Ddr, x0r, timeStep, c2dMethod);
+		reduced.setIntegrationSolver(solver);
+		return reduced;
+	}
+
 	std::string StateSpaceModel::toString() const
 	{
 		std::string str = "StateSpaceModel:\n";
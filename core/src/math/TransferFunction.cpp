@@ -22,43 +22,77 @@ namespace MatlabAPI
 		}
 	}
 
+	TransferFunction::TransferFunction(std::vector<double>&& num, std::vector<double>&& den)
+		: numerator(std::move(num))
+		, denominator(std::move(den))
+	{
+		if (denominator.empty() || (denominator.size() == 1 && denominator[0] == 0.0))
+		{
+			throw std::invalid_argument("Denominator cannot be zero.");
+		}
+	}
+	TransferFunction::TransferFunction(const double* num, size_t numSize, const double* den, size_t denSize)
+		: numerator(num, num + numSize)
+		, denominator(den, den + denSize)
+	{
+		if (denominator.empty() || (denominator.size() == 1 && denominator[0] == 0.0))
+		{
+			throw std::invalid_argument("Denominator cannot be zero.");
+		}
+	}
+
 	TransferFunction::TransferFunction(const TransferFunction& other)
 		: numerator(other.numerator)
 		, denominator(other.denominator)
 	{
 
 	}
+	TransferFunction::TransferFunction(TransferFunction&& other) noexcept
+		: numerator(std::move(other.numerator))
+		, denominator(std::move(other.denominator))
+	{
+		// The moved-from object stays a valid transfer function (ZERO), its denominator is never empty
+		other.numerator.assign(1, 0.0);
+		other.denominator.assign(1, 1.0);
+	}
 
-	void TransferFunction::operator=(const TransferFunction& other)
+	TransferFunction& TransferFunction::operator=(const TransferFunction& other)
 	{
 		if (this != &other)
 		{
 			numerator = other.numerator;
 			denominator = other.denominator;
 		}
+		return *this;
+	}
+	TransferFunction& TransferFunction::operator=(TransferFunction&& other) noexcept
+	{
+		if (this != &other)
+		{
+			numerator = std::move(other.numerator);
+			denominator = std::move(other.denominator);
+			other.numerator.assign(1, 0.0);
+			other.denominator.assign(1, 1.0);
+		}
+		return *this;
 	}
 
 	StateSpaceModel TransferFunction::toStateSpaceModel(double timeStep, StateSpaceModel::C2DMethod methode) const
 	{
-		if (!MatlabEngine::isInstantiated())
+		if (!MatlabEngine::isAvailable())
 		{
 			throw std::runtime_error("Matlab engine is not instantiated.");
 		}
 
-
-		putInMatlabWorkspace("sys");
-		MatlabEngine::eval(("sysd = c2d(sys, " + std::to_string(timeStep) + ", '"+ StateSpaceModel::c2dMethodToMatlabString(methode) + "'); [Ad,Bd,Cd,Dd] = ssdata(ss(sysd)); [A,B,C,D] = ssdata(ss(sys));").c_str());
-		Matrix Ad = MatlabEngine::getMatrix("Ad");
-		Matrix Bd = MatlabEngine::getMatrix("Bd");
-		Matrix Cd = MatlabEngine::getMatrix("Cd");
-		Matrix Dd = MatlabEngine::getMatrix("Dd");
-
-		Matrix A = MatlabEngine::getMatrix("A");
-		Matrix B = MatlabEngine::getMatrix("B");
-		Matrix C = MatlabEngine::getMatrix("C");
-		Matrix D = MatlabEngine::getMatrix("D");
-
-		return StateSpaceModel(A, B, C, D, Ad, Bd, Cd, Dd, Matrix(B.getRows(), 1), timeStep, methode);
+		// tf expects row vectors
+		MatlabArray num("num", 1, numerator.size(), numerator);
+		MatlabArray den("den", 1, denominator.size(), denominator);
+		std::vector<MatlabArray> sys = MatlabEngine::feval("tf", 1, num, den);
+		if (sys.empty())
+		{
+			throw std::runtime_error("Failed to create the transfer function in MATLAB.");
+		}
+		return StateSpaceModel::fromMatlabSystem(sys[0], timeStep, methode);
 	}
 
 	void TransferFunction::putInMatlabWorkspace(const std::string& varName) const
@@ -75,9 +109,12 @@ namespace MatlabAPI
 			denMat(0, i) = denominator[i];
 		}
 
-		MatlabEngine::addVariable(numMat.toMatlabArray("num"));
-		MatlabEngine::addVariable(denMat.toMatlabArray("den"));
-		MatlabEngine::eval((varName + " = tf(num, den);").c_str());
+		MatlabEngine::WorkspaceScope scope;
+		std::string num = scope.getName("num");
+		std::string den = scope.getName("den");
+		MatlabEngine::addVariable(numMat.toMatlabArray(num));
+		MatlabEngine::addVariable(denMat.toMatlabArray(den));
+		MatlabEngine::eval((varName + " = tf(" + num + ", " + den + ");").c_str());
 	}
 
 }
\ No newline at end of file
@@ -15,7 +15,7 @@ namespace MatlabAPI
         : QWidget(parent) 
 		, m_figureName(figureName)
     {
-        if(!MatlabEngine::isInstantiated())
+        if(!MatlabEngine::isAvailable())
 			MatlabEngine::instantiate();
         m_embeddedWidget = nullptr;
         m_figureHandle = 0;
@@ -31,19 +31,21 @@ namespace MatlabAPI
 
     bool MatlabEmbeddedPlotWidget::createMatlabFigure()
     {
+        MatlabEngine::WorkspaceScope scope;
+        std::string fig = scope.getName("fig");
+
         // Create a MATLAB figure and make it visible
-        MatlabEngine::eval(("fig = figure('Name', '"+ m_figureName.toStdString()+"', 'NumberTitle', 'off');").c_str());
-        MatlabEngine::eval("set(fig, 'MenuBar', 'none', 'ToolBar', 'figure');");
+        MatlabEngine::eval((fig + " = figure('Name', '"+ m_figureName.toStdString()+"', 'NumberTitle', 'off');").c_str());
+        MatlabEngine::eval(("set(" + fig + ", 'MenuBar', 'none', 'ToolBar', 'figure');").c_str());
 
         // Get figure handle
-        MatlabArray* figHandle = MatlabEngine::getVariable("fig");
-        if (!figHandle) return false;
+        MatlabArray figHandle = MatlabEngine::getVariable(fig);
+        if (!figHandle.isValid()) return false;
 #ifdef MATLAB_API_USE_CPP_API
-        m_figureHandle = (int)MatlabEngine::getProperty(figHandle, u"Number").getScalar();
+        m_figureHandle = (int)MatlabEngine::getProperty(&figHandle, u"Number").getScalar();
 #else
-		m_figureHandle = static_cast<int>(*(figHandle->getPr()));
+		m_figureHandle = static_cast<int>(*(figHandle.getPr()));
 #endif
-		MatlabEngine::removeVariable("fig");
    
 
         // Small delay to let MATLAB create the window
@@ -64,30 +66,36 @@ namespace MatlabAPI
         if (m_figureHandle == 0) 
             return;
 
+        // All commands and transfers are sent in one batch
+        MatlabEngine::WorkspaceScope scope;
+        std::string xData = scope.getName("x_data");
+        std::string yData = scope.getName("y_data");
+        MatlabEngine::Batch batch;
+
         // Set current figure
-        QString cmd = QString("figure(%1);").arg(m_figureHandle);
-        MatlabEngine::eval(cmd.toStdString().c_str());
+        batch.eval(QString("figure(%1);").arg(m_figureHandle).toStdString());
 
         // Send data to MATLAB
-        sendVectorToMatlab("x_data", x);
-        sendVectorToMatlab("y_data", y);
+        batch.put(MatlabArray(xData, x));
+        batch.put(MatlabArray(yData, y));
 
         // Create plot
-        MatlabEngine::eval("plot(x_data, y_data);");
-        MatlabEngine::eval("grid on;");
+        batch.eval("plot(" + xData + ", " + yData + ");");
+        batch.eval("grid on;");
 
         if (!title.isEmpty()) {
             QString titleCmd = QString("title('%1');").arg(title);
-            MatlabEngine::eval(titleCmd.toStdString().c_str());
+            batch.eval(titleCmd.toStdString());
         }
         if (!xlabel.isEmpty()) {
             QString xlabelCmd = QString("xlabel('%1');").arg(xlabel);
-            MatlabEngine::eval(xlabelCmd.toStdString().c_str());
+            batch.eval(xlabelCmd.toStdString());
         }
         if (!ylabel.isEmpty()) {
             QString ylabelCmd = QString("ylabel('%1');").arg(ylabel);
-            MatlabEngine::eval(ylabelCmd.toStdString().c_str());
+            batch.eval(ylabelCmd.toStdString());
         }
+        batch.flush();
     }
 
     void MatlabEmbeddedPlotWidget::plot3D(
@@ -98,14 +106,19 @@ namespace MatlabAPI
         if (m_figureHandle == 0) 
             return;
 
-        QString cmd = QString("figure(%1);").arg(m_figureHandle);
-        MatlabEngine::eval(cmd.toStdString().c_str());
+        MatlabEngine::WorkspaceScope scope;
+        std::string xData = scope.getName("x_data");
+        std::string yData = scope.getName("y_data");
+        std::string zData = scope.getName("z_data");
+        MatlabEngine::Batch batch;
+        batch.eval(QString("figure(%1);").arg(m_figureHandle).toStdString());
 
-        sendVectorToMatlab("x_data", x);
-        sendVectorToMatlab("y_data", y);
-        sendVectorToMatlab("z_data", z);
+        batch.put(MatlabArray(xData, x));
+        batch.put(MatlabArray(yData, y));
+        batch.put(MatlabArray(zData, z));
 
-        MatlabEngine::eval("plot3(x_data, y_data, z_data); grid on; rotate3d on;");
+        batch.eval("plot3(" + xData + ", " + yData + ", " + zData + "); grid on; rotate3d on;");
+        batch.flush();
     }
 
     void MatlabEmbeddedPlotWidget::surf(
@@ -116,24 +129,27 @@ namespace MatlabAPI
     {
         if (m_figureHandle == 0) return;
 
-        QString cmd = QString("figure(%1);").arg(m_figureHandle);
-        MatlabEngine::eval(cmd.toStdString().c_str());
+        // The expression refers to X and Y, which are the arguments of an anonymous function,
+        // so variables named X, Y or Z in the workspace of the user are neither used nor overwritten
+        MatlabEngine::WorkspaceScope scope;
+        QString xGrid = QString::fromStdString(scope.getName("X"));
+        QString yGrid = QString::fromStdString(scope.getName("Y"));
+        QString zGrid = QString::fromStdString(scope.getName("Z"));
+        QString function = QString::fromStdString(scope.getName("surf_function"));
+        MatlabEngine::Batch batch;
+        batch.eval(QString("figure(%1);").arg(m_figureHandle).toStdString());
 
         // Create meshgrid and surface
-        QString meshCmd = QString("[X, Y] = meshgrid(linspace(%1, %2, %3), linspace(%4, %5, %3));")
-            .arg(xmin).arg(xmax).arg(gridSize).arg(ymin).arg(ymax);
-        MatlabEngine::eval(meshCmd.toStdString().c_str());
+        QString meshCmd = QString("[%6, %7] = meshgrid(linspace(%1, %2, %3), linspace(%4, %5, %3));")
+            .arg(xmin).arg(xmax).arg(gridSize).arg(ymin).arg(ymax).arg(xGrid).arg(yGrid);
+        batch.eval(meshCmd.toStdString());
 
-        QString surfCmd = QString("Z = %1; surf(X, Y, Z); shading interp;").arg(expression);
-        MatlabEngine::eval(surfCmd.toStdString().c_str());
+        QString surfCmd = QString("%1 = @(X, Y) %2; %3 = %1(%4, %5); surf(%4, %5, %3); shading interp;")
+            .arg(function, expression, zGrid, xGrid, yGrid);
+        batch.eval(surfCmd.toStdString());
 
-        MatlabEngine::eval("colorbar; rotate3d on;");
-    }
-
-    void MatlabEmbeddedPlotWidget::sendVectorToMatlab(const QString& varName, const std::vector<double>& data) 
-    {
-		MatlabArray* array = new MatlabArray(varName.toStdString(), data);
-		MatlabEngine::addVariable(array);
+        batch.eval("colorbar; rotate3d on;");
+        batch.flush();
     }
 
     bool MatlabEmbeddedPlotWidget::embedMatlabWindow()
@@ -154,8 +170,11 @@ namespace MatlabAPI
     bool MatlabEmbeddedPlotWidget::embedWindowsHandle()
     {
         // Get MATLAB figure window handle
-        QString cmd = QString("hwnd = get(%1, 'Number'); disp(hwnd);").arg(m_figureHandle);
-        MatlabEngine::eval(cmd.toStdString().c_str());
+        {
+            MatlabEngine::WorkspaceScope scope;
+            QString cmd = QString("%2 = get(%1, 'Number'); disp(%2);").arg(m_figureHandle).arg(QString::fromStdString(scope.getName("hwnd")));
+            MatlabEngine::eval(cmd.toStdString().c_str());
+        }
 
         // Get all figure windows and find ours
         m_matlabHwnd = getMatlabFigureHwnd();
@@ -198,37 +217,45 @@ namespace MatlabAPI
         if (m_figureHandle == 0) 
             return nullptr;
 
+        // Helper variables of the commands below
+        MatlabEngine::WorkspaceScope scope;
+        QString javaFrame = QString::fromStdString(scope.getName("javaFrame"));
+        QString hwndVal = QString::fromStdString(scope.getName("hwndVal"));
+        QString fig = QString::fromStdString(scope.getName("fig"));
+        QString jFrame = QString::fromStdString(scope.getName("jFrame"));
+        QString jClient = QString::fromStdString(scope.getName("jClient"));
+
         // Get the figure's JavaFrame (this is the key!)
         MatlabEngine::eval("drawnow;"); // Ensure figure is drawn
 
         QString cmd = QString(
-            "javaFrame = get(%1, 'JavaFrame'); "
-            "if ~isempty(javaFrame), "
-            "  hwndVal = javaFrame.fHG2Client.getWindow.getHWnd; "
+            "%2 = get(%1, 'JavaFrame'); "
+            "if ~isempty(%2), "
+            "  %3 = %2.fHG2Client.getWindow.getHWnd; "
             "else, "
-            "  hwndVal = 0; "
+            "  %3 = 0; "
             "end"
-        ).arg(m_figureHandle);
+        ).arg(m_figureHandle).arg(javaFrame).arg(hwndVal);
 
         MatlabEngine::eval(cmd.toStdString().c_str());
 
         // Get the HWND value
-        MatlabArray* hwndArray = MatlabEngine::getVariable("hwndVal");
-        if (!hwndArray || !hwndArray->isDouble()) {
-            if (hwndArray)
-                MatlabEngine::removeVariable(hwndArray->getName());
+        MatlabArray hwndArray = MatlabEngine::getVariable(hwndVal.toStdString());
+        if (!hwndArray.isDouble()) {
+            if (hwndArray.isValid())
+                MatlabEngine::removeVariable(hwndArray.getName());
             //return nullptr;
         }
         else
         {
 #ifdef MATLAB_API_USE_CPP_API
-            matlab::data::TypedArray<double> typedHwndArray = hwndArray->getAPIArray();
+            matlab::data::TypedArray<double> typedHwndArray = hwndArray.getAPIArray();
             double hwndValue = typedHwndArray[0];
 #else
-            double hwndValue = *hwndArray->getPr();
+            double hwndValue = *hwndArray.getPr();
 #endif
             
-            MatlabEngine::removeVariable(hwndArray->getName());
+            MatlabEngine::removeVariable(hwndArray.getName());
 
             HWND windowHandle = reinterpret_cast<HWND>(static_cast<uintptr_t>(hwndValue));
             if (windowHandle)
@@ -240,34 +267,34 @@ namespace MatlabAPI
         // For newer MATLAB versions, try different approach
         cmd = QString(
             "try, "
-            "  fig = %1; "
+            "  %2 = %1; "
             "  drawnow; "
             "  warning('off', 'MATLAB:HandleGraphics:ObsoletedProperty:JavaFrame'); "
-            "  jFrame = get(fig, 'JavaFrame'); "
-            "  jClient = jFrame.fHG2Client; "
-            "  hwndVal = jClient.getWindow.getHWnd; "
+            "  %3 = get(%2, 'JavaFrame'); "
+            "  %4 = %3.fHG2Client; "
+            "  %5 = %4.getWindow.getHWnd; "
             "catch, "
-            "  hwndVal = 0; "
+            "  %5 = 0; "
             "end"
-        ).arg(m_figureHandle);
+        ).arg(m_figureHandle).arg(fig).arg(jFrame).arg(jClient).arg(hwndVal);
 
         MatlabEngine::eval(cmd.toStdString().c_str());
 
-        hwndArray = MatlabEngine::getVariable("hwndVal");
-        if (!hwndArray || !hwndArray->isDouble()) {
-            if (hwndArray)
-                MatlabEngine::removeVariable(hwndArray->getName());
+        hwndArray = MatlabEngine::getVariable(hwndVal.toStdString());
+        if (!hwndArray.isDouble()) {
+            if (hwndArray.isValid())
+                MatlabEngine::removeVariable(hwndArray.getName());
             //return nullptr;
         }
         else
         {
 #ifdef MATLAB_API_USE_CPP_API
-            matlab::data::TypedArray<double> typedHwndArray = hwndArray->getAPIArray();
+            matlab::data::TypedArray<double> typedHwndArray = hwndArray.getAPIArray();
             double hwndValue = typedHwndArray[0];
 #else
-            double hwndValue = *hwndArray->getPr();
+            double hwndValue = *hwndArray.getPr();
 #endif
-            MatlabEngine::removeVariable(hwndArray->getName());
+            MatlabEngine::removeVariable(hwndArray.getName());
 
             HWND windowHandle = reinterpret_cast<HWND>(static_cast<uintptr_t>(hwndValue));
             if (windowHandle)
@@ -0,0 +1,29 @@
+## description: zlib, optional, enables compressed variables in MatFileWriter / MatFileReader
+
+function(dep LIBRARY_MACRO_NAME SHARED_LIB STATIC_LIB STATIC_PROFILE_LIB)
+    set(LIB_MACRO_NAME ZLIB_AVAILABLE)
+    find_package(ZLIB)
+    if(NOT ZLIB_FOUND)
+        message("zlib not found, MAT-files are written uncompressed")
+        return()
+    endif()
+
+    # Include directories
+    include_directories(${ZLIB_INCLUDE_DIRS})
+
+    set(ZLIB_LIBS
+        ZLIB::ZLIB
+    )
+
+    # Add this library to the specific profiles of this project
+    list(APPEND DEPS_FOR_SHARED_LIB ${ZLIB_LIBS})
+    list(APPEND DEPS_FOR_STATIC_LIB ${ZLIB_LIBS})
+    list(APPEND DEPS_FOR_STATIC_PROFILE_LIB ${ZLIB_LIBS}) # only use for static profiling profile
+
+	set(${LIBRARY_MACRO_NAME} "${${LIBRARY_MACRO_NAME}};${LIB_MACRO_NAME}" PARENT_SCOPE)
+    set(${SHARED_LIB} "${${SHARED_LIB}};${DEPS_FOR_SHARED_LIB}" PARENT_SCOPE)
+    set(${STATIC_LIB} "${${STATIC_LIB}};${DEPS_FOR_STATIC_LIB}" PARENT_SCOPE)
+    set(${STATIC_PROFILE_LIB} "${${STATIC_PROFILE_LIB}};${DEPS_FOR_STATIC_PROFILE_LIB}" PARENT_SCOPE)
+endfunction()
+
+dep(DEPENDENCY_NAME_MACRO DEPENDENCIES_FOR_SHARED_LIB DEPENDENCIES_FOR_STATIC_LIB DEPENDENCIES_FOR_STATIC_PROFILE_LIB)
@@ -6,4 +6,12 @@
 #include "tests/TST_QTPlot.h"
 #include "tests/TST_Matrix.h"
 #include "tests/TST_StateSpaceModel.h"
+#include "tests/TST_ModelReduction.h"
+#include "tests/TST_BulkTransfer.h"
+#include "tests/TST_ChunkedTransfer.h"
+#include "tests/TST_StructSchema.h"
+#include "tests/TST_EngineBackend.h"
+#include "tests/TST_Utf.h"
+#include "tests/TST_MatFile.h"
+#include "tests/TST_NumericConversion.h"
 //#include "test_nasted.h"
\ No newline at end of file
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "UnitTest.h"
+#include "MatlabAPI.h"
+#include <chrono>
+
+
+
+using namespace MatlabAPI;
+class TST_BulkTransfer : public UnitTest::Test
+{
+	TEST_CLASS(TST_BulkTransfer)
+public:
+	TST_BulkTransfer()
+		: Test("TST_BulkTransfer")
+	{
+		ADD_TEST(TST_BulkTransfer::roundTrip);
+		ADD_TEST(TST_BulkTransfer::matrix);
+		ADD_TEST(TST_BulkTransfer::benchmark);
+
+	}
+
+private:
+	// Tests
+	TEST_FUNCTION(roundTrip)
+	{
+		TEST_START;
+
+		const size_t rows = 3;
+		const size_t cols = 4;
+		BulkTransfer::Region region = BulkTransfer::allocate<float>("bulk_x", rows, cols);
+		TEST_ASSERT(region.isValid());
+		for (size_t i = 0; i < rows * cols; ++i)
+			region.data<float>()[i] = (float)i;
+		TEST_ASSERT(region.commit());
+
+		std::vector<float> values;
+		size_t receivedRows = 0;
+		size_t receivedCols = 0;
+		TEST_ASSERT(BulkTransfer::receive("bulk_x", values, receivedRows, receivedCols));
+		TEST_ASSERT(receivedRows == rows && receivedCols == cols);
+		for (size_t i = 0; i < rows * cols; ++i)
+			TEST_ASSERT(values[i] == (float)i);
+
+		// Missing variables are reported, not thrown
+		TEST_ASSERT(!BulkTransfer::receive("bulk_missing", values, receivedRows, receivedCols));
+		MatlabEngine::eval("clear bulk_x");
+	}
+
+	TEST_FUNCTION(matrix)
+	{
+		TEST_START;
+
+		Matrix m(2, 3);
+		for (size_t r = 0; r < 2; ++r)
+			for (size_t c = 0; c < 3; ++c)
+				m(r, c) = (double)(r * 10 + c);
+		TEST_ASSERT(BulkTransfer::send("bulk_m", m));
+		TEST_ASSERT(MatlabEngine::getMatrix("bulk_m") == m);
+		TEST_ASSERT(BulkTransfer::receiveMatrix("bulk_m") == m);
+		MatlabEngine::removeVariable("bulk_m");
+	}
+
+	// Compares the throughput of the mapped file with the engine transfer
+	TEST_FUNCTION(benchmark)
+	{
+		TEST_START;
+
+		const size_t rows = 1000000;
+		const size_t cols = 8;
+		const double megabytes = (double)(rows * cols * sizeof(double)) / (1024.0 * 1024.0);
+		std::vector<double> data(rows * cols);
+		for (size_t i = 0; i < data.size(); ++i)
+			data[i] = (double)i;
+
+		auto start = std::chrono::steady_clock::now();
+		TEST_ASSERT(MatlabEngine::addVariable(new MatlabArray("bulk_engine", rows, cols, data)));
+		auto engineTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		start = std::chrono::steady_clock::now();
+		TEST_ASSERT(BulkTransfer::send("bulk_mapped", data.data(), rows, cols));
+		auto mappedTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		Logger::logInfo("BulkTransfer benchmark, " + std::to_string(megabytes) + " MB: engine "
+			+ std::to_string(megabytes / engineTime) + " MB/s, mapped file " + std::to_string(megabytes / mappedTime) + " MB/s");
+
+		std::vector<double> received;
+		size_t receivedRows = 0;
+		size_t receivedCols = 0;
+		start = std::chrono::steady_clock::now();
+		TEST_ASSERT(BulkTransfer::receive("bulk_mapped", received, receivedRows, receivedCols));
+		auto receiveTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		Logger::logInfo("BulkTransfer benchmark, receive: " + std::to_string(megabytes / receiveTime) + " MB/s");
+		TEST_ASSERT(received == data);
+
+		MatlabEngine::removeVariable("bulk_engine");
+		MatlabEngine::eval("clear bulk_mapped");
+	}
+};
+
+TEST_INSTANTIATE(TST_BulkTransfer);
@@ -0,0 +1,126 @@
+#pragma once
+
+#include "UnitTest.h"
+#include "MatlabAPI.h"
+#include <chrono>
+
+
+
+using namespace MatlabAPI;
+class TST_ChunkedTransfer : public UnitTest::Test
+{
+	TEST_CLASS(TST_ChunkedTransfer)
+public:
+	TST_ChunkedTransfer()
+		: Test("TST_ChunkedTransfer")
+	{
+		ADD_TEST(TST_ChunkedTransfer::matrix);
+		ADD_TEST(TST_ChunkedTransfer::producerConsumer);
+		ADD_TEST(TST_ChunkedTransfer::benchmark);
+
+	}
+
+private:
+	// Tests
+	TEST_FUNCTION(matrix)
+	{
+		TEST_START;
+
+		// 3 rows of 4 doubles per block, the last block is a single row
+		Matrix m(10, 4);
+		for (size_t r = 0; r < 10; ++r)
+			for (size_t c = 0; c < 4; ++c)
+				m(r, c) = (double)(r * 10 + c);
+		const size_t chunkSize = 3 * 4 * sizeof(double);
+		TEST_ASSERT(ChunkedTransfer::getRowsPerChunk(4 * sizeof(double), chunkSize) == 3);
+		TEST_ASSERT(ChunkedTransfer::send("chunked_m", m, chunkSize));
+		TEST_ASSERT(MatlabEngine::getMatrix("chunked_m") == m);
+		TEST_ASSERT(ChunkedTransfer::receiveMatrix("chunked_m", chunkSize) == m);
+		TEST_ASSERT(ChunkedTransfer::receiveMatrix("chunked_m", 1) == m); // one row per block
+
+		// Empty matrices keep their columns
+		TEST_ASSERT(ChunkedTransfer::send("chunked_empty", Matrix(0, 3), chunkSize));
+		MatlabEngine::RemoteVariable empty = MatlabEngine::getRemoteVariable("chunked_empty");
+		TEST_ASSERT(empty.isValid() && empty.getRows() == 0 && empty.getCols() == 3);
+
+		TEST_ASSERT(ChunkedTransfer::receiveMatrix("chunked_missing").getRows() == 0);
+		MatlabEngine::eval("clear chunked_m chunked_empty");
+	}
+
+	TEST_FUNCTION(producerConsumer)
+	{
+		TEST_START;
+
+		// int16 samples, value = row - column, produced and consumed in blocks of 7 rows
+		const size_t rows = 50;
+		const size_t cols = 2;
+		const size_t chunkSize = 7 * cols * sizeof(int16_t);
+		size_t produced = 0;
+		TEST_ASSERT(ChunkedTransfer::send("chunked_samples", rows, cols, sizeof(int16_t), [&](size_t first, size_t count) {
+			ArrayBuffer<int16_t> buffer = MatlabArray::createBuffer<int16_t>(count * cols);
+			for (size_t c = 0; c < cols; ++c)
+				for (size_t r = 0; r < count; ++r)
+					buffer.data()[c * count + r] = (int16_t)(first + r) - (int16_t)c;
+			produced += count;
+			return MatlabArray("block", std::move(buffer), { count, cols });
+			}, chunkSize));
+		TEST_ASSERT(produced == rows);
+
+		size_t consumed = 0;
+		bool ordered = true;
+		TEST_ASSERT(ChunkedTransfer::receive("chunked_samples", [&](size_t first, const MatlabArray& block) {
+			ordered &= first == consumed && block.isInt16() && block.getN() == cols;
+			for (size_t r = 0; r < block.getM(); ++r)
+				ordered &= block.getRowData<int16_t>(r) == std::vector<int16_t>({ (int16_t)(first + r), (int16_t)(first + r - 1) });
+			consumed += block.getM();
+			return true;
+			}, chunkSize));
+		TEST_ASSERT(ordered && consumed == rows);
+
+		// A consumer can stop the transfer, a producer can abort it with an invalid block
+		consumed = 0;
+		TEST_ASSERT(!ChunkedTransfer::receive("chunked_samples", [&](size_t, const MatlabArray& block) {
+			consumed += block.getM();
+			return false;
+			}, chunkSize));
+		TEST_ASSERT(consumed == 7);
+		TEST_ASSERT(!ChunkedTransfer::send("chunked_samples", rows, cols, sizeof(int16_t), [&](size_t first, size_t count) {
+			return first == 0 ? MatlabArray("block", count, cols, std::vector<double>(count * cols)) : MatlabArray("block");
+			}, chunkSize));
+		MatlabEngine::eval("clear chunked_samples");
+	}
+
+	// Compares the chunked transfer of a Matrix with addVariable(), which converts the whole matrix at once
+	TEST_FUNCTION(benchmark)
+	{
+		TEST_START;
+
+		const size_t rows = 1000000;
+		const size_t cols = 8;
+		const double megabytes = (double)(rows * cols * sizeof(double)) / (1024.0 * 1024.0);
+		Matrix m(rows, cols);
+		for (size_t i = 0; i < rows * cols; ++i)
+			m.data()[i] = (double)i;
+
+		auto start = std::chrono::steady_clock::now();
+		TEST_ASSERT(MatlabEngine::addVariable(m.toMatlabArray("chunked_engine")));
+		auto engineTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		start = std::chrono::steady_clock::now();
+		TEST_ASSERT(ChunkedTransfer::send("chunked_blocks", m, 4 * 1024 * 1024));
+		auto chunkedTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		start = std::chrono::steady_clock::now();
+		TEST_ASSERT(ChunkedTransfer::receiveMatrix("chunked_blocks", 4 * 1024 * 1024) == m);
+		auto receiveTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		Logger::logInfo("ChunkedTransfer benchmark, " + std::to_string(megabytes) + " MB: engine "
+			+ std::to_string(megabytes / engineTime) + " MB/s, chunked " + std::to_string(megabytes / chunkedTime)
+			+ " MB/s, chunked receive " + std::to_string(megabytes / receiveTime) + " MB/s");
+
+		MatlabEngine::removeVariable("chunked_engine");
+		MatlabEngine::eval("clear chunked_blocks");
+	}
+};
+
+TEST_INSTANTIATE(TST_ChunkedTransfer);
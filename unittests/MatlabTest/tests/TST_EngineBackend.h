@@ -0,0 +1,533 @@
+#pragma once
+
+#include "UnitTest.h"
+#include "MatlabAPI.h"
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+
+
+using namespace MatlabAPI;
+
+// Forwards the basic calls to another backend, so that the default implementations
+// of the metadata and indexing calls run against it
+class TST_EngineBackend_Forwarding : public EngineBackend
+{
+public:
+	explicit TST_EngineBackend_Forwarding(EngineBackend& target)
+		: m_target(target)
+	{}
+	std::string getName() const override { return "Forwarding"; }
+
+protected:
+	int doEval(const std::string& command) override { return m_target.eval(command); }
+	std::vector<MatlabArray> doFeval(const std::string& function, size_t nargout, const std::vector<MatlabArray>& args) override
+	{
+		return m_target.feval(function, nargout, args);
+	}
+	bool doSetVariable(const std::string& name, const MatlabArray& value) override { return m_target.setVariable(name, value); }
+	MatlabArray doGetVariable(const std::string& name) override { return m_target.getVariable(name); }
+
+private:
+	EngineBackend& m_target;
+};
+
+class TST_EngineBackend : public UnitTest::Test
+{
+	TEST_CLASS(TST_EngineBackend)
+public:
+	TST_EngineBackend()
+		: Test("TST_EngineBackend")
+	{
+		ADD_TEST(TST_EngineBackend::roundTrips);
+		ADD_TEST(TST_EngineBackend::c2dZoh);
+		ADD_TEST(TST_EngineBackend::c2dTustin);
+		ADD_TEST(TST_EngineBackend::latency);
+		ADD_TEST(TST_EngineBackend::pool);
+		ADD_TEST(TST_EngineBackend::telemetry);
+		ADD_TEST(TST_EngineBackend::preparedCommand);
+		ADD_TEST(TST_EngineBackend::workspaceScope);
+		ADD_TEST(TST_EngineBackend::remoteVariable);
+		ADD_TEST(TST_EngineBackend::slices);
+		ADD_TEST(TST_EngineBackend::defaultIndexing);
+		ADD_TEST(TST_EngineBackend::growingVariable);
+		ADD_TEST(TST_EngineBackend::asyncStart);
+
+	}
+
+private:
+	static bool near(double a, double b)
+	{
+		return std::abs(a - b) < 1e-9;
+	}
+
+	// Tests
+	TEST_FUNCTION(roundTrips)
+	{
+		TEST_START;
+
+		InProcessBackend backend;
+		TEST_ASSERT(backend.setVariable("x", MatlabArray("x", 1, 2, { 1.0, 2.0 })));
+		TEST_ASSERT(backend.eval("y = x * 2; z = [1 2; 3 4]'") == 0);
+		MatlabArray y = backend.getVariable("y");
+		TEST_ASSERT(y.getDoubleVector() == std::vector<double>({ 2.0, 4.0 }));
+		MatlabArray zArray = backend.getVariable("z");
+		Matrix z(&zArray);
+		TEST_ASSERT(z == Matrix({ { 1, 3 }, { 2, 4 } }));
+
+		TEST_ASSERT(backend.eval("w = undefinedFunction(x);") != 0);
+		TEST_ASSERT(!backend.getVariable("w").isValid());
+		TEST_ASSERT(backend.eval("clear x y") == 0);
+		TEST_ASSERT(backend.getVariableNames() == std::vector<std::string>({ "z" }));
+
+		EngineBackend::Statistics statistics = backend.getStatistics();
+		TEST_ASSERT(statistics.roundTrips == 7);
+		TEST_ASSERT(statistics.puts == 1);
+		TEST_ASSERT(statistics.evals == 3);
+		TEST_ASSERT(statistics.gets == 3);
+		TEST_ASSERT(statistics.errors == 2);
+		TEST_ASSERT(backend.getOperationCount() == 7);
+
+		// Operation ids are reported when the operation starts
+		std::vector<uint64_t> started;
+		backend.setOperationListener([&](uint64_t operation) { started.push_back(operation); });
+		TEST_ASSERT(backend.eval("x = 1;") == 0);
+		TEST_ASSERT(backend.getVariable("x").isValid());
+		backend.setOperationListener(nullptr);
+		TEST_ASSERT(backend.eval("clear x") == 0);
+		TEST_ASSERT(started == std::vector<uint64_t>({ 8, 9 }));
+
+		backend.resetStatistics();
+		TEST_ASSERT(backend.getStatistics().roundTrips == 0);
+	}
+
+	TEST_FUNCTION(c2dZoh)
+	{
+		TEST_START;
+
+		// Double integrator: Ad = [1 T; 0 1], Bd = [T^2/2; T]
+		InProcessBackend backend;
+		TEST_ASSERT(backend.eval("sys = ss([0 1; 0 0], [0; 1], [1 0], 0); sysd = c2d(sys, 0.5, 'zoh');") == 0);
+		std::vector<MatlabArray> data = backend.feval("ssdata", 4, { backend.getVariable("sysd") });
+		TEST_ASSERT(data.size() == 4);
+		if (data.size() != 4)
+			return;
+		Matrix Ad(&data[0]);
+		Matrix Bd(&data[1]);
+		TEST_ASSERT(near(Ad(0, 0), 1.0) && near(Ad(0, 1), 0.5) && near(Ad(1, 0), 0.0) && near(Ad(1, 1), 1.0));
+		TEST_ASSERT(near(Bd(0, 0), 0.125) && near(Bd(1, 0), 0.5));
+
+		// First order lag 1/(s + 1)
+		TEST_ASSERT(backend.eval("[A, B, C, D] = ssdata(c2d(tf(1, [1 1]), 0.1));") == 0);
+		TEST_ASSERT(near(backend.getVariable("A").getScalar(), std::exp(-0.1)));
+		TEST_ASSERT(near(backend.getVariable("B").getScalar() * backend.getVariable("C").getScalar(), 1.0 - std::exp(-0.1)));
+		TEST_ASSERT(near(backend.getVariable("D").getScalar(), 0.0));
+	}
+
+	TEST_FUNCTION(c2dTustin)
+	{
+		TEST_START;
+
+		InProcessBackend backend;
+		TEST_ASSERT(backend.eval("[A, B, C, D] = ssdata(c2d(tf(1, [1 1]), 0.1, 'tustin'));") == 0);
+		TEST_ASSERT(near(backend.getVariable("A").getScalar(), 0.95 / 1.05));
+		TEST_ASSERT(near(backend.getVariable("B").getScalar(), std::sqrt(0.1) / 1.05));
+		TEST_ASSERT(near(backend.getVariable("C").getScalar(), std::sqrt(0.1) / 1.05));
+		TEST_ASSERT(near(backend.getVariable("D").getScalar(), 0.05 / 1.05));
+
+		// Not supported by the stand-in
+		TEST_ASSERT(backend.eval("sysd = c2d(tf(1, [1 1]), 0.1, 'matched');") != 0);
+	}
+
+	TEST_FUNCTION(latency)
+	{
+		TEST_START;
+
+		InProcessBackend backend;
+		backend.setLatency(std::chrono::milliseconds(2));
+		const size_t calls = 10;
+		auto start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < calls; ++i)
+			TEST_ASSERT(backend.eval("x = " + std::to_string(i) + ";") == 0);
+		auto elapsed = std::chrono::steady_clock::now() - start;
+		TEST_ASSERT(elapsed >= std::chrono::milliseconds(2 * calls));
+		TEST_ASSERT(backend.getStatistics().busyTime >= std::chrono::milliseconds(2 * calls));
+		TEST_MESSAGE("10 round trips with 2ms latency took " + std::to_string(std::chrono::duration<double, std::milli>(elapsed).count()) + "ms");
+	}
+
+	TEST_FUNCTION(pool)
+	{
+		TEST_START;
+
+		EnginePool pool(2, [](size_t) { return std::unique_ptr<EngineBackend>(new InProcessBackend()); });
+		TEST_ASSERT(pool.waitForStartup() == 2);
+
+		std::vector<std::future<double>> results;
+		for (size_t i = 0; i < 8; ++i)
+		{
+			results.push_back(pool.submit([i](EnginePool::Session& session) {
+				session.setVariable("x", MatlabArray("x", (double)i));
+				session.eval("y = x * x + 1;");
+				return session.getVariable("y").getScalar();
+				}));
+		}
+		for (size_t i = 0; i < results.size(); ++i)
+			TEST_ASSERT(results[i].get() == (double)(i * i + 1));
+
+		// Destroying the pool fails the queued jobs before it waits for the running one
+		std::unique_ptr<EnginePool> busyPool(new EnginePool(1, [](size_t) { return std::unique_ptr<EngineBackend>(new InProcessBackend()); }));
+		std::promise<void> started;
+		std::promise<void> release;
+		std::shared_future<void> released = release.get_future().share();
+		std::future<int> running = busyPool->submit([&started, released](EnginePool::Session&) {
+			started.set_value();
+			released.wait();
+			return 1;
+			});
+		std::future<int> queued = busyPool->submit([](EnginePool::Session&) { return 2; });
+		started.get_future().wait();
+		std::thread destroyer([&busyPool]() { busyPool.reset(); });
+		TEST_ASSERT(queued.wait_for(std::chrono::seconds(5)) == std::future_status::ready);
+		bool failed = false;
+		try { queued.get(); }
+		catch (const std::runtime_error&) { failed = true; }
+		TEST_ASSERT(failed);
+		release.set_value();
+		destroyer.join();
+		TEST_ASSERT(running.get() == 1);
+	}
+
+	TEST_FUNCTION(telemetry)
+	{
+		TEST_START;
+
+		EngineTelemetry::reset();
+		MatlabArray* a = new MatlabArray("telemetryA", 1, 4, { 1.0, 2.0, 3.0, 4.0 });
+		TEST_ASSERT(MatlabEngine::addVariable(a));
+		TEST_ASSERT(a->updateToEngine()); // unchanged, no transfer
+		TEST_ASSERT(MatlabEngine::eval("telemetryB = telemetryA * 2;") == 0);
+		TEST_ASSERT(MatlabEngine::getVariable("telemetryB").isValid());
+		TEST_ASSERT(MatlabEngine::removeVariable("telemetryB"));
+		TEST_ASSERT(!MatlabEngine::removeVariable("telemetryB"));
+		TEST_ASSERT(MatlabEngine::removeVariable("telemetryA"));
+
+		EngineTelemetry::Snapshot snapshot = EngineTelemetry::getSnapshot();
+		TEST_ASSERT(snapshot.get(EngineTelemetry::Operation::AddVariable).calls == 1);
+		TEST_ASSERT(snapshot.get(EngineTelemetry::Operation::AddVariable).bytesToEngine == 4 * sizeof(double));
+		TEST_ASSERT(snapshot.get(EngineTelemetry::Operation::SendVariable).calls == 1);
+		TEST_ASSERT(snapshot.get(EngineTelemetry::Operation::SendVariable).bytesToEngine == 0);
+		TEST_ASSERT(snapshot.get(EngineTelemetry::Operation::GetVariable).bytesFromEngine == 4 * sizeof(double));
+		TEST_ASSERT(snapshot.get(EngineTelemetry::Operation::RemoveVariable).calls == 3);
+		TEST_ASSERT(snapshot.get(EngineTelemetry::Operation::RemoveVariable).errors == 1);
+		TEST_ASSERT(snapshot.variables.count("telemetryA") == 1 && snapshot.variables.count("telemetryB") == 1);
+		TEST_ASSERT(snapshot.getTotal().latency.getCount() == snapshot.getTotal().calls);
+		TEST_ASSERT(snapshot.toJson().find("\"removeVariable\":{\"calls\":3,\"errors\":1") != std::string::npos);
+	}
+
+	TEST_FUNCTION(preparedCommand)
+	{
+		TEST_START;
+
+		MatlabEngine::PreparedCommand command = MatlabEngine::prepare("preparedY = $a * 2 + $b; preparedS = '$a'; preparedZ = $a';");
+		TEST_ASSERT(command.isValid());
+		TEST_ASSERT(command.getParameterNames() == std::vector<std::string>({ "a", "b" }));
+
+		TEST_ASSERT(command.execute(1.5, 3.0) == 0);
+		TEST_ASSERT(MatlabEngine::getVariable("preparedY").getScalar() == 6.0);
+		TEST_ASSERT(MatlabEngine::getVariable("preparedS").getString() == "$a");
+
+		// Values are transferred, not formatted: no rounding
+		TEST_ASSERT(command.bind("a", 0.1).execute() == 0);
+		TEST_ASSERT(MatlabEngine::getVariable("preparedY").getScalar() == 0.1 * 2 + 3.0);
+		TEST_ASSERT(MatlabEngine::getVariable("preparedZ").getScalar() == 0.1);
+
+		// Values equal to the transferred ones are not sent again
+		EngineTelemetry::reset();
+		TEST_ASSERT(command.execute(0.1, 3.0) == 0);
+		TEST_ASSERT(EngineTelemetry::getSnapshot().get(EngineTelemetry::Operation::Eval).bytesToEngine == 0);
+		TEST_ASSERT(command.execute(0.1, 4.0) == 0);
+		TEST_ASSERT(EngineTelemetry::getSnapshot().get(EngineTelemetry::Operation::Eval).bytesToEngine == sizeof(double));
+		TEST_ASSERT(MatlabEngine::getVariable("preparedY").getScalar() == 0.1 * 2 + 4.0);
+
+		// After the workspace changed, the same values are sent again
+		TEST_ASSERT(MatlabEngine::eval("clear matlab_api_prepared_*") == 0);
+		EngineTelemetry::reset();
+		TEST_ASSERT(command.execute(0.1, 4.0) == 0);
+		TEST_ASSERT(EngineTelemetry::getSnapshot().get(EngineTelemetry::Operation::Eval).bytesToEngine == 2 * sizeof(double));
+		TEST_ASSERT(MatlabEngine::getVariable("preparedY").getScalar() == 0.1 * 2 + 4.0);
+
+		bool thrown = false;
+		try { command.bind("c", 1.0); }
+		catch (const std::invalid_argument&) { thrown = true; }
+		TEST_ASSERT(thrown);
+
+		MatlabEngine::PreparedCommand unbound = MatlabEngine::prepare("preparedY = $a;");
+		TEST_ASSERT(unbound.execute() != 0);
+
+		TEST_ASSERT(MatlabEngine::removeVariable("preparedY"));
+		TEST_ASSERT(MatlabEngine::removeVariable("preparedS"));
+		TEST_ASSERT(MatlabEngine::removeVariable("preparedZ"));
+	}
+
+	TEST_FUNCTION(workspaceScope)
+	{
+		TEST_START;
+
+		auto isMirrored = [](const std::string& name) {
+			std::vector<std::string> names = MatlabEngine::listVariables();
+			return std::find(names.begin(), names.end(), name) != names.end();
+		};
+
+		std::string sys;
+		{
+			MatlabEngine::WorkspaceScope scope;
+			sys = scope.getName("sys");
+			TEST_ASSERT(scope.getName("sys") == sys);
+			{
+				MatlabEngine::WorkspaceScope inner;
+				TEST_ASSERT(inner.getName("sys") != sys);
+				TEST_ASSERT(MatlabEngine::WorkspaceScope::getCurrent() == &inner);
+			}
+			TEST_ASSERT(MatlabEngine::WorkspaceScope::getCurrent() == &scope);
+
+			TEST_ASSERT(MatlabEngine::addVariable(new MatlabArray("scopeTracked", 1.0)));
+			TEST_ASSERT(MatlabEngine::eval((sys + " = scopeTracked * 2;").c_str()) == 0);
+			TEST_ASSERT(MatlabEngine::getVariable(sys).getScalar() == 2.0);
+			TEST_ASSERT(scope.getVariableNames() == std::vector<std::string>({ sys, "scopeTracked" }));
+			TEST_ASSERT(isMirrored(sys) && isMirrored("scopeTracked"));
+		}
+		TEST_ASSERT(MatlabEngine::WorkspaceScope::getCurrent() == nullptr);
+
+		// Cleared in the workspace and removed from the variable map
+		TEST_ASSERT(!isMirrored(sys) && !isMirrored("scopeTracked"));
+		TEST_ASSERT(!MatlabEngine::getVariableAsync(sys).get().isValid());
+		TEST_ASSERT(!MatlabEngine::getVariableAsync("scopeTracked").get().isValid());
+	}
+
+	TEST_FUNCTION(remoteVariable)
+	{
+		TEST_START;
+
+		// 1000 x 3 log, value = row * 10 + column
+		std::vector<double> values(3000);
+		for (size_t c = 0; c < 3; ++c)
+			for (size_t r = 0; r < 1000; ++r)
+				values[c * 1000 + r] = double(r * 10 + c);
+		TEST_ASSERT(MatlabEngine::setVariableAsync(MatlabArray("remoteLog", 1000, 3, values)).get());
+
+		EngineBackend::Statistics before = MatlabEngine::getBackend()->getStatistics();
+		MatlabEngine::RemoteVariable log = MatlabEngine::getRemoteVariable("remoteLog");
+		TEST_ASSERT(log.isValid() && log.isCurrent() && !log.isFetched());
+		TEST_ASSERT(log.getClassName() == "double" && !log.isComplex() && !log.isSparse());
+		TEST_ASSERT(log.getRows() == 1000 && log.getCols() == 3 && log.getSizeInBytes() == 3000 * sizeof(double));
+
+		// Only the last 100 rows are transferred
+		MatlabArray tail = log.getRowRange(900, 100);
+		TEST_ASSERT(tail.getM() == 100 && tail.getN() == 3);
+		TEST_ASSERT(tail.getRowData<double>(99) == std::vector<double>({ 9990, 9991, 9992 }));
+		TEST_ASSERT(!log.getRowRange(950, 100).isValid()); // checked against the metadata, not sent
+		TEST_ASSERT(!log.isFetched());
+		TEST_ASSERT(MatlabEngine::getBackend()->getStatistics().gets == before.gets + 2); // query and rows
+
+		// The whole array on first access, then served from the cache
+		TEST_ASSERT(log.getData().getDoubleVector() == values);
+		TEST_ASSERT(log.isFetched());
+		TEST_ASSERT(log.getRowRange(0, 2).getColData<double>(1) == std::vector<double>({ 1, 11 }));
+		TEST_ASSERT(MatlabEngine::getBackend()->getStatistics().gets == before.gets + 3);
+
+		TEST_ASSERT(MatlabEngine::eval("remoteLog = 5;") == 0);
+		TEST_ASSERT(!log.isCurrent());
+		TEST_ASSERT(log.refresh() && log.getRows() == 1 && !log.isFetched());
+
+		TEST_ASSERT(!MatlabEngine::getRemoteVariable("remoteMissing").isValid());
+		TEST_ASSERT(MatlabEngine::eval("clear remoteLog") == 0);
+	}
+
+	TEST_FUNCTION(slices)
+	{
+		TEST_START;
+
+		InProcessBackend backend;
+		TEST_ASSERT(backend.eval("s = zeros(3, 2)") == 0);
+		TEST_ASSERT(backend.setVariableSlice("s", EngineBackend::Slice::Rows, 1, MatlabArray("v", 1, 2, { 1.0, 2.0 })));
+		TEST_ASSERT(backend.setVariableSlice("s", EngineBackend::Slice::Columns, 1, MatlabArray("v", 3, 1, { 3.0, 4.0, 5.0 })));
+		TEST_ASSERT(backend.setVariableSlice("s", EngineBackend::Slice::Elements, 0, MatlabArray("v", 1, 2, { 6.0, 7.0 })));
+		MatlabArray sArray = backend.getVariable("s");
+		TEST_ASSERT(Matrix(&sArray) == Matrix({ { 6, 3 }, { 7, 4 }, { 0, 5 } }));
+
+		// Grows with zeros like MATLAB
+		TEST_ASSERT(backend.setVariableSlice("s", EngineBackend::Slice::Rows, 4, MatlabArray("v", 1, 2, { 8.0, 9.0 })));
+		sArray = backend.getVariable("s");
+		TEST_ASSERT(Matrix(&sArray) == Matrix({ { 6, 3 }, { 7, 4 }, { 0, 5 }, { 0, 0 }, { 8, 9 } }));
+		TEST_ASSERT(backend.resizeVariableRows("s", 2));
+		sArray = backend.getVariable("s");
+		TEST_ASSERT(Matrix(&sArray) == Matrix({ { 6, 3 }, { 7, 4 } }));
+
+		// Mismatching sizes and unknown variables leave the workspace unchanged
+		TEST_ASSERT(!backend.setVariableSlice("s", EngineBackend::Slice::Rows, 0, MatlabArray("v", 1, 3, { 1.0, 2.0, 3.0 })));
+		TEST_ASSERT(!backend.setVariableSlice("s", EngineBackend::Slice::Elements, 3, MatlabArray("v", 1, 2, { 1.0, 2.0 })));
+		TEST_ASSERT(!backend.setVariableSlice("missing", EngineBackend::Slice::Rows, 0, MatlabArray("v", 1.0)));
+		sArray = backend.getVariable("s");
+		TEST_ASSERT(Matrix(&sArray) == Matrix({ { 6, 3 }, { 7, 4 } }));
+		TEST_ASSERT(backend.getStatistics().puts == 8);
+
+		// A registered array sends only the rows that changed
+		MatlabArray* samples = new MatlabArray("sliceSamples", 4, 1, { 1.0, 2.0, 3.0, 4.0 });
+		TEST_ASSERT(MatlabEngine::addVariable(samples));
+		ArrayView<double> data = samples->view<double>();
+		data[2] = 30.0;
+		data[3] = 40.0;
+		TEST_ASSERT(samples->updateRowsToEngine(2, 2));
+		TEST_ASSERT(MatlabEngine::getVariableAsync("sliceSamples").get().getDoubleVector() == std::vector<double>({ 1.0, 2.0, 30.0, 40.0 }));
+		TEST_ASSERT(!samples->updateRowsToEngine(3, 2));
+		TEST_ASSERT(MatlabEngine::removeVariable("sliceSamples"));
+	}
+
+	TEST_FUNCTION(defaultIndexing)
+	{
+		TEST_START;
+
+		// The engine thread is idle between the synchronous calls, so the backend is used by one thread at a time
+		EngineBackend& target = *MatlabEngine::getBackend();
+		TST_EngineBackend_Forwarding backend(target);
+		EngineBackend::VariableInfo info;
+
+		// Names are checked before anything is evaluated
+		size_t evals = target.getStatistics().evals;
+		TEST_ASSERT(!backend.getVariableInfo("x'); disp('injected", info));
+		TEST_ASSERT(!backend.getVariableInfo("default*", info));
+		TEST_ASSERT(!backend.getVariableRows("x(1)", 0, 1).isValid());
+		TEST_ASSERT(!backend.resizeVariableRows("1x", 2));
+		TEST_ASSERT(!backend.setVariableSlice("a b", EngineBackend::Slice::Rows, 0, MatlabArray("v", 1.0)));
+		TEST_ASSERT(target.getStatistics().evals == evals);
+
+		// InProcessBackend does not evaluate whos, the default implementations need MATLAB
+		if (!target.isNative())
+			return;
+
+		TEST_ASSERT(MatlabEngine::eval("matlab_api_remote = 'user'; defaultLog = reshape(1:12, 4, 3); defaultCount = 0; defaultCount = numel(who);") == 0);
+		TEST_ASSERT(backend.getVariableInfo("defaultLog", info));
+		TEST_ASSERT(info.className == "double" && info.getRows() == 4 && info.getCols() == 3);
+		TEST_ASSERT(!backend.getVariableInfo("defaultMissing", info));
+		MatlabArray rows = backend.getVariableRows("defaultLog", 1, 2);
+		TEST_ASSERT(rows.getM() == 2 && rows.getRowData<double>(0) == std::vector<double>({ 2, 6, 10 }));
+		TEST_ASSERT(backend.setVariableSlice("defaultLog", EngineBackend::Slice::Rows, 3, MatlabArray("v", 1, 3, { 0, 0, 0 })));
+		TEST_ASSERT(backend.resizeVariableRows("defaultLog", 6));
+
+		// No temporary variable is left and user variables are not touched
+		TEST_ASSERT(MatlabEngine::eval("defaultOk = numel(who) == defaultCount && isequal(matlab_api_remote, 'user') "
+									   "&& isequal(defaultLog, [1 5 9; 2 6 10; 3 7 11; 0 0 0; 0 0 0; 0 0 0]);") == 0);
+		TEST_ASSERT(MatlabEngine::getVariable("defaultOk").getLogicalVector() == std::vector<bool>({ true }));
+		TEST_ASSERT(MatlabEngine::eval("clear matlab_api_remote defaultLog defaultCount defaultOk") == 0);
+	}
+
+	TEST_FUNCTION(growingVariable)
+	{
+		TEST_START;
+
+		EngineBackend::Statistics before = MatlabEngine::getBackend()->getStatistics();
+		{
+			MatlabEngine::GrowingVariable log("growingLog", 4);
+			for (size_t block = 0; block < 10; ++block)
+			{
+				std::vector<double> rows(6);
+				for (size_t r = 0; r < 3; ++r)
+				{
+					rows[r] = double(block * 3 + r);
+					rows[3 + r] = -double(block * 3 + r);
+				}
+				TEST_ASSERT(log.append(MatlabArray("block", 3, 2, rows)));
+			}
+			TEST_ASSERT(log.getRows() == 30 && log.getCols() == 2);
+			TEST_ASSERT(log.getCapacity() == 32); // 4, 8, 16, 32
+			TEST_ASSERT(!log.append(MatlabArray("block", 1, 3, { 1.0, 2.0, 3.0 })));
+			TEST_ASSERT(log.getRows() == 30);
+
+			// The preallocated rows are visible until trim()
+			TEST_ASSERT(MatlabEngine::getRemoteVariable("growingLog").getRows() == 32);
+			TEST_ASSERT(log.trim() && log.getCapacity() == 30);
+			MatlabArray data = MatlabEngine::getVariableAsync("growingLog").get();
+			TEST_ASSERT(data.getM() == 30 && data.getN() == 2);
+			TEST_ASSERT(data.getRowData<double>(29) == std::vector<double>({ 29, -29 }));
+
+			TEST_ASSERT(log.append(MatlabArray("block", 1, 2, { 30.0, -30.0 })));
+			TEST_ASSERT(log.getCapacity() == 60);
+		}
+		// The destructor trims without waiting, the next call is queued behind it
+		TEST_ASSERT(MatlabEngine::getRemoteVariable("growingLog").getRows() == 31);
+
+		// One put per append and per doubling, the mismatching columns never reach the engine:
+		// creation (put and resize), 9 slices, doublings to 8, 16 and 32, trim, doubling to 60 and slice, trim
+		EngineBackend::Statistics after = MatlabEngine::getBackend()->getStatistics();
+		TEST_ASSERT(after.errors == before.errors);
+		TEST_ASSERT(after.puts - before.puts == 18);
+		TEST_ASSERT(MatlabEngine::eval("clear growingLog") == 0);
+	}
+
+	// Restarts the engine with InProcessBackends, the engine of the other tests is started again at the end
+	TEST_FUNCTION(asyncStart)
+	{
+		TEST_START;
+
+		EngineBackend* running = MatlabEngine::getBackend();
+		bool native = running && running->isNative();
+		TEST_ASSERT(MatlabEngine::terminate());
+		TEST_ASSERT(!MatlabEngine::isAvailable());
+
+		// The first attempt fails, calls made during the retry delay wait for the engine
+		std::atomic<int> attempts{ 0 };
+		auto failTwice = [&attempts]() {
+			return ++attempts < 2 ? nullptr : std::unique_ptr<EngineBackend>(new InProcessBackend());
+		};
+		MatlabFuture<bool> start = MatlabEngine::instantiateAsync(failTwice, 3);
+		TEST_ASSERT(MatlabEngine::isStarting() && MatlabEngine::isAvailable() && !MatlabEngine::isInstantiated());
+		TEST_ASSERT(MatlabEngine::instantiateAsync(failTwice, 3).isValid()); // joins the running start
+		MatlabFuture<int> queued = MatlabEngine::evalAsync("startQueued = 2;");
+		TEST_ASSERT(start.get());
+		TEST_ASSERT(attempts == 2);
+		TEST_ASSERT(queued.get() == 0);
+		TEST_ASSERT(MatlabEngine::isInstantiated() && !MatlabEngine::isStarting());
+		TEST_ASSERT(MatlabEngine::getVariable("startQueued").getScalar() == 2.0);
+
+		// Already instantiated: all overloads report the running engine
+		TEST_ASSERT(MatlabEngine::instantiate(std::make_unique<InProcessBackend>()));
+		TEST_ASSERT(MatlabEngine::instantiateAsync(std::make_unique<InProcessBackend>()).get());
+		TEST_ASSERT(MatlabEngine::instantiateAsync(failTwice, 3).get());
+		TEST_ASSERT(attempts == 2);
+		TEST_ASSERT(MatlabEngine::terminate());
+
+		// All attempts fail, queued calls fail and the engine can be started again afterwards
+		attempts = 0;
+		auto failAlways = [&attempts]() {
+			++attempts;
+			return std::unique_ptr<EngineBackend>();
+		};
+		start = MatlabEngine::instantiateAsync(failAlways, 2);
+		queued = MatlabEngine::evalAsync("startQueued = 3;");
+		TEST_ASSERT(!start.get());
+		TEST_ASSERT(attempts == 2);
+		TEST_ASSERT(queued.get() == -1);
+		TEST_ASSERT(!MatlabEngine::isAvailable());
+		TEST_ASSERT(MatlabEngine::instantiate(std::make_unique<InProcessBackend>()));
+		TEST_ASSERT(MatlabEngine::eval("startQueued = 4;") == 0);
+		TEST_ASSERT(MatlabEngine::terminate());
+
+		// Cancelling stops the retries
+		attempts = 0;
+		start = MatlabEngine::instantiateAsync(failAlways, 10);
+		TEST_ASSERT(start.cancel());
+		while (MatlabEngine::isStarting())
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		TEST_ASSERT(attempts < 10 && !MatlabEngine::isAvailable());
+
+		if (native)
+			TEST_ASSERT(MatlabEngine::instantiate());
+		else
+			TEST_ASSERT(MatlabEngine::instantiate(std::make_unique<InProcessBackend>()));
+	}
+};
+
+TEST_INSTANTIATE(TST_EngineBackend);
@@ -0,0 +1,204 @@
+#pragma once
+
+#include "UnitTest.h"
+#include "MatlabAPI.h"
+#include <cstdio>
+
+
+
+using namespace MatlabAPI;
+class TST_MatFile : public UnitTest::Test
+{
+	TEST_CLASS(TST_MatFile)
+public:
+	TST_MatFile()
+		: Test("TST_MatFile")
+	{
+		ADD_TEST(TST_MatFile::numeric);
+		ADD_TEST(TST_MatFile::arrays);
+		ADD_TEST(TST_MatFile::rowStream);
+		ADD_TEST(TST_MatFile::map);
+		ADD_TEST(TST_MatFile::compressed);
+
+	}
+
+private:
+	const std::string m_path = "TST_MatFile.mat";
+
+	// Tests
+	TEST_FUNCTION(numeric)
+	{
+		TEST_START;
+
+		const double values[] = { 1, 2, 3, 4, 5, 6 }; // 2x3, column-major
+		const int16_t counts[] = { -1, 7, 300 };
+		{
+			MatFileWriter writer(m_path);
+			TEST_ASSERT(writer.isOpen());
+			TEST_ASSERT(writer.write("A", values, 2, 3));
+			TEST_ASSERT(writer.write("counts", counts, 3, 1));
+			TEST_ASSERT(writer.write("M", Matrix({ { 1, 2 }, { 3, 4 } })));
+			TEST_ASSERT(writer.close());
+		}
+		MatFileReader reader(m_path);
+		TEST_ASSERT(reader.isOpen());
+		TEST_ASSERT(reader.getVariables().size() == 3);
+		const MatFileReader::Variable* a = reader.find("A");
+		TEST_ASSERT(a != nullptr);
+		TEST_ASSERT(a->arrayClass == MatFileFormat::mxDOUBLE && a->getRows() == 2 && a->getCols() == 3);
+		TEST_ASSERT(std::string(reader.find("counts")->getClassName()) == "int16");
+		TEST_ASSERT(reader.find("missing") == nullptr);
+
+		std::vector<double> data;
+		size_t rows = 0, cols = 0;
+		TEST_ASSERT(reader.read("A", data, rows, cols));
+		TEST_ASSERT(rows == 2 && cols == 3);
+		TEST_ASSERT(data == std::vector<double>(values, values + 6));
+
+		// Converted to the requested type
+		std::vector<int16_t> countsRead;
+		std::vector<double> countsAsDouble;
+		TEST_ASSERT(reader.read("counts", countsRead, rows, cols));
+		TEST_ASSERT(countsRead == std::vector<int16_t>(counts, counts + 3));
+		TEST_ASSERT(reader.read("counts", countsAsDouble, rows, cols));
+		TEST_ASSERT(countsAsDouble == std::vector<double>({ -1, 7, 300 }));
+
+		Matrix m = reader.readMatrix("M");
+		TEST_ASSERT(m.getRows() == 2 && m.getCols() == 2);
+		TEST_ASSERT(m(0, 1) == 2 && m(1, 0) == 3);
+		std::remove(m_path.c_str());
+
+		// Sizes are 32 bit in the v5 format, larger elements are rejected before any data is read
+		{
+			MatFileWriter writer(m_path);
+			TEST_ASSERT(!writer.write("huge", values, 1, size_t(1) << 30));
+			TEST_ASSERT(!writer.write("wide", values, 0, size_t(INT32_MAX) + 1));
+			TEST_ASSERT(!writer.close());
+		}
+		std::remove(m_path.c_str());
+	}
+
+	TEST_FUNCTION(arrays)
+	{
+		TEST_START;
+
+		MatlabArray cell = MatlabArray::createCell("c", 1, 2);
+		cell.setCell(0, MatlabArray("", 2.5));
+		cell.setCell(1, MatlabArray("", std::string("text")));
+		{
+			MatFileWriter writer(m_path);
+			TEST_ASSERT(writer.write("name", std::string("Gr\xC3\xBC\xC3\x9F" "e")));
+			TEST_ASSERT(writer.write("flags", std::vector<bool>({ true, false, true })));
+			TEST_ASSERT(writer.write(MatlabArray("v", 1, 3, { 1, 2, 3 })));
+			TEST_ASSERT(writer.write(cell));
+		}
+		MatFileReader reader(m_path);
+		TEST_ASSERT(reader.readString("name") == "Gr\xC3\xBC\xC3\x9F" "e");
+		TEST_ASSERT(reader.readString("flags").empty());
+		TEST_ASSERT(reader.find("flags")->logical);
+
+		MatlabArray flags = reader.read("flags");
+		TEST_ASSERT(flags.isLogical());
+		TEST_ASSERT(flags.getLogicalVector() == std::vector<bool>({ true, false, true }));
+		MatlabArray v = reader.read("v");
+		TEST_ASSERT(v.getDoubleVector() == std::vector<double>({ 1, 2, 3 }));
+		MatlabArray c = reader.read("c");
+		TEST_ASSERT(c.isCell() && c.getNumberOfElements() == 2);
+		TEST_ASSERT(c.getCell(0).getDoubleVector() == std::vector<double>({ 2.5 }));
+		TEST_ASSERT(c.getCell(1).getString() == "text");
+		std::remove(m_path.c_str());
+	}
+
+	TEST_FUNCTION(rowStream)
+	{
+		TEST_START;
+
+		const size_t cols = 3;
+		const size_t blocks = 50;
+		{
+			MatFileWriter writer(m_path);
+			TEST_ASSERT(writer.write("before", std::string("x")));
+			TEST_ASSERT(writer.beginRows("log", cols));
+			TEST_ASSERT(writer.isStreamingRows());
+			TEST_ASSERT(!writer.write("blocked", std::string("y")));
+			for (size_t block = 0; block < blocks; ++block)
+			{
+				// 2 rows per block, row-major: value = row * 10 + col
+				double rows[2 * cols];
+				for (size_t r = 0; r < 2; ++r)
+					for (size_t c = 0; c < cols; ++c)
+						rows[r * cols + c] = double((block * 2 + r) * 10 + c);
+				TEST_ASSERT(writer.appendRows(rows, 2));
+			}
+			TEST_ASSERT(writer.endRows());
+			TEST_ASSERT(writer.write("after", std::string("z")));
+		}
+		MatFileReader reader(m_path);
+		TEST_ASSERT(reader.getVariables().size() == 3);
+		Matrix log = reader.readMatrix("log");
+		TEST_ASSERT(log.getRows() == blocks * 2 && log.getCols() == cols);
+		bool match = true;
+		for (size_t r = 0; r < log.getRows(); ++r)
+			for (size_t c = 0; c < cols; ++c)
+				match &= log(r, c) == double(r * 10 + c);
+		TEST_ASSERT(match);
+		TEST_ASSERT(reader.readString("after") == "z");
+		std::remove(m_path.c_str());
+	}
+
+	TEST_FUNCTION(map)
+	{
+		TEST_START;
+
+		std::vector<float> values(1000);
+		for (size_t i = 0; i < values.size(); ++i)
+			values[i] = float(i) * 0.5f;
+		{
+			MatFileWriter writer(m_path);
+			TEST_ASSERT(writer.write("f", values.data(), 10, 100));
+		}
+		MatFileReader reader(m_path);
+		size_t rows = 0, cols = 0;
+		const float* mapped = reader.map<float>("f", rows, cols);
+		TEST_ASSERT(mapped != nullptr);
+		TEST_ASSERT(reinterpret_cast<uintptr_t>(mapped) % 8 == 0);
+		TEST_ASSERT(rows == 10 && cols == 100);
+		TEST_ASSERT(std::equal(values.begin(), values.end(), mapped));
+
+		// Stored as single, not as double
+		TEST_ASSERT(reader.map<double>("f", rows, cols) == nullptr);
+		std::remove(m_path.c_str());
+	}
+
+	TEST_FUNCTION(compressed)
+	{
+		TEST_START;
+
+		std::vector<double> values(5000, 1.0);
+		{
+			MatFileWriter writer(m_path, MatFileWriter::Compression::Zlib);
+			TEST_ASSERT(writer.getCompression() == (MatFileFormat::isCompressionAvailable() ? MatFileWriter::Compression::Zlib : MatFileWriter::Compression::None));
+			TEST_ASSERT(writer.write("ones", values.data(), values.size(), 1));
+			TEST_ASSERT(writer.write("s", std::string("compressed")));
+			TEST_ASSERT(writer.beginRows("rows", 2));
+			for (int i = 0; i < 100; ++i)
+				TEST_ASSERT(writer.appendRows(Matrix({ { double(i), -double(i) } })));
+			TEST_ASSERT(writer.endRows());
+		}
+		MatFileReader reader(m_path);
+		TEST_ASSERT(reader.getVariables().size() == 3);
+		TEST_ASSERT(reader.find("ones")->compressed == MatFileFormat::isCompressionAvailable());
+		std::vector<double> data;
+		size_t rows = 0, cols = 0;
+		TEST_ASSERT(reader.read("ones", data, rows, cols));
+		TEST_ASSERT(data == values);
+		TEST_ASSERT(reader.readString("s") == "compressed");
+		Matrix streamed = reader.readMatrix("rows");
+		TEST_ASSERT(streamed.getRows() == 100 && streamed(42, 0) == 42 && streamed(42, 1) == -42);
+		if (MatFileFormat::isCompressionAvailable())
+			TEST_ASSERT(reader.map<double>("ones", rows, cols) == nullptr);
+		std::remove(m_path.c_str());
+	}
+};
+
+TEST_INSTANTIATE(TST_MatFile);
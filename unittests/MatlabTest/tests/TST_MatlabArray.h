@@ -19,7 +19,15 @@ public:
 	{
 		ADD_TEST(TST_MatlabArray::scalar);
 		ADD_TEST(TST_MatlabArray::vector);
+		ADD_TEST(TST_MatlabArray::view);
+		ADD_TEST(TST_MatlabArray::buffer);
+		ADD_TEST(TST_MatlabArray::copyOnWrite);
 		ADD_TEST(TST_MatlabArray::printVariables);
+		ADD_TEST(TST_MatlabArray::async);
+		ADD_TEST(TST_MatlabArray::feval);
+		ADD_TEST(TST_MatlabArray::batch);
+		ADD_TEST(TST_MatlabArray::variableCache);
+		ADD_TEST(TST_MatlabArray::multiThreaded);
 
 		
 
@@ -63,10 +71,113 @@ private:
 		for (double v : vec_data) 
 			expected.push_back(v * scalarValue);
 
-		TEST_ASSERT(MatlabEngine::getVariable("vec_data")->getDoubleVector() == expected);
+		TEST_ASSERT(MatlabEngine::getVariable("vec_data").getDoubleVector() == expected);
 	}
 
 
+	TEST_FUNCTION(view)
+	{
+		TEST_START;
+
+		// 2x3, column-major
+		MatlabArray matrix("view_data", 2, 3, { 1, 2, 3, 4, 5, 6 });
+		const MatlabArray& constMatrix = matrix;
+		ArrayView<const double> data = constMatrix.view<double>();
+		TEST_ASSERT(data.getRows() == 2 && data.getCols() == 3 && data.size() == 6);
+		TEST_ASSERT(data(1, 2) == 6 && data.at(0, 1) == 3 && data[3] == 4);
+		TEST_ASSERT(data.row(1).toVector() == std::vector<double>({ 2, 4, 6 }));
+		TEST_ASSERT(data.transposed()(2, 1) == 6);
+		TEST_ASSERT(matrix.getRowData<double>(0) == std::vector<double>({ 1, 3, 5 }));
+		TEST_ASSERT(matrix.getColData<double>(2) == std::vector<double>({ 5, 6 }));
+		TEST_ASSERT(matrix.getDoubleMatrix()[1][0] == 2);
+
+		bool thrown = false;
+		try { data.at(2, 0); }
+		catch (const std::out_of_range&) { thrown = true; }
+		TEST_ASSERT(thrown);
+		thrown = false;
+		try { constMatrix.view<float>(); }
+		catch (const std::runtime_error&) { thrown = true; }
+		TEST_ASSERT(thrown);
+
+		// Writes go to this array only, not to its copies
+		MatlabArray copy = matrix;
+		ArrayView<double> writable = matrix.view<double>();
+		writable.row(0)[1] = 30;
+		TEST_ASSERT(matrix.getDoubleVector() == std::vector<double>({ 1, 2, 30, 4, 5, 6 }));
+		TEST_ASSERT(copy.getDoubleVector() == std::vector<double>({ 1, 2, 3, 4, 5, 6 }));
+
+		// Other numeric classes
+		TEST_ASSERT(MatlabEngine::eval("view_int = int16([1 -2; 3 -4]); view_single = single(0.5);") == 0);
+		MatlabArray integers = MatlabEngine::getVariable("view_int");
+		TEST_ASSERT(integers.isValid() && integers.view<int16_t>().at(1, 1) == -4);
+		MatlabArray single = MatlabEngine::getVariable("view_single");
+		TEST_ASSERT(single.isValid() && single.view<float>()[0] == 0.5f);
+		MatlabEngine::eval("clear view_int view_single");
+	}
+
+	TEST_FUNCTION(buffer)
+	{
+		TEST_START;
+
+		ArrayBuffer<double> buffer = MatlabArray::createBuffer<double>(6);
+		TEST_ASSERT(buffer && buffer.size() == 6);
+		for (size_t i = 0; i < buffer.size(); ++i)
+			buffer[i] = double(i);
+		const double* memory = buffer.data();
+		MatlabArray adopted("buffer_data", std::move(buffer), { 2, 3 });
+		TEST_ASSERT(!buffer);
+		TEST_ASSERT(adopted.getM() == 2 && adopted.getN() == 3);
+		TEST_ASSERT(adopted.cview<double>().data() == memory); // adopted, not copied
+		TEST_ASSERT(adopted.getRowData<double>(1) == std::vector<double>({ 1, 3, 5 }));
+
+		ArrayBuffer<int32_t> integers = MatlabArray::createBuffer<int32_t>(2);
+		integers[0] = -7;
+		integers[1] = 7;
+		MatlabArray adoptedIntegers("buffer_int", std::move(integers), { 1, 2 });
+		TEST_ASSERT(adoptedIntegers.isInt32() && adoptedIntegers.cview<int32_t>()[0] == -7);
+
+		bool thrown = false;
+		try { MatlabArray("buffer_wrong", MatlabArray::createBuffer<double>(5), { 2, 3 }); }
+		catch (const std::invalid_argument&) { thrown = true; }
+		TEST_ASSERT(thrown);
+
+		Matrix m({ { 1, 2 }, { 3, 4 } });
+		std::unique_ptr<MatlabArray> converted(m.toMatlabArray("buffer_matrix"));
+		TEST_ASSERT(converted->getDoubleVector() == std::vector<double>({ 1, 3, 2, 4 }));
+	}
+
+	TEST_FUNCTION(copyOnWrite)
+	{
+		TEST_START;
+
+		MatlabArray original("cow", 2, 2, { 1, 2, 3, 4 });
+		const double* memory = original.cview<double>().data();
+		MatlabArray copy = original;
+		MatlabArray cloned = original.clone();
+		TEST_ASSERT(original.isShared() && copy.isShared() && cloned.isShared());
+		TEST_ASSERT(copy.cview<double>().data() == memory); // shared, not copied
+
+		// The first write unshares the written copy only
+		copy.view<double>()[0] = 10;
+		TEST_ASSERT(copy.cview<double>().data() != memory);
+		TEST_ASSERT(copy.getDoubleVector() == std::vector<double>({ 10, 2, 3, 4 }));
+		TEST_ASSERT(original.getDoubleVector() == std::vector<double>({ 1, 2, 3, 4 }));
+		TEST_ASSERT(!copy.isShared() && original.isShared());
+
+		cloned = copy;
+		TEST_ASSERT(!original.isShared());
+		original.view<double>()[3] = 40; // not shared anymore, written in place
+		TEST_ASSERT(original.cview<double>().data() == memory);
+		TEST_ASSERT(cloned.getDoubleVector() == std::vector<double>({ 10, 2, 3, 4 }));
+
+		MatlabArray cell = MatlabArray::createCell("cow_cell", 1, 2);
+		cell.setCell(0, MatlabArray("", 1.0));
+		MatlabArray cellCopy = cell;
+		cellCopy.setCell(0, MatlabArray("", 2.0));
+		TEST_ASSERT(cell.getCell(0).getScalar() == 1.0 && cellCopy.getCell(0).getScalar() == 2.0);
+	}
+
 	TEST_FUNCTION(printVariables)
 	{
 		TEST_START;
@@ -75,8 +186,170 @@ private:
 		for (const auto& name : vars)
 		{
 			auto var = MatlabEngine::getVariable(name);
-			TEST_MESSAGE("Variable: " + var->toString());
+			TEST_MESSAGE("Variable: " + var.toString());
+		}
+	}
+
+	TEST_FUNCTION(async)
+	{
+		TEST_START;
+
+		MatlabFuture<bool> put = MatlabEngine::setVariableAsync(MatlabArray("async_in", std::vector<double>({ 1.0, 2.0, 3.0 })));
+		MatlabFuture<int> eval = MatlabEngine::evalAsync("async_out = async_in * 2;");
+		MatlabFuture<std::vector<double>> result = MatlabEngine::getVariableAsync("async_out")
+			.then([](const MatlabArray& arr) { return arr.getDoubleVector(); });
+		MatlabFuture<std::vector<MatlabArray>> sum = MatlabEngine::fevalAsync("sum", 1, { MatlabArray("x", std::vector<double>({ 1.0, 2.0, 3.0 })) });
+
+		TEST_ASSERT(put.get() == true);
+		TEST_ASSERT(eval.get() == 0);
+		TEST_ASSERT(result.get() == std::vector<double>({ 2.0, 4.0, 6.0 }));
+		TEST_ASSERT(sum.get().size() == 1);
+		TEST_ASSERT(sum.get()[0].getScalar() == 6.0);
+
+		MatlabFuture<int> longRunning = MatlabEngine::evalAsync("pause(10);");
+		TEST_ASSERT(longRunning.cancel());
+		TEST_ASSERT(longRunning.isCancelled());
+		MatlabEngine::eval("clear async_in async_out");
+
+		// A promise dropped without a result fails its future and the continuations instead of blocking them
+		MatlabFuture<int> dropped;
+		MatlabFuture<int> droppedContinuation;
+		{
+			MatlabPromise<int> promise;
+			MatlabPromise<int> copy = promise;
+			dropped = promise.getFuture();
+			droppedContinuation = dropped.then([](int value) { return value + 1; });
+		}
+		TEST_ASSERT(dropped.isReady());
+		TEST_ASSERT(!dropped.isCancelled());
+		bool broken = false;
+		try { dropped.get(); }
+		catch (const std::future_error& e) { broken = e.code() == std::future_errc::broken_promise; }
+		TEST_ASSERT(broken);
+		broken = false;
+		try { droppedContinuation.get(); }
+		catch (const std::future_error& e) { broken = e.code() == std::future_errc::broken_promise; }
+		TEST_ASSERT(broken);
+	}
+
+	TEST_FUNCTION(feval)
+	{
+		TEST_START;
+
+		Matrix m(2, 2);
+		m(0, 0) = 1; m(0, 1) = 2;
+		m(1, 0) = 3; m(1, 1) = 4;
+		std::vector<MatlabArray> product = MatlabEngine::feval("mtimes", 1, m, 0.1);
+		TEST_ASSERT(product.size() == 1);
+		Matrix scaled(&product[0]);
+		TEST_ASSERT(scaled(1, 0) == 3 * 0.1); // no precision is lost on the way
+
+		std::vector<MatlabArray> size = MatlabEngine::feval("size", 2, m);
+		TEST_ASSERT(size.size() == 2);
+		TEST_ASSERT(size[0].getScalar() == 2.0);
+		TEST_ASSERT(size[1].getScalar() == 2.0);
+
+		TEST_ASSERT(MatlabEngine::feval("function_that_does_not_exist", 1, m).empty());
+	}
+
+	TEST_FUNCTION(batch)
+	{
+		TEST_START;
+
+		MatlabEngine::Batch batch;
+		size_t putOp = batch.put(MatlabArray("batch_x", std::vector<double>({ 1.0, 2.0, 3.0 })));
+		size_t evalOp = batch.eval("batch_y = cumsum(batch_x);");
+		size_t failingOp = batch.eval("batch_z = undefined_function_xyz(batch_x);");
+		size_t getOp = batch.get("batch_y");
+		TEST_ASSERT(batch.getPendingOperationCount() == 4);
+
+		// The failing operation does not stop the following ones
+		TEST_ASSERT(batch.flush() == false);
+		TEST_ASSERT(batch.getPendingOperationCount() == 0);
+		TEST_ASSERT(batch.succeeded(putOp));
+		TEST_ASSERT(batch.succeeded(evalOp));
+		TEST_ASSERT(!batch.succeeded(failingOp));
+		TEST_MESSAGE("Expected error: " + batch.getError(failingOp));
+		TEST_ASSERT(batch.succeeded(getOp));
+		TEST_ASSERT(batch.getResult(getOp).getDoubleVector() == std::vector<double>({ 1.0, 3.0, 6.0 }));
+
+		// Operations recorded after a flush are executed by the next flush
+		size_t secondGet = batch.get("batch_x");
+		TEST_ASSERT(batch.flush());
+		TEST_ASSERT(batch.getResult(secondGet).getDoubleVector() == std::vector<double>({ 1.0, 2.0, 3.0 }));
+		MatlabEngine::eval("clear batch_x batch_y");
+	}
+
+	TEST_FUNCTION(variableCache)
+	{
+		TEST_START;
+
+		std::vector<double> data = { 1.0, 2.0, 3.0 };
+		TEST_ASSERT(MatlabEngine::addVariable(new MatlabArray("cached", data)));
+		MatlabEngine::resetCacheStatistics();
+
+		// Nothing changed in the workspace, both directions are served from the cache
+		MatlabArray before = MatlabEngine::getVariable("cached");
+		TEST_ASSERT(before.getDoubleVector() == data);
+		TEST_ASSERT(MatlabEngine::addVariable(new MatlabArray("cached", data)));
+		TEST_ASSERT(MatlabEngine::getCacheStatistics().hits == 2);
+		TEST_ASSERT(MatlabEngine::getCacheStatistics().misses == 0);
+
+		// An eval may have changed the variable
+		uint64_t version = MatlabEngine::getVariableVersion("cached");
+		MatlabEngine::eval("cached = cached * 2;");
+		TEST_ASSERT(MatlabEngine::getVariable("cached").getDoubleVector() == std::vector<double>({ 2.0, 4.0, 6.0 }));
+		TEST_ASSERT(MatlabEngine::getCacheStatistics().misses == 1);
+		TEST_ASSERT(MatlabEngine::getVariableVersion("cached") == version + 1);
+
+		// Sign flips of two elements change the content hash, the new values reach the engine
+		uint64_t hash = 0, flippedHash = 0;
+		TEST_ASSERT(MatlabArray("a", std::vector<double>({ 1.0, 2.0 })).computeContentHash(hash));
+		TEST_ASSERT(MatlabArray("a", std::vector<double>({ -1.0, -2.0 })).computeContentHash(flippedHash));
+		TEST_ASSERT(hash != flippedHash);
+		TEST_ASSERT(MatlabEngine::addVariable(new MatlabArray("cached", data)));
+		TEST_ASSERT(MatlabEngine::addVariable(new MatlabArray("cached", std::vector<double>({ -1.0, -2.0, 3.0 }))));
+		TEST_ASSERT(MatlabEngine::eval("cachedCopy = cached;") == 0);
+		TEST_ASSERT(MatlabEngine::getVariable("cachedCopy").getDoubleVector() == std::vector<double>({ -1.0, -2.0, 3.0 }));
+		TEST_ASSERT(MatlabEngine::removeVariable("cachedCopy"));
+
+		// Copies returned before keep their data, also after the variable is removed
+		TEST_ASSERT(MatlabEngine::removeVariable("cached"));
+		TEST_ASSERT(before.getDoubleVector() == data);
+		TEST_ASSERT(!MatlabEngine::getVariable("cached").isValid());
+	}
+
+	TEST_FUNCTION(multiThreaded)
+	{
+		TEST_START;
+
+		// All threads share the engine, their requests are serialized by the engine thread
+		const size_t threadCount = 4;
+		std::vector<std::thread> threads;
+		std::atomic<size_t> failures(0);
+		for (size_t t = 0; t < threadCount; ++t)
+		{
+			threads.emplace_back([t, &failures]() {
+				std::string name = "thread_var" + std::to_string(t);
+				std::vector<double> data(100, double(t));
+				for (size_t i = 0; i < 10; ++i)
+				{
+					data[0] = double(i);
+					if (!MatlabEngine::addVariable(new MatlabArray(name, data)))
+						++failures;
+					MatlabArray var = MatlabEngine::getVariable(name);
+					if (!var.isValid() || var.getDoubleVector() != data)
+						++failures;
+					if (MatlabEngine::evalAsync(name + "_copy = " + name + ";").get() != 0)
+						++failures;
+				}
+				MatlabEngine::removeVariable(name);
+				MatlabEngine::eval(("clear " + name + "_copy").c_str());
+				});
 		}
+		for (std::thread& thread : threads)
+			thread.join();
+		TEST_ASSERT(failures == 0);
 	}
 };
 
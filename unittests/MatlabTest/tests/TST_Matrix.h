@@ -2,6 +2,7 @@
 
 #include "UnitTest.h"
 #include "MatlabAPI.h"
+#include <chrono>
 //#include <QObject>
 //#include <QCoreapplication>
 
@@ -18,6 +19,8 @@ public:
 	{
 		ADD_TEST(TST_Matrix::matmul);
 		ADD_TEST(TST_Matrix::matlabInterface);
+		ADD_TEST(TST_Matrix::transpose);
+		ADD_TEST(TST_Matrix::transposeBenchmark);
 		//ADD_TEST(TST_Matrix::test2);
 
 	}
@@ -58,9 +61,9 @@ private:
 		MatlabEngine::eval("m3= m1*m2;");
 		
 
-		Matrix m1Compare(MatlabEngine::getVariable("m1"));
-		Matrix m2Compare(MatlabEngine::getVariable("m2"));
-		Matrix m3Compare(MatlabEngine::getVariable("m3"));
+		Matrix m1Compare = MatlabEngine::getMatrix("m1");
+		Matrix m2Compare = MatlabEngine::getMatrix("m2");
+		Matrix m3Compare = MatlabEngine::getMatrix("m3");
 		
 
 		Matrix m3 = m1 * m2;
@@ -79,6 +82,70 @@ private:
 
 
 
+	TEST_FUNCTION(transpose)
+	{
+		TEST_START;
+
+		// Sizes around the kernel (2, 4) and block (32) edges
+		for (size_t rows : { 1, 3, 4, 5, 33, 70 })
+		{
+			for (size_t cols : { 1, 2, 7, 32, 65 })
+			{
+				Matrix m(rows, cols);
+				for (size_t r = 0; r < rows; ++r)
+					for (size_t c = 0; c < cols; ++c)
+						m(r, c) = double(r * 1000 + c);
+				Matrix t = m.getTransposed();
+				bool match = t.getRows() == cols && t.getCols() == rows;
+				for (size_t r = 0; r < rows && match; ++r)
+					for (size_t c = 0; c < cols; ++c)
+						match &= t(c, r) == m(r, c);
+				TEST_ASSERT(match);
+				TEST_ASSERT(Matrix(m).transpose() == t);
+
+				// Through the column-major layout of MatlabArray and back
+				std::unique_ptr<MatlabArray> array(m.toMatlabArray("transpose_m"));
+				TEST_ASSERT(array->getM() == rows && array->getN() == cols);
+				TEST_ASSERT(array->cview<double>().at(rows - 1, cols - 1) == m(rows - 1, cols - 1));
+				TEST_ASSERT(Matrix(array.get()) == m);
+				std::vector<double> rowMajor = array->getDoubleMatrixRowMajor();
+				TEST_ASSERT(std::equal(rowMajor.begin(), rowMajor.end(), m.data()));
+			}
+		}
+	}
+
+	// Compares the extraction into nested vectors with the contiguous, blocked transpose
+	TEST_FUNCTION(transposeBenchmark)
+	{
+		TEST_START;
+
+		const size_t rows = 2000;
+		const size_t cols = 1500;
+		std::vector<double> data(rows * cols);
+		for (size_t i = 0; i < data.size(); ++i)
+			data[i] = double(i);
+		MatlabArray array("transpose_benchmark", rows, cols, data);
+
+		auto start = std::chrono::steady_clock::now();
+		std::vector<std::vector<double>> nested = array.getDoubleMatrix();
+		double nestedTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		start = std::chrono::steady_clock::now();
+		std::vector<double> rowMajor = array.getDoubleMatrixRowMajor();
+		double rowMajorTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		start = std::chrono::steady_clock::now();
+		Matrix matrix(&array);
+		double matrixTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		Logger::logInfo("Transpose benchmark, " + std::to_string(rows) + " x " + std::to_string(cols) + ": nested vectors "
+			+ std::to_string(nestedTime) + " ms, row-major buffer " + std::to_string(rowMajorTime) + " ms, Matrix " + std::to_string(matrixTime) + " ms");
+
+		TEST_ASSERT(nested[rows - 1][cols - 1] == rowMajor.back());
+		TEST_ASSERT(nested[17][42] == matrix(17, 42));
+		TEST_ASSERT(rowMajor[17 * cols + 42] == data[42 * rows + 17]);
+	}
+
 	/*TEST_FUNCTION(test2)
 	{
 		TEST_START;
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "UnitTest.h"
+#include "MatlabAPI.h"
+#include <cmath>
+
+
+
+using namespace MatlabAPI;
+class TST_ModelReduction : public UnitTest::Test
+{
+	TEST_CLASS(TST_ModelReduction)
+public:
+	TST_ModelReduction()
+		: Test("TST_ModelReduction")
+	{
+		ADD_TEST(TST_ModelReduction::lyapunov);
+		ADD_TEST(TST_ModelReduction::balancedTruncation);
+		ADD_TEST(TST_ModelReduction::discreteResponse);
+
+	}
+
+private:
+	// Stable test plant with decaying modes
+	StateSpaceModel createModel(size_t n)
+	{
+		Matrix A(n, n);
+		Matrix B(n, 1);
+		Matrix C(1, n);
+		Matrix D(1, 1);
+		for (size_t i = 0; i < n; ++i)
+		{
+			A(i, i) = -1.0 - (double)i;
+			if (i + 1 < n)
+				A(i, i + 1) = 0.2;
+			B(i, 0) = 1.0;
+			C(0, i) = 1.0 / (1.0 + (double)i);
+		}
+		double dt = 0.001;
+		Matrix Ad = Matrix::identity(n) + A * dt;
+		Matrix Bd = B * dt;
+		return StateSpaceModel(A, B, C, D, Ad, Bd, C, D, Matrix(n, 1), dt, StateSpaceModel::ZeroOrderHold);
+	}
+
+	static double dcGain(const StateSpaceModel& model)
+	{
+		Matrix gain = model.getD() - LinearAlgebra::multiply(model.getC(), LinearAlgebra::solve(model.getA(), model.getB()));
+		return gain(0, 0);
+	}
+
+	// Outputs of the discretized model for a unit step input
+	static std::vector<double> discreteStepResponse(StateSpaceModel model, size_t steps)
+	{
+		Matrix u(1, 1);
+		u(0, 0) = 1.0;
+		std::vector<double> response(steps);
+		model.reset();
+		for (size_t i = 0; i < steps; ++i)
+		{
+			model.processTimeStepDiscretized(u);
+			response[i] = model.getOutput()(0, 0);
+		}
+		return response;
+	}
+
+	// Tests
+	TEST_FUNCTION(lyapunov)
+	{
+		TEST_START;
+		StateSpaceModel model = createModel(30);
+		const Matrix& A = model.getA();
+		Matrix Q = LinearAlgebra::multiplyTransposed(model.getB(), model.getB());
+		Matrix P = LinearAlgebra::solveLyapunov(A, Q);
+
+		Matrix residual = LinearAlgebra::multiply(A, P) + LinearAlgebra::multiply(P, A.getTransposed()) + Q;
+		double relResidual = LinearAlgebra::frobeniusNorm(residual) / LinearAlgebra::frobeniusNorm(P);
+		TEST_MESSAGE("Lyapunov relative residual: " + std::to_string(relResidual));
+		TEST_ASSERT(relResidual < 1e-10);
+	}
+
+	TEST_FUNCTION(balancedTruncation)
+	{
+		TEST_START;
+		StateSpaceModel model = createModel(40);
+		std::vector<double> hsv = model.getHankelSingularValues();
+		TEST_ASSERT(hsv.size() == 40);
+		for (size_t i = 1; i < hsv.size(); ++i)
+			TEST_ASSERT(hsv[i] <= hsv[i - 1]);
+
+		double bound = 0;
+		StateSpaceModel reduced = model.reduceToOrder(6, &bound);
+		TEST_ASSERT(reduced.getStateCount() == 6);
+		TEST_ASSERT(reduced.getAd().getRows() == 6);
+		TEST_MESSAGE("Error bound for order 6: " + std::to_string(bound));
+
+		// The DC gain error is bounded by the H-infinity error bound
+		double dcError = std::abs(dcGain(model) - dcGain(reduced));
+		TEST_MESSAGE("DC gain error: " + std::to_string(dcError));
+		TEST_ASSERT(dcError <= bound);
+
+		double tolerance = 1e-4;
+		StateSpaceModel byTolerance = model.reduceToTolerance(tolerance, &bound);
+		TEST_MESSAGE("Order for tolerance 1e-4: " + std::to_string(byTolerance.getStateCount()));
+		TEST_ASSERT(bound <= tolerance);
+		TEST_ASSERT(byTolerance.getStateCount() < model.getStateCount());
+	}
+
+	TEST_FUNCTION(discreteResponse)
+	{
+		TEST_START;
+		const StateSpaceModel::C2DMethod methods[] = { StateSpaceModel::ZeroOrderHold, StateSpaceModel::Tustin };
+		for (StateSpaceModel::C2DMethod method : methods)
+		{
+			StateSpaceModel euler = createModel(20);
+			double dt = 0.05;
+			StateSpaceModel model(euler.getA(), euler.getB(), euler.getC(), euler.getD(), Matrix(20, 1), dt, method);
+			StateSpaceModel reduced = model.reduceToOrder(4);
+			TEST_ASSERT(reduced.getAd().getRows() == 4);
+
+			// Reference: the reduced continuous model discretized by MATLAB
+			StateSpaceModel reference(reduced.getA(), reduced.getB(), reduced.getC(), reduced.getD(), Matrix(4, 1), dt, method);
+			std::vector<double> response = discreteStepResponse(reduced, 100);
+			std::vector<double> expected = discreteStepResponse(reference, 100);
+			double maxError = 0;
+			for (size_t i = 0; i < response.size(); ++i)
+				maxError = std::max(maxError, std::abs(response[i] - expected[i]));
+			TEST_MESSAGE(StateSpaceModel::c2dMethodToString(method) + " step response error: " + std::to_string(maxError));
+			TEST_ASSERT(maxError < 1e-10);
+		}
+	}
+
+};
+
+TEST_INSTANTIATE(TST_ModelReduction);
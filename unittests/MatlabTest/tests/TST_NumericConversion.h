@@ -0,0 +1,161 @@
+#pragma once
+
+#include "UnitTest.h"
+#include "MatlabAPI.h"
+#include <chrono>
+#include <limits>
+
+
+
+using namespace MatlabAPI;
+class TST_NumericConversion : public UnitTest::Test
+{
+	TEST_CLASS(TST_NumericConversion)
+public:
+	TST_NumericConversion()
+		: Test("TST_NumericConversion")
+	{
+		ADD_TEST(TST_NumericConversion::integers);
+		ADD_TEST(TST_NumericConversion::floatingPoint);
+		ADD_TEST(TST_NumericConversion::typedArrays);
+		ADD_TEST(TST_NumericConversion::benchmark);
+
+	}
+
+private:
+	// Converts values of every length up to 40 (around the vector widths) and compares with a scalar loop
+	template<typename T>
+	bool checkToDouble(const std::vector<T>& pattern, double scale, double offset)
+	{
+		for (size_t length = 0; length <= 40; ++length)
+		{
+			std::vector<T> source(length);
+			for (size_t i = 0; i < length; ++i)
+				source[i] = pattern[i % pattern.size()];
+			std::vector<double> target(length + 1, -1.0);
+			NumericConversion::toDouble(source.data(), length, target.data(), scale, offset);
+			for (size_t i = 0; i < length; ++i)
+				if (target[i] != static_cast<double>(source[i]) * scale + offset)
+					return false;
+			if (target[length] != -1.0) // nothing written behind the end
+				return false;
+		}
+		return true;
+	}
+
+	// Tests
+	TEST_FUNCTION(integers)
+	{
+		TEST_START;
+
+		TEST_ASSERT(checkToDouble<int8_t>({ 0, 1, -1, 127, -128, 42, -42 }, 1.0, 0.0));
+		TEST_ASSERT(checkToDouble<uint8_t>({ 0, 1, 255, 128, 42 }, 1.0, 0.0));
+		TEST_ASSERT(checkToDouble<int16_t>({ 0, 1, -1, INT16_MAX, INT16_MIN, 1234, -4321 }, 1.0, 0.0));
+		TEST_ASSERT(checkToDouble<uint16_t>({ 0, 1, UINT16_MAX, 32768, 1234 }, 1.0, 0.0));
+		TEST_ASSERT(checkToDouble<int32_t>({ 0, 1, -1, INT32_MAX, INT32_MIN, 123456 }, 1.0, 0.0));
+		TEST_ASSERT(checkToDouble<uint32_t>({ 0, 1, UINT32_MAX, 2147483648u, 123456 }, 1.0, 0.0));
+		TEST_ASSERT(checkToDouble<int64_t>({ 0, -1, INT64_MAX, INT64_MIN }, 1.0, 0.0));
+		TEST_ASSERT(checkToDouble<uint64_t>({ 0, 1, UINT64_MAX }, 1.0, 0.0));
+
+		// ADC counts to volts, scale and offset are powers of two so the results are exact
+		TEST_ASSERT(checkToDouble<int16_t>({ 0, 1, -1, INT16_MAX, INT16_MIN, 1234 }, 1.0 / 32768.0, 0.5));
+		TEST_ASSERT(checkToDouble<uint16_t>({ 0, 1, UINT16_MAX, 1234 }, 0.25, -8.0));
+
+		// Scale and offset that are not exact, every lane has to round like the scalar formula
+		TEST_ASSERT(checkToDouble<uint32_t>({ 5, 0, 1, UINT32_MAX, 2147483648u, 2147483647u, 123456 }, 0.1, 1.7));
+		TEST_ASSERT(checkToDouble<int32_t>({ 5, 0, -1, INT32_MAX, INT32_MIN, 123456 }, 0.1, 1.7));
+
+		bool logical[] = { true, false, true };
+		double target[3];
+		NumericConversion::toDouble(logical, 3, target);
+		TEST_ASSERT(target[0] == 1.0 && target[1] == 0.0 && target[2] == 1.0);
+	}
+
+	TEST_FUNCTION(floatingPoint)
+	{
+		TEST_START;
+
+		const float infinity = std::numeric_limits<float>::infinity();
+		TEST_ASSERT(checkToDouble<float>({ 0.0f, -0.5f, 1.0e-30f, 3.0e38f, infinity, -infinity }, 1.0, 0.0));
+		TEST_ASSERT(checkToDouble<double>({ 0.0, -0.5, 1.0e300 }, 1.0, 0.0));
+		TEST_ASSERT(checkToDouble<double>({ 0.0, -0.5, 3.0 }, 2.0, 1.0));
+
+		for (size_t length = 0; length <= 40; ++length)
+		{
+			std::vector<double> source(length);
+			for (size_t i = 0; i < length; ++i)
+				source[i] = 0.1 * double(i) - 1.0;
+			std::vector<float> target(length + 1, -1.0f);
+			NumericConversion::toSingle(source.data(), length, target.data());
+			bool match = target[length] == -1.0f;
+			for (size_t i = 0; i < length; ++i)
+				match &= target[i] == static_cast<float>(source[i]);
+			TEST_ASSERT(match);
+		}
+	}
+
+	TEST_FUNCTION(typedArrays)
+	{
+		TEST_START;
+
+		// 2 x 3 int16, column-major
+		ArrayBuffer<int16_t> samples = MatlabArray::createBuffer<int16_t>(6);
+		const int16_t values[] = { 1, -2, 3, -4, 5, INT16_MIN };
+		std::copy(values, values + 6, samples.begin());
+		MatlabArray array("samples", std::move(samples), { 2, 3 });
+
+		TEST_ASSERT(array.getVector<int16_t>() == std::vector<int16_t>(values, values + 6));
+		TEST_ASSERT(array.getRowData<int16_t>(1) == std::vector<int16_t>({ -2, -4, INT16_MIN }));
+		std::vector<double> scaled(6);
+		array.copyAsDouble(scaled.data(), 0.5, 1.0);
+		TEST_ASSERT(scaled[1] == 0.0 && scaled[5] == INT16_MIN * 0.5 + 1.0);
+
+		Matrix m(&array);
+		TEST_ASSERT(m.getRows() == 2 && m.getCols() == 3);
+		TEST_ASSERT(m(0, 1) == 3 && m(1, 2) == INT16_MIN);
+
+		bool thrown = false;
+		try { array.getVector<double>(); }
+		catch (const std::runtime_error&) { thrown = true; }
+		TEST_ASSERT(thrown);
+
+		MatlabArray doubles("doubles", std::vector<double>({ 0.5, 1.5 }));
+		float singles[2];
+		doubles.copyAsSingle(singles);
+		TEST_ASSERT(singles[0] == 0.5f && singles[1] == 1.5f);
+		thrown = false;
+		try { array.copyAsSingle(singles); }
+		catch (const std::runtime_error&) { thrown = true; }
+		TEST_ASSERT(thrown);
+	}
+
+	// Compares the vectorized int16 -> double conversion with a scalar loop
+	TEST_FUNCTION(benchmark)
+	{
+		TEST_START;
+
+		const size_t count = 20000000;
+		std::vector<int16_t> source(count);
+		for (size_t i = 0; i < count; ++i)
+			source[i] = static_cast<int16_t>(i * 7919);
+		std::vector<double> scalar(count);
+		std::vector<double> vectorized(count);
+		const double scale = 10.0 / 32768.0;
+		const double offset = -0.25;
+
+		auto start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < count; ++i)
+			scalar[i] = static_cast<double>(source[i]) * scale + offset;
+		double scalarTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		start = std::chrono::steady_clock::now();
+		NumericConversion::toDouble(source.data(), count, vectorized.data(), scale, offset);
+		double vectorizedTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		Logger::logInfo("NumericConversion benchmark, " + std::to_string(count) + " int16 samples: scalar "
+			+ std::to_string(scalarTime) + " ms, vectorized " + std::to_string(vectorizedTime) + " ms");
+		TEST_ASSERT(scalar == vectorized);
+	}
+};
+
+TEST_INSTANTIATE(TST_NumericConversion);
@@ -16,6 +16,7 @@ public:
 	{
 		ADD_TEST(TST_StateSpaceModel::stepResp);
 		ADD_TEST(TST_StateSpaceModel::MIMOstepResp);
+		ADD_TEST(TST_StateSpaceModel::MIMOcopyOnWrite);
 
 
 	}
@@ -157,7 +158,48 @@ private:
 
 	}
 
+	TEST_FUNCTION(MIMOcopyOnWrite)
+	{
+		TEST_START;
+		TransferFunction tf_11({ 1 }, { 1, 1 });
+		TransferFunction tf_12({ 2 }, { 1, 3 });
+		TransferFunction tf_21({ 1, 2 }, { 1, 2, 5 });
 
+		MIMOSystem mimoSys(
+			{
+				{tf_11, tf_12},
+				{tf_21}
+			});
+
+		// Copies share the coefficient arena until one of them gets modified
+		MIMOSystem copy = mimoSys;
+		TEST_ASSERT(copy.getCoefficientArena().isShared());
+
+		copy.setTransferFunction(0, 0, TransferFunction({ 5, 6, 7 }, { 1, 2, 3, 4 }));
+		TEST_ASSERT(!mimoSys.getCoefficientArena().isShared());
+		TEST_ASSERT(mimoSys.getTransferFunction(0, 0).getNumerator() == std::vector<double>({ 1 }));
+		TEST_ASSERT(copy.getTransferFunction(0, 0).getNumerator() == std::vector<double>({ 5, 6, 7 }));
+
+		// Missing entries are filled with TransferFunction::ZERO
+		TEST_ASSERT(copy.getTransferFunction(1, 1).getNumerator() == TransferFunction::ZERO.getNumerator());
+
+		// A packed arena can be used to rebuild the system
+		CoefficientArena arena = copy.getCoefficientArena();
+		arena.compact();
+		MIMOSystem rebuilt(copy.getNumOutputs(), copy.getNumInputs(), arena);
+		TEST_ASSERT(rebuilt.getTransferFunction(0, 0).getDenominator() == std::vector<double>({ 1, 2, 3, 4 }));
+		TEST_ASSERT(rebuilt.getTransferFunction(0, 1).getNumerator() == std::vector<double>({ 1, 2 }));
+
+		// Moved-from transfer functions are ZERO and keep a valid denominator
+		TransferFunction moved(std::move(tf_21));
+		TEST_ASSERT(moved.getDenominator() == std::vector<double>({ 1, 2, 5 }));
+		TEST_ASSERT(tf_21.getNumerator() == TransferFunction::ZERO.getNumerator());
+		TEST_ASSERT(tf_21.getDenominator() == TransferFunction::ZERO.getDenominator());
+		moved = std::move(tf_12);
+		TEST_ASSERT(moved.getNumerator() == std::vector<double>({ 2 }));
+		TEST_ASSERT(tf_12.getDenominator() == std::vector<double>({ 1 }));
+		TEST_ASSERT(tf_12.getNumerator() == std::vector<double>({ 0 }));
+	}
 
 
 };
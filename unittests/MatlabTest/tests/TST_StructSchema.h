@@ -0,0 +1,186 @@
+#pragma once
+
+#include "UnitTest.h"
+#include "MatlabAPI.h"
+
+struct TST_StructSchema_Point
+{
+	double x = 0;
+	double y = 0;
+};
+
+struct TST_StructSchema_Trace
+{
+	std::string name;
+	int32_t id = 0;
+	bool enabled = false;
+	std::vector<double> samples;
+	std::vector<std::string> tags;
+	TST_StructSchema_Point origin;
+	std::vector<TST_StructSchema_Point> markers;
+};
+
+MATLAB_API_STRUCT_SCHEMA(TST_StructSchema_Point, MATLAB_API_FIELD(x), MATLAB_API_FIELD(y));
+MATLAB_API_STRUCT_SCHEMA(TST_StructSchema_Trace,
+	MATLAB_API_FIELD_AS(name, "Name"),
+	MATLAB_API_FIELD(id),
+	MATLAB_API_FIELD(enabled),
+	MATLAB_API_FIELD(samples),
+	MATLAB_API_FIELD(tags),
+	MATLAB_API_FIELD(origin),
+	MATLAB_API_FIELD(markers));
+
+
+
+using namespace MatlabAPI;
+class TST_StructSchema : public UnitTest::Test
+{
+	TEST_CLASS(TST_StructSchema)
+public:
+	TST_StructSchema()
+		: Test("TST_StructSchema")
+	{
+		ADD_TEST(TST_StructSchema::fieldAccess);
+		ADD_TEST(TST_StructSchema::roundTrip);
+		ADD_TEST(TST_StructSchema::structArray);
+		ADD_TEST(TST_StructSchema::errors);
+
+	}
+
+private:
+	// Tests
+	TEST_FUNCTION(fieldAccess)
+	{
+		TEST_START;
+
+		MatlabArray s = MatlabArray::createStruct("s", 1, 2, { "a", "b" });
+		TEST_ASSERT(s.isStruct() && s.getNumberOfElements() == 2 && s.getNumberOfFields() == 2);
+		TEST_ASSERT(s.getFieldNames() == std::vector<std::string>({ "a", "b" }));
+		TEST_ASSERT(s.getField("a", 1).isEmpty()); // not set yet
+
+		s.setField("a", MatlabArray("a", 3.0), 1);
+		s.setFields(0, { MatlabArray("a", 1.0), MatlabArray("b", std::string("text")) });
+		TEST_ASSERT(s.getField("a", 1).getScalar() == 3.0);
+		std::vector<MatlabArray> fields = s.getFields(0);
+		TEST_ASSERT(fields.size() == 2 && fields[0].getScalar() == 1.0 && fields[1].getString() == "text");
+
+		// Names resolved once for all elements
+		std::vector<std::string> names = s.getFieldNames();
+		s.setFields(1, { MatlabArray("a", 3.0), MatlabArray("b", 2.0) }, names);
+		fields = s.getFields(1, names);
+		TEST_ASSERT(fields.size() == 2 && fields[0].getScalar() == 3.0 && fields[1].getScalar() == 2.0);
+		TEST_ASSERT(fields[1].getName() == "s_b_1");
+
+		// Copies share the data until one of them is modified
+		MatlabArray copy(s);
+		copy.setField("a", MatlabArray("a", 4.0), 1);
+		TEST_ASSERT(s.getField("a", 1).getScalar() == 3.0);
+		TEST_ASSERT(copy.getField("a", 1).getScalar() == 4.0);
+
+		// Fields and cells are values, writing to them does not change the struct or its copies
+		MatlabArray field = copy.getField("a", 1);
+		field.view<double>()[0] = 5.0;
+		TEST_ASSERT(copy.getField("a", 1).getScalar() == 4.0 && s.getField("a", 1).getScalar() == 3.0);
+		MatlabArray cell = MatlabArray::createCell("c", 1, 1);
+		cell.setCell(0, MatlabArray("x", 1.0));
+		MatlabArray cellCopy(cell);
+		MatlabArray element = cellCopy.getCell(0);
+		element.view<double>()[0] = 2.0;
+		TEST_ASSERT(cell.getCell(0).getScalar() == 1.0 && cellCopy.getCell(0).getScalar() == 1.0);
+	}
+
+	TEST_FUNCTION(roundTrip)
+	{
+		TEST_START;
+
+		TST_StructSchema_Trace trace;
+		trace.name = "trace";
+		trace.id = -7;
+		trace.enabled = true;
+		trace.samples = { 1.5, 2.5, 3.5 };
+		trace.tags = { "raw", "filtered" };
+		trace.origin = { 1, 2 };
+		trace.markers = { { 3, 4 }, { 5, 6 } };
+
+		MatlabArray array = StructMarshaller::toStruct("trace", trace);
+		TEST_ASSERT(array.getFieldNames() == StructMarshaller::getFieldNames<TST_StructSchema_Trace>());
+		TEST_ASSERT(array.getField("Name").getString() == "trace");
+		TEST_ASSERT(array.getField("id").isInt32());
+		TEST_ASSERT(array.getField("enabled").isLogical());
+		TEST_ASSERT(array.getField("samples").getM() == 3);
+		TEST_ASSERT(array.getField("markers").getN() == 2);
+
+		TST_StructSchema_Trace back = StructMarshaller::fromStruct<TST_StructSchema_Trace>(array);
+		TEST_ASSERT(back.name == trace.name && back.id == trace.id && back.enabled == trace.enabled);
+		TEST_ASSERT(back.samples == trace.samples && back.tags == trace.tags);
+		TEST_ASSERT(back.origin.x == 1 && back.origin.y == 2);
+		TEST_ASSERT(back.markers.size() == 2 && back.markers[1].x == 5 && back.markers[1].y == 6);
+
+		// Numeric fields of another class are converted, extra fields are ignored
+		MatlabArray other = MatlabArray::createStruct("p", 1, 1, { "z", "y", "x" });
+		ArrayBuffer<int16_t> y = MatlabArray::createBuffer<int16_t>(1);
+		y.data()[0] = 9;
+		other.setFields(0, { MatlabArray("z", 0.0), MatlabArray("y", std::move(y), { 1, 1 }), MatlabArray("x", 8.0) });
+		TST_StructSchema_Point point = StructMarshaller::fromStruct<TST_StructSchema_Point>(other);
+		TEST_ASSERT(point.x == 8 && point.y == 9);
+	}
+
+	TEST_FUNCTION(structArray)
+	{
+		TEST_START;
+
+		std::vector<TST_StructSchema_Point> points;
+		for (size_t i = 0; i < 1000; ++i)
+			points.push_back({ (double)i, -(double)i });
+		MatlabArray array = StructMarshaller::toStructArray("points", points);
+		TEST_ASSERT(array.getM() == 1 && array.getN() == points.size());
+		TEST_ASSERT(array.getField("y", 10).getScalar() == -10.0);
+
+		std::vector<TST_StructSchema_Point> back = StructMarshaller::fromStructArray<TST_StructSchema_Point>(array);
+		bool equal = back.size() == points.size();
+		for (size_t i = 0; equal && i < points.size(); ++i)
+			equal = back[i].x == points[i].x && back[i].y == points[i].y;
+		TEST_ASSERT(equal);
+
+		TEST_ASSERT(StructMarshaller::fromStructArray<TST_StructSchema_Point>(
+			StructMarshaller::toStructArray("empty", std::vector<TST_StructSchema_Point>())).empty());
+	}
+
+	TEST_FUNCTION(errors)
+	{
+		TEST_START;
+
+		MatlabArray s = MatlabArray::createStruct("s", 1, 1, { "x" });
+		bool thrown = false;
+		try { s.getField("missing"); }
+		catch (const std::runtime_error&) { thrown = true; }
+		TEST_ASSERT(thrown);
+
+		thrown = false;
+		try { s.setField("x", MatlabArray("x", 1.0), 1); }
+		catch (const std::out_of_range&) { thrown = true; }
+		TEST_ASSERT(thrown);
+
+		thrown = false;
+		try { s.setFields(0, {}); }
+		catch (const std::invalid_argument&) { thrown = true; }
+		TEST_ASSERT(thrown);
+
+		thrown = false;
+		try { s.getFields(0, { "x", "y" }); }
+		catch (const std::invalid_argument&) { thrown = true; }
+		TEST_ASSERT(thrown);
+
+		thrown = false;
+		try { StructMarshaller::fromStruct<TST_StructSchema_Point>(s); } // no field y
+		catch (const std::runtime_error&) { thrown = true; }
+		TEST_ASSERT(thrown);
+
+		thrown = false;
+		try { MatlabArray("d", 1.0).getFieldNames(); }
+		catch (const std::runtime_error&) { thrown = true; }
+		TEST_ASSERT(thrown);
+	}
+};
+
+TEST_INSTANTIATE(TST_StructSchema);
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "UnitTest.h"
+#include "MatlabAPI.h"
+
+
+
+using namespace MatlabAPI;
+class TST_Utf : public UnitTest::Test
+{
+	TEST_CLASS(TST_Utf)
+public:
+	TST_Utf()
+		: Test("TST_Utf")
+	{
+		ADD_TEST(TST_Utf::ascii);
+		ADD_TEST(TST_Utf::multiByte);
+		ADD_TEST(TST_Utf::invalid);
+		ADD_TEST(TST_Utf::nameCache);
+
+	}
+
+private:
+
+	// Tests
+	TEST_FUNCTION(ascii)
+	{
+		TEST_START;
+
+		// Lengths around the 16 and 32 character blocks of the fast path
+		for (size_t length : { 0, 1, 15, 16, 17, 31, 32, 33, 100 })
+		{
+			std::string utf8;
+			std::u16string utf16;
+			for (size_t i = 0; i < length; ++i)
+			{
+				utf8 += static_cast<char>(' ' + i % 95);
+				utf16 += static_cast<char16_t>(' ' + i % 95);
+			}
+			TEST_ASSERT(Utf::toUtf16(utf8) == utf16);
+			TEST_ASSERT(Utf::toUtf8(utf16) == utf8);
+		}
+		TEST_ASSERT(Utf::toUtf16(static_cast<const char*>(nullptr)).empty());
+	}
+
+	TEST_FUNCTION(multiByte)
+	{
+		TEST_START;
+
+		// 2, 3 and 4 byte sequences at every position relative to a block boundary
+		const std::string special = "\xC3\xA4\xE2\x82\xAC\xF0\x9F\x98\x80"; // U+00E4 U+20AC U+1F600
+		const std::u16string specialUtf16 = { 0x00E4, 0x20AC, 0xD83D, 0xDE00 };
+		for (size_t prefix = 0; prefix < 40; ++prefix)
+		{
+			std::string utf8 = std::string(prefix, 'a') + special + std::string(20, 'b');
+			std::u16string utf16 = std::u16string(prefix, u'a') + specialUtf16 + std::u16string(20, u'b');
+			TEST_ASSERT(Utf::toUtf16(utf8) == utf16);
+			TEST_ASSERT(Utf::toUtf8(utf16) == utf8);
+		}
+	}
+
+	TEST_FUNCTION(invalid)
+	{
+		TEST_START;
+
+		// Truncated sequence, overlong encoding, encoded surrogate, stray continuation byte
+		TEST_ASSERT(Utf::toUtf16("a\xE2\x82") == std::u16string({ u'a', 0xFFFD, 0xFFFD }));
+		TEST_ASSERT(Utf::toUtf16("\xC0\xAF") == std::u16string({ 0xFFFD, 0xFFFD }));
+		TEST_ASSERT(Utf::toUtf16("\xED\xA0\x80") == std::u16string({ 0xFFFD, 0xFFFD, 0xFFFD }));
+		TEST_ASSERT(Utf::toUtf16("\x80z") == std::u16string({ 0xFFFD, u'z' }));
+
+		// Unpaired surrogates
+		TEST_ASSERT(Utf::toUtf8(std::u16string({ 0xD83D, u'x' })) == "\xEF\xBF\xBDx");
+		TEST_ASSERT(Utf::toUtf8(std::u16string({ 0xDE00 })) == "\xEF\xBF\xBD");
+	}
+
+	TEST_FUNCTION(nameCache)
+	{
+		TEST_START;
+
+		const std::u16string& first = Utf::toUtf16Name("Ad");
+		const std::u16string& second = Utf::toUtf16Name("Ad");
+		TEST_ASSERT(first == u"Ad");
+		TEST_ASSERT(&first == &second);
+		TEST_ASSERT(Utf::getInternedNameCount() >= 1);
+
+		// Not a valid MATLAB name, converted but not cached
+		std::string longName(Utf::maxInternedNameLength + 1, 'x');
+		size_t count = Utf::getInternedNameCount();
+		TEST_ASSERT(Utf::toUtf16Name(longName) == Utf::toUtf16(longName));
+		TEST_ASSERT(Utf::getInternedNameCount() == count);
+	}
+};
+
+TEST_INSTANTIATE(TST_Utf);